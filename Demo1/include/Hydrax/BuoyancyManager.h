@@ -0,0 +1,355 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef _Hydrax_BuoyancyManager_H_
+#define _Hydrax_BuoyancyManager_H_
+
+#include "Prerequisites.h"
+
+#include "ThreadPool.h"
+
+namespace Hydrax
+{
+	class Hydrax;
+
+	/** Floating body, a set of sample points which are sampled against 
+	    the water surface each frame by the buoyancy manager.
+	 */
+	class DllExport FloatingBody
+	{
+	public:
+		/** Constructor
+		    @param SamplePoints Sample points in body local-space
+			@param Id Body Id
+		 */
+		FloatingBody(const std::vector<Ogre::Vector3> &SamplePoints, const int& Id);
+
+		/** Destructor
+		 */
+		~FloatingBody();
+
+		/** Set the body transform, call it before Hydrax::update(...) 
+		    @param Position World-space position
+			@param Orientation World-space orientation
+		 */
+		void setTransform(const Ogre::Vector3 &Position, const Ogre::Quaternion &Orientation);
+
+		/** Enable/Disable the body sampling
+		    @param Enable true for enable it, false for disable it
+		 */
+		inline void setEnabled(const bool &Enable)
+		{
+			mEnabled = Enable;
+		}
+
+		/** Is the body sampling enabled?
+		    @return true if yes, false if not
+		 */
+		inline const bool& isEnabled() const
+		{
+			return mEnabled;
+		}
+
+		/** Get the body Id
+		    @return Body Id
+		 */
+		inline const int& getId() const
+		{
+			return mId;
+		}
+
+		/** Get body position
+		    @return World-space position
+		 */
+		inline const Ogre::Vector3& getPosition() const
+		{
+			return mPosition;
+		}
+
+		/** Get body orientation
+		    @return World-space orientation
+		 */
+		inline const Ogre::Quaternion& getOrientation() const
+		{
+			return mOrientation;
+		}
+
+		/** Get the number of sample points
+		    @return Number of sample points
+		 */
+		inline int getNumberOfSamples() const
+		{
+			return static_cast<int>(mSamplePoints.size());
+		}
+
+		/** Get the sample points
+		    @return Sample points in body local-space
+		 */
+		inline const std::vector<Ogre::Vector3>& getSamplePoints() const
+		{
+			return mSamplePoints;
+		}
+
+		/** Get the world-space sample points of the last update
+		    @return World-space sample points
+		 */
+		inline const std::vector<Ogre::Vector3>& getWorldSamplePoints() const
+		{
+			return mWorldSamplePoints;
+		}
+
+		/** Get the water heigths at the sample points, computed in the last update
+		    @return Heigths in y-World coordinates
+		 */
+		inline const std::vector<float>& getHeigths() const
+		{
+			return mHeigths;
+		}
+
+		/** Get the water surface normals at the sample points, computed in the last update
+		    @return Surface normals
+		 */
+		inline const std::vector<Ogre::Vector3>& getNormals() const
+		{
+			return mNormals;
+		}
+
+		/** Get the water surface vertical velocities at the sample points, computed in the last update
+		    @return Surface vertical velocities (dh/dt), 0 if there isn't a previous frame sample
+		 */
+		inline const std::vector<float>& getVelocities() const
+		{
+			return mVelocities;
+		}
+
+	private:
+		/// Body Id
+		int mId;
+		/// Is the body sampling enabled?
+		bool mEnabled;
+
+		/// World-space position
+		Ogre::Vector3 mPosition;
+		/// World-space orientation
+		Ogre::Quaternion mOrientation;
+
+		/// Local-space sample points
+		std::vector<Ogre::Vector3> mSamplePoints;
+		/// World-space sample points
+		std::vector<Ogre::Vector3> mWorldSamplePoints;
+
+		/// Water heigths
+		std::vector<float> mHeigths;
+		/// Water surface normals
+		std::vector<Ogre::Vector3> mNormals;
+		/// Water surface vertical velocities
+		std::vector<float> mVelocities;
+
+		/// Tile of each sample point
+		std::vector<int> mSampleTiles;
+		/// Sample point coords inside its tile, in cells
+		std::vector<Ogre::Vector2> mSampleCoords;
+
+		friend class BuoyancyManager;
+	};
+
+	/** Buoyancy manager class. Register floating bodies (boats, debris, ...) and read 
+	    the water heigths, normals and velocities at their sample points after Hydrax::update(...)
+		@remarks The water is sampled in tiles of TileCells x TileCells cells of CellSize world 
+		         units, which are shared by all the bodies over them and evaluated with batched 
+				 heigth queries, in parallel if Hydrax has worker threads. Sample points are 
+				 bilinear interpolated from the tile nodes, so CellSize must be small compared 
+				 with the wave length. Tiles of the last frame are kept for the velocities.
+	 */
+	class DllExport BuoyancyManager
+	{
+	public:
+		/** Constructor
+		    @param h Hydrax parent pointer
+		 */
+		BuoyancyManager(Hydrax *h);
+
+		/** Destructor
+		 */
+		~BuoyancyManager();
+
+		/** Update the bodies samples
+		    @param timeSinceLastFrame Time since last frame
+		    @remarks Called by Hydrax::update(...) after the module/noise update
+		 */
+		void update(const Ogre::Real &timeSinceLastFrame);
+
+		/** Add a floating body
+		    @param SamplePoints Sample points in body local-space
+			@return Hydrax::FloatingBody*, set its transform each frame
+		 */
+		FloatingBody* add(const std::vector<Ogre::Vector3> &SamplePoints);
+
+		/** Get a floating body
+		    @param Id Body Id
+			@return Hydrax::FloatingBody*, NULL if it doesn't exist
+		 */
+		FloatingBody* get(const int& Id);
+
+		/** Remove a floating body
+		    @param Id Body Id
+		 */
+		void remove(const int& Id);
+
+		/** Remove all floating bodies
+		 */
+		void removeAll();
+
+		/** Get floating bodies std::vector
+		    @return std::vector<FloatingBody*> list
+		 */
+		inline const std::vector<FloatingBody*>& getBodies() const
+		{
+			return mBodies;
+		}
+
+		/** Set the sampling tile options
+		    @param CellSize Distance between tile nodes, in world units
+			@param TileCells Number of cells per tile side, in [1, 32] range
+		 */
+		void setTileOptions(const Ogre::Real &CellSize, const int &TileCells);
+
+		/** Get the distance between tile nodes
+		    @return Cell size in world units
+		 */
+		inline const Ogre::Real& getCellSize() const
+		{
+			return mCellSize;
+		}
+
+		/** Get the number of cells per tile side
+		    @return Number of cells per tile side
+		 */
+		inline const int& getTileCells() const
+		{
+			return mTileCells;
+		}
+
+		/** Get the number of tiles evaluated in the last update
+		    @return Number of tiles
+		 */
+		inline int getNumberOfTiles() const
+		{
+			return static_cast<int>(mTiles.size());
+		}
+
+		/** Discard the cached tiles, velocities will be 0 in the next update
+		    @remarks Use it when the water module changes
+		 */
+		void _resetTiles();
+
+	private:
+		/// Tile x/z coords, in tiles
+		typedef std::pair<int, int> TileCoords;
+		/// Tile coords -> tile index map
+		typedef std::map<TileCoords, int> TileIndexMap;
+
+		/** Tiles evaluation task
+		 */
+		class TilesTask : public ThreadPool::ParallelTask
+		{
+		public:
+			/// BuoyancyManager pointer
+			BuoyancyManager *mBuoyancyManager;
+			/// Number of chunks
+			int mNumberOfChunks;
+
+			/** Evaluate a chunk of tiles
+			    @param Chunk Chunk index
+			 */
+			void execute(const int& Chunk)
+			{
+				const int Tiles = static_cast<int>(mBuoyancyManager->mTiles.size());
+
+				mBuoyancyManager->_evaluateTiles(Tiles*Chunk/mNumberOfChunks, Tiles*(Chunk+1)/mNumberOfChunks);
+			}
+		};
+
+		friend class TilesTask;
+
+		/** Get the tile which contains a world-space point, and the point coords inside the tile
+		    @param x World x
+			@param z World z
+			@param TileX Tile x coord (Output)
+			@param TileZ Tile z coord (Output)
+			@param u Point x coord inside the tile, in cells (Output)
+			@param v Point z coord inside the tile, in cells (Output)
+		 */
+		void _getTileCoords(const float &x, const float &z, int &TileX, int &TileZ, float &u, float &v) const;
+
+		/** Evaluate the heigths of a range of tiles
+		    @param First First tile
+			@param Last Last tile (Not included)
+			@remarks Tiles are independent, so ranges can be evaluated in parallel
+		 */
+		void _evaluateTiles(const int &First, const int &Last);
+
+		/** Bilinear interpolate a tile
+		    @param Heigths Tile node heigths
+			@param u Point x coord inside the tile, in cells
+			@param v Point z coord inside the tile, in cells
+			@param dhdu Heigth derivative along x, per cell (Output, can be 0)
+			@param dhdv Heigth derivative along z, per cell (Output, can be 0)
+			@return Interpolated heigth
+		 */
+		float _interpolate(const float *Heigths, const float &u, const float &v, float *dhdu = 0, float *dhdv = 0) const;
+
+		/// Floating bodies std::vector
+		std::vector<FloatingBody*> mBodies;
+		/// Next Id
+		int mNextId;
+
+		/// Distance between tile nodes
+		Ogre::Real mCellSize;
+		/// Number of cells per tile side
+		int mTileCells;
+
+		/// Number of nodes per tile, (TileCells+1)^2
+		int mTileNodes;
+
+		/// Current frame tiles
+		std::vector<TileCoords> mTiles;
+		/// Current frame tile index
+		TileIndexMap mTileIndex;
+		/// Current frame tile node heigths, mTileNodes per tile
+		std::vector<float> mTileHeigths;
+		/// Last frame tile index
+		TileIndexMap mLastTileIndex;
+		/// Last frame tile node heigths
+		std::vector<float> mLastTileHeigths;
+
+		/// Tiles evaluation task
+		TilesTask mTilesTask;
+
+		/// Hydrax parent pointer
+		Hydrax *mHydrax;
+	};
+}
+
+#endif
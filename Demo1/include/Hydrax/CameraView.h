@@ -0,0 +1,168 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef _Hydrax_CameraView_H_
+#define _Hydrax_CameraView_H_
+
+#include "Prerequisites.h"
+
+#include "Mesh.h"
+#include "Modules/Module.h"
+
+namespace Hydrax
+{
+	class Hydrax;
+
+	/** Per-camera water state, for split-screen and multi-viewport rendering.
+	    Each camera view has its own module (grid buffers, projection, last camera state, ...) 
+		and mesh, which is only rendered in the view viewport, while the noise is shared with 
+		the main water module and evaluated once per frame.
+		@remarks Add it with Hydrax::addCamera(...).
+		         RTTs and underwater effects are only rendered for the main Hydrax camera, 
+				 the water bodies and the far field too.
+	 */
+	class DllExport CameraView
+	{
+	public:
+		/** Constructor
+		    @param h Hydrax parent pointer
+			@param c Camera
+			@param v Viewport where the camera is rendered
+		 */
+		CameraView(Hydrax *h, Ogre::Camera *c, Ogre::Viewport *v);
+
+		/** Destructor
+		 */
+		~CameraView();
+
+		/** Set the camera view module
+		    @param Module Module with the main water module normal mode (usually of the same type), 
+			       built with the main module noise for share it
+			@param DeleteOldModule Delete the old module
+			@return false if the module isn't compatible
+			@remarks The main water module must be set before. NM_RTT modules aren't supported.
+		 */
+		bool setModule(Module::Module* Module, const bool& DeleteOldModule = true);
+
+		/** Create the camera view geometry
+		    @remarks Called by Hydrax::create(), only needed if the view has been added after it
+		 */
+		void create();
+
+		/** Remove the camera view geometry
+		 */
+		void remove();
+
+		/** Call it each frame
+		    @param timeSinceLastFrame Time since last frame(delta)
+			@remarks Called by Hydrax::update(...)
+		 */
+		void update(const Ogre::Real &timeSinceLastFrame);
+
+		/** Update the mesh visibility from the Hydrax visibility
+		 */
+		void _checkVisible();
+
+		/** Get the camera
+		    @return Camera
+		 */
+		inline Ogre::Camera* getCamera()
+		{
+			return mCamera;
+		}
+
+		/** Get the viewport
+		    @return Viewport
+		 */
+		inline Ogre::Viewport* getViewport()
+		{
+			return mViewport;
+		}
+
+		/** Is the camera view created?
+		    @return true if yes, false if not
+		 */
+		inline const bool& isCreated() const
+		{
+			return mCreated;
+		}
+
+		/** Get the camera view module
+		    @return Module, NULL if it isn't set
+		 */
+		inline Module::Module* getModule()
+		{
+			return mModule;
+		}
+
+		/** Get the camera view mesh
+		    @return Hydrax::Mesh pointer
+		 */
+		inline Mesh* getMesh()
+		{
+			return mMesh;
+		}
+
+	private:
+		/** Viewport listener, shows the camera view mesh instead of the main 
+		    water mesh while the view viewport is rendered
+		 */
+		class DllExport ViewportListener : public Ogre::RenderTargetListener
+		{
+		public:
+			/// Camera view pointer
+			CameraView *mCameraView;
+
+			/** Called before a viewport is updated
+			    @param evt Ogre::RenderTargetViewportEvent
+			 */
+			void preViewportUpdate(const Ogre::RenderTargetViewportEvent& evt);
+
+			/** Called after a viewport is updated
+			    @param evt Ogre::RenderTargetViewportEvent
+			 */
+			void postViewportUpdate(const Ogre::RenderTargetViewportEvent& evt);
+		};
+
+		/// Camera
+		Ogre::Camera *mCamera;
+		/// Viewport
+		Ogre::Viewport *mViewport;
+		/// Is the camera view created?
+		bool mCreated;
+
+		/// Viewport listener
+		ViewportListener mViewportListener;
+
+		/// Our Hydrax::Mesh pointer
+		Mesh *mMesh;
+		/// Our Hydrax::Module::Module pointer
+		Module::Module *mModule;
+
+		/// Hydrax parent pointer
+		Hydrax *mHydrax;
+	};
+}
+
+#endif
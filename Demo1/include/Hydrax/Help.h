@@ -91,6 +91,27 @@ namespace Hydrax
         }
     };
 
+	/** Water surface sample, see Hydrax::getSurfaceSample(...)
+	 */
+	struct DllExport SurfaceSample
+	{
+		/// Heigth in y-World coordinates
+		float Heigth;
+		/// Surface normal
+		Ogre::Vector3 Normal;
+		/// Surface vertical velocity, d(Heigth)/dt
+		float Velocity;
+
+		/** Default constructor, flat and still surface at y = 0
+		 */
+		SurfaceSample()
+			: Heigth(0)
+			, Normal(Ogre::Vector3::UNIT_Y)
+			, Velocity(0)
+		{
+		}
+	};
+
 	/** Math class with some help funtions
 	 */
 	class Math
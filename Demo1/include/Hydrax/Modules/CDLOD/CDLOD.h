@@ -0,0 +1,303 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef _Hydrax_Modules_CDLOD_H_
+#define _Hydrax_Modules_CDLOD_H_
+
+#include "../../Prerequisites.h"
+
+#include "../../Hydrax.h"
+#include "../../Mesh.h"
+#include "../Module.h"
+
+namespace Hydrax{ namespace Module
+{
+	/** Hydrax CDLOD (Continuous distance-dependent level of detail) module
+	    A quadtree over a square world is traversed each frame, the selected nodes are 
+		drawn with the same grid patch and odd vertices are morphed towards the next level 
+		(coarser) positions, so levels blend without popping or cracks.
+		The cost depends on the number of selected nodes, which grows with the log of the world size.
+		@remarks The water mesh can't be rotated (Hydrax::rotate(...))
+	 */
+	class DllExport CDLOD : public Module
+	{
+	public:
+		/** Struct wich contains Hydrax CDLOD module options
+		 */
+		struct Options
+		{
+			/// World size (X/Z), the quadtree root node size
+			float WorldSize;
+			/// Number of quads per patch side, must be a power of two
+			int PatchComplexity;
+			/// Number of levels of detail (quadtree depth)
+			int LODLevels;
+			/// Range of the most detailed level, each level doubles it.
+			/// It must be at least twice the size of the most detailed nodes (WorldSize/2^(LODLevels-1))
+			float LODDistance;
+			/// Part [0,1] of each level range used for morphing to the next level
+			float MorphRatio;
+			/// Max number of selected nodes, vertex and index buffers are allocated for them
+			int MaxNodes;
+			/// Water strength
+			float Strength;
+
+			/** Default constructor
+			 */
+			Options()
+				: WorldSize(16384)
+				, PatchComplexity(32)
+				, LODLevels(8)
+				, LODDistance(512)
+				, MorphRatio(0.3f)
+				, MaxNodes(256)
+				, Strength(32.5f)
+			{
+			}
+
+			/** Constructor
+			    @param _WorldSize World size
+				@param _PatchComplexity Number of quads per patch side
+				@param _LODLevels Number of levels of detail
+				@param _LODDistance Range of the most detailed level
+			 */
+			Options(const float &_WorldSize,
+				    const int   &_PatchComplexity,
+					const int   &_LODLevels,
+					const float &_LODDistance)
+				: WorldSize(_WorldSize)
+				, PatchComplexity(_PatchComplexity)
+				, LODLevels(_LODLevels)
+				, LODDistance(_LODDistance)
+				, MorphRatio(0.3f)
+				, MaxNodes(256)
+				, Strength(32.5f)
+			{
+			}
+
+			/** Constructor
+			    @param _WorldSize World size
+				@param _PatchComplexity Number of quads per patch side
+				@param _LODLevels Number of levels of detail
+				@param _LODDistance Range of the most detailed level
+				@param _MorphRatio Part of each level range used for morphing
+				@param _MaxNodes Max number of selected nodes
+				@param _Strength Water strength
+			 */
+			Options(const float &_WorldSize,
+				    const int   &_PatchComplexity,
+					const int   &_LODLevels,
+					const float &_LODDistance,
+					const float &_MorphRatio,
+					const int   &_MaxNodes,
+					const float &_Strength)
+				: WorldSize(_WorldSize)
+				, PatchComplexity(_PatchComplexity)
+				, LODLevels(_LODLevels)
+				, LODDistance(_LODDistance)
+				, MorphRatio(_MorphRatio)
+				, MaxNodes(_MaxNodes)
+				, Strength(_Strength)
+			{
+			}
+		};
+
+		/** Constructor
+		    @param h Hydrax manager pointer
+			@param n Hydrax noise module
+			@param NormalMode Switch between MaterialManager::NM_VERTEX and Materialmanager::NM_RTT
+		 */
+		CDLOD(Hydrax *h, Noise::Noise *n, const MaterialManager::NormalMode& NormalMode);
+
+		/** Constructor
+		    @param h Hydrax manager pointer
+			@param n Hydrax noise module
+			@param NormalMode Switch between MaterialManager::NM_VERTEX and Materialmanager::NM_RTT
+			@param Options CDLOD options
+		 */
+		CDLOD(Hydrax *h, Noise::Noise *n, const MaterialManager::NormalMode& NormalMode, const Options &Options);
+
+		/** Destructor
+		 */
+        ~CDLOD();
+
+		/** Create
+		 */
+		void create();
+
+		/** Remove
+		 */
+		void remove();
+
+		/** Call it each frame
+		    @param timeSinceLastFrame Time since last frame(delta)
+		 */
+		void update(const Ogre::Real &timeSinceLastFrame);
+
+		/** Set options
+		    @param Options Options
+		 */
+		void setOptions(const Options &Options);
+
+		/** Save config
+		    @param Data String reference 
+		 */
+		void saveCfg(Ogre::String &Data);
+
+		/** Load config
+		    @param CgfFile Ogre::ConfigFile reference 
+			@return True if is the correct module config
+		 */
+		bool loadCfg(Ogre::ConfigFile &CfgFile);
+
+		/** Get the current heigth at a especified world-space point
+		    @param Position X/Z World position
+			@return Heigth at the given position in y-World coordinates, if it's outside of the water return -1
+		 */
+		float getHeigth(const Ogre::Vector2 &Position);
+
+		/** Get the current heigths at some world-space points
+		    @param Positions X/Z World positions
+			@param Heigths Heigths at the given positions in y-World coordinates (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+		 */
+		void getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid = 0);
+
+		/** Get the current surface samples (heigth, normal and vertical velocity) at some world-space points
+		    @param Positions X/Z World positions
+			@param Samples Surface samples (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+		 */
+		void getSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, bool *Valid = 0);
+
+		/** Get the bounds of the current water surface
+		    @param MaxDisplacement Maximum y displacement from the water position (Output)
+			@param MaxSlope Maximum surface slope (Output)
+			@return false if the noise can't bound its values
+		 */
+		bool getSurfaceBounds(float &MaxDisplacement, float &MaxSlope);
+
+		/** Create an immutable snapshot of the current water state
+		    @return New water state, or 0 if the noise doesn't support snapshots
+		 */
+		WaterState* _createWaterState();
+
+		/** Get current options
+		    @return Current options
+		 */
+		inline const Options& getOptions() const
+		{
+			return mOptions;
+		}
+
+		/** Create geometry in module(If special geometry is needed)
+		    @param mMesh Mesh
+			@return false if it must be create by default Mesh::_createGeometry() fnc.
+		 */
+		const bool _createGeometry(Mesh *mMesh) const;
+
+		/** Get the number of nodes selected in the last frame
+		    @return Number of drawn patches
+		 */
+		inline int getNumberOfSelectedNodes() const
+		{
+			return static_cast<int>(mSelectedNodes.size());
+		}
+
+	private:
+		/** Selected quadtree node
+		 */
+		struct SelectedNode
+		{
+			/// Object-space x/z position of the node corner
+			float x, z;
+			/// Node size
+			float Size;
+			/// Level of detail (0 = most detailed)
+			int Level;
+		};
+
+		/** Calcule the level ranges and morph constants
+		 */
+		void _calculeRanges();
+
+		/** Get the world-space bounding box of a node
+		    @param x Object-space x position of the node corner
+			@param z Object-space z position of the node corner
+			@param Size Node size
+			@return World-space bounding box
+		 */
+		Ogre::AxisAlignedBox _getNodeBox(const float &x, const float &z, const float &Size) const;
+
+		/** Select the nodes to draw of a quadtree node
+		    @param x Object-space x position of the node corner
+			@param z Object-space z position of the node corner
+			@param Size Node size
+			@param Level Node level
+			@return false if the node is out of its level range, the parent must draw the area
+		 */
+		bool _selectNode(const float &x, const float &z, const float &Size, const int &Level);
+
+		/** Add a node to the selection
+		    @param x Object-space x position of the node corner
+			@param z Object-space z position of the node corner
+			@param Size Node size
+			@param Level Node level
+		 */
+		void _addNode(const float &x, const float &z, const float &Size, const int &Level);
+
+		/** Update the patch vertices of a selected node
+		    @param Node Selected node index
+		 */
+		void _updateNode(const int &Node);
+
+		/// Vertex pointer (Mesh::POS_NORM_VERTEX or Mesh::POS_VERTEX)
+		void *mVertices;
+		/// Number of vertices per patch
+		int mPatchVertices;
+
+		/// Morphed x/z positions and heights of the current patch (batch noise sampling)
+		float *mPatchX, *mPatchZ, *mPatchHeights;
+
+		/// Range per level
+		std::vector<float> mRanges;
+		/// Morph start distance and 1/(morph end - morph start) per level
+		std::vector<float> mMorphStart, mMorphScale;
+
+		/// Selected nodes in the current frame
+		std::vector<SelectedNode> mSelectedNodes;
+
+		/// World-space position of the object-space origin
+		Ogre::Vector3 mOrigin;
+		/// Camera position in the current frame
+		Ogre::Vector3 mCameraPosition;
+
+		/// Our CDLOD options
+		Options mOptions;
+	};
+}}
+
+#endif
@@ -44,6 +44,9 @@ namespace Hydrax{ namespace Module
 		{
 			/// Projected grid complexity (N*N)
 			int Complexity;
+			/// Max grid complexity, vertex arrays and buffers are allocated for it so
+			/// Complexity can be changed at runtime without reallocations (0 = Complexity)
+			int MaxComplexity;
 			/// Size
 			Size MeshSize;
 			/// Strength
@@ -54,16 +57,24 @@ namespace Hydrax{ namespace Module
 			bool ChoppyWaves;
 			/// Choppy waves strength
 			float ChoppyStrength;
+			/// Number of tiles per side (0 = not tiled), (Complexity-1)/Tiles must be a power of two.
+			/// Only the tiles inside of the camera frustum are updated and drawn
+			int Tiles;
+			/// Distance between tile levels of detail, each level halves the tile resolution (0 = no LOD)
+			float TileLODDistance;
 
 			/** Default constructor
 			 */
 			Options()
 				: Complexity(256)
+				, MaxComplexity(0)
 				, MeshSize(Size(100))
 				, Strength(32.5f)
 				, Smooth(false)
 				, ChoppyWaves(true)
 				, ChoppyStrength(0.065f)
+				, Tiles(0)
+				, TileLODDistance(0)
 			{
 			}
 
@@ -74,11 +85,14 @@ namespace Hydrax{ namespace Module
 			Options(const int &_Complexity, 
 				    const Size &_MeshSize)
 				: Complexity(_Complexity)
+				, MaxComplexity(0)
 				, MeshSize(_MeshSize)
 				, Strength(32.5f)
 				, Smooth(false)
 				, ChoppyWaves(true)
 				, ChoppyStrength(0.065f)
+				, Tiles(0)
+				, TileLODDistance(0)
 			{
 			}
 
@@ -97,11 +111,14 @@ namespace Hydrax{ namespace Module
 					const bool  &_ChoppyWaves,
 					const float &_ChoppyStrength)
 				: Complexity(_Complexity)
+				, MaxComplexity(0)
 				, MeshSize(_MeshSize)
 				, Strength(_Strength)
 				, Smooth(_Smooth)
 				, ChoppyWaves(_ChoppyWaves)
 				, ChoppyStrength(_ChoppyStrength)
+				, Tiles(0)
+				, TileLODDistance(0)
 			{
 			}
 		};
@@ -160,6 +177,34 @@ namespace Hydrax{ namespace Module
 		 */
 		float getHeigth(const Ogre::Vector2 &Position);
 
+		/** Get the current heigths at some world-space points
+		    @param Positions X/Z World positions
+			@param Heigths Heigths at the given positions in y-World coordinates (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+		 */
+		void getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid = 0);
+
+		/** Get the current surface samples (heigth, normal and vertical velocity) at some world-space points
+		    @param Positions X/Z World positions
+			@param Samples Surface samples (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+		 */
+		void getSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, bool *Valid = 0);
+
+		/** Get the bounds of the current water surface
+		    @param MaxDisplacement Maximum y displacement from the water position (Output)
+			@param MaxSlope Maximum surface slope (Output)
+			@return false if the noise can't bound its values
+		 */
+		bool getSurfaceBounds(float &MaxDisplacement, float &MaxSlope);
+
+		/** Create an immutable snapshot of the current water state
+		    @return New water state, or 0 if the noise doesn't support snapshots
+		 */
+		WaterState* _createWaterState();
+
 		/** Get current options
 		    @return Current options
 		 */
@@ -168,7 +213,46 @@ namespace Hydrax{ namespace Module
 			return mOptions;
 		}
 
+		/** Is the grid tiled?
+		    @return true if Options::Tiles is valid for the current complexity
+		 */
+		inline bool isTiled() const
+		{
+			return mTileQuads > 0;
+		}
+
+		/** Get the number of tiles updated and drawn in the last frame
+		    @return Number of visible tiles
+		 */
+		inline const int& getNumberOfVisibleTiles() const
+		{
+			return mNumberOfVisibleTiles;
+		}
+
 	private:
+		/** Update the world-space x/z vertex positions cache (NM_RTT only)
+		 */
+		void _updateWorldPositions();
+
+		/** Calcule the tile layout for the current options
+		 */
+		void _calculeTiles();
+
+		/** Tiled update: cull tiles, select levels of detail, update visible tiles and build indices
+		 */
+		void _updateTiles();
+
+		/** Update heights, normals and choppy displacement of a tile
+		    @param TileV Tile row
+			@param TileU Tile column
+			@param Step Vertex step of the tile level of detail
+		 */
+		void _updateTile(const int &TileV, const int &TileU, const int &Step);
+
+		/** Build the index data of the visible tiles, stitching edges between levels of detail
+		 */
+		void _buildTileIndices();
+
 		/** Calcule current normals
 		 */
 		void _calculeNormals();
@@ -183,11 +267,31 @@ namespace Hydrax{ namespace Module
 		/// Use it to store vertex positions when choppy displacement is enabled
 		Mesh::POS_NORM_VERTEX* mVerticesChoppyBuffer;
 
+		/// Allocated number of vertices (see Options::MaxComplexity)
+		int mVertexCapacity;
+
+		/// World-space x/z vertex positions and heights (NM_RTT only)
+		float *mWorldX, *mWorldZ, *mHeights;
+		/// Mesh transform revision of the world-space positions, 0 if they're invalid
+		unsigned int mWorldRevision;
+
+		/// Quads per tile side, 0 if the grid isn't tiled
+		int mTileQuads;
+		/// Max tile level of detail
+		int mMaxTileLOD;
+		/// Level of detail per tile in the current frame, -1 if the tile isn't visible
+		std::vector<int> mTileLOD;
+		/// Number of visible tiles in the current frame
+		int mNumberOfVisibleTiles;
+		/// Cached tile index patterns (vertex offsets from the tile first vertex) per level of detail and edge levels
+		std::map<int, std::vector<int> > mTilePatterns;
+		/// Index data of the visible tiles
+		std::vector<unsigned int> mTileIndices;
+		/// Gather buffer for batch noise sampling of a tile (x, z, heights)
+		std::vector<float> mTileScratch;
+
 		/// Our projected grid options
 		Options mOptions;
-
-		/// Our Hydrax pointer
-		Hydrax* mHydrax;
 	};
 }}
 
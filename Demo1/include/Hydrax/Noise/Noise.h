@@ -36,6 +36,32 @@ namespace Hydrax{ namespace Noise
 	class DllExport Noise
 	{
 	public:
+		/** Immutable copy of the noise state needed for get noise values, 
+		    it can be queried from any thread while the noise is being updated
+		 */
+		class DllExport Snapshot
+		{
+		public:
+			/** Destructor
+			 */
+			virtual ~Snapshot()
+			{
+			}
+
+			/** Get the noise values of an array of x/y coords: 
+			    Values[i] = noise(OffsetX + x[i], OffsetY + y[i])*Scale
+			    @param x X Coords
+			    @param y Y Coords
+			    @param n Number of coords
+			    @param Values Noise values (Output)
+			    @param OffsetX X offset added to all x coords
+			    @param OffsetY Y offset added to all y coords
+			    @param Scale Scale applied to all values
+			 */
+			virtual void getValues(const float *x, const float *y, const int &n, float *Values, 
+			                       const float &OffsetX = 0, const float &OffsetY = 0, const float &Scale = 1) const = 0;
+		};
+
 		/** Constructor
 		    @param Name Noise name
 			@param GPUNormalMapSupported Is GPU normal map generation supported?
@@ -70,6 +96,30 @@ namespace Hydrax{ namespace Noise
 		 */
 		virtual void update(const Ogre::Real &timeSinceLastFrame) = 0;
 
+		/** Advance the noise simulation, called each frame by the modules instead of update(...)
+		    @param timeSinceLastFrame Time since last frame(delta)
+			@remarks With a fixed time step (see setFixedTimeStep(...)) update(...) is only called when 
+			         the simulation time reaches the next step, and the noise values are interpolated 
+					 between the last two steps.
+		 */
+		void advance(const Ogre::Real &timeSinceLastFrame);
+
+		/** Set the fixed simulation time step
+		    @param TimeStep Time step in seconds (i.e. 1/30 for update the noise at 30 Hz), 0 for update 
+			       the noise each frame
+			@remarks Noise values lag one step behind the simulation time, so the water cost doesn't depend 
+			         on the frame rate. Ignored if the noise doesn't support interpolation.
+		 */
+		void setFixedTimeStep(const Ogre::Real &TimeStep);
+
+		/** Get the fixed simulation time step
+		    @return Time step in seconds, 0 if the noise is updated each frame
+		 */
+		inline const Ogre::Real& getFixedTimeStep() const
+		{
+			return mFixedTimeStep;
+		}
+
 		/** Save config
 		    @param Data String reference 
 		 */
@@ -120,7 +170,103 @@ namespace Hydrax{ namespace Noise
 		 */
 		virtual float getValue(const float &x, const float &y) = 0;
 
+		/** Get the noise values of an array of x/y coords: 
+		    Values[i] = getValue(OffsetX + x[i], OffsetY + y[i])*Scale
+		    @param x X Coords
+			@param y Y Coords
+			@param n Number of coords
+			@param Values Noise values (Output)
+			@param OffsetX X offset added to all x coords
+			@param OffsetY Y offset added to all y coords
+			@param Scale Scale applied to all values
+			@remarks Override it for avoid a virtual call per value, it must be safe to call it 
+			         from several threads at the same time (for different output arrays)
+		 */
+		virtual void getValues(const float *x, const float *y, const int &n, float *Values, 
+			                   const float &OffsetX = 0, const float &OffsetY = 0, const float &Scale = 1);
+
+		/** Get the noise values and derivatives of an array of x/y coords
+		    @param x X Coords
+			@param y Y Coords
+			@param n Number of coords
+			@param Values Noise values (Output)
+			@param dx Noise x derivatives, d value/dx (Output)
+			@param dy Noise y derivatives, d value/dy (Output)
+			@param dt Noise time derivatives, d value/dt per second (Output, can be 0)
+			@param OffsetX X offset added to all x coords
+			@param OffsetY Y offset added to all y coords
+			@param Scale Scale applied to all values and derivatives
+			@return false if time derivatives aren't supported or enabled (dt is filled with 0), 
+			        see setTimeDerivatives(...)
+			@remarks Override it for analytic derivatives, by default x/y derivatives are central 
+			         differences of getValues(...), 5 values per coord, and dt isn't supported.
+					 It must be thread-safe like getValues(...)
+		 */
+		virtual bool getValuesAndDerivatives(const float *x, const float *y, const int &n, float *Values, float *dx, float *dy, float *dt,
+			                                 const float &OffsetX = 0, const float &OffsetY = 0, const float &Scale = 1);
+
+		/** Enable/Disable the time derivatives calculation, see getValuesAndDerivatives(...)
+		    @param Enable true for calculate the time derivatives in each update
+			@remarks Not thread-safe: call it from the update thread, out of the noise queries
+		 */
+		inline virtual void setTimeDerivatives(const bool &Enable)
+		{
+		}
+
+		/** Are time derivatives calculated?
+		    @return true if yes, false if not
+		 */
+		inline virtual bool areTimeDerivativesEnabled() const
+		{
+			return false;
+		}
+
+		/** Get the bounds of the current noise values
+		    @param MaxValue Maximum absolute noise value (Output)
+			@param MaxSlope Maximum noise slope, |d value/d x| along any x/y direction (Output)
+			@return false if the noise can't bound its values
+			@remarks Used for clip and march rays against the water surface, see Hydrax::raycast(...)
+		 */
+		inline virtual bool getBounds(float &MaxValue, float &MaxSlope)
+		{
+			return false;
+		}
+
+		/** Create a snapshot of the current noise state
+		    @return New snapshot (The caller must delete it), 0 if the noise doesn't support snapshots
+			@remarks Called from the render thread, once per frame, when water state snapshots 
+			         are enabled (See Hydrax::setWaterStateSnapshots(...))
+		 */
+		inline virtual Snapshot* _createSnapshot() const
+		{
+			return 0;
+		}
+
 	protected:
+		/** Does the noise support interpolation between two states? See setFixedTimeStep(...)
+		    @return true if yes, false if not
+		 */
+		inline virtual bool _isInterpolationSupported() const
+		{
+			return false;
+		}
+
+		/** Store the current noise state as the newest interpolation state,
+		    the newest one becomes the oldest one
+		 */
+		inline virtual void _pushInterpolationState()
+		{
+		}
+
+		/** Set the current noise state from the two interpolation states
+		    @param Alpha Interpolation factor in [0,1), 0 = oldest state
+			@remarks Only called when a step has been simulated or Alpha has changed. GPU normal map 
+			         resources are updated by update(...) on simulation steps, not here.
+		 */
+		inline virtual void _interpolateState(const float &Alpha)
+		{
+		}
+
 		/// Module name
 		Ogre::String mName;
 		/// Has create() been already called?
@@ -130,6 +276,15 @@ namespace Hydrax{ namespace Noise
         bool mGPUNormalMapSupported;
 		/// Are GPU normal map resources created?
 		bool mGPUNormalMapResourcesCreated;
+
+		/// Fixed simulation time step, 0 if disabled
+		Ogre::Real mFixedTimeStep;
+		/// Simulation time elapsed since the last step
+		Ogre::Real mFixedTimeAccumulator;
+		/// Have the interpolation states been stored?
+		bool mInterpolationReady;
+		/// Last interpolation factor
+		float mInterpolationAlpha;
 	};
 }}
 
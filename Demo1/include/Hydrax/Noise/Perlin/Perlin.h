@@ -211,6 +211,64 @@ namespace Hydrax{ namespace Noise
 		 */
 		float getValue(const float &x, const float &y);
 
+		/** Get the noise values of an array of x/y coords
+		    @param x X Coords
+			@param y Y Coords
+			@param n Number of coords
+			@param Values Noise values (Output)
+			@param OffsetX X offset added to all x coords
+			@param OffsetY Y offset added to all y coords
+			@param Scale Scale applied to all values
+		 */
+		void getValues(const float *x, const float *y, const int &n, float *Values, 
+			           const float &OffsetX = 0, const float &OffsetY = 0, const float &Scale = 1);
+
+		/** Create a snapshot of the current noise state
+		    @return New snapshot (The caller must delete it)
+		 */
+		Snapshot* _createSnapshot() const;
+
+		/** Get the bounds of the current noise values
+		    @param MaxValue Maximum absolute noise value (Output)
+			@param MaxSlope Maximum noise slope (Output)
+			@return true
+			@remarks Computed from the current noise data, so it's a tight bound
+		 */
+		bool getBounds(float &MaxValue, float &MaxSlope);
+
+		/** Get the noise values and analytic derivatives of an array of x/y coords
+		    @param x X Coords
+			@param y Y Coords
+			@param n Number of coords
+			@param Values Noise values (Output)
+			@param dx Noise x derivatives (Output)
+			@param dy Noise y derivatives (Output)
+			@param dt Noise time derivatives, per second (Output, can be 0)
+			@param OffsetX X offset added to all x coords
+			@param OffsetY Y offset added to all y coords
+			@param Scale Scale applied to all values and derivatives
+			@return true
+			@remarks x/y derivatives come from the bilinear filtered packed octaves, at the cost of 
+			         one value. Time derivatives need a second set of packed octaves, built in 
+					 each update() when they're enabled, see setTimeDerivatives(...)
+		 */
+		bool getValuesAndDerivatives(const float *x, const float *y, const int &n, float *Values, float *dx, float *dy, float *dt,
+			                         const float &OffsetX = 0, const float &OffsetY = 0, const float &Scale = 1);
+
+		/** Enable/Disable the time derivatives calculation
+		    @param Enable true for calculate the time derivatives in each update
+			@remarks Not thread-safe: call it from the update thread, out of the noise queries
+		 */
+		void setTimeDerivatives(const bool &Enable);
+
+		/** Are time derivatives calculated?
+		    @return true if yes, false if not
+		 */
+		inline bool areTimeDerivativesEnabled() const
+		{
+			return mTimeDerivatives;
+		}
+
 		/** Set/Update perlin noise options
 		    @param Options Perlin noise options
 			@remarks If create() have been already called, Octaves option doesn't be updated.
@@ -225,27 +283,39 @@ namespace Hydrax{ namespace Noise
 			return mOptions;
 		}
 
+	protected:
+		/** Does the noise support interpolation between two states?
+		    @return true
+		 */
+		inline bool _isInterpolationSupported() const
+		{
+			return true;
+		}
+
+		/** Store the current packed octaves as the newest interpolation state
+		 */
+		void _pushInterpolationState();
+
+		/** Set the current packed octaves from the two interpolation states
+		    @param Alpha Interpolation factor in [0,1), 0 = oldest state
+		 */
+		void _interpolateState(const float &Alpha);
+
 	private:
 		/** Initialize noise
 		 */
 		void _initNoise();
 
 		/** Calcule noise
+		    @param TimeDerivative false for calcule the packed octaves (p_noise), true for 
+			       calcule their time derivatives (dp_noise)
 		 */
-		void _calculeNoise();
+		void _calculeNoise(const bool &TimeDerivative = false);
 
 		/** Update gpu normal map resources
 		 */
 		void _updateGPUNormalMapResources();
 
-		/** Read texel linear dual
-		    @param u u
-			@param v v
-			@param o Octave
-			@return int
-		 */
-	    int _readTexelLinearDual(const int &u, const int &v, const int &o);
-
 		/** Read texel linear
 		    @param u u
 			@param v v
@@ -254,24 +324,42 @@ namespace Hydrax{ namespace Noise
 		float _getHeigthDual(float u, float v);
 
 		/** Map sample
+		    @param Octaves Octaves source (o_noise or o_dnoise)
 		    @param u u
 			@param v v
 			@param level Level
 			@param octave Octave
 			@return Map sample
 		 */
-		int _mapSample(const int &u, const int &v, const int &upsamplepower, const int &octave);
+		int _mapSample(const int *Octaves, const int &u, const int &v, const int &upsamplepower, const int &octave);
 
 		/// Perlin noise variables
 		int noise[n_size_sq*noise_frames];
 		int o_noise[n_size_sq*max_octaves];
 		int p_noise[np_size_sq*(max_octaves>>(n_packsize-1))];	
-		int *r_noise;
 		float magnitude;
 
+		/// Time derivatives of o_noise/p_noise, scaled by 1/mTimeDerivativeScale
+		int o_dnoise[n_size_sq*max_octaves];
+		int dp_noise[np_size_sq*(max_octaves>>(n_packsize-1))];
+		/// Are the time derivatives calculated in each update?
+		bool mTimeDerivatives;
+		/// dp_noise -> d(noise)/d(time) scale
+		float mTimeDerivativeScale;
+
+		/// Oldest/newest interpolation states: p_noise, followed by dp_noise if time derivatives are calculated
+		std::vector<int> mInterpolationStates[2];
+
 		/// Elapsed time
 		double time;
 
+		/// Have the noise bounds to be recalculated?
+		bool mBoundsDirty;
+		/// Maximum absolute noise value
+		float mMaxValue;
+		/// Maximum noise slope
+		float mMaxSlope;
+
 		/// GPUNormalMapManager pointer
 		GPUNormalMapManager *mGPUNormalMapManager;
 
@@ -127,6 +127,11 @@ namespace Hydrax
 		 */
 		void removeAll();
 
+		/** Activate/Deactivate all the created RTTs
+		    @param Active true for render them, false for stop rendering them without releasing them
+		 */
+		void setActive(const bool& Active);
+
 		/** Get RTT texture name
 		    @param Rtt Rtt type
 		    @return Rtt texture name
@@ -0,0 +1,229 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef _Hydrax_TaskGraph_H_
+#define _Hydrax_TaskGraph_H_
+
+#include "Prerequisites.h"
+
+#include "ThreadPool.h"
+
+namespace Hydrax
+{
+	/** Task scheduler interface, implement it for run the Hydrax internal tasks 
+	    in your own job system (see Hydrax::setTaskScheduler(...))
+	 */
+	class DllExport TaskScheduler
+	{
+	public:
+		/** Destructor
+		 */
+		virtual ~TaskScheduler()
+		{
+		}
+
+		/** Schedule a task, it can be executed in any thread but only once
+		    @param t Task, it's alive until it's executed
+			@remarks If HYDRAX_THREAD_SUPPORT is 0, the task must be executed before 
+			         returning or from help()
+		 */
+		virtual void schedule(ThreadPool::Task* t) = 0;
+
+		/** Called while a thread is waiting for scheduled tasks, execute one of them here 
+		    if the waiting thread can help your worker threads
+		    @return true if a task has been executed, false if not
+		 */
+		virtual bool help()
+		{
+			return false;
+		}
+	};
+
+	/** Task scheduler which runs the tasks in a Hydrax::ThreadPool
+	 */
+	class DllExport ThreadPoolScheduler : public TaskScheduler
+	{
+	public:
+		/** Constructor
+		    @param t Thread pool
+		 */
+		ThreadPoolScheduler(ThreadPool* t = 0)
+			: mThreadPool(t)
+		{
+		}
+
+		/** Set the thread pool
+		    @param t Thread pool
+			@remarks Don't change it while there are scheduled tasks
+		 */
+		inline void setThreadPool(ThreadPool* t)
+		{
+			mThreadPool = t;
+		}
+
+		/** Schedule a task
+		    @param t Task
+		 */
+		void schedule(ThreadPool::Task* t)
+		{
+			mThreadPool->addTask(t, mGroup);
+		}
+
+		/** Help the worker threads
+		    @return true if a task has been executed
+		 */
+		bool help()
+		{
+			return mThreadPool->executeQueuedTask();
+		}
+
+	private:
+		/// Thread pool
+		ThreadPool *mThreadPool;
+		/// Scheduled tasks group
+		ThreadPool::TaskGroup mGroup;
+	};
+
+	/** Graph of tasks with explicit dependencies. Once executed, each task is started
+	    as soon as all its dependencies are finished.
+		@remarks Nodes can't be added while the graph is being executed, the graph must be acyclic
+	 */
+	class DllExport TaskGraph
+	{
+	public:
+		/** Thread where a node can be executed
+		 */
+		enum Affinity
+		{
+			/// Any scheduler thread
+			AFFINITY_ANY_THREAD     = 0,
+			/// The thread which calls execute(...), use it for tasks which touch the scene/render system
+			AFFINITY_CALLING_THREAD = 1
+		};
+
+		/** Constructor
+		 */
+		TaskGraph();
+
+		/** Remove all nodes
+		 */
+		void clear();
+
+		/** Add a node
+		    @param t Task, it must be alive while the graph is executed
+			@param a Thread affinity
+			@return Node index
+		 */
+		int addNode(ThreadPool::Task* t, const Affinity& a = AFFINITY_ANY_THREAD);
+
+		/** Add a dependency
+		    @param Node Node index
+			@param Dependency Node index which must be finished before Node is started
+		 */
+		void addDependency(const int& Node, const int& Dependency);
+
+		/** Get the number of nodes
+		    @return Number of nodes
+		 */
+		inline int getNumberOfNodes() const
+		{
+			return static_cast<int>(mNodes.size());
+		}
+
+		/** Execute the graph and wait until all nodes are finished
+		    @param Scheduler Task scheduler for AFFINITY_ANY_THREAD nodes, NULL for execute all
+			       nodes in the calling thread
+			@remarks The calling thread executes the AFFINITY_CALLING_THREAD nodes and helps
+			         the scheduler while it's waiting
+		 */
+		void execute(TaskScheduler* Scheduler);
+
+	private:
+		/** Scheduled node
+		 */
+		class NodeTask : public ThreadPool::Task
+		{
+		public:
+			/// Graph
+			TaskGraph *mGraph;
+			/// Node index
+			int mNode;
+
+			/** Execute the node
+			 */
+			void execute()
+			{
+				mGraph->_executeNode(mNode);
+			}
+		};
+
+		/** Graph node
+		 */
+		struct Node
+		{
+			/// Task
+			ThreadPool::Task *mTask;
+			/// Thread affinity
+			Affinity mAffinity;
+			/// Nodes which depend on this one
+			std::vector<int> mSuccessors;
+			/// Number of dependencies
+			int mDependencies;
+			/// Number of not finished dependencies, while the graph is executed
+			int mPendingDependencies;
+			/// Scheduled task
+			NodeTask mNodeTask;
+		};
+
+		/** Execute a node and start its ready successors
+		    @param n Node index
+		 */
+		void _executeNode(const int& n);
+
+		/** Start ready nodes
+		    @param Ready Node indices
+		 */
+		void _startNodes(const std::vector<int>& Ready);
+
+		/// Nodes
+		std::vector<Node> mNodes;
+		/// Ready nodes which must be executed by the calling thread
+		std::deque<int> mCallingThreadNodes;
+		/// Number of not finished nodes
+		int mPendingNodes;
+		/// Number of finished nodes, used for detect progress while helping the scheduler
+		int mFinishedNodes;
+		/// Current scheduler
+		TaskScheduler *mScheduler;
+
+#if HYDRAX_THREAD_SUPPORT
+		/// Mutex which protects the node counters and the calling thread queue
+		boost::mutex mMutex;
+		/// Signaled when a node is finished
+		boost::condition mNodeFinished;
+#endif
+	};
+}
+
+#endif
@@ -0,0 +1,231 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef _Hydrax_ThreadPool_H_
+#define _Hydrax_ThreadPool_H_
+
+#include "Prerequisites.h"
+
+#if HYDRAX_THREAD_SUPPORT
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+#endif
+
+namespace Hydrax
+{
+	/** Small pool of worker threads used for run Hydrax internal work (geometry generation, ...)
+	    in parallel with the render thread.
+		@remarks If HYDRAX_THREAD_SUPPORT is 0 or the pool has 0 threads, tasks are executed 
+		         in the calling thread when they're added.
+	 */
+	class DllExport ThreadPool
+	{
+	public:
+		/** Task interface, override execute()
+		 */
+		class DllExport Task
+		{
+		public:
+			/** Destructor
+			 */
+			virtual ~Task()
+			{
+			}
+
+			/** Task body, called from a worker thread
+			 */
+			virtual void execute() = 0;
+		};
+
+		/** Parallel task interface, see parallelFor(...)
+		 */
+		class DllExport ParallelTask
+		{
+		public:
+			/** Destructor
+			 */
+			virtual ~ParallelTask()
+			{
+			}
+
+			/** Task body, called once per chunk from the worker threads and the calling thread
+			    @param Chunk Chunk index
+			 */
+			virtual void execute(const int& Chunk) = 0;
+		};
+
+		/** Group of tasks that can be waited together
+		 */
+		class DllExport TaskGroup
+		{
+		public:
+			/** Default constructor
+			 */
+			TaskGroup()
+				: mPendingTasks(0)
+			{
+			}
+
+			/** Are there tasks of this group still pending?
+			    @return true if there are pending tasks
+				@remarks Use ThreadPool::wait(...) for wait them
+			 */
+			inline bool isBusy() const
+			{
+				return mPendingTasks > 0;
+			}
+
+		private:
+			/// Number of added but not finished tasks
+			volatile int mPendingTasks;
+
+			friend class ThreadPool;
+		};
+
+		/** Constructor
+		    @param NumberOfThreads Number of worker threads
+		 */
+		ThreadPool(const int& NumberOfThreads = 1);
+
+		/** Destructor
+		    @remarks Pending tasks are executed before the threads are stopped
+		 */
+		~ThreadPool();
+
+		/** Set the number of worker threads
+		    @param NumberOfThreads Number of worker threads, 0 for execute tasks in the calling thread
+			@remarks Pending tasks are executed before the threads are changed
+		 */
+		void setNumberOfThreads(const int& NumberOfThreads);
+
+		/** Get the number of worker threads
+		    @return Number of worker threads
+		 */
+		inline const int& getNumberOfThreads() const
+		{
+			return mNumberOfThreads;
+		}
+
+		/** Add a task
+		    @param t Task, it must be alive until it's finished
+			@param Group Task group
+		 */
+		void addTask(Task* t, TaskGroup& Group);
+
+		/** Wait until all the tasks of a group are finished
+		    @param Group Task group
+			@remarks The calling thread executes queued tasks while it's waiting
+		 */
+		void wait(TaskGroup& Group);
+
+		/** Execute one of the queued tasks, if any, in the calling thread
+		    @return true if a task has been executed, false if the queue was empty
+		 */
+		bool executeQueuedTask();
+
+		/** Execute a parallel task for all its chunks and wait until they're finished
+		    @param t Parallel task
+			@param NumberOfChunks Number of chunks, chunk 0 is executed in the calling thread
+		 */
+		void parallelFor(ParallelTask* t, const int& NumberOfChunks);
+
+	private:
+		/** Queued task
+		 */
+		struct QueuedTask
+		{
+			/// Task pointer
+			Task *mTask;
+			/// Task group
+			TaskGroup *mGroup;
+		};
+
+		/** Chunk of a parallel task
+		 */
+		class ChunkTask : public Task
+		{
+		public:
+			/// Parallel task
+			ParallelTask *mParallelTask;
+			/// Chunk index
+			int mChunk;
+
+			/** Execute the chunk
+			 */
+			void execute()
+			{
+				mParallelTask->execute(mChunk);
+			}
+		};
+
+		/** Create worker threads
+		 */
+		void _createThreads();
+
+		/** Stop and delete worker threads
+		 */
+		void _removeThreads();
+
+		/** Worker thread loop
+		 */
+		void _workerLoop();
+
+		/// Number of worker threads
+		int mNumberOfThreads;
+
+		/// Queued tasks
+		std::deque<QueuedTask> mTasks;
+
+#if HYDRAX_THREAD_SUPPORT
+		/** Worker thread entry point
+		 */
+		struct WorkerFunctor
+		{
+			/// Thread pool
+			ThreadPool *mThreadPool;
+
+			/** Thread entry point
+			 */
+			void operator()()
+			{
+				mThreadPool->_workerLoop();
+			}
+		};
+
+		/// Worker threads
+		std::vector<boost::thread*> mThreads;
+		/// Mutex which protects the task queue and the group counters
+		boost::mutex mMutex;
+		/// Signaled when a task is added or the threads must be stopped
+		boost::condition mTaskAdded;
+		/// Signaled when a task is finished
+		boost::condition mTaskFinished;
+		/// Must the worker threads be stopped?
+		bool mStopThreads;
+#endif
+	};
+}
+
+#endif
@@ -0,0 +1,178 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef _Hydrax_WaterBody_H_
+#define _Hydrax_WaterBody_H_
+
+#include "Prerequisites.h"
+
+#include "Mesh.h"
+#include "Modules/Module.h"
+
+namespace Hydrax
+{
+	class Hydrax;
+
+	/** Additional finite water body (lake, pool, river section, ...) with its own position, 
+	    extent and module. Noise, materials and RTTs are shared with the main Hydrax water.
+		@remarks Create it with Hydrax::createWaterBody(...).
+		         Material parameters (colour, foam, ...) are the main water ones, underwater 
+				 and depth effects are only computed for the main water.
+				 The reflection RTT uses the nearest visible water height, so only one 
+				 reflection plane is rendered per frame.
+	 */
+	class DllExport WaterBody
+	{
+	public:
+		/** Constructor
+		    @param h Hydrax parent pointer
+			@param Name Water body name
+			@param Position Water body center position
+		 */
+		WaterBody(Hydrax *h, const Ogre::String &Name, const Ogre::Vector3 &Position);
+
+		/** Destructor
+		 */
+		~WaterBody();
+
+		/** Set the water body module
+		    @param Module Finite module (SimpleGrid, RadialGrid, ...) built with the same normal mode 
+			       as the main water module, use the main module noise for share it
+			@param DeleteOldModule Delete the old module
+			@return false if the module isn't compatible
+			@remarks The main water module must be set before. NM_RTT and infinite modules 
+			         (ProjectedGrid, Clipmap) aren't supported.
+		 */
+		bool setModule(Module::Module* Module, const bool& DeleteOldModule = true);
+
+		/** Create the water body geometry
+		    @remarks Called by Hydrax::create(), only needed if the body has been created after it
+		 */
+		void create();
+
+		/** Remove the water body geometry
+		 */
+		void remove();
+
+		/** Call it each frame
+		    @param timeSinceLastFrame Time since last frame(delta)
+			@remarks Called by Hydrax::update(...)
+		 */
+		void update(const Ogre::Real &timeSinceLastFrame);
+
+		/** Set the water body position
+		    @param Position Center position
+		 */
+		void setPosition(const Ogre::Vector3 &Position);
+
+		/** Show/Hide the water body
+		    @param Visible true for visible, false for hide
+		 */
+		void setVisible(const bool& Visible);
+
+		/** Get the current heigth at a especified world-space point
+		    @param Position X/Z World position
+			@return Heigth at the given position in y-World coordinates, if it's outside of the water return -1
+		 */
+		float getHeigth(const Ogre::Vector2 &Position);
+
+		/** Is the water body surface inside of the camera frustum?
+		    @param c Camera
+			@return true if yes, false if not
+		 */
+		bool _isInFrustum(Ogre::Camera *c);
+
+		/** Update the water body mesh visibility from its and the Hydrax visibility
+		 */
+		void _checkVisible();
+
+		/** Get the water body name
+		    @return Water body name
+		 */
+		inline const Ogre::String& getName() const
+		{
+			return mName;
+		}
+
+		/** Get the water body position
+		    @return Center position
+		 */
+		inline const Ogre::Vector3& getPosition() const
+		{
+			return mPosition;
+		}
+
+		/** Is the water body visible?
+		    @return true if yes, false if not
+		 */
+		inline const bool& isVisible() const
+		{
+			return mVisible;
+		}
+
+		/** Is the water body created?
+		    @return true if yes, false if not
+		 */
+		inline const bool& isCreated() const
+		{
+			return mCreated;
+		}
+
+		/** Get the water body module
+		    @return Module, NULL if it isn't set
+		 */
+		inline Module::Module* getModule()
+		{
+			return mModule;
+		}
+
+		/** Get the water body mesh
+		    @return Hydrax::Mesh pointer
+		 */
+		inline Mesh* getMesh()
+		{
+			return mMesh;
+		}
+
+	private:
+		/// Water body name
+		Ogre::String mName;
+		/// Center position
+		Ogre::Vector3 mPosition;
+		/// Is the water body visible?
+		bool mVisible;
+		/// Is the water body created?
+		bool mCreated;
+
+		/// Our Hydrax::Mesh pointer
+		Mesh *mMesh;
+		/// Our Hydrax::Module::Module pointer
+		Module::Module *mModule;
+
+		/// Hydrax parent pointer
+		Hydrax *mHydrax;
+	};
+}
+
+#endif
@@ -0,0 +1,249 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef _Hydrax_WaterState_H_
+#define _Hydrax_WaterState_H_
+
+#include "Prerequisites.h"
+
+#include "Help.h"
+#include "Noise/Noise.h"
+
+namespace Hydrax
+{
+	/** Immutable water state of a frame: noise data, water transform and strength.
+	    Heigth queries don't lock anything, so any number of threads (physics, AI, ...) 
+		can query it while Hydrax is updating the next frame.
+		@remarks Get the last published state with Hydrax::getWaterState(), it's released
+		         when the last WaterStatePtr which references it is destroyed.
+	 */
+	class DllExport WaterState
+	{
+	public:
+		/** Constructor, infinite water: noise is evaluated in world-space coords
+		    @param NoiseSnapshot Noise snapshot, it'll be deleted by the water state
+			@param WaterHeigth Water y-World position
+			@param Strength Water strength
+		 */
+		WaterState(Noise::Noise::Snapshot *NoiseSnapshot, const float &WaterHeigth, const float &Strength);
+
+		/** Constructor, finite water grid: noise is evaluated in grid object-space coords
+		    @param NoiseSnapshot Noise snapshot, it'll be deleted by the water state
+			@param WaterHeigth Water y-World position
+			@param Strength Water strength
+			@param GridTransformX World-space x/z -> grid x affine transform (See Mesh::getGridTransform(...))
+			@param GridTransformY World-space x/z -> grid y affine transform (See Mesh::getGridTransform(...))
+			@param GridSize Grid size (X/Z) world space
+		 */
+		WaterState(Noise::Noise::Snapshot *NoiseSnapshot, const float &WaterHeigth, const float &Strength,
+			       const Ogre::Vector3 &GridTransformX, const Ogre::Vector3 &GridTransformY, const Size &GridSize);
+
+		/** Destructor
+		 */
+		~WaterState();
+
+		/** Get the heigth at a especified world-space point
+		    @param Position X/Z World position
+			@param Valid Is the position over the water? (Output, can be 0)
+			@return Heigth at the given position in y-World coordinates
+		 */
+		float getHeigth(const Ogre::Vector2 &Position, bool *Valid = 0) const;
+
+		/** Get the heigths at some world-space points
+		    @param Positions X/Z World positions
+			@param Heigths Heigths at the given positions in y-World coordinates (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+			@remarks Points outside of the water have the water heigth
+		 */
+		void getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid = 0) const;
+
+		/** Get the water y-World position
+		    @return Water heigth
+		 */
+		inline const float& getWaterHeigth() const
+		{
+			return mWaterHeigth;
+		}
+
+		/** Get the water strength
+		    @return Water strength
+		 */
+		inline const float& getStrength() const
+		{
+			return mStrength;
+		}
+
+		/** Is the water infinite?
+		    @return true if yes, false if it's a finite grid
+		 */
+		inline const bool& isInfinite() const
+		{
+			return mInfinite;
+		}
+
+	private:
+		/** Non copyable
+		 */
+		WaterState(const WaterState &);
+
+		/** Non copyable
+		 */
+		WaterState& operator=(const WaterState &);
+
+		/// Noise snapshot
+		Noise::Noise::Snapshot *mNoiseSnapshot;
+		/// Water y-World position
+		float mWaterHeigth;
+		/// Water strength
+		float mStrength;
+		/// Is the water infinite?
+		bool mInfinite;
+		/// World-space x/z -> grid x affine transform
+		Ogre::Vector3 mGridTransformX;
+		/// World-space x/z -> grid y affine transform
+		Ogre::Vector3 mGridTransformY;
+		/// Grid size
+		Size mGridSize;
+
+		/// Number of WaterStatePtr which reference the state
+		volatile long mReferences;
+
+		friend class WaterStatePtr;
+	};
+
+	/** Reference counted water state pointer.
+	    Reference counting uses atomic operations, so it's thread-safe whatever the 
+		Ogre/boost thread support is (physics, AI, ... threads can be user threads).
+	 */
+	class DllExport WaterStatePtr
+	{
+	public:
+		/** Default constructor, null pointer
+		 */
+		WaterStatePtr();
+
+		/** Constructor
+		    @param State Water state, it'll be deleted when the last pointer is released
+		 */
+		explicit WaterStatePtr(WaterState *State);
+
+		/** Copy constructor
+		    @param Other Pointer to be copied
+		 */
+		WaterStatePtr(const WaterStatePtr &Other);
+
+		/** Destructor
+		 */
+		~WaterStatePtr();
+
+		/** Assignment operator
+		    @param Other Pointer to be copied
+		 */
+		WaterStatePtr& operator=(const WaterStatePtr &Other);
+
+		/** Reference a new water state
+		    @param State Water state, it'll be deleted when the last pointer is released
+		 */
+		void bind(WaterState *State);
+
+		/** Release the referenced water state
+		 */
+		void setNull();
+
+		/** Swap the referenced water states, reference counts don't change
+		    @param Other Pointer to be swapped
+		 */
+		void swap(WaterStatePtr &Other);
+
+		/** Is the pointer null?
+		    @return true if yes, false if not
+		 */
+		inline bool isNull() const
+		{
+			return mState == 0;
+		}
+
+		/** Get the water state
+		    @return Water state, NULL if the pointer is null
+		 */
+		inline WaterState* get() const
+		{
+			return mState;
+		}
+
+		/** Get the water state
+		    @return Water state, NULL if the pointer is null
+		 */
+		inline WaterState* getPointer() const
+		{
+			return mState;
+		}
+
+		inline WaterState* operator->() const
+		{
+			return mState;
+		}
+
+		inline WaterState& operator*() const
+		{
+			return *mState;
+		}
+
+	private:
+		/// Referenced water state
+		WaterState *mState;
+	};
+
+	/** Last published water state, it can be read from any thread while a new state is published.
+	    The pointer copy is protected with a spin lock (a few instructions), so it doesn't depend 
+		on the Ogre/boost thread support either.
+	 */
+	class DllExport WaterStateSlot
+	{
+	public:
+		/** Constructor
+		 */
+		WaterStateSlot();
+
+		/** Get the water state
+		    @return Water state, null pointer if there isn't any
+		 */
+		WaterStatePtr get();
+
+		/** Publish a water state
+		    @param State New water state
+			@remarks The old state is released out of the lock
+		 */
+		void set(const WaterStatePtr &State);
+
+	private:
+		/// Water state
+		WaterStatePtr mState;
+		/// Spin lock
+		volatile long mLock;
+	};
+}
+
+#endif
@@ -0,0 +1,334 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#include "BuoyancyManager.h"
+
+#include "Hydrax.h"
+
+#define _def_MaxTileCells 32
+
+namespace Hydrax
+{
+	FloatingBody::FloatingBody(const std::vector<Ogre::Vector3> &SamplePoints, const int& Id)
+		: mId(Id)
+		, mEnabled(true)
+		, mPosition(Ogre::Vector3::ZERO)
+		, mOrientation(Ogre::Quaternion::IDENTITY)
+		, mSamplePoints(SamplePoints)
+		, mWorldSamplePoints(SamplePoints)
+		, mHeigths(SamplePoints.size(), 0)
+		, mNormals(SamplePoints.size(), Ogre::Vector3::UNIT_Y)
+		, mVelocities(SamplePoints.size(), 0)
+		, mSampleTiles(SamplePoints.size(), 0)
+		, mSampleCoords(SamplePoints.size(), Ogre::Vector2::ZERO)
+	{
+	}
+
+	FloatingBody::~FloatingBody()
+	{
+	}
+
+	void FloatingBody::setTransform(const Ogre::Vector3 &Position, const Ogre::Quaternion &Orientation)
+	{
+		mPosition = Position;
+		mOrientation = Orientation;
+	}
+
+	BuoyancyManager::BuoyancyManager(Hydrax *h)
+		: mNextId(0)
+		, mCellSize(1)
+		, mTileCells(8)
+		, mTileNodes(81)
+		, mHydrax(h)
+	{
+		mTilesTask.mBuoyancyManager = this;
+		mTilesTask.mNumberOfChunks = 1;
+	}
+
+	BuoyancyManager::~BuoyancyManager()
+	{
+		removeAll();
+	}
+
+	void BuoyancyManager::update(const Ogre::Real &timeSinceLastFrame)
+	{
+		Module::Module *Module = mHydrax->getModule();
+
+		if (mBodies.empty() || !Module)
+		{
+			_resetTiles();
+
+			return;
+		}
+
+		// Keep the last frame tiles for the velocities
+		mLastTileIndex.swap(mTileIndex);
+		mLastTileHeigths.swap(mTileHeigths);
+
+		mTiles.clear();
+		mTileIndex.clear();
+
+		std::vector<FloatingBody*>::iterator BodyIt;
+		int k, n, TileX, TileZ;
+		float u, v;
+
+		// Transform the sample points and find the tiles under them, 
+		// near bodies share their tiles
+		for(BodyIt = mBodies.begin(); BodyIt != mBodies.end(); BodyIt++)
+        {
+			FloatingBody *Body = *BodyIt;
+
+			if (!Body->mEnabled)
+			{
+				continue;
+			}
+
+			n = Body->getNumberOfSamples();
+
+			for (k = 0; k < n; k++)
+			{
+				Ogre::Vector3 &Point = Body->mWorldSamplePoints[k];
+
+				Point = Body->mPosition + Body->mOrientation*Body->mSamplePoints[k];
+
+				_getTileCoords(Point.x, Point.z, TileX, TileZ, u, v);
+
+				TileCoords Coords(TileX, TileZ);
+				TileIndexMap::iterator TileIt = mTileIndex.find(Coords);
+
+				if (TileIt == mTileIndex.end())
+				{
+					TileIt = mTileIndex.insert(std::make_pair(Coords, static_cast<int>(mTiles.size()))).first;
+					mTiles.push_back(Coords);
+				}
+
+				Body->mSampleTiles[k] = TileIt->second;
+				Body->mSampleCoords[k] = Ogre::Vector2(u, v);
+			}
+		}
+
+		const int NumberOfTiles = static_cast<int>(mTiles.size());
+
+		if (NumberOfTiles == 0)
+		{
+			return;
+		}
+
+		mTileHeigths.resize(NumberOfTiles*mTileNodes);
+
+		// Evaluate the tiles, in parallel if there're worker threads
+		ThreadPool *Pool = mHydrax->getThreadPool();
+
+		int NumberOfChunks = (Pool && Pool->getNumberOfThreads() > 0) ? 2*(Pool->getNumberOfThreads()+1) : 1;
+
+		NumberOfChunks = std::min(NumberOfChunks, NumberOfTiles);
+
+		if (NumberOfChunks > 1)
+		{
+			// Update the cached world -> grid transform before the worker threads read it
+			mHydrax->getMesh()->_refreshGridTransform();
+
+			mTilesTask.mNumberOfChunks = NumberOfChunks;
+
+			Pool->parallelFor(&mTilesTask, NumberOfChunks);
+		}
+		else
+		{
+			_evaluateTiles(0, NumberOfTiles);
+		}
+
+		// Interpolate the samples
+		const float InvCellSize = 1.0f / mCellSize,
+			        InvTime     = (timeSinceLastFrame > 0) ? 1.0f / timeSinceLastFrame : 0;
+
+		float dhdu, dhdv;
+
+		for(BodyIt = mBodies.begin(); BodyIt != mBodies.end(); BodyIt++)
+        {
+			FloatingBody *Body = *BodyIt;
+
+			if (!Body->mEnabled)
+			{
+				continue;
+			}
+
+			n = Body->getNumberOfSamples();
+
+			for (k = 0; k < n; k++)
+			{
+				const int &Tile = Body->mSampleTiles[k];
+				const Ogre::Vector2 &Coords = Body->mSampleCoords[k];
+
+				Body->mHeigths[k] = _interpolate(&mTileHeigths[Tile*mTileNodes], Coords.x, Coords.y, &dhdu, &dhdv);
+				Body->mNormals[k] = Ogre::Vector3(-dhdu*InvCellSize, 1, -dhdv*InvCellSize).normalisedCopy();
+				Body->mVelocities[k] = 0;
+
+				if (InvTime > 0)
+				{
+					TileIndexMap::const_iterator LastTileIt = mLastTileIndex.find(mTiles[Tile]);
+
+					if (LastTileIt != mLastTileIndex.end())
+					{
+						Body->mVelocities[k] = (Body->mHeigths[k] - 
+							_interpolate(&mLastTileHeigths[LastTileIt->second*mTileNodes], Coords.x, Coords.y)) * InvTime;
+					}
+				}
+			}
+		}
+	}
+
+	FloatingBody* BuoyancyManager::add(const std::vector<Ogre::Vector3> &SamplePoints)
+	{
+		FloatingBody* NewBody = new FloatingBody(SamplePoints, mNextId);
+
+		mBodies.push_back(NewBody);
+
+		mNextId++;
+
+		return NewBody;
+	}
+
+	FloatingBody* BuoyancyManager::get(const int& Id)
+	{
+		for(std::vector<FloatingBody*>::iterator BodyIt = mBodies.begin(); BodyIt != mBodies.end(); BodyIt++)
+        {
+            if((*BodyIt)->getId() == Id)
+            {
+				return (*BodyIt);
+            }
+		}
+
+		return static_cast<FloatingBody*>(NULL);
+	}
+
+	void BuoyancyManager::remove(const int& Id)
+	{
+		for(std::vector<FloatingBody*>::iterator BodyIt = mBodies.begin(); BodyIt != mBodies.end(); BodyIt++)
+        {
+            if((*BodyIt)->getId() == Id)
+            {
+				delete (*BodyIt);
+				mBodies.erase(BodyIt);
+
+				return;
+            }
+		}
+	}
+
+	void BuoyancyManager::removeAll()
+	{
+		for(std::vector<FloatingBody*>::iterator BodyIt = mBodies.begin(); BodyIt != mBodies.end(); BodyIt++)
+        {
+			delete (*BodyIt);
+		}
+
+		mBodies.clear();
+
+		mNextId = 0;
+
+		_resetTiles();
+	}
+
+	void BuoyancyManager::setTileOptions(const Ogre::Real &CellSize, const int &TileCells)
+	{
+		mCellSize = (CellSize > 0) ? CellSize : 1;
+		mTileCells = std::max(1, std::min(TileCells, _def_MaxTileCells));
+		mTileNodes = (mTileCells+1)*(mTileCells+1);
+
+		// Cached tiles have the old layout
+		_resetTiles();
+	}
+
+	void BuoyancyManager::_resetTiles()
+	{
+		mTiles.clear();
+		mTileIndex.clear();
+		mTileHeigths.clear();
+		mLastTileIndex.clear();
+		mLastTileHeigths.clear();
+	}
+
+	void BuoyancyManager::_getTileCoords(const float &x, const float &z, int &TileX, int &TileZ, float &u, float &v) const
+	{
+		const float CellX = x / mCellSize,
+			        CellZ = z / mCellSize;
+
+		TileX = static_cast<int>(Ogre::Math::Floor(CellX / mTileCells));
+		TileZ = static_cast<int>(Ogre::Math::Floor(CellZ / mTileCells));
+
+		u = CellX - TileX*mTileCells;
+		v = CellZ - TileZ*mTileCells;
+	}
+
+	void BuoyancyManager::_evaluateTiles(const int &First, const int &Last)
+	{
+		Ogre::Vector2 Positions[(_def_MaxTileCells+1)*(_def_MaxTileCells+1)];
+		int Tile, x, z;
+
+		for (Tile = First; Tile < Last; Tile++)
+		{
+			const float OriginX = mTiles[Tile].first *mTileCells*mCellSize,
+				        OriginZ = mTiles[Tile].second*mTileCells*mCellSize;
+
+			for (z = 0; z <= mTileCells; z++)
+			{
+				for (x = 0; x <= mTileCells; x++)
+				{
+					Positions[z*(mTileCells+1) + x] = Ogre::Vector2(OriginX + x*mCellSize, OriginZ + z*mCellSize);
+				}
+			}
+
+			mHydrax->getModule()->getHeigths(Positions, &mTileHeigths[Tile*mTileNodes], mTileNodes);
+		}
+	}
+
+	float BuoyancyManager::_interpolate(const float *Heigths, const float &u, const float &v, float *dhdu, float *dhdv) const
+	{
+		const int Row = mTileCells+1;
+
+		// Points on the far tile border use the last cell
+		int x = std::min(static_cast<int>(u), mTileCells-1),
+			z = std::min(static_cast<int>(v), mTileCells-1);
+
+		float fu = u - x,
+			  fv = v - z;
+
+		const float &h00 = Heigths[ z   *Row + x  ],
+			        &h10 = Heigths[ z   *Row + x+1],
+			        &h01 = Heigths[(z+1)*Row + x  ],
+			        &h11 = Heigths[(z+1)*Row + x+1];
+
+		if (dhdu)
+		{
+			*dhdu = (h10 - h00)*(1-fv) + (h11 - h01)*fv;
+		}
+
+		if (dhdv)
+		{
+			*dhdv = (h01 - h00)*(1-fu) + (h11 - h10)*fu;
+		}
+
+		return (h00*(1-fu) + h10*fu)*(1-fv) + (h01*(1-fu) + h11*fu)*fv;
+	}
+}
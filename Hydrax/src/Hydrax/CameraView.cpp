@@ -0,0 +1,180 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#include "CameraView.h"
+
+#include "Hydrax.h"
+
+namespace Hydrax
+{
+	CameraView::CameraView(Hydrax *h, Ogre::Camera *c, Ogre::Viewport *v)
+		: mCamera(c)
+		, mViewport(v)
+		, mCreated(false)
+		, mMesh(0)
+		, mModule(0)
+		, mHydrax(h)
+	{
+		mViewportListener.mCameraView = this;
+
+		mMesh = new Mesh(mHydrax, 0, this);
+	}
+
+	CameraView::~CameraView()
+	{
+		remove();
+
+		if (mModule)
+		{
+			delete mModule;
+		}
+
+		delete mMesh;
+	}
+
+	bool CameraView::setModule(Module::Module* Module, const bool& DeleteOldModule)
+	{
+		Module::Module *MainModule = mHydrax->getModule();
+
+		if (!MainModule)
+		{
+			HydraxLOG("CameraView::setModule(...): The main water module must be set before, skipping...");
+
+			return false;
+		}
+
+		if (Module->getNormalMode() == MaterialManager::NM_RTT || Module->getNormalMode() != MainModule->getNormalMode())
+		{
+			HydraxLOG("CameraView::setModule(...): Camera views use the main water material, the module normal mode must be the main module one and can't be NM_RTT, skipping...");
+
+			return false;
+		}
+
+		bool Created = mCreated;
+
+		remove();
+
+		if (mModule)
+		{
+			if (DeleteOldModule)
+			{
+				delete mModule;
+			}
+			else
+			{
+				mModule->_setCameraView(0);
+			}
+		}
+
+		mModule = Module;
+		mModule->_setCameraView(this);
+		mModule->_setNoiseShared(mModule->getNoise() == MainModule->getNoise());
+
+		if (Created || mHydrax->isCreated())
+		{
+			create();
+		}
+
+		return true;
+	}
+
+	void CameraView::create()
+	{
+		if (mCreated || !mModule)
+		{
+			return;
+		}
+
+		mModule->create();
+
+		mMesh->setOptions(mModule->getMeshOptions());
+		mMesh->setMaterialName(mHydrax->getMaterialManager()->getMaterial(MaterialManager::MAT_WATER)->getName());
+		mMesh->create();
+
+		// Only rendered in the view viewport
+		mMesh->getEntity()->setVisible(false);
+		mViewport->getTarget()->addListener(&mViewportListener);
+
+		mCreated = true;
+
+		_checkVisible();
+	}
+
+	void CameraView::remove()
+	{
+		if (!mCreated)
+		{
+			return;
+		}
+
+		mViewport->getTarget()->removeListener(&mViewportListener);
+
+		mMesh->remove();
+		mModule->remove();
+
+		mCreated = false;
+	}
+
+	void CameraView::update(const Ogre::Real &timeSinceLastFrame)
+	{
+		if (!mCreated)
+		{
+			return;
+		}
+
+		mModule->update(timeSinceLastFrame);
+	}
+
+	void CameraView::_checkVisible()
+	{
+		if (!mCreated)
+		{
+			return;
+		}
+
+		mMesh->getSceneNode()->setVisible(mHydrax->isVisible() && !mHydrax->isDormant());
+	}
+
+	void CameraView::ViewportListener::preViewportUpdate(const Ogre::RenderTargetViewportEvent& evt)
+	{
+		if (evt.source != mCameraView->mViewport)
+		{
+			return;
+		}
+
+		mCameraView->mHydrax->getMesh()->getEntity()->setVisible(false);
+		mCameraView->mMesh->getEntity()->setVisible(true);
+	}
+
+	void CameraView::ViewportListener::postViewportUpdate(const Ogre::RenderTargetViewportEvent& evt)
+	{
+		if (evt.source != mCameraView->mViewport)
+		{
+			return;
+		}
+
+		mCameraView->mMesh->getEntity()->setVisible(false);
+		mCameraView->mHydrax->getMesh()->getEntity()->setVisible(true);
+	}
+}
@@ -63,6 +63,15 @@ namespace Hydrax
 		mHydrax->setNormalDistortion(_getFloatValue(CfgFile,"NormalDistortion"));
 		mHydrax->setWaterColor(_getVector3Value(CfgFile,"WaterColor"));
 
+		if (_getBoolValue(CfgFile,"FarField"))
+		{
+			mHydrax->setFarField(true, _getFloatValue(CfgFile,"FarFieldInnerRadius"), _getFloatValue(CfgFile,"FarFieldOuterRadius"));
+		}
+		else
+		{
+			mHydrax->setFarField(false, mHydrax->getFarFieldInnerRadius(), mHydrax->getFarFieldOuterRadius());
+		}
+
 		// Load components settings
 		_loadComponentsSettings(CfgFile);
 
@@ -99,7 +108,10 @@ namespace Hydrax
 		Data += _getCfgString("FullReflectionDistance", mHydrax->getFullReflectionDistance());
 		Data += _getCfgString("GlobalTransparency",     mHydrax->getGlobalTransparency());
 		Data += _getCfgString("NormalDistortion",       mHydrax->getNormalDistortion()); 
-		Data += _getCfgString("WaterColor",             mHydrax->getWaterColor()); Data += "\n";
+		Data += _getCfgString("WaterColor",             mHydrax->getWaterColor());
+		Data += _getCfgString("FarField",               mHydrax->isFarFieldEnabled());
+		Data += _getCfgString("FarFieldInnerRadius",    mHydrax->getFarFieldInnerRadius());
+		Data += _getCfgString("FarFieldOuterRadius",    mHydrax->getFarFieldOuterRadius()); Data += "\n";
 
 		Data += "#Components field\n";
 		Data += _getComponentsCfgString();
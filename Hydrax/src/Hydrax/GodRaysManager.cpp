@@ -54,6 +54,7 @@ namespace Hydrax
 		, mProjectorCamera(0)
 		, mProjectorSN(0)
 		, mPerlin(0)
+		, mNoiseUpdated(false)
 		, mSimulationSpeed(5.0f)
 		, mNumberOfRays(100)
 		, mRaysSize(0.03f)
@@ -157,6 +158,7 @@ namespace Hydrax
 
 		delete mPerlin;
 		mPerlin = static_cast<Noise::Perlin*>(NULL);
+		mNoiseUpdated = false;
 
 		mHydrax->getSceneManager()->destroyManualObject(mManualGodRays);
 		mManualGodRays = static_cast<Ogre::ManualObject*>(NULL);
@@ -210,10 +212,17 @@ namespace Hydrax
 	{
 		if (!mCreated || !mHydrax->_isCurrentFrameUnderwater())
 		{
+			mNoiseUpdated = false;
+
 			return;
 		}
 
-		mPerlin->update(timeSinceLastFrame);
+		if (!mNoiseUpdated)
+		{
+		    mPerlin->update(timeSinceLastFrame);
+		}
+
+		mNoiseUpdated = false;
 
 		_updateRays();
 		_updateProjector();
@@ -225,6 +234,17 @@ namespace Hydrax
 		}
 	}
 
+	void GodRaysManager::_updateNoise(const Ogre::Real& timeSinceLastFrame)
+	{
+		if (!mCreated)
+		{
+			return;
+		}
+
+		mPerlin->update(timeSinceLastFrame);
+		mNoiseUpdated = true;
+	}
+
 	void GodRaysManager::_updateRays()
 	{
 		// Get frustum corners to calculate far plane dimensions
@@ -752,6 +772,7 @@ namespace Hydrax
 		mMaterials.empty();
 
 		mGodRaysManager->mHydrax->getMesh()->getEntity()->setVisible(false);
+		mGodRaysManager->mHydrax->_setWaterBodiesVisible(false);
 
 		while( EntityIterator.hasMoreElements() )
 		{
@@ -774,6 +795,7 @@ namespace Hydrax
 		unsigned int k = 0;
 
 		mGodRaysManager->mHydrax->getMesh()->getEntity()->setVisible(true);
+		mGodRaysManager->mHydrax->_setWaterBodiesVisible(true);
 
 		while( EntityIterator.hasMoreElements() )
 		{
@@ -73,6 +73,12 @@ namespace Hydrax
          */
         void update(const Ogre::Real& timeSinceLastFrame);
 
+		/** Update the god rays noise ahead of update(...), it doesn't touch any scene object 
+		    so it can be called from a worker thread (see Hydrax::setParallelUpdate(...))
+		    @param timeSinceLastFrame Time since last frame
+		 */
+		void _updateNoise(const Ogre::Real& timeSinceLastFrame);
+
 		/** Has been create() already called?
 		    @return true If yes
 		 */
@@ -294,6 +300,8 @@ namespace Hydrax
 
 		/// Our Perlin noise module
 		Noise::Perlin *mPerlin;
+		/// Has the noise already been updated for the current frame? (See _updateNoise(...))
+		bool mNoiseUpdated;
 
 		/** Noise parameters (Used in _calculateRayPosition(...))
 		 */
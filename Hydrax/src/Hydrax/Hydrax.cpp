@@ -26,6 +26,9 @@ http://www.gnu.org/copyleft/lesser.txt.
 
 #include "Hydrax.h"
 
+#define _def_RaycastMaxSamples  64
+#define _def_RaycastRefineSteps 5
+
 namespace Hydrax
 {
 
@@ -60,17 +63,34 @@ namespace Hydrax
 			, mGodRaysIntensity(0.015)
 			, mUnderwaterCameraSwitchDelta(1.25f)
 			, mCurrentFrameUnderwater(false)
+			, mDormantMode(false)
+			, mDormant(false)
+			, mDormantTime(0)
+			, mPipelinedUpdate(false)
+			, mAsyncUpdatePending(false)
+			, mThreadPool(0)
+			, mParallelUpdate(false)
+			, mTaskScheduler(0)
+			, mUpdateTime(0)
+			, mWaterStateSnapshots(false)
             , mMesh(new Mesh(this))
 			, mMaterialManager(new MaterialManager(this))
 			, mRttManager(new RttManager(this))
 			, mTextureManager(new TextureManager(this))
 			, mGodRaysManager(new GodRaysManager(this))
 			, mDecalsManager(new DecalsManager(this))
+			, mBuoyancyManager(new BuoyancyManager(this))
 			, mGPUNormalMapManager(new GPUNormalMapManager(this))
 			, mCfgFileManager(new CfgFileManager(this))
 			, mModule(0)
             , mComponents(HYDRAX_COMPONENTS_NONE)
     {
+		for (int k = 0; k < US_COUNT; k++)
+		{
+			mUpdateStageTasks[k].mHydrax = this;
+			mUpdateStageTasks[k].mStage = static_cast<UpdateStage>(k);
+		}
+
         HydraxLOG("Hydrax created.");
     }
 
@@ -78,6 +98,15 @@ namespace Hydrax
     {
 		remove();
 
+		// Water bodies and camera views can share the main module noise
+		destroyAllWaterBodies();
+		removeAllCameras();
+
+		if (mThreadPool)
+		{
+			delete mThreadPool;
+		}
+
 		if (mModule)
 		{
             delete mModule;
@@ -87,6 +116,7 @@ namespace Hydrax
 		delete mMaterialManager;
 		delete mGPUNormalMapManager;
 		delete mDecalsManager;
+		delete mBuoyancyManager;
 		delete mGodRaysManager;
 		delete mRttManager;
 		delete mCfgFileManager;
@@ -161,6 +191,26 @@ namespace Hydrax
         mMesh->create();
         HydraxLOG("Water mesh created.");
 
+		if (!mWaterBodies.empty())
+		{
+			HydraxLOG("Creating water bodies...");
+			for (unsigned int k = 0; k < mWaterBodies.size(); k++)
+			{
+				mWaterBodies[k]->create();
+			}
+			HydraxLOG("Water bodies created.");
+		}
+
+		if (!mCameraViews.empty())
+		{
+			HydraxLOG("Creating camera views...");
+			for (unsigned int k = 0; k < mCameraViews.size(); k++)
+			{
+				mCameraViews[k]->create();
+			}
+			HydraxLOG("Camera views created.");
+		}
+
         mCreated = true;
 
 		// Hide if !mVisible
@@ -178,8 +228,23 @@ namespace Hydrax
 
 		Ogre::Root::getSingleton().getRenderSystem()->removeListener(&mDeviceListener);
 
+		// Discard the pending pipelined update
+		_waitForAsyncUpdate();
+		mAsyncUpdatePending = false;
+
 		mMesh->remove();
+		for (unsigned int k = 0; k < mWaterBodies.size(); k++)
+		{
+			mWaterBodies[k]->remove();
+		}
+		for (unsigned int k = 0; k < mCameraViews.size(); k++)
+		{
+			mCameraViews[k]->remove();
+		}
 		mDecalsManager->removeAll();
+		mBuoyancyManager->_resetTiles();
+		mDormant = false;
+		mDormantTime = 0;
 		mMaterialManager->removeMaterials();
 		mRttManager->removeAll();
 		mGodRaysManager->remove();
@@ -187,6 +252,128 @@ namespace Hydrax
         mTextureManager->remove();
 
 		mCreated = false;
+
+		// Release the last water state
+		_publishWaterState();
+	}
+
+	void Hydrax::setDormantMode(const bool& Enable)
+	{
+		mDormantMode = Enable;
+
+		// Resume
+		if (!Enable && mDormant)
+		{
+			mDormant = false;
+			_checkVisible();
+		}
+
+		HydraxLOG(Ogre::String("Dormant mode ") + (Enable ? "enabled." : "disabled."));
+	}
+
+	void Hydrax::_checkDormant()
+	{
+		// Underwater effects are needed even if the surface isn't visible
+		bool Underwater = mCurrentFrameUnderwater;
+
+		// update(...) doesn't check for underwater while dormant, the surface slab 
+		// discards most of the cases before sampling the water heigth
+		if (mDormant && isComponent(HYDRAX_COMPONENT_UNDERWATER))
+		{
+			const Ogre::Vector3 &CameraPosition = mCamera->getDerivedPosition();
+			const Ogre::Vector2 CameraXZ = Ogre::Vector2(CameraPosition.x, CameraPosition.z);
+			float MaxDisplacement, MaxSlope;
+
+			Underwater = mMesh->isPointInGrid(CameraXZ);
+
+			if (Underwater && mModule->getSurfaceBounds(MaxDisplacement, MaxSlope))
+			{
+				Underwater = CameraPosition.y-mUnderwaterCameraSwitchDelta < mPosition.y + MaxDisplacement;
+			}
+
+			if (Underwater)
+			{
+				Underwater = getHeigth(CameraXZ) > CameraPosition.y-mUnderwaterCameraSwitchDelta;
+			}
+		}
+
+		bool Dormant = !Underwater;
+
+		// Check the main camera (-1) and the camera views cameras
+		for (int c = -1; Dormant && c < static_cast<int>(mCameraViews.size()); c++)
+		{
+			Ogre::Camera *Camera = (c == -1) ? mCamera : mCameraViews[c]->getCamera();
+
+			if (_isWaterInFrustum(Camera))
+			{
+				Dormant = false;
+			}
+
+			for (unsigned int k = 0; Dormant && k < mWaterBodies.size(); k++)
+			{
+				if (mWaterBodies[k]->_isInFrustum(Camera))
+				{
+					Dormant = false;
+				}
+			}
+		}
+
+		if (Dormant != mDormant)
+		{
+			mDormant = Dormant;
+
+			mMesh->getSceneNode()->setVisible(!mDormant);
+			mRttManager->setActive(!mDormant);
+
+			for (unsigned int k = 0; k < mWaterBodies.size(); k++)
+			{
+				mWaterBodies[k]->_checkVisible();
+			}
+			for (unsigned int k = 0; k < mCameraViews.size(); k++)
+			{
+				mCameraViews[k]->_checkVisible();
+			}
+		}
+		else if (mDormant)
+		{
+			// RTTs could have been (re)created while dormant
+			mRttManager->setActive(false);
+		}
+	}
+
+	bool Hydrax::_isWaterInFrustum(Ogre::Camera *c)
+	{
+		const Ogre::AxisAlignedBox &Box = mMesh->getEntity()->getWorldBoundingBox(true);
+
+		if (!Box.isInfinite())
+		{
+			return c->isVisible(Box);
+		}
+
+		// Infinite water: check if the frustum intersects the slab which contains the surface
+		float MaxDisplacement, MaxSlope;
+
+		if (!mModule->getSurfaceBounds(MaxDisplacement, MaxSlope))
+		{
+			return true;
+		}
+
+		const Ogre::Vector3 *Corners = c->getWorldSpaceCorners();
+		bool Above = false, Below = false;
+
+		for (int k = 0; k < 8; k++)
+		{
+			if (Corners[k].y > mPosition.y - MaxDisplacement)
+			{
+				Above = true;
+			}
+			if (Corners[k].y < mPosition.y + MaxDisplacement)
+			{
+				Below = true;
+			}
+		}
+
+		return Above && Below;
 	}
 
 	void Hydrax::setVisible(const bool& Visible)
@@ -203,6 +390,9 @@ namespace Hydrax
 			return;
 		}
 
+		// RTTs are recreated/removed and the mesh shown/hidden, the dormant state will be checked again
+		mDormant = false;
+
 		if (!mVisible)
 		{
 			// Stop RTTs:
@@ -235,12 +425,22 @@ namespace Hydrax
 			// Set over-water material and check for underwater:
 			mMesh->setMaterialName(mMaterialManager->getMaterial(MaterialManager::MAT_WATER)->getName());
 			mMaterialManager->reload(MaterialManager::MAT_WATER);
+			_setAdditionalMeshesMaterial(mMaterialManager->getMaterial(MaterialManager::MAT_WATER)->getName());
 
 			_checkUnderwater(0);
 
 			// Set hydrax mesh node visible
 			mMesh->getSceneNode()->setVisible(true);
 		}
+
+		for (unsigned int k = 0; k < mWaterBodies.size(); k++)
+		{
+			mWaterBodies[k]->_checkVisible();
+		}
+		for (unsigned int k = 0; k < mCameraViews.size(); k++)
+		{
+			mCameraViews[k]->_checkVisible();
+		}
 	}
 
 	void Hydrax::DeviceListener::eventOccurred(const Ogre::String& eventName, const Ogre::NameValuePairList *parameters)
@@ -280,6 +480,7 @@ namespace Hydrax
 		    mMaterialManager->createMaterials(mComponents, MaterialManager::Options(mShaderMode, mModule->getNormalMode()));
 
 		    mMesh->setMaterialName(mMaterialManager->getMaterial(MaterialManager::MAT_WATER)->getName());
+			_setAdditionalMeshesMaterial(mMaterialManager->getMaterial(MaterialManager::MAT_WATER)->getName());
 		}
 	}
 
@@ -287,12 +488,559 @@ namespace Hydrax
 	{
 		if (mCreated && mModule && mVisible)
 		{
-            mModule->update(timeSinceLastFrame);
+			if (mDormantMode)
+			{
+				_checkDormant();
+
+				if (mDormant)
+				{
+					mDormantTime += timeSinceLastFrame;
+
+					return;
+				}
+			}
+
+			// Catch up the time elapsed while dormant in one step, noise is a function of the time
+			const Ogre::Real Time = timeSinceLastFrame + mDormantTime;
+			mDormantTime = 0;
+
+			if (mPipelinedUpdate)
+			{
+				// Upload the geometry generated during the last frame
+				_commitAsyncUpdate();
+
+				// Before launching the next generation, the worker thread reads the shared noise
+				_updateWaterBodies(Time);
+				_updateCameraViews(Time);
+
+				mDecalsManager->update();
+				mMesh->_updateFarField(mCamera->getDerivedPosition());
+				_checkUnderwater(Time);
+
+				// Launch the next frame geometry generation, the render thread 
+				// mustn't touch the module until it's committed
+				if (mModule->_prepareAsyncUpdate(Time))
+				{
+					// The worker thread isn't running yet, the noise can be read
+					_publishWaterState();
+					mBuoyancyManager->update(Time);
+
+					mAsyncUpdateTask.mModule = mModule;
+					mThreadPool->addTask(&mAsyncUpdateTask, mAsyncUpdateGroup);
+					mAsyncUpdatePending = true;
+				}
+				else
+				{
+					mModule->update(Time);
+					_publishWaterState();
+					mBuoyancyManager->update(Time);
+				}
+
+				return;
+			}
+
+			if (mParallelUpdate)
+			{
+				_parallelUpdate(Time);
+
+				return;
+			}
+
+            mModule->update(Time);
+			_publishWaterState();
+			mBuoyancyManager->update(Time);
+			_updateWaterBodies(Time);
+			_updateCameraViews(Time);
 		    mDecalsManager->update();
-			_checkUnderwater(timeSinceLastFrame);
+			mMesh->_updateFarField(mCamera->getDerivedPosition());
+			_checkUnderwater(Time);
 		}
     }
 
+	void Hydrax::setPipelinedUpdate(const bool& Enable)
+	{
+		if (mPipelinedUpdate == Enable)
+		{
+			return;
+		}
+
+		if (!Enable)
+		{
+			_commitAsyncUpdate();
+		}
+		else if (!mThreadPool)
+		{
+			mThreadPool = new ThreadPool(1);
+		}
+
+		mPipelinedUpdate = Enable;
+
+		HydraxLOG(Ogre::String("Pipelined update ") + (Enable ? "enabled." : "disabled."));
+	}
+
+	void Hydrax::setParallelUpdate(const bool& Enable)
+	{
+		if (mParallelUpdate == Enable)
+		{
+			return;
+		}
+
+		if (Enable && !mTaskScheduler && !mThreadPool)
+		{
+			mThreadPool = new ThreadPool(1);
+		}
+
+		mParallelUpdate = Enable;
+
+		HydraxLOG(Ogre::String("Parallel update ") + (Enable ? "enabled." : "disabled."));
+	}
+
+	void Hydrax::setTaskScheduler(TaskScheduler* Scheduler)
+	{
+		mTaskScheduler = Scheduler;
+
+		if (!mTaskScheduler && mParallelUpdate && !mThreadPool)
+		{
+			mThreadPool = new ThreadPool(1);
+		}
+
+		HydraxLOG(Ogre::String("Task scheduler: ") + (Scheduler ? "user scheduler." : "Hydrax worker threads."));
+	}
+
+	TaskScheduler* Hydrax::getTaskScheduler()
+	{
+		if (mTaskScheduler)
+		{
+			return mTaskScheduler;
+		}
+
+		if (mThreadPool)
+		{
+			mThreadPoolScheduler.setThreadPool(mThreadPool);
+
+			return &mThreadPoolScheduler;
+		}
+
+		return static_cast<TaskScheduler*>(NULL);
+	}
+
+	void Hydrax::setNumberOfWorkerThreads(const int& NumberOfThreads)
+	{
+		_waitForAsyncUpdate();
+
+		if (!mThreadPool)
+		{
+			mThreadPool = new ThreadPool(NumberOfThreads);
+		}
+		else
+		{
+			mThreadPool->setNumberOfThreads(NumberOfThreads);
+		}
+
+		HydraxLOG("Number of worker threads: " + Ogre::StringConverter::toString(mThreadPool->getNumberOfThreads()));
+	}
+
+	void Hydrax::setWaterStateSnapshots(const bool& Enable)
+	{
+		mWaterStateSnapshots = Enable;
+
+		if (!Enable)
+		{
+			_publishWaterState();
+		}
+
+		HydraxLOG(Ogre::String("Water state snapshots ") + (Enable ? "enabled." : "disabled."));
+	}
+
+	WaterStatePtr Hydrax::getWaterState()
+	{
+		return mWaterState.get();
+	}
+
+	void Hydrax::_publishWaterState()
+	{
+		WaterStatePtr NewState;
+
+		// Build the snapshot out of the lock, only the pointer swap is locked
+		if (mWaterStateSnapshots && mCreated && mModule)
+		{
+			WaterState *State = mModule->_createWaterState();
+
+			if (State)
+			{
+				NewState.bind(State);
+			}
+		}
+
+		mWaterState.set(NewState);
+	}
+
+	std::pair<bool, Ogre::Real> Hydrax::raycast(const Ogre::Ray &Ray, const Ogre::Real &MaxDistance)
+	{
+		Ogre::Real Distance;
+		bool Hit;
+
+		raycast(&Ray, 1, MaxDistance, &Distance, &Hit);
+
+		return std::pair<bool, Ogre::Real>(Hit, Distance);
+	}
+
+	int Hydrax::raycast(const Ogre::Ray *Rays, const int &Count, const Ogre::Real &MaxDistance, Ogre::Real *Distances, bool *Hits)
+	{
+		std::fill(Hits, Hits+Count, false);
+		std::fill(Distances, Distances+Count, static_cast<Ogre::Real>(0));
+
+		if (!mModule || Count <= 0)
+		{
+			return 0;
+		}
+
+		_waitForAsyncUpdate();
+
+		float MaxDisplacement, MaxSlope;
+		bool Bounded = mModule->getSurfaceBounds(MaxDisplacement, MaxSlope);
+
+		// Per ray march state: current point (T/FT), last point at the starting side of the surface (A/FA), 
+		// max. distance (End/FEnd), min. step and Lipschitz constant of F(t) = Ray(t).y - heigth(Ray(t).xz)
+		std::vector<Ogre::Real> T(Count), A(Count), End(Count), MinStep(Count), Lipschitz(Count);
+		std::vector<float> FT(Count), FA(Count), FEnd(Count);
+		std::vector<int> Active, Next, Refine;
+
+		Active.reserve(Count);
+		Next.reserve(Count);
+
+		int i, k, s, Hit = 0;
+
+		// Clip the rays against the y-slab which contains the displaced surface
+		for (i = 0; i < Count; i++)
+		{
+			const Ogre::Vector3 &Origin = Rays[i].getOrigin(), 
+				                &Direction = Rays[i].getDirection();
+
+			Ogre::Real t0 = 0, t1 = MaxDistance;
+
+			Lipschitz[i] = 0;
+
+			if (Bounded)
+			{
+				Ogre::Real Bottom = mPosition.y - MaxDisplacement,
+					       Top    = mPosition.y + MaxDisplacement;
+
+				if (Direction.y == 0)
+				{
+					if (Origin.y < Bottom || Origin.y > Top)
+					{
+						continue;
+					}
+				}
+				else
+				{
+					Ogre::Real tBottom = (Bottom - Origin.y) / Direction.y,
+						       tTop    = (Top    - Origin.y) / Direction.y;
+
+					t0 = std::max(t0, std::min(tBottom, tTop));
+					t1 = std::min(t1, std::max(tBottom, tTop));
+				}
+
+				// |dF/dt| <= |Direction.y| + MaxSlope*|Direction.xz|
+				Lipschitz[i] = Ogre::Math::Abs(Direction.y) + MaxSlope*Ogre::Math::Sqrt(Direction.x*Direction.x + Direction.z*Direction.z);
+			}
+
+			if (t0 > t1)
+			{
+				continue;
+			}
+
+			T[i] = t0;
+			End[i] = t1;
+			MinStep[i] = (t1 - t0) / _def_RaycastMaxSamples;
+
+			Active.push_back(i);
+		}
+
+		// March: F can't change its sign before |F|/Lipschitz, so these steps never miss the surface.
+		// The min. step bounds the number of samples to _def_RaycastMaxSamples + 1
+		for (bool First = true; !Active.empty(); First = false)
+		{
+			_getRaySurfaceDistances(Rays, &Active[0], static_cast<int>(Active.size()), &T[0], &FT[0]);
+
+			Next.clear();
+
+			for (k = 0; k < static_cast<int>(Active.size()); k++)
+			{
+				i = Active[k];
+
+				if (FT[i] == 0)
+				{
+					Hits[i] = true;
+					Distances[i] = T[i];
+					Hit++;
+
+					continue;
+				}
+
+				if (!First && (FT[i] > 0) != (FA[i] > 0))
+				{
+					// The surface is between A and T
+					Refine.push_back(i);
+
+					continue;
+				}
+
+				A[i] = T[i];
+				FA[i] = FT[i];
+
+				if (T[i] >= End[i])
+				{
+					continue;
+				}
+
+				Ogre::Real Step = MinStep[i];
+
+				if (Lipschitz[i] > 0)
+				{
+					Step = std::max(Step, Ogre::Math::Abs(FT[i]) / Lipschitz[i]);
+				}
+
+				T[i] = std::min(T[i] + Step, End[i]);
+
+				Next.push_back(i);
+			}
+
+			Active.swap(Next);
+		}
+
+		// Refine: secant steps which keep the surface bracketed between A and End
+		for (k = 0; k < static_cast<int>(Refine.size()); k++)
+		{
+			i = Refine[k];
+
+			End[i] = T[i];
+			FEnd[i] = FT[i];
+		}
+
+		for (s = 0; s < _def_RaycastRefineSteps && !Refine.empty(); s++)
+		{
+			for (k = 0; k < static_cast<int>(Refine.size()); k++)
+			{
+				i = Refine[k];
+
+				T[i] = A[i] - FA[i]*(End[i] - A[i])/(FEnd[i] - FA[i]);
+			}
+
+			_getRaySurfaceDistances(Rays, &Refine[0], static_cast<int>(Refine.size()), &T[0], &FT[0]);
+
+			Next.clear();
+
+			for (k = 0; k < static_cast<int>(Refine.size()); k++)
+			{
+				i = Refine[k];
+
+				if (FT[i] == 0)
+				{
+					Hits[i] = true;
+					Distances[i] = T[i];
+					Hit++;
+				}
+				else
+				{
+					if ((FT[i] > 0) == (FA[i] > 0))
+					{
+						A[i] = T[i];
+						FA[i] = FT[i];
+					}
+					else
+					{
+						End[i] = T[i];
+						FEnd[i] = FT[i];
+					}
+
+					Next.push_back(i);
+				}
+			}
+
+			Refine.swap(Next);
+		}
+
+		for (k = 0; k < static_cast<int>(Refine.size()); k++)
+		{
+			i = Refine[k];
+
+			Hits[i] = true;
+			Distances[i] = A[i] - FA[i]*(End[i] - A[i])/(FEnd[i] - FA[i]);
+			Hit++;
+		}
+
+		return Hit;
+	}
+
+	void Hydrax::_getRaySurfaceDistances(const Ogre::Ray *Rays, const int *Indices, const int &Count, const Ogre::Real *T, float *F)
+	{
+		const int ChunkSize = 256;
+
+		Ogre::Vector2 Positions[ChunkSize];
+		float Heigths[ChunkSize], y[ChunkSize];
+		int First, n, k;
+
+		for (First = 0; First < Count; First += ChunkSize)
+		{
+			n = std::min(ChunkSize, Count-First);
+
+			for (k = 0; k < n; k++)
+			{
+				Ogre::Vector3 Point = Rays[Indices[First+k]].getPoint(T[Indices[First+k]]);
+
+				Positions[k] = Ogre::Vector2(Point.x, Point.z);
+				y[k] = Point.y;
+			}
+
+			mModule->getHeigths(Positions, Heigths, n);
+
+			for (k = 0; k < n; k++)
+			{
+				F[Indices[First+k]] = y[k] - Heigths[k];
+			}
+		}
+	}
+
+	void Hydrax::_commitAsyncUpdate()
+	{
+		if (!mAsyncUpdatePending)
+		{
+			return;
+		}
+
+		_waitForAsyncUpdate();
+
+		mModule->_commitAsyncUpdate();
+		mAsyncUpdatePending = false;
+	}
+
+	void Hydrax::_parallelUpdate(const Ogre::Real& timeSinceLastFrame)
+	{
+		mUpdateTime = timeSinceLastFrame;
+		mUpdateGraph.clear();
+
+		// The noise has been updated once Module is finished
+		int Module, Commit, WaterState, Underwater;
+
+		if (mModule->_prepareAsyncUpdate(timeSinceLastFrame))
+		{
+			Module = mUpdateGraph.addNode(&mUpdateStageTasks[US_MODULE_GENERATION]);
+
+			Commit = mUpdateGraph.addNode(&mUpdateStageTasks[US_MODULE_COMMIT], TaskGraph::AFFINITY_CALLING_THREAD);
+			mUpdateGraph.addDependency(Commit, Module);
+		}
+		else
+		{
+			Module = Commit = mUpdateGraph.addNode(&mUpdateStageTasks[US_MODULE], TaskGraph::AFFINITY_CALLING_THREAD);
+		}
+
+		WaterState = mUpdateGraph.addNode(&mUpdateStageTasks[US_WATER_STATE], TaskGraph::AFFINITY_CALLING_THREAD);
+		mUpdateGraph.addDependency(WaterState, Module);
+
+		// Independent of the water surface
+		mUpdateGraph.addNode(&mUpdateStageTasks[US_DECALS], TaskGraph::AFFINITY_CALLING_THREAD);
+		mUpdateGraph.addNode(&mUpdateStageTasks[US_FAR_FIELD], TaskGraph::AFFINITY_CALLING_THREAD);
+
+		Underwater = mUpdateGraph.addNode(&mUpdateStageTasks[US_UNDERWATER], TaskGraph::AFFINITY_CALLING_THREAD);
+		mUpdateGraph.addDependency(Underwater, Module);
+
+		// The module commit can move the reflection plane
+		if (!mWaterBodies.empty())
+		{
+			int WaterBodies = mUpdateGraph.addNode(&mUpdateStageTasks[US_WATER_BODIES], TaskGraph::AFFINITY_CALLING_THREAD);
+			mUpdateGraph.addDependency(WaterBodies, Commit);
+		}
+
+		// Camera views read the noise updated by the module
+		if (!mCameraViews.empty())
+		{
+			int CameraViews = mUpdateGraph.addNode(&mUpdateStageTasks[US_CAMERA_VIEWS], TaskGraph::AFFINITY_CALLING_THREAD);
+			mUpdateGraph.addDependency(CameraViews, Module);
+		}
+
+		// God rays are only updated while the camera is underwater, assume that it's
+		// still underwater if it was in the last frame
+		if (mCurrentFrameUnderwater && isComponent(HYDRAX_COMPONENT_UNDERWATER_GODRAYS))
+		{
+			int GodRaysNoise = mUpdateGraph.addNode(&mUpdateStageTasks[US_GODRAYS_NOISE]);
+			mUpdateGraph.addDependency(Underwater, GodRaysNoise);
+		}
+
+		mUpdateGraph.execute(getTaskScheduler());
+	}
+
+	void Hydrax::_executeUpdateStage(const UpdateStage& Stage)
+	{
+		switch (Stage)
+		{
+			case US_MODULE:
+			{
+				mModule->update(mUpdateTime);
+			}
+			break;
+
+			case US_MODULE_GENERATION:
+			{
+				mModule->_asyncUpdate();
+			}
+			break;
+
+			case US_MODULE_COMMIT:
+			{
+				mModule->_commitAsyncUpdate();
+			}
+			break;
+
+			case US_WATER_STATE:
+			{
+				_publishWaterState();
+			    mBuoyancyManager->update(mUpdateTime);
+			}
+			break;
+
+			case US_DECALS:
+			{
+				mDecalsManager->update();
+			}
+			break;
+
+			case US_FAR_FIELD:
+			{
+				mMesh->_updateFarField(mCamera->getDerivedPosition());
+			}
+			break;
+
+			case US_GODRAYS_NOISE:
+			{
+				mGodRaysManager->_updateNoise(mUpdateTime);
+			}
+			break;
+
+			case US_UNDERWATER:
+			{
+				_checkUnderwater(mUpdateTime);
+			}
+			break;
+
+			case US_WATER_BODIES:
+			{
+				_updateWaterBodies(mUpdateTime);
+			}
+			break;
+
+			case US_CAMERA_VIEWS:
+			{
+				_updateCameraViews(mUpdateTime);
+			}
+			break;
+
+			default:
+			break;
+		}
+	}
+
     void Hydrax::setComponents(const HydraxComponent &Components)
     {
         mComponents = Components;
@@ -501,7 +1249,9 @@ namespace Hydrax
 		}
 
 		mMesh->setMaterialName("BaseWhiteNoLighting");
+		_setAdditionalMeshesMaterial("BaseWhiteNoLighting");
 		mMaterialManager->createMaterials(mComponents, MaterialManager::Options(mShaderMode, mModule->getNormalMode()));
+		_setAdditionalMeshesMaterial(mMaterialManager->getMaterial(MaterialManager::MAT_WATER)->getName());
 
 		if (!isComponent(HYDRAX_COMPONENT_UNDERWATER))
 		{
@@ -520,6 +1270,12 @@ namespace Hydrax
 
 	void Hydrax::setModule(Module::Module* Module, const bool& DeleteOldModule)
 	{
+		// Discard the pending pipelined update
+		_waitForAsyncUpdate();
+		mAsyncUpdatePending = false;
+
+		mBuoyancyManager->_resetTiles();
+
 		if (mModule)
 		{
 			if (mModule->getNormalMode() != Module->getNormalMode())
@@ -527,6 +1283,7 @@ namespace Hydrax
 				mMaterialManager->createMaterials(mComponents, MaterialManager::Options(mShaderMode, Module->getNormalMode()));
 
 		        mMesh->setMaterialName(mMaterialManager->getMaterial(MaterialManager::MAT_WATER)->getName());
+				_setAdditionalMeshesMaterial(mMaterialManager->getMaterial(MaterialManager::MAT_WATER)->getName());
 			}
 
 			if (mModule->getNormalMode() == MaterialManager::NM_RTT && mModule->isCreated() && mModule->getNoise()->areGPUNormalMapResourcesCreated())
@@ -550,6 +1307,10 @@ namespace Hydrax
 
 		mModule = Module;
 
+		// Modules don't touch the water mesh until they're set
+		mMesh->setOptions(mModule->getMeshOptions());
+		_setStrength(mModule->getMeshOptions().MeshStrength);
+
 		if (mCreated)
 		{
 			if (!mModule->isCreated())
@@ -603,6 +1364,196 @@ namespace Hydrax
 		}
 	}
 
+	WaterBody* Hydrax::createWaterBody(const Ogre::String &Name, const Ogre::Vector3 &Position)
+	{
+		if (getWaterBody(Name))
+		{
+			HydraxLOG("Hydrax::createWaterBody(...): " + Name + " water body already exists, skipping...");
+
+			return 0;
+		}
+
+		WaterBody *Body = new WaterBody(this, Name, Position);
+		mWaterBodies.push_back(Body);
+
+		return Body;
+	}
+
+	WaterBody* Hydrax::getWaterBody(const Ogre::String &Name)
+	{
+		for (unsigned int k = 0; k < mWaterBodies.size(); k++)
+		{
+			if (mWaterBodies[k]->getName() == Name)
+			{
+				return mWaterBodies[k];
+			}
+		}
+
+		return 0;
+	}
+
+	void Hydrax::destroyWaterBody(const Ogre::String &Name)
+	{
+		for (std::vector<WaterBody*>::iterator it = mWaterBodies.begin(); it != mWaterBodies.end(); it++)
+		{
+			if ((*it)->getName() == Name)
+			{
+				delete *it;
+				mWaterBodies.erase(it);
+
+				// Restore the main water reflection plane
+				if (mCreated && mWaterBodies.empty())
+				{
+					setPosition(mPosition);
+				}
+
+				return;
+			}
+		}
+	}
+
+	void Hydrax::destroyAllWaterBodies()
+	{
+		bool Restore = !mWaterBodies.empty();
+
+		for (unsigned int k = 0; k < mWaterBodies.size(); k++)
+		{
+			delete mWaterBodies[k];
+		}
+
+		mWaterBodies.clear();
+
+		if (mCreated && Restore)
+		{
+			setPosition(mPosition);
+		}
+	}
+
+	void Hydrax::_setWaterBodiesVisible(const bool& Visible)
+	{
+		for (unsigned int k = 0; k < mWaterBodies.size(); k++)
+		{
+			if (mWaterBodies[k]->isCreated())
+			{
+				mWaterBodies[k]->getMesh()->getEntity()->setVisible(Visible);
+			}
+		}
+	}
+
+	CameraView* Hydrax::addCamera(Ogre::Camera *c, Ogre::Viewport *v)
+	{
+		if (c == mCamera || getCameraView(c))
+		{
+			HydraxLOG("Hydrax::addCamera(...): " + c->getName() + " camera already added, skipping...");
+
+			return 0;
+		}
+
+		CameraView *View = new CameraView(this, c, v);
+		mCameraViews.push_back(View);
+
+		return View;
+	}
+
+	CameraView* Hydrax::getCameraView(Ogre::Camera *c)
+	{
+		for (unsigned int k = 0; k < mCameraViews.size(); k++)
+		{
+			if (mCameraViews[k]->getCamera() == c)
+			{
+				return mCameraViews[k];
+			}
+		}
+
+		return 0;
+	}
+
+	void Hydrax::removeCamera(Ogre::Camera *c)
+	{
+		for (std::vector<CameraView*>::iterator it = mCameraViews.begin(); it != mCameraViews.end(); it++)
+		{
+			if ((*it)->getCamera() == c)
+			{
+				delete *it;
+				mCameraViews.erase(it);
+
+				return;
+			}
+		}
+	}
+
+	void Hydrax::removeAllCameras()
+	{
+		for (unsigned int k = 0; k < mCameraViews.size(); k++)
+		{
+			delete mCameraViews[k];
+		}
+
+		mCameraViews.clear();
+	}
+
+	void Hydrax::_setAdditionalMeshesMaterial(const Ogre::String &MaterialName)
+	{
+		for (unsigned int k = 0; k < mWaterBodies.size(); k++)
+		{
+			mWaterBodies[k]->getMesh()->setMaterialName(MaterialName);
+		}
+		for (unsigned int k = 0; k < mCameraViews.size(); k++)
+		{
+			mCameraViews[k]->getMesh()->setMaterialName(MaterialName);
+		}
+	}
+
+	void Hydrax::_updateCameraViews(const Ogre::Real& timeSinceLastFrame)
+	{
+		for (unsigned int k = 0; k < mCameraViews.size(); k++)
+		{
+			mCameraViews[k]->update(timeSinceLastFrame);
+		}
+	}
+
+	void Hydrax::_updateWaterBodies(const Ogre::Real& timeSinceLastFrame)
+	{
+		if (mWaterBodies.empty())
+		{
+			return;
+		}
+
+		const Ogre::Real CameraHeigth = mCamera->getDerivedPosition().y;
+
+		// There is only one reflection RTT, render it for the nearest visible water.
+		// Underwater effects are only computed for the main water.
+		Ogre::Real ReflectionHeigth = mPosition.y,
+			       MinDistance = (mCurrentFrameUnderwater || _isWaterInFrustum(mCamera)) ? 
+					   Ogre::Math::Abs(CameraHeigth - mPosition.y) : Ogre::Math::POS_INFINITY;
+
+		for (unsigned int k = 0; k < mWaterBodies.size(); k++)
+		{
+			WaterBody *Body = mWaterBodies[k];
+
+			Body->update(timeSinceLastFrame);
+
+			if (!mCurrentFrameUnderwater && Body->_isInFrustum(mCamera) && 
+				Ogre::Math::Abs(CameraHeigth - Body->getPosition().y) < MinDistance)
+			{
+				MinDistance = Ogre::Math::Abs(CameraHeigth - Body->getPosition().y);
+				ReflectionHeigth = Body->getPosition().y;
+			}
+		}
+
+		Ogre::SceneNode *PlanesSceneNode = mRttManager->getPlanesSceneNode();
+
+		if (PlanesSceneNode)
+		{
+			const Ogre::Vector3 &PlanesPosition = PlanesSceneNode->getPosition();
+
+			if (PlanesPosition.y != ReflectionHeigth)
+			{
+				PlanesSceneNode->setPosition(PlanesPosition.x, ReflectionHeigth, PlanesPosition.z);
+			}
+		}
+	}
+
     bool Hydrax::isComponent(const HydraxComponent &Component)
     {
         if (mComponents & Component)
@@ -728,6 +1679,7 @@ namespace Hydrax
 		}
 
         mMesh->getSceneNode()->setPosition(Position.x-mMesh->getSize().Width/2, Position.y, Position.z-mMesh->getSize().Height/2);
+		mMesh->_notifyTransformChanged();
 		mRttManager->getPlanesSceneNode()->setPosition(Position);
 
 		// For world-space -> object-space conversion
@@ -744,6 +1696,7 @@ namespace Hydrax
 		}
 
 		mMesh->getSceneNode()->rotate(q);
+		mMesh->_notifyTransformChanged();
 		mRttManager->getPlanesSceneNode()->rotate(q);
 
 		// For world-space -> object-space conversion
@@ -755,6 +1708,35 @@ namespace Hydrax
         mPlanesError = PlanesError;
     }
 
+	void Hydrax::setFarField(const bool& Enable, const Ogre::Real &InnerRadius, const Ogre::Real &OuterRadius)
+	{
+		if (mMesh->isFarFieldEnabled() == Enable && 
+			mMesh->getFarFieldInnerRadius() == InnerRadius && mMesh->getFarFieldOuterRadius() == OuterRadius)
+		{
+			return;
+		}
+
+		bool Recreate = mCreated && mModule && mMesh->isCreated() && mMesh->isFarFieldEnabled() != Enable;
+
+		mMesh->setFarField(Enable, InnerRadius, OuterRadius);
+
+		if (Recreate)
+		{
+			// The module writes the water mesh when the pipelined update is committed
+			_commitAsyncUpdate();
+
+			Ogre::String MaterialNameTmp = mMesh->getMaterialName();
+
+			mMesh->remove();
+			mMesh->setOptions(mModule->getMeshOptions());
+		    mMesh->setMaterialName(MaterialNameTmp);
+		    mMesh->create();
+			setPosition(mPosition);
+		}
+
+		HydraxLOG(Ogre::String("Far field ") + (Enable ? "enabled." : "disabled."));
+	}
+
     void Hydrax::_setStrength(const Ogre::Real &Strength)
     {
 		if (isComponent(HYDRAX_COMPONENT_FOAM))
@@ -36,15 +36,22 @@ http://www.gnu.org/copyleft/lesser.txt.
 #include "TextureManager.h"
 #include "GodRaysManager.h"
 #include "DecalsManager.h"
+#include "BuoyancyManager.h"
 #include "GPUNormalMapManager.h"
 #include "CfgFileManager.h"
+#include "ThreadPool.h"
+#include "TaskGraph.h"
+#include "WaterState.h"
 #include "Modules/Module.h"
+#include "WaterBody.h"
+#include "CameraView.h"
 
 namespace Hydrax
 {
     /** Main Hydrax class. 
 	    Hydrax is a plugin for the Ogre3D engine whose aim is rendering realistic water scenes.
-		Do not use two instances of the Hydrax class.
+		Do not use two instances of the Hydrax class, use water bodies (see createWaterBody(...)) 
+		for additional waters.
      */
     class DllExport Hydrax
     {
@@ -94,6 +101,125 @@ namespace Hydrax
 		 */
 		void setModule(Module::Module* Module, const bool& DeleteOldModule = true);
 
+		/** Create a water body
+		    @param Name Water body name
+			@param Position Water body center position
+			@return Water body, NULL if the name is already used
+			@remarks Water bodies are finite waters (lakes, pools, ...) with their own position, 
+			         extent and module (see WaterBody::setModule(...)) which share the noise, the 
+					 materials and the RTTs with the main water. The reflection is rendered for the 
+					 nearest visible water height. Destroy them before deleting the main module 
+					 if they share its noise.
+		 */
+		WaterBody* createWaterBody(const Ogre::String &Name, const Ogre::Vector3 &Position);
+
+		/** Get a water body
+		    @param Name Water body name
+			@return Water body, NULL if it doesn't exist
+		 */
+		WaterBody* getWaterBody(const Ogre::String &Name);
+
+		/** Destroy a water body
+		    @param Name Water body name
+		 */
+		void destroyWaterBody(const Ogre::String &Name);
+
+		/** Destroy all water bodies
+		 */
+		void destroyAllWaterBodies();
+
+		/** Get the water bodies
+		    @return Water bodies
+		 */
+		inline const std::vector<WaterBody*>& getWaterBodies() const
+		{
+			return mWaterBodies;
+		}
+
+		/** Add a camera, for split-screen or multi-viewport rendering
+		    @param c Camera
+			@param v Viewport where the camera is rendered
+			@return Camera view, NULL if the camera is already added
+			@remarks Set the camera view module (see CameraView::setModule(...)) built with the 
+			         main module noise: each camera gets its own grid while the noise is evaluated 
+					 once per frame. RTTs, underwater effects, water bodies and the far field are 
+					 rendered for the main camera. Remove the cameras before deleting the main module.
+		 */
+		CameraView* addCamera(Ogre::Camera *c, Ogre::Viewport *v);
+
+		/** Get a camera view
+		    @param c Camera
+			@return Camera view, NULL if the camera hasn't been added
+		 */
+		CameraView* getCameraView(Ogre::Camera *c);
+
+		/** Remove a camera
+		    @param c Camera
+		 */
+		void removeCamera(Ogre::Camera *c);
+
+		/** Remove all the added cameras
+		 */
+		void removeAllCameras();
+
+		/** Get the camera views
+		    @return Camera views
+		 */
+		inline const std::vector<CameraView*>& getCameraViews() const
+		{
+			return mCameraViews;
+		}
+
+		/** Show/Hide the water bodies entities
+		    @param Visible true for visible, false for hide
+			@remarks Used by RTT listeners, like the main water mesh entity
+		 */
+		void _setWaterBodiesVisible(const bool& Visible);
+
+		/** Set the pipelined update mode
+		    @param Enable true for enable it, false for disable it
+			@remarks In pipelined mode update(...) only launchs the generation of the next frame 
+			         water geometry in a worker thread, using a snapshot of the camera and noise time.
+					 The finished geometry is uploaded in the next update(...) call, so the water 
+					 geometry is one frame behind (the module compensates it if possible).
+					 getHeigth(...) waits for the pending generation; change module options or 
+					 noise when the generation isn't running (before update(...)) or call 
+					 _waitForAsyncUpdate() before.
+					 Modules which don't support it are updated as usual.
+		 */
+		void setPipelinedUpdate(const bool& Enable);
+
+		/** Set the number of worker threads used by Hydrax (pipelined update, parallel module updates, ...)
+		    @param NumberOfThreads Number of worker threads, 0 for do all the work in the calling thread
+		 */
+		void setNumberOfWorkerThreads(const int& NumberOfThreads);
+
+		/** Set the parallel update mode
+		    @param Enable true for enable it, false for disable it
+			@remarks In parallel mode update(...) is executed as a graph of stages (module geometry 
+			         generation, god rays noise, decals, far field, underwater check, ...) with explicit 
+					 dependencies: the stages which touch the scene or the render system are executed 
+					 in the calling thread while the others run in the task scheduler (see setTaskScheduler(...)),
+					 so update(...) takes about the time of its longest stage.
+					 update(...) still returns once the current frame is finished, it's ignored in pipelined mode.
+		 */
+		void setParallelUpdate(const bool& Enable);
+
+		/** Set the task scheduler used by the parallel update mode
+		    @param Scheduler Task scheduler, it must be alive while Hydrax uses it. NULL for use 
+			       the Hydrax worker threads (see setNumberOfWorkerThreads(...))
+		 */
+		void setTaskScheduler(TaskScheduler* Scheduler);
+
+		/** Enable/Disable the per-frame water state snapshots
+		    @param Enable true for enable it, false for disable it
+			@remarks When enabled, each update(...) publishes an immutable copy of the module 
+			         noise data, see getWaterState(). Other threads (physics, AI, ...) can query 
+					 it without locking and without waiting for the pipelined update.
+					 It costs a copy of the noise data per frame (only supported by some noise modules).
+		 */
+		void setWaterStateSnapshots(const bool& Enable);
+
         /** Set polygon mode (Solid, Wireframe, Points)
             @param PM Polygon mode
          */
@@ -142,6 +268,16 @@ namespace Hydrax
          */
         void setPlanesError(const Ogre::Real &PlanesError);
 
+        /** Set the far field ring, a flat water ring around the camera beyond the simulated water
+            @param Enable true to enable it, false to disable it
+			@param InnerRadius Distance from the camera where the simulated water ends
+			@param OuterRadius Distance from the camera where the ring ends
+			@remarks The module only needs to cover the inner radius (The projected grid 
+			         clamps its range to it), the ring is rendered with the water material
+					 and it doesn't evaluate any noise. The mesh is recreated if needed.
+         */
+        void setFarField(const bool& Enable, const Ogre::Real &InnerRadius, const Ogre::Real &OuterRadius);
+
         /** Set water strength GPU param
             @param Strength Water strength GPU param
          */
@@ -282,6 +418,31 @@ namespace Hydrax
 			return mVisible;
 		}
 
+		/** Enable/Disable the automatic dormant mode
+		    @param Enable true for enable it, false for disable it
+			@remarks When enabled, all the water work (noise, geometry, decals, RTTs) is suspended 
+			         while the water surface is outside the camera frustum (indoor scenes, cutscenes, ...)
+					 and the camera isn't underwater. On resume the noise catches up the elapsed time 
+					 in one step.
+		 */
+		void setDormantMode(const bool& Enable);
+
+		/** Is the automatic dormant mode enabled?
+		    @return true if yes, false if not
+		 */
+		inline const bool& isDormantModeEnabled() const
+		{
+			return mDormantMode;
+		}
+
+		/** Is hydrax currently dormant? See setDormantMode(...)
+		    @return true if yes, false if not
+		 */
+		inline const bool& isDormant() const
+		{
+			return mDormant;
+		}
+
 		/** Get rendering camera
 		    @return Ogre::Camera pointer
 		 */
@@ -354,6 +515,14 @@ namespace Hydrax
 			return mDecalsManager;
 		}
 
+		/** Get Hydrax::BuoyancyManager
+		    @return Hydrax::BuoyancyManager pointer
+		 */
+		inline BuoyancyManager* getBuoyancyManager()
+		{
+			return mBuoyancyManager;
+		}
+
 		/** Get Hydrax::GPUNormalMapManager
 		    @return Hydrax::GPUNormalMapManager pointer
 	     */
@@ -418,6 +587,30 @@ namespace Hydrax
 			return mPlanesError;
 		}
 
+		/** Is the far field ring enabled?
+		    @return true if yes, false if not
+		 */
+		inline const bool& isFarFieldEnabled() const
+		{
+			return mMesh->isFarFieldEnabled();
+		}
+
+		/** Get the far field inner radius
+		    @return Distance from the camera where the simulated water ends
+		 */
+		inline const float& getFarFieldInnerRadius() const
+		{
+			return mMesh->getFarFieldInnerRadius();
+		}
+
+		/** Get the far field outer radius
+		    @return Distance from the camera where the far field ring ends
+		 */
+		inline const float& getFarFieldOuterRadius() const
+		{
+			return mMesh->getFarFieldOuterRadius();
+		}
+
 		/** Get the current heigth at a especified world-space point
 		    @param Position X/Z World position
 			@return Heigth at the given position in y-World coordinates, if it's outside of the water return -1
@@ -426,12 +619,92 @@ namespace Hydrax
 		{
 			if (mModule)
 			{
+				_waitForAsyncUpdate();
+
 				return mModule->getHeigth(Position);
 			}
 
 			return -1;
 		}
 
+		/** Get the current heigths at some world-space points
+		    @param Positions X/Z World positions
+			@param Heigths Heigths at the given positions in y-World coordinates (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+			@return false if there isn't a module, all positions are invalid then
+			@remarks Use it instead of a getHeigth(...) call per position: points are transformed 
+			         once and the noise is evaluated in batches. Validity flags instead of -1 
+					 heigths, which can be real water heigths.
+		 */
+		inline bool getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid = 0)
+		{
+			if (mModule)
+			{
+				_waitForAsyncUpdate();
+
+				mModule->getHeigths(Positions, Heigths, Count, Valid);
+
+				return true;
+			}
+
+			if (Valid)
+			{
+				std::fill(Valid, Valid+Count, false);
+			}
+
+			return false;
+		}
+
+		/** Get the current surface sample (heigth, normal and vertical velocity) at a especified world-space point
+		    @param Position X/Z World position
+			@return Surface sample, its heigth is -1 if there isn't a module
+			@remarks Normals and velocities come from analytic noise derivatives when the 
+			         noise supports them, costing about one heigth lookup
+		 */
+		inline SurfaceSample getSurfaceSample(const Ogre::Vector2 &Position)
+		{
+			SurfaceSample Sample;
+
+			if (!getSurfaceSamples(&Position, &Sample, 1))
+			{
+				Sample.Heigth = -1;
+			}
+
+			return Sample;
+		}
+
+		/** Get the current surface samples (heigth, normal and vertical velocity) at some world-space points
+		    @param Positions X/Z World positions
+			@param Samples Surface samples (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+			@return false if there isn't a module, all positions are invalid then
+			@remarks The first call enables the noise time derivatives (see Noise::setTimeDerivatives(...)), 
+			         so velocities are available since then
+		 */
+		inline bool getSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, bool *Valid = 0)
+		{
+			if (mModule)
+			{
+				_waitForAsyncUpdate();
+
+				// The pipelined update has finished, no noise query is running
+				mModule->getNoise()->setTimeDerivatives(true);
+
+				mModule->getSurfaceSamples(Positions, Samples, Count, Valid);
+
+				return true;
+			}
+
+			if (Valid)
+			{
+				std::fill(Valid, Valid+Count, false);
+			}
+
+			return false;
+		}
+
 		/** Get the current heigth at a especified world-space point
 		    @param Position X/(Y)/Z World position
 			@return Heigth at the given position in y-World coordinates, if it's outside of the water return -1
@@ -441,6 +714,30 @@ namespace Hydrax
 			return getHeigth(Ogre::Vector2(Position.x, Position.z));
 		}
 
+		/** Intersect a ray with the displaced water surface
+		    @param Ray Ray
+			@param MaxDistance Maximum distance along the ray, in ray direction units (Like Ogre::Ray::getPoint(...))
+			@return (true, distance) if the ray hits the water, (false, 0) if not
+			@remarks See raycast(const Ogre::Ray*, ...)
+		 */
+		std::pair<bool, Ogre::Real> raycast(const Ogre::Ray &Ray, const Ogre::Real &MaxDistance);
+
+		/** Intersect some rays with the displaced water surface
+		    @param Rays Rays
+			@param Count Number of rays
+			@param MaxDistance Maximum distance along the rays, in ray direction units (Like Ogre::Ray::getPoint(...))
+			@param Distances Hit distance of each ray (Output)
+			@param Hits Does each ray hit the water? (Output)
+			@return Number of rays which hit the water
+			@remarks Rays are clipped against the module displacement bounds, marched with steps 
+			         derived from the surface maximum slope (a step never jumps over the surface 
+					 unless it's the minimum step) and refined with secant steps. Each ray costs 
+					 a bounded number of heigth samples, and all rays are marched together with a 
+					 batched getHeigths(...) call per step.
+					 The first crossing of the surface is returned, from above or from below.
+		 */
+		int raycast(const Ogre::Ray *Rays, const int &Count, const Ogre::Real &MaxDistance, Ogre::Real *Distances, bool *Hits);
+
         /** Get full reflection distance
             @return Hydrax water full reflection distance
          */
@@ -610,6 +907,61 @@ namespace Hydrax
 			return mCurrentFrameUnderwater;
 		}
 
+		/** Is the pipelined update mode enabled?
+		    @return true if yes, false if not
+		 */
+		inline const bool& isPipelinedUpdate() const
+		{
+			return mPipelinedUpdate;
+		}
+
+		/** Is the parallel update mode enabled?
+		    @return true if yes, false if not
+		 */
+		inline const bool& isParallelUpdate() const
+		{
+			return mParallelUpdate;
+		}
+
+		/** Get the task scheduler used by the parallel update mode
+		    @return User task scheduler or the Hydrax worker threads scheduler, NULL if there is none
+		 */
+		TaskScheduler* getTaskScheduler();
+
+		/** Are the per-frame water state snapshots enabled?
+		    @return true if yes, false if not
+		 */
+		inline const bool& areWaterStateSnapshotsEnabled() const
+		{
+			return mWaterStateSnapshots;
+		}
+
+		/** Get the last published water state
+		    @return Water state, null if snapshots are disabled or not supported by the module/noise
+			@remarks Thread-safe, the returned state is immutable and remains valid while it's referenced
+			         (thread-safe whatever the Ogre thread support is, see WaterStatePtr)
+		 */
+		WaterStatePtr getWaterState();
+
+		/** Get the worker threads pool
+		    @return Hydrax::ThreadPool pointer, NULL if no worker threads are needed
+		 */
+		inline ThreadPool* getThreadPool()
+		{
+			return mThreadPool;
+		}
+
+		/** Wait until the pending pipelined update (if any) is finished
+		    @remarks The result will be uploaded in the next update(...) call
+		 */
+		inline void _waitForAsyncUpdate()
+		{
+			if (mAsyncUpdateGroup.isBusy())
+			{
+				mThreadPool->wait(mAsyncUpdateGroup);
+			}
+		}
+
     private:
 
         /** Device listener
@@ -635,11 +987,126 @@ namespace Hydrax
 		 */
 		void _checkVisible();
 
+		/** Check if the water has to be dormant, and suspend/resume it
+		 */
+		void _checkDormant();
+
+		/** Is the water surface inside a camera frustum?
+		    @param c Camera
+			@return false if the water surface is outside the frustum
+			@remarks Conservative: it's only false if the water surely isn't visible
+		 */
+		bool _isWaterInFrustum(Ogre::Camera *c);
+
 		/** Check for underwater effects
 		    @param timeSinceLastFrame Time since last frame
 		 */
 		void _checkUnderwater(const Ogre::Real& timeSinceLastFrame);
 
+		/** Update the water bodies and move the reflection plane to the nearest visible water
+		    @param timeSinceLastFrame Time since last frame
+		 */
+		void _updateWaterBodies(const Ogre::Real& timeSinceLastFrame);
+
+		/** Set the water bodies and camera views material
+		    @param MaterialName Material name
+		 */
+		void _setAdditionalMeshesMaterial(const Ogre::String &MaterialName);
+
+		/** Update the camera views
+		    @param timeSinceLastFrame Time since last frame
+		 */
+		void _updateCameraViews(const Ogre::Real& timeSinceLastFrame);
+
+		/** Pipelined module update task
+		 */
+		class DllExport AsyncUpdateTask : public ThreadPool::Task
+		{
+		public:
+			/// Module to be updated
+			Module::Module *mModule;
+
+			/** Execute the module pipelined update
+			 */
+			void execute()
+			{
+				mModule->_asyncUpdate();
+			}
+		};
+
+		/** Upload the finished pipelined update, if any
+		 */
+		void _commitAsyncUpdate();
+
+		/** Parallel update stages, see setParallelUpdate(...)
+		 */
+		enum UpdateStage
+		{
+			/// Module update (noise and geometry), calling thread
+			US_MODULE            = 0,
+			/// Module geometry generation (Module::_asyncUpdate()), any thread
+			US_MODULE_GENERATION = 1,
+			/// Module geometry upload (Module::_commitAsyncUpdate()), calling thread
+			US_MODULE_COMMIT     = 2,
+			/// Water state publication and buoyancy, calling thread
+			US_WATER_STATE       = 3,
+			/// Decals update, calling thread
+			US_DECALS            = 4,
+			/// Far field update, calling thread
+			US_FAR_FIELD         = 5,
+			/// God rays noise update, any thread
+			US_GODRAYS_NOISE     = 6,
+			/// Underwater check (and god rays update), calling thread
+			US_UNDERWATER        = 7,
+			/// Water bodies update and reflection plane selection, calling thread
+			US_WATER_BODIES      = 8,
+			/// Camera views update, calling thread
+			US_CAMERA_VIEWS      = 9,
+
+			US_COUNT             = 10
+		};
+
+		/** Parallel update stage task
+		 */
+		class DllExport UpdateStageTask : public ThreadPool::Task
+		{
+		public:
+			/// Hydrax manager pointer
+			Hydrax *mHydrax;
+			/// Stage
+			UpdateStage mStage;
+
+			/** Execute the stage
+			 */
+			void execute()
+			{
+				mHydrax->_executeUpdateStage(mStage);
+			}
+		};
+
+		/** Parallel update(...) implementation
+		    @param timeSinceLastFrame Time since last frame
+		 */
+		void _parallelUpdate(const Ogre::Real& timeSinceLastFrame);
+
+		/** Execute a parallel update stage
+		    @param Stage Stage
+		 */
+		void _executeUpdateStage(const UpdateStage& Stage);
+
+		/** Get the signed y distances (Point y - water heigth) between some ray points and the water surface
+		    @param Rays Rays
+			@param Indices Indices of the rays to be sampled
+			@param Count Number of indices
+			@param T Distance along each ray
+			@param F Signed y distance of each ray point (Output)
+		 */
+		void _getRaySurfaceDistances(const Ogre::Ray *Rays, const int *Indices, const int &Count, const Ogre::Real *T, float *F);
+
+		/** Publish the current water state snapshot, if enabled
+		 */
+		void _publishWaterState();
+
         /// Has create() already called?
         bool mCreated;
 
@@ -712,6 +1179,42 @@ namespace Hydrax
 		/// Is current frame underwater?
 		bool mCurrentFrameUnderwater;
 
+		/// Is the automatic dormant mode enabled?
+		bool mDormantMode;
+		/// Is hydrax currently dormant?
+		bool mDormant;
+		/// Time elapsed while dormant, added to the next update
+		Ogre::Real mDormantTime;
+
+		/// Is the pipelined update mode enabled?
+		bool mPipelinedUpdate;
+		/// Has the last pipelined update to be uploaded?
+		bool mAsyncUpdatePending;
+		/// Pipelined update task
+		AsyncUpdateTask mAsyncUpdateTask;
+		/// Pipelined update task group
+		ThreadPool::TaskGroup mAsyncUpdateGroup;
+		/// Our Hydrax::ThreadPool pointer
+		ThreadPool *mThreadPool;
+
+		/// Is the parallel update mode enabled?
+		bool mParallelUpdate;
+		/// User task scheduler, NULL for use the thread pool
+		TaskScheduler *mTaskScheduler;
+		/// Thread pool task scheduler
+		ThreadPoolScheduler mThreadPoolScheduler;
+		/// Parallel update graph
+		TaskGraph mUpdateGraph;
+		/// Parallel update stage tasks
+		UpdateStageTask mUpdateStageTasks[US_COUNT];
+		/// Time since last frame of the current parallel update
+		Ogre::Real mUpdateTime;
+
+		/// Are the per-frame water state snapshots enabled?
+		bool mWaterStateSnapshots;
+		/// Last published water state, queries on the state itself don't lock
+		WaterStateSlot mWaterState;
+
         /// Our Hydrax::Mesh pointer
         Mesh *mMesh;
 		/// Our Hydrax::MaterialManager
@@ -724,12 +1227,18 @@ namespace Hydrax
 		GodRaysManager *mGodRaysManager;
 		/// Our Hydrax::DecalsManager pointer
 		DecalsManager *mDecalsManager;
+		/// Our Hydrax::BuoyancyManager pointer
+		BuoyancyManager *mBuoyancyManager;
 		/// Our Hydrax::GPUNormalMapManager pointer
 		GPUNormalMapManager *mGPUNormalMapManager;
 		/// Our Hydrax::CfgFileManager pointer
 		CfgFileManager *mCfgFileManager;
 		/// Our Hydrax::Module::Module pointer
 		Module::Module *mModule;
+		/// Water bodies
+		std::vector<WaterBody*> mWaterBodies;
+		/// Camera views
+		std::vector<CameraView*> mCameraViews;
 
         /// Pointer to Ogre::SceneManager
         Ogre::SceneManager *mSceneManager;
@@ -25,21 +25,84 @@ http://www.gnu.org/copyleft/lesser.txt.
 #include "Mesh.h"
 
 #include "Hydrax.h"
+#include "WaterBody.h"
+#include "CameraView.h"
+
+#define _def_FarFieldSteps 64
+
+// Vertex buffer locks slower than this (microseconds) are counted as stalled locks
+#define _def_StalledLockTime 1000
+
+// Simulated LRU cache size for the index optimizer, and its scoring (Tom Forsyth's 
+// "Linear-speed vertex cache optimisation" values)
+#define _def_OptimizerCacheSize    32
+#define _def_OptimizerLastTriScore 0.75f
+#define _def_OptimizerDecayPower   1.5f
+#define _def_OptimizerValenceScale 2.0f
+#define _def_OptimizerValencePower 0.5f
 
 namespace Hydrax
 {
-	Mesh::Mesh(Hydrax *h)
-            : mHydrax(h)
-			, mCreated(false)
+	float _M_getVertexScore(const int &CachePosition, const int &RemainingTriangles)
+	{
+		if (RemainingTriangles == 0)
+		{
+			// Not used by any other triangle
+			return -1.0f;
+		}
+
+		float Score = 0;
+
+		if (CachePosition >= 0)
+		{
+			if (CachePosition < 3)
+			{
+				// Used by the last triangle, fixed score so the next one isn't always in the same strip direction
+				Score = _def_OptimizerLastTriScore;
+			}
+			else
+			{
+				Score = Ogre::Math::Pow(1.0f - static_cast<float>(CachePosition-3)/(_def_OptimizerCacheSize-3), _def_OptimizerDecayPower);
+			}
+		}
+
+		// Boost vertices with few remaining triangles, so they're finished and the isolated triangles aren't left to the end
+		Score += _def_OptimizerValenceScale * Ogre::Math::Pow(static_cast<float>(RemainingTriangles), -_def_OptimizerValencePower);
+
+		return Score;
+	}
+
+	Mesh::Mesh(Hydrax *h, WaterBody *b, CameraView *v)
+			: mCreated(false)
             , mMesh(0)
             , mSubMesh(0)
             , mEntity(0)
             , mNumFaces(0)
             , mNumVertices(0)
             , mVertexBuffer(0)
+			, mNumberOfVertexBuffers(2)
+			, mCurrentVertexBuffer(0)
+			, mNumberOfStalledLocks(0)
             , mIndexBuffer(0)
+			, mDefaultGeometry(false)
+			, mFarFieldEnabled(false)
+			, mFarFieldInnerRadius(5000)
+			, mFarFieldOuterRadius(100000)
+			, mFarFieldSubMesh(0)
+			, mFarFieldVertexBuffer(0)
+			, mFarFieldCenter(Ogre::Vector2::ZERO)
+			, mFarFieldValid(false)
 			, mSceneNode(0)
+			, mTransformRevision(1)
+			, mGridTransformX(Ogre::Vector3::ZERO)
+			, mGridTransformY(Ogre::Vector3::ZERO)
+			, mGridTransformRevision(0)
             , mMaterialName("_NULL_")
+            , mHydrax(h)
+			, mWaterBody(b)
+			, mCameraView(v)
+			, mMeshName(b ? "HydraxMesh_" + b->getName() : 
+			            v ? "HydraxViewMesh_" + v->getCamera()->getName() : Ogre::String("HydraxMesh"))
     {
     }
 
@@ -59,7 +122,7 @@ namespace Hydrax
 		mSceneNode->getParentSceneNode()->removeAndDestroyChild(mSceneNode->getName());
 		mSceneNode = 0;
 
-		Ogre::MeshManager::getSingleton().remove("HydraxMesh");
+		Ogre::MeshManager::getSingleton().remove(mMeshName);
 		mHydrax->getSceneManager()->destroyEntity(mEntity);
 
 		mMesh.setNull();
@@ -68,7 +131,15 @@ namespace Hydrax
 		mNumFaces = 0;
 		mNumVertices = 0;
 		mVertexBuffer.setNull();
+		mVertexBuffers.clear();
+		mCurrentVertexBuffer = 0;
 		mIndexBuffer.setNull();
+		mIndexBuffers.clear();
+		mDynamicIndexBuffer.setNull();
+		mDefaultGeometry = false;
+		mFarFieldSubMesh = 0;
+		mFarFieldVertexBuffer.setNull();
+		mFarFieldValid = false;
 		mMaterialName = "_NULL_";
 		
 		mCreated = false;
@@ -78,25 +149,13 @@ namespace Hydrax
     {
 		if (mCreated)
 		{
-			Ogre::AxisAlignedBox meshBounds;
-
-			if (Options.MeshSize.Width == 0 && Options.MeshSize.Height == 0)
-			{
-				meshBounds = Ogre::AxisAlignedBox(-1000000, -Options.MeshStrength/2,-1000000,
-		                                       	   1000000,  Options.MeshStrength/2, 1000000);
-			}
-			else
-			{
-				meshBounds = Ogre::AxisAlignedBox(0,                     -Options.MeshStrength/2, 0,
-			                                      Options.MeshSize.Width, Options.MeshStrength/2, Options.MeshSize.Height);
-			}
-
-        	mMesh->_setBounds(meshBounds);
+        	mMesh->_setBounds(_getMeshBounds(Options));
 			mSceneNode->_updateBounds();
 
 			if (mOptions.MeshSize.Width != Options.MeshSize.Width || mOptions.MeshSize.Height != Options.MeshSize.Height)
 			{
-			    mSceneNode->setPosition(mHydrax->getPosition().x-Options.MeshSize.Width/2,mHydrax->getPosition().y,mHydrax->getPosition().z-Options.MeshSize.Height/2);
+			    mSceneNode->setPosition(_getPosition().x-Options.MeshSize.Width/2,_getPosition().y,_getPosition().z-Options.MeshSize.Height/2);
+				_notifyTransformChanged();
 			}
 		}
 
@@ -121,38 +180,37 @@ namespace Hydrax
 		}
 
 		// Create mesh and submesh
-        mMesh = Ogre::MeshManager::getSingleton().createManual("HydraxMesh",
+        mMesh = Ogre::MeshManager::getSingleton().createManual(mMeshName,
                 HYDRAX_RESOURCE_GROUP);
         mSubMesh = mMesh->createSubMesh();
         mSubMesh->useSharedVertices = false;
 
-		if (mHydrax->getModule())
+		Module::Module *Module = mWaterBody  ? mWaterBody->getModule()  : 
+			                     mCameraView ? mCameraView->getModule() : mHydrax->getModule();
+
+		if (Module)
 		{
-			if (!mHydrax->getModule()->_createGeometry(this))
+			if (!Module->_createGeometry(this))
 			{
 				_createGeometry();
+
+				mDefaultGeometry = true;
 			}
 		}
 
-		// End mesh creation
-        Ogre::AxisAlignedBox meshBounds;
+		_createVertexBufferRing();
 
-		if (mOptions.MeshSize.Width == 0 && mOptions.MeshSize.Height == 0)
-		{
-			meshBounds = Ogre::AxisAlignedBox(-1000000, -mOptions.MeshStrength/2,-1000000,
-		                                       1000000,  mOptions.MeshStrength/2, 1000000);
-		}
-		else
+		if (mFarFieldEnabled)
 		{
-			meshBounds = Ogre::AxisAlignedBox(0,                      -mOptions.MeshStrength/2, 0,
-			                                  mOptions.MeshSize.Width, mOptions.MeshStrength/2, mOptions.MeshSize.Height);
+			_createFarFieldGeometry();
 		}
 
-        mMesh->_setBounds(meshBounds);
+		// End mesh creation
+        mMesh->_setBounds(_getMeshBounds(mOptions));
         mMesh->load();
         mMesh->touch();
 
-        mEntity = mHydrax->getSceneManager()->createEntity("HydraxMeshEnt", "HydraxMesh");
+        mEntity = mHydrax->getSceneManager()->createEntity(mMeshName + "Ent", mMeshName);
         mEntity->setMaterialName(mMaterialName);
 		mEntity->setCastShadows(false);
 		mEntity->setRenderQueueGroup(Ogre::RENDER_QUEUE_1);
@@ -160,17 +218,23 @@ namespace Hydrax
 		mSceneNode = mHydrax->getSceneManager()->getRootSceneNode()->createChildSceneNode();
 		mSceneNode->showBoundingBox(false);
         mSceneNode->attachObject(mEntity);
-        mSceneNode->setPosition(mHydrax->getPosition().x-mOptions.MeshSize.Width/2,mHydrax->getPosition().y,mHydrax->getPosition().z-mOptions.MeshSize.Height/2);
+        mSceneNode->setPosition(_getPosition().x-mOptions.MeshSize.Width/2,_getPosition().y,_getPosition().z-mOptions.MeshSize.Height/2);
+		_notifyTransformChanged();
 
 		mCreated = true;
 	}
 
+	const Ogre::Vector3& Mesh::_getPosition() const
+	{
+		return mWaterBody ? mWaterBody->getPosition() : mHydrax->getPosition();
+	}
+
 	void Mesh::_createGeometry()
 	{
 		int& Complexity = mOptions.MeshComplexity;
+		int MaxComplexity = std::max(Complexity, mOptions.MeshMaxComplexity);
 
-		int numVertices = Complexity*Complexity;
-		int numEle = 6 * (Complexity-1)*(Complexity-1);
+		int numVertices = MaxComplexity*MaxComplexity;
 
 		// Vertex buffers
 		mSubMesh->vertexData = new Ogre::VertexData();
@@ -239,6 +303,170 @@ namespace Hydrax
 		
 		vbind->setBinding(0, mVertexBuffer);
 
+		// Index buffers, precompute the complexity halving chain used for quality scaling
+		for (int c = MaxComplexity; c >= 2; c /= 2)
+		{
+			_addIndexBuffer(c, _createGridIndexBuffer(c));
+		}
+
+		if (!_hasIndexBuffer(Complexity))
+		{
+			_addIndexBuffer(Complexity, _createGridIndexBuffer(Complexity));
+		}
+
+		_setDrawRange(Complexity, Complexity*Complexity);
+	}
+
+	void Mesh::_createFarFieldGeometry()
+	{
+		const int Steps = _def_FarFieldSteps;
+		int numVertices = 2*Steps;
+
+		mFarFieldSubMesh = mMesh->createSubMesh();
+		mFarFieldSubMesh->useSharedVertices = false;
+
+		// Vertex buffer, same vertex declaration as the module geometry
+		mFarFieldSubMesh->vertexData = new Ogre::VertexData();
+		mFarFieldSubMesh->vertexData->vertexStart = 0;
+		mFarFieldSubMesh->vertexData->vertexCount = numVertices;
+
+		Ogre::VertexDeclaration* vdecl = mFarFieldSubMesh->vertexData->vertexDeclaration;
+		Ogre::VertexBufferBinding* vbind = mFarFieldSubMesh->vertexData->vertexBufferBinding;
+
+		size_t offset = 0;
+
+		vdecl->addElement(0, 0, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+		offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+
+		if (mOptions.MeshVertexType == VT_POS_NORM_UV || mOptions.MeshVertexType == VT_POS_NORM)
+		{
+			vdecl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
+		    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+		}
+
+		if (mOptions.MeshVertexType == VT_POS_NORM_UV || mOptions.MeshVertexType == VT_POS_UV)
+		{
+			vdecl->addElement(0, offset, Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES);
+			offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT2);
+		}
+
+		mFarFieldVertexBuffer = Ogre::HardwareBufferManager::getSingleton().
+			createVertexBuffer(offset,
+			                   numVertices,
+			                   Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+
+		vbind->setBinding(0, mFarFieldVertexBuffer);
+
+		// Index buffer, the ring topology never changes: 
+		// vertex 2*i is in the inner circle and 2*i+1 in the outer one
+		int numEle = 6*Steps;
+
+		unsigned int *indexbuffer = new unsigned int[numEle];
+
+		int i = 0;
+		for (int k = 0; k < Steps; k++)
+		{
+			int In0 = 2*k,             Out0 = In0+1,
+				In1 = 2*((k+1)%Steps), Out1 = In1+1;
+
+			indexbuffer[i++] = In0;
+			indexbuffer[i++] = Out0;
+			indexbuffer[i++] = In1;
+
+			indexbuffer[i++] = Out0;
+			indexbuffer[i++] = In1;
+			indexbuffer[i++] = Out1;
+		}
+
+		mFarFieldSubMesh->indexData->indexBuffer = _createIndexBuffer(indexbuffer, numEle);
+		mFarFieldSubMesh->indexData->indexStart = 0;
+		mFarFieldSubMesh->indexData->indexCount = numEle;
+
+		delete []indexbuffer;
+
+		mFarFieldValid = false;
+	}
+
+	void Mesh::setFarField(const bool &Enable, const float &InnerRadius, const float &OuterRadius)
+	{
+		mFarFieldEnabled = Enable;
+		mFarFieldInnerRadius = InnerRadius;
+		mFarFieldOuterRadius = std::max(InnerRadius, OuterRadius);
+
+		mFarFieldValid = false;
+	}
+
+	void Mesh::_updateFarField(const Ogre::Vector3 &CameraPosition)
+	{
+		if (!mCreated || !mFarFieldSubMesh)
+		{
+			return;
+		}
+
+		Ogre::Vector3 ObjectSpaceCamera = getObjectSpacePosition(CameraPosition);
+		Ogre::Vector2 Center = Ogre::Vector2(ObjectSpaceCamera.x, ObjectSpaceCamera.z);
+
+		// The ring is huge, it only needs to follow the camera when it has moved a noticeable distance
+		if (mFarFieldValid && (Center-mFarFieldCenter).squaredLength() < Ogre::Math::Sqr(mFarFieldInnerRadius*0.01f))
+		{
+			return;
+		}
+
+		mFarFieldCenter = Center;
+		mFarFieldValid = true;
+
+		const int Steps = _def_FarFieldSteps;
+		const size_t VertexSize = mFarFieldVertexBuffer->getVertexSize();
+		// Below the module waves, so the simulated water always wins where both overlap
+		const float y = -mOptions.MeshStrength/2;
+
+		// The inner circle is circumscribed, so the polygon edges don't cut into the simulated radius
+		const float InnerRadius = mFarFieldInnerRadius / Ogre::Math::Cos(Ogre::Math::PI/Steps);
+
+		float *Data = static_cast<float*>(mFarFieldVertexBuffer->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+
+		for (int k = 0; k < 2*Steps; k++)
+		{
+			float Angle  = Ogre::Math::TWO_PI*static_cast<float>(k/2)/Steps,
+				  Radius = (k & 1) ? mFarFieldOuterRadius : InnerRadius;
+
+			float *v = reinterpret_cast<float*>(reinterpret_cast<unsigned char*>(Data) + k*VertexSize);
+
+			*v++ = Center.x + Radius*Ogre::Math::Cos(Angle);
+			*v++ = y;
+			*v++ = Center.y + Radius*Ogre::Math::Sin(Angle);
+
+			if (mOptions.MeshVertexType == VT_POS_NORM_UV || mOptions.MeshVertexType == VT_POS_NORM)
+			{
+				*v++ = 0; *v++ = -1; *v++ = 0;
+			}
+
+			if (mOptions.MeshVertexType == VT_POS_NORM_UV || mOptions.MeshVertexType == VT_POS_UV)
+			{
+				*v++ = 0; *v++ = 0;
+			}
+		}
+
+		mFarFieldVertexBuffer->unlock();
+	}
+
+	Ogre::AxisAlignedBox Mesh::_getMeshBounds(const Options &Options) const
+	{
+		// The far field ring follows the camera, so the mesh is unbounded like infinite modules
+		if ((Options.MeshSize.Width == 0 && Options.MeshSize.Height == 0) || mFarFieldEnabled)
+		{
+			return Ogre::AxisAlignedBox(-1000000, -Options.MeshStrength/2,-1000000,
+		                                 1000000,  Options.MeshStrength/2, 1000000);
+		}
+
+		return Ogre::AxisAlignedBox(0,                     -Options.MeshStrength/2, 0,
+			                        Options.MeshSize.Width, Options.MeshStrength/2, Options.MeshSize.Height);
+	}
+
+	Ogre::HardwareIndexBufferSharedPtr Mesh::_createGridIndexBuffer(const int &Complexity) const
+	{
+		int numEle = 6 * (Complexity-1)*(Complexity-1);
+
 		unsigned int *indexbuffer = new unsigned int[numEle];
 
 		int i = 0;
@@ -256,97 +484,523 @@ namespace Hydrax
 			}
 		}
 
-		// Prepare buffer for indices
-		mIndexBuffer =
+		_optimizeIndices(indexbuffer, numEle);
+
+		Ogre::HardwareIndexBufferSharedPtr IndexBuffer = _createIndexBuffer(indexbuffer, numEle);
+
+		delete []indexbuffer;
+
+		return IndexBuffer;
+	}
+
+	Ogre::HardwareIndexBufferSharedPtr Mesh::_createIndexBuffer(const unsigned int *Indices, const int &NumIndices)
+	{
+		unsigned int MaxIndex = 0;
+
+		for (int k = 0; k < NumIndices; k++)
+		{
+			MaxIndex = std::max(MaxIndex, Indices[k]);
+		}
+
+		// 16-bit indices when possible, half of the index bandwidth
+		if (MaxIndex < 65536)
+		{
+			Ogre::HardwareIndexBufferSharedPtr IndexBuffer =
+				Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(
+				Ogre::HardwareIndexBuffer::IT_16BIT,
+				NumIndices,
+				Ogre::HardwareBuffer::HBU_STATIC, true);
+
+			unsigned short *ShortIndices = new unsigned short[NumIndices];
+
+			for (int k = 0; k < NumIndices; k++)
+			{
+				ShortIndices[k] = static_cast<unsigned short>(Indices[k]);
+			}
+
+			IndexBuffer->
+				writeData(0,
+				          IndexBuffer->getSizeInBytes(),
+				          ShortIndices,
+				          true);
+
+			delete []ShortIndices;
+
+			return IndexBuffer;
+		}
+
+		Ogre::HardwareIndexBufferSharedPtr IndexBuffer =
 			Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(
 			Ogre::HardwareIndexBuffer::IT_32BIT,
-			numEle,
+			NumIndices,
 			Ogre::HardwareBuffer::HBU_STATIC, true);
 
-		mIndexBuffer->
+		IndexBuffer->
 			writeData(0,
-			          mIndexBuffer->getSizeInBytes(),
-			          indexbuffer,
+			          IndexBuffer->getSizeInBytes(),
+			          Indices,
 			          true);
 
-		delete []indexbuffer;
+		return IndexBuffer;
+	}
+
+	void Mesh::_optimizeIndices(unsigned int *Indices, const int &NumIndices)
+	{
+		const int NumTriangles = NumIndices/3;
+
+		if (NumTriangles < 2)
+		{
+			return;
+		}
+
+		int NumVertices = 0, 
+			t, k, i, v;
+
+		for (i = 0; i < 3*NumTriangles; i++)
+		{
+			NumVertices = std::max(NumVertices, static_cast<int>(Indices[i])+1);
+		}
+
+		// Vertex -> triangles adjacency, triangles of the vertex v are in [Offsets[v], Offsets[v+1])
+		std::vector<int> Offsets(NumVertices+1, 0);
+
+		for (i = 0; i < 3*NumTriangles; i++)
+		{
+			Offsets[Indices[i]+1]++;
+		}
+
+		for (v = 0; v < NumVertices; v++)
+		{
+			Offsets[v+1] += Offsets[v];
+		}
+
+		std::vector<int> Adjacency(3*NumTriangles),
+			             Fill(Offsets.begin(), Offsets.end()-1);
+
+		for (i = 0; i < 3*NumTriangles; i++)
+		{
+			Adjacency[Fill[Indices[i]]++] = i/3;
+		}
+
+		std::vector<int>   RemainingTriangles(NumVertices),
+			               CachePosition(NumVertices, -1);
+		std::vector<float> VertexScore(NumVertices),
+			               TriangleScore(NumTriangles, 0);
+		std::vector<bool>  TriangleAdded(NumTriangles, false);
+
+		for (v = 0; v < NumVertices; v++)
+		{
+			RemainingTriangles[v] = Offsets[v+1]-Offsets[v];
+			VertexScore[v] = _M_getVertexScore(-1, RemainingTriangles[v]);
+		}
+
+		int Best = 0;
+
+		for (t = 0; t < NumTriangles; t++)
+		{
+			TriangleScore[t] = VertexScore[Indices[3*t]] + VertexScore[Indices[3*t+1]] + VertexScore[Indices[3*t+2]];
+
+			if (TriangleScore[t] > TriangleScore[Best])
+			{
+				Best = t;
+			}
+		}
+
+		std::vector<unsigned int> Output;
+		Output.reserve(3*NumTriangles);
+
+		int Cache[_def_OptimizerCacheSize+3], NewCache[_def_OptimizerCacheSize+3],
+			CacheCount = 0, NewCacheCount, 
+			Cursor = 0;
+
+		while (Best >= 0)
+		{
+			TriangleAdded[Best] = true;
+
+			// The triangle vertices go to the front of the cache
+			NewCacheCount = 0;
+
+			for (k = 0; k < 3; k++)
+			{
+				v = Indices[3*Best+k];
+
+				Output.push_back(v);
+				RemainingTriangles[v]--;
+				NewCache[NewCacheCount++] = v;
+			}
+
+			for (i = 0; i < CacheCount; i++)
+			{
+				v = Cache[i];
+
+				if (v != NewCache[0] && v != NewCache[1] && v != NewCache[2])
+				{
+					NewCache[NewCacheCount++] = v;
+				}
+			}
+
+			// Update the scores of the vertices which are (or were, the last three) in the cache
+			for (i = 0; i < NewCacheCount; i++)
+			{
+				v = NewCache[i];
+
+				CachePosition[v] = (i < _def_OptimizerCacheSize) ? i : -1;
+				VertexScore[v] = _M_getVertexScore(CachePosition[v], RemainingTriangles[v]);
+			}
+
+			CacheCount = std::min(NewCacheCount, _def_OptimizerCacheSize);
+
+			for (i = 0; i < CacheCount; i++)
+			{
+				Cache[i] = NewCache[i];
+			}
+
+			// Next triangle: the best one using the updated vertices
+			Best = -1;
+			float BestScore = -1;
+
+			for (i = 0; i < NewCacheCount; i++)
+			{
+				v = NewCache[i];
+
+				for (k = Offsets[v]; k < Offsets[v+1]; k++)
+				{
+					t = Adjacency[k];
+
+					if (TriangleAdded[t])
+					{
+						continue;
+					}
+
+					TriangleScore[t] = VertexScore[Indices[3*t]] + VertexScore[Indices[3*t+1]] + VertexScore[Indices[3*t+2]];
+
+					if (TriangleScore[t] > BestScore)
+					{
+						BestScore = TriangleScore[t];
+						Best = t;
+					}
+				}
+			}
+
+			// Disconnected from the cache, continue with the first remaining triangle
+			if (Best < 0)
+			{
+				while (Cursor < NumTriangles && TriangleAdded[Cursor])
+				{
+					Cursor++;
+				}
+
+				Best = (Cursor < NumTriangles) ? Cursor : -1;
+			}
+		}
+
+		for (i = 0; i < 3*NumTriangles; i++)
+		{
+			Indices[i] = Output[i];
+		}
+	}
+
+	float Mesh::_getACMR(const unsigned int *Indices, const int &NumIndices, const int &CacheSize)
+	{
+		if (NumIndices < 3 || CacheSize < 1)
+		{
+			return 0;
+		}
+
+		// FIFO post-transform cache
+		std::vector<unsigned int> Cache(CacheSize, 0xFFFFFFFF);
+		int Head = 0, Misses = 0;
+
+		for (int i = 0; i < NumIndices; i++)
+		{
+			if (std::find(Cache.begin(), Cache.end(), Indices[i]) == Cache.end())
+			{
+				Cache[Head] = Indices[i];
+				Head = (Head+1) % CacheSize;
+
+				Misses++;
+			}
+		}
+
+		return static_cast<float>(Misses) / (NumIndices/3);
+	}
+
+	float Mesh::getACMR(const int &CacheSize)
+	{
+		if (!mCreated || mIndexBuffer.isNull() || !mIndexBuffer->hasShadowBuffer())
+		{
+			return 0;
+		}
+
+		int NumIndices = static_cast<int>(mSubMesh->indexData->indexCount),
+			First      = static_cast<int>(mSubMesh->indexData->indexStart);
+
+		if (NumIndices < 3)
+		{
+			return 0;
+		}
+
+		std::vector<unsigned int> Indices(NumIndices);
+
+		// Read from the shadow buffer
+		const void *Data = mIndexBuffer->lock(First*mIndexBuffer->getIndexSize(), NumIndices*mIndexBuffer->getIndexSize(), Ogre::HardwareBuffer::HBL_READ_ONLY);
+
+		if (mIndexBuffer->getType() == Ogre::HardwareIndexBuffer::IT_16BIT)
+		{
+			const unsigned short *ShortIndices = static_cast<const unsigned short*>(Data);
+
+			for (int k = 0; k < NumIndices; k++)
+			{
+				Indices[k] = ShortIndices[k];
+			}
+		}
+		else
+		{
+			memcpy(&Indices[0], Data, NumIndices*sizeof(unsigned int));
+		}
+
+		mIndexBuffer->unlock();
+
+		return _getACMR(&Indices[0], NumIndices, CacheSize);
+	}
+
+	void Mesh::_addIndexBuffer(const int &LODKey, const Ogre::HardwareIndexBufferSharedPtr &IndexBuffer)
+	{
+		mIndexBuffers[LODKey] = IndexBuffer;
+	}
+
+	bool Mesh::_hasIndexBuffer(const int &LODKey) const
+	{
+		return mIndexBuffers.find(LODKey) != mIndexBuffers.end();
+	}
+
+	bool Mesh::_setDrawRange(const int &LODKey, const int &NumVertices, const int &NumIndices)
+	{
+		std::map<int, Ogre::HardwareIndexBufferSharedPtr>::iterator IndexBufferIt = mIndexBuffers.find(LODKey);
+
+		if (IndexBufferIt == mIndexBuffers.end() || NumVertices > getVertexCapacity() ||
+			NumIndices > static_cast<int>(IndexBufferIt->second->getNumIndexes()))
+		{
+			return false;
+		}
+
+		mIndexBuffer = IndexBufferIt->second;
+
+		mSubMesh->vertexData->vertexStart = 0;
+		mSubMesh->vertexData->vertexCount = NumVertices;
 
-		// Set index buffer for this submesh
 		mSubMesh->indexData->indexBuffer = mIndexBuffer;
 		mSubMesh->indexData->indexStart = 0;
-		mSubMesh->indexData->indexCount = numEle;
+		mSubMesh->indexData->indexCount = (NumIndices < 0) ? mIndexBuffer->getNumIndexes() : NumIndices;
+
+		mNumVertices = NumVertices;
+		mNumFaces    = static_cast<int>(mSubMesh->indexData->indexCount)/3;
+
+		return true;
 	}
 
-	bool Mesh::updateGeometry(const int &numVer, void* verArray)
+	bool Mesh::_updateIndexData(const unsigned int *Indices, const int &NumIndices)
 	{
-		if (numVer != mVertexBuffer->getNumVertices() || !mCreated)
+		if (!mCreated)
 		{
 			return false;
 		}
 
-		if (verArray)
+		if (mDynamicIndexBuffer.isNull() || static_cast<int>(mDynamicIndexBuffer->getNumIndexes()) < NumIndices)
 		{
-		    mVertexBuffer->
-				writeData(0,
-		                  mVertexBuffer->getSizeInBytes(),
-	                      verArray,
-		                  true);
+			// Enough for a full grid of the max complexity, so it's usually allocated only once
+			int MaxComplexity = std::max(mOptions.MeshComplexity, mOptions.MeshMaxComplexity);
+
+			// The vertex buffer capacity doesn't change, so neither the index type
+			mDynamicIndexBuffer =
+				Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(
+				(getVertexCapacity() <= 65536) ? Ogre::HardwareIndexBuffer::IT_16BIT : Ogre::HardwareIndexBuffer::IT_32BIT,
+				std::max(NumIndices, 6*(MaxComplexity-1)*(MaxComplexity-1)),
+				Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY_DISCARDABLE);
+		}
+
+		if (NumIndices > 0)
+		{
+			if (mDynamicIndexBuffer->getType() == Ogre::HardwareIndexBuffer::IT_16BIT)
+			{
+				unsigned short *ShortIndices = static_cast<unsigned short*>(
+					mDynamicIndexBuffer->lock(0, NumIndices*sizeof(unsigned short), Ogre::HardwareBuffer::HBL_DISCARD));
+
+				for (int k = 0; k < NumIndices; k++)
+				{
+					ShortIndices[k] = static_cast<unsigned short>(Indices[k]);
+				}
+
+				mDynamicIndexBuffer->unlock();
+			}
+			else
+			{
+			    mDynamicIndexBuffer->
+				    writeData(0,
+				              NumIndices*sizeof(unsigned int),
+				              Indices,
+				              true);
+			}
 		}
 
+		mIndexBuffer = mDynamicIndexBuffer;
+
+		mSubMesh->indexData->indexBuffer = mIndexBuffer;
+		mSubMesh->indexData->indexStart = 0;
+		mSubMesh->indexData->indexCount = NumIndices;
+
+		mNumFaces = NumIndices/3;
+
 		return true;
 	}
 
-	bool Mesh::isPointInGrid(const Ogre::Vector2 &Position)
+	bool Mesh::setComplexity(const int &Complexity)
 	{
-		Ogre::AxisAlignedBox WordMeshBox = mEntity->getWorldBoundingBox();
-
-		// Get our mesh grid rectangle:
-		// c-----------d
-		// |           |
-		// |           |
-		// |           |
-		// a-----------b
-		Ogre::Vector3
-			a = WordMeshBox.getCorner(Ogre::AxisAlignedBox::FAR_LEFT_BOTTOM),
-			b = WordMeshBox.getCorner(Ogre::AxisAlignedBox::FAR_RIGHT_BOTTOM),
-			c = WordMeshBox.getCorner(Ogre::AxisAlignedBox::NEAR_RIGHT_BOTTOM),
-			d = WordMeshBox.getCorner(Ogre::AxisAlignedBox::NEAR_LEFT_BOTTOM);
-
-		// Transform all corners to Ogre::Vector2 array
-		Ogre::Vector2 Corners2D[4] =
-		   {Ogre::Vector2(a.x, a.z), 
-		    Ogre::Vector2(b.x, b.z), 
-		    Ogre::Vector2(c.x, c.z), 
-		    Ogre::Vector2(d.x, d.z)};
-
-		// Determinate if Position is into our rectangle, we use a line intersection detection
-		// because our mesh rectangle can be rotated, if the number of collisions with the four
-		// segments AB, BC, CD, DA is one, the Position point is into the rectangle, else(if number 
-		// of collisions are 0 or 2, the Position point is outside the rectangle.
-		int NumberOfCollisions = 0;
-		// Find a point wich isn't be inside the rectangle
-		Ogre::Vector2 DestPoint = Corners2D[0] + (Corners2D[1]-Corners2D[0])*2;
-		for (int k = 0; k < 3; k++)
-		{
-			if (Math::intersectionOfTwoLines(Corners2D[k], Corners2D[k+1], Position, DestPoint) != Ogre::Vector2::ZERO)
-			{
-				NumberOfCollisions ++;
-			}
+		if (!mCreated || !mDefaultGeometry || Complexity*Complexity > getVertexCapacity())
+		{
+			return false;
+		}
+
+		if (!_hasIndexBuffer(Complexity))
+		{
+			_addIndexBuffer(Complexity, _createGridIndexBuffer(Complexity));
+		}
 
-			if (k == 2)
+		mOptions.MeshComplexity = Complexity;
+
+		return _setDrawRange(Complexity, Complexity*Complexity);
+	}
+
+	bool Mesh::updateGeometry(const int &numVer, void* verArray)
+	{
+		if (!mCreated || numVer != static_cast<int>(mSubMesh->vertexData->vertexCount))
+		{
+			return false;
+		}
+
+		if (verArray)
+		{
+			// Full rewrite, so write the next buffer of the ring: the GPU can be still reading 
+			// the previous frames ones
+			if (mVertexBuffers.size() > 1)
 			{
-				if (Math::intersectionOfTwoLines(Corners2D[3], Corners2D[0], Position, DestPoint) != Ogre::Vector2::ZERO)
-			    {
-				    NumberOfCollisions ++;
-			    }
+				mCurrentVertexBuffer = (mCurrentVertexBuffer+1) % static_cast<int>(mVertexBuffers.size());
+				mVertexBuffer = mVertexBuffers[mCurrentVertexBuffer];
+
+				mSubMesh->vertexData->vertexBufferBinding->setBinding(0, mVertexBuffer);
 			}
+
+			// Only the active range, the rest of the buffer capacity isn't drawn
+			_writeVertexBuffer(0, numVer*mVertexBuffer->getVertexSize(), verArray, true);
+		}
+
+		return true;
+	}
+
+	void Mesh::setNumberOfVertexBuffers(const int &NumberOfVertexBuffers)
+	{
+		mNumberOfVertexBuffers = std::max(1, std::min(NumberOfVertexBuffers, 3));
+
+		if (mCreated)
+		{
+			_createVertexBufferRing();
+		}
+	}
+
+	void Mesh::_createVertexBufferRing()
+	{
+		if (mVertexBuffer.isNull())
+		{
+			return;
+		}
+
+		// The buffer created by the module (or by _createGeometry()) is the first one, 
+		// it has the current vertices
+		mVertexBuffers.clear();
+		mVertexBuffers.push_back(mVertexBuffer);
+		mCurrentVertexBuffer = 0;
+
+		mSubMesh->vertexData->vertexBufferBinding->setBinding(0, mVertexBuffer);
+
+		for (int k = 1; k < mNumberOfVertexBuffers; k++)
+		{
+			mVertexBuffers.push_back(Ogre::HardwareBufferManager::getSingleton().
+				createVertexBuffer(mVertexBuffer->getVertexSize(),
+			                       mVertexBuffer->getNumVertices(),
+			                       mVertexBuffer->getUsage()));
+		}
+	}
+
+	bool Mesh::_updateGeometryRange(const int &First, const int &NumVertices, const void* Vertices)
+	{
+		if (!mCreated || First < 0 || First + NumVertices > getVertexCapacity())
+		{
+			return false;
+		}
+
+		if (NumVertices > 0)
+		{
+			// The buffer isn't rotated, the rest of its vertices must be kept
+			_writeVertexBuffer(First*mVertexBuffer->getVertexSize(), NumVertices*mVertexBuffer->getVertexSize(), Vertices, false);
+		}
+
+		return true;
+	}
+
+	void Mesh::_writeVertexBuffer(const size_t &Offset, const size_t &Length, const void* Source, const bool &Discard)
+	{
+		mLockTimer.reset();
+
+		void *Data = mVertexBuffer->lock(Offset, Length, Discard ? Ogre::HardwareBuffer::HBL_DISCARD : Ogre::HardwareBuffer::HBL_NORMAL);
+
+		// A lock waiting for the GPU is a stall, the copy below isn't
+		if (mLockTimer.getMicroseconds() > _def_StalledLockTime)
+		{
+			mNumberOfStalledLocks++;
 		}
-		if (NumberOfCollisions == 1)
+
+		memcpy(Data, Source, Length);
+
+		mVertexBuffer->unlock();
+	}
+
+	void Mesh::_updateGridTransform()
+	{
+		mGridTransformRevision = mTransformRevision;
+
+		// World -> object-space (The grid is in [0,Width]x[0,Height] object-space x/z coords), 
+		// with the world y at the water level, then scaled to [0,1]
+		Ogre::Matrix4 InverseWorld = mSceneNode->_getFullTransform().inverseAffine();
+
+		float InvWidth  = (mOptions.MeshSize.Width  > 0) ? 1.0f/mOptions.MeshSize.Width  : 0,
+			  InvHeight = (mOptions.MeshSize.Height > 0) ? 1.0f/mOptions.MeshSize.Height : 0,
+			  y         = _getPosition().y;
+
+		mGridTransformX = Ogre::Vector3(InverseWorld[0][0], InverseWorld[0][2], InverseWorld[0][1]*y + InverseWorld[0][3]) * InvWidth;
+		mGridTransformY = Ogre::Vector3(InverseWorld[2][0], InverseWorld[2][2], InverseWorld[2][1]*y + InverseWorld[2][3]) * InvHeight;
+	}
+
+	bool Mesh::isPointInGrid(const Ogre::Vector2 &Position)
+	{
+		if (mOptions.MeshSize.Width == 0 && mOptions.MeshSize.Height == 0)
 		{
 			return true;
 		}
 
-		return false;
+		if (!mCreated)
+		{
+			return false;
+		}
+
+		if (mGridTransformRevision != mTransformRevision)
+		{
+			_updateGridTransform();
+		}
+
+		float x = mGridTransformX.x*Position.x + mGridTransformX.y*Position.y + mGridTransformX.z,
+			  y = mGridTransformY.x*Position.x + mGridTransformY.y*Position.y + mGridTransformY.z;
+
+		return x >= 0 && x <= 1 && y >= 0 && y <= 1;
 	}
 
 	Ogre::Vector2 Mesh::getGridPosition(const Ogre::Vector2 &Position)
@@ -356,53 +1010,87 @@ namespace Hydrax
 			return Position;
 		}
 
-		if (!isPointInGrid(Position))
+		if (!mCreated)
 		{
 			return Ogre::Vector2(-1,-1);
 		}
 
-		Ogre::AxisAlignedBox WordMeshBox = mEntity->getWorldBoundingBox();
-
-		// Get our mesh grid rectangle: (Only a,b,c corners)
-		// c
-		// |           
-		// |           
-		// |           
-		// a-----------b
-		Ogre::Vector3
-			a = WordMeshBox.getCorner(Ogre::AxisAlignedBox::FAR_LEFT_BOTTOM),
-			b = WordMeshBox.getCorner(Ogre::AxisAlignedBox::FAR_RIGHT_BOTTOM),
-			c = WordMeshBox.getCorner(Ogre::AxisAlignedBox::NEAR_LEFT_BOTTOM);
-
-		// Transform all corners to Ogre::Vector2 array
-		Ogre::Vector2 Corners2D[3] =
-		   {Ogre::Vector2(a.x, a.z), 
-		    Ogre::Vector2(b.x, b.z), 
-		    Ogre::Vector2(c.x, c.z)};
-
-		// Get segments AB and AC
-		Ogre::Vector2 AB = Corners2D[1]-Corners2D[0],
-			          AC = Corners2D[2]-Corners2D[0];
-
-		// Find the X/Y position projecting the Position point to AB and AC segments.
-		Ogre::Vector2 XProjectedPoint = Position-AC,
-			          YProjectedPoint = Position-AB;
-
-		// Fint the intersections points
-		Ogre::Vector2 XPoint = Math::intersectionOfTwoLines(Corners2D[0],Corners2D[1],Position,XProjectedPoint),
-			          YPoint = Math::intersectionOfTwoLines(Corners2D[0],Corners2D[2],Position,YProjectedPoint);
-		
-		// Find lengths
-		Ogre::Real ABLength = AB.length(),
-			       ACLength = AC.length(),
-				   XLength  = (XPoint-Corners2D[0]).length(),
-				   YLength  = (YPoint-Corners2D[0]).length();
+		if (mGridTransformRevision != mTransformRevision)
+		{
+			_updateGridTransform();
+		}
+
+		float x = mGridTransformX.x*Position.x + mGridTransformX.y*Position.y + mGridTransformX.z,
+			  y = mGridTransformY.x*Position.x + mGridTransformY.y*Position.y + mGridTransformY.z;
+
+		if (x < 0 || x > 1 || y < 0 || y > 1)
+		{
+			return Ogre::Vector2(-1,-1);
+		}
+
+		return Ogre::Vector2(x,y);
+	}
 
-		// Find final x/y grid positions in [0,1] range
-		Ogre::Real XFinal = XLength / ABLength,
-			       YFinal = YLength / ACLength;
+	void Mesh::getGridPositions(const Ogre::Vector2 *Positions, Ogre::Vector2 *GridPositions, const int &Count)
+	{
+		if (mOptions.MeshSize.Width == 0 && mOptions.MeshSize.Height == 0)
+		{
+			for (int k = 0; k < Count; k++)
+			{
+				GridPositions[k] = Positions[k];
+			}
 
-		return Ogre::Vector2(XFinal,YFinal);
+			return;
+		}
+
+		if (!mCreated)
+		{
+			for (int k = 0; k < Count; k++)
+			{
+				GridPositions[k] = Ogre::Vector2(-1,-1);
+			}
+
+			return;
+		}
+
+		if (mGridTransformRevision != mTransformRevision)
+		{
+			_updateGridTransform();
+		}
+
+		const Ogre::Vector3 TX = mGridTransformX, 
+			                TY = mGridTransformY;
+
+		for (int k = 0; k < Count; k++)
+		{
+			float x = TX.x*Positions[k].x + TX.y*Positions[k].y + TX.z,
+				  y = TY.x*Positions[k].x + TY.y*Positions[k].y + TY.z;
+
+			if (x < 0 || x > 1 || y < 0 || y > 1)
+			{
+				GridPositions[k] = Ogre::Vector2(-1,-1);
+			}
+			else
+			{
+				GridPositions[k] = Ogre::Vector2(x,y);
+			}
+		}
+	}
+
+	void Mesh::getGridTransform(Ogre::Vector3 &X, Ogre::Vector3 &Y)
+	{
+		_refreshGridTransform();
+
+		X = mGridTransformX;
+		Y = mGridTransformY;
+	}
+
+	void Mesh::_refreshGridTransform()
+	{
+		if (mCreated && mGridTransformRevision != mTransformRevision)
+		{
+			_updateGridTransform();
+		}
 	}
 
 	const Ogre::Vector3 Mesh::getObjectSpacePosition(const Ogre::Vector3& WorldSpacePosition) const
@@ -416,7 +1104,7 @@ namespace Hydrax
 		else
 		{
 			Ogre::SceneNode *mTmpSN = new Ogre::SceneNode(0);
-		    mTmpSN->setPosition(mHydrax->getPosition());
+		    mTmpSN->setPosition(_getPosition());
 
 			mTmpSN->getWorldTransforms(&mWorldMatrix);
 
@@ -437,7 +1125,7 @@ namespace Hydrax
 		else
 		{
 			Ogre::SceneNode *mTmpSN = new Ogre::SceneNode(0);
-		    mTmpSN->setPosition(mHydrax->getPosition());
+		    mTmpSN->setPosition(_getPosition());
 
 			mTmpSN->getWorldTransforms(&mWorldMatrix);
 
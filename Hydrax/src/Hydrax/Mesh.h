@@ -33,6 +33,8 @@ http://www.gnu.org/copyleft/lesser.txt.
 namespace Hydrax
 {
 	class Hydrax;
+	class WaterBody;
+	class CameraView;
 
     /** Class wich contains all funtions/variables related to
         Hydrax water mesh
@@ -93,6 +95,7 @@ namespace Hydrax
 				, MeshSize(Size(0))
 				, MeshStrength(10)
 				, MeshVertexType(VT_POS_NORM_UV)
+				, MeshMaxComplexity(0)
 			{
 			}
 
@@ -106,6 +109,7 @@ namespace Hydrax
 				, MeshSize(meshSize)
 				, MeshStrength(10)
 				, MeshVertexType(meshVertexType)
+				, MeshMaxComplexity(0)
 			{
 			}
 
@@ -120,6 +124,7 @@ namespace Hydrax
 				, MeshSize(meshSize)
 				, MeshStrength(meshStrength)
 				, MeshVertexType(meshVertexType)
+				, MeshMaxComplexity(0)
 			{
 			}
 
@@ -131,12 +136,17 @@ namespace Hydrax
 			float MeshStrength;
 			/// Vertex type 
 			VertexType MeshVertexType;
+			/// Max mesh complexity, the vertex buffer is created for it so the complexity 
+			/// can be changed with setComplexity(...) without recreating the mesh (0 = MeshComplexity)
+			int MeshMaxComplexity;
 		};
 
         /** Constructor
             @param h Hydrax pointer
+			@param b Water body which owns the mesh, NULL for the main water mesh
+			@param v Camera view which owns the mesh, NULL for the main water mesh
          */
-		Mesh(Hydrax *h);
+		Mesh(Hydrax *h, WaterBody *b = 0, CameraView *v = 0);
 
         /** Destructor
          */
@@ -169,6 +179,152 @@ namespace Hydrax
 		 */
 		bool updateGeometry(const int &numVer, void* verArray);
 
+		/** Update a range of the vertex buffer
+		    @param First First vertex
+			@param NumVertices Number of vertices
+			@param Vertices Vertex array, starting with the first vertex of the range
+			@return false if the range is out of the vertex buffer capacity
+			@remarks The draw range doesn't change, use it for modules which only change some parts of the geometry.
+			         The vertex buffers ring isn't rotated, so don't mix it with updateGeometry(...)
+		 */
+		bool _updateGeometryRange(const int &First, const int &NumVertices, const void* Vertices);
+
+		/** Set the number of vertex buffers, updateGeometry(...) writes them in a ring
+		    @param NumberOfVertexBuffers Number of vertex buffers, [1,3] range
+			@remarks Each full geometry update writes the least recently used buffer, so
+			         the CPU doesn't wait for the GPU to finish with the last frame vertices.
+					 2 by default, use 1 to save memory.
+		 */
+		void setNumberOfVertexBuffers(const int &NumberOfVertexBuffers);
+
+		/** Get the number of vertex buffers
+		    @return Number of vertex buffers in the ring
+		 */
+		inline const int& getNumberOfVertexBuffers() const
+		{
+			return mNumberOfVertexBuffers;
+		}
+
+		/** Get the number of stalled vertex buffer locks
+		    @return Number of vertex buffer locks which have taken more than 1 ms
+			@remarks Use it for tune the number of vertex buffers
+		 */
+		inline const unsigned long& getNumberOfStalledLocks() const
+		{
+			return mNumberOfStalledLocks;
+		}
+
+		/** Change the grid complexity without recreating the mesh
+		    @param Complexity New grid complexity
+			@return false if the mesh geometry has been created by the module or if the 
+			        complexity is over the vertex buffer capacity (Options::MeshMaxComplexity)
+			@remarks Index buffers are cached per complexity, so switching between already used 
+			         complexities only changes the mesh draw range.
+					 Vertices must be packed using the new complexity on the next updateGeometry(...)
+		 */
+		bool setComplexity(const int &Complexity);
+
+		/** Set the active index buffer and number of vertices (draw range)
+		    @param LODKey Level of detail key of an index buffer added with _addIndexBuffer(...)
+			@param NumVertices Number of vertices to draw, starting from the first one
+			@param NumIndices Number of indices to draw, starting from the first one (-1 = all the index buffer)
+			@return false if there isn't an index buffer for the key or NumVertices/NumIndices are over the buffers capacity
+		 */
+		bool _setDrawRange(const int &LODKey, const int &NumVertices, const int &NumIndices = -1);
+
+		/** Add an index buffer for a level of detail
+		    @param LODKey Level of detail key (Module dependent: grid complexity, steps/circles, etc)
+			@param IndexBuffer Index buffer
+		 */
+		void _addIndexBuffer(const int &LODKey, const Ogre::HardwareIndexBufferSharedPtr &IndexBuffer);
+
+		/** Has an index buffer been added for a level of detail?
+		    @param LODKey Level of detail key
+			@return true if it's cached
+		 */
+		bool _hasIndexBuffer(const int &LODKey) const;
+
+		/** Set per-frame indices (triangle list), for modules which build the visible geometry each frame
+		    @param Indices Index array
+			@param NumIndices Number of indices
+			@return false if the mesh isn't created
+			@remarks A dynamic index buffer is used, it's only reallocated if it's too small.
+			         The number of vertices (draw range) doesn't change.
+		 */
+		bool _updateIndexData(const unsigned int *Indices, const int &NumIndices);
+
+		/** Create a static index buffer (triangle list)
+		    @param Indices Index array
+			@param NumIndices Number of indices
+			@return Index buffer
+			@remarks 16-bit indices are used if all indices are under 65536
+		 */
+		static Ogre::HardwareIndexBufferSharedPtr _createIndexBuffer(const unsigned int *Indices, const int &NumIndices);
+
+		/** Reorder the triangles of a triangle list for the post-transform vertex cache
+		    @param Indices Index array, reordered in place
+			@param NumIndices Number of indices
+			@remarks Tom Forsyth's linear-speed vertex cache optimisation, use it on index 
+			         data created once, since it's too slow for per-frame index data.
+					 Triangles are only reordered, the vertices of each triangle keep their order.
+		 */
+		static void _optimizeIndices(unsigned int *Indices, const int &NumIndices);
+
+		/** Get the average cache miss ratio (Vertex shader invocations per triangle) of a triangle list
+		    @param Indices Index array
+			@param NumIndices Number of indices
+			@param CacheSize Simulated FIFO post-transform cache size
+			@return ACMR, 0.5 is the ideal value for big grids and 3 the worst
+		 */
+		static float _getACMR(const unsigned int *Indices, const int &NumIndices, const int &CacheSize = 24);
+
+		/** Get the average cache miss ratio of the current index data
+			@param CacheSize Simulated FIFO post-transform cache size
+		    @return ACMR, 0 if the index data can't be read (Dynamic index data, see _updateIndexData(...))
+		 */
+		float getACMR(const int &CacheSize = 24);
+
+		/** Set the far field ring options
+		    @param Enable true to add a flat ring around the camera, beyond the simulated water
+			@param InnerRadius Distance from the camera where the ring starts
+			@param OuterRadius Distance from the camera where the ring ends
+			@remarks The ring is a cheap static-topology annulus rendered with the water material, 
+			         so modules only need to cover the inner radius.
+			         Call it before create(...), use Hydrax::setFarField(...) if the mesh is already created.
+		 */
+		void setFarField(const bool &Enable, const float &InnerRadius, const float &OuterRadius);
+
+		/** Is the far field ring enabled?
+		    @return true if yes, false if not
+		 */
+		inline const bool& isFarFieldEnabled() const
+		{
+			return mFarFieldEnabled;
+		}
+
+		/** Get the far field inner radius
+		    @return Far field inner radius
+		 */
+		inline const float& getFarFieldInnerRadius() const
+		{
+			return mFarFieldInnerRadius;
+		}
+
+		/** Get the far field outer radius
+		    @return Far field outer radius
+		 */
+		inline const float& getFarFieldOuterRadius() const
+		{
+			return mFarFieldOuterRadius;
+		}
+
+		/** Center the far field ring on the camera
+		    @param CameraPosition World-space camera position
+			@remarks Called by Hydrax::update(...), the vertex buffer is only rewritten 
+			         when the camera has moved a noticeable distance
+		 */
+		void _updateFarField(const Ogre::Vector3 &CameraPosition);
+
 		/** Get if a Position point is inside of the grid
 		    @param Position World-space point
 			@return true if Position point is inside of the grid, else false.
@@ -181,6 +337,27 @@ namespace Hydrax
 		 */
 		Ogre::Vector2 getGridPosition(const Ogre::Vector2 &Position);
 
+		/** Get the [0,1] range x/y grid positions of some 2D world space x/z points
+		    @param Positions World-space points
+			@param GridPositions Output grid positions, (-1,-1) for points which aren't in the grid
+			@param Count Number of points
+			@remarks The world -> grid transform is cached and only recomputed when the 
+			         mesh is moved/rotated, so each point only costs a few multiply-adds
+		 */
+		void getGridPositions(const Ogre::Vector2 *Positions, Ogre::Vector2 *GridPositions, const int &Count);
+
+		/** Get the world-space x/z -> [0,1] grid x/y affine transform
+		    @param X Grid x = X.x*World.x + X.y*World.z + X.z (Output)
+			@param Y Grid y = Y.x*World.x + Y.y*World.z + Y.z (Output)
+			@remarks Only valid if the mesh is created
+		 */
+		void getGridTransform(Ogre::Vector3 &X, Ogre::Vector3 &Y);
+
+		/** Update the cached world-space -> grid-space transform if the mesh has been moved/rotated
+		    @remarks Call it before querying grid positions from several threads, queries then only read the cache
+		 */
+		void _refreshGridTransform();
+
 	    /** Get the object-space position from world-space position
 		    @param WorldSpacePosition Position in world coords
 			@return Position in object-space
@@ -209,6 +386,14 @@ namespace Hydrax
             return mSubMesh;
         }
 
+		/** Get the far field sub mesh
+		    @return Far field sub mesh, 0 if the far field isn't enabled
+		 */
+		inline Ogre::SubMesh* getFarFieldSubMesh()
+		{
+			return mFarFieldSubMesh;
+		}
+
         /** Get entity
             @return Entity
          */
@@ -257,6 +442,14 @@ namespace Hydrax
             return mNumVertices;
         }
 
+		/** Get vertex buffer capacity
+		    @return Max number of vertices which can be drawn without recreating the mesh
+		 */
+		inline int getVertexCapacity() const
+		{
+			return mVertexBuffer.isNull() ? 0 : static_cast<int>(mVertexBuffer->getNumVertices());
+		}
+
         /** Get material name
             @return Material name
          */
@@ -289,6 +482,27 @@ namespace Hydrax
 			return mSceneNode;
 		}
 
+		/** Get the transform revision, it changes each time the mesh scene node is moved or rotated
+		    @return Transform revision (Never 0)
+			@remarks Use it to cache world-space data in modules
+		 */
+		inline const unsigned int& getTransformRevision() const
+		{
+			return mTransformRevision;
+		}
+
+		/** Notify that the mesh scene node has been moved or rotated
+		    @remarks Called by Hydrax::setPosition(...) and Hydrax::rotate(...)
+		 */
+		inline void _notifyTransformChanged()
+		{
+			// Skip 0, modules use it as invalid revision
+			if (++mTransformRevision == 0)
+			{
+				mTransformRevision = 1;
+			}
+		}
+
 		/** Is _createGeometry() called?
 		    @return true if created() have been already called
 		 */
@@ -298,10 +512,48 @@ namespace Hydrax
 		}
 
     private:
+		/** Get the position of the water which owns the mesh
+		    @return Hydrax or water body position
+		 */
+		const Ogre::Vector3& _getPosition() const;
+
 		/** Create mesh geometry
 		 */
 		void _createGeometry();
 
+		/** Create the index buffer of a complexity*complexity grid
+		    @param Complexity Grid complexity
+			@return Index buffer
+		 */
+		Ogre::HardwareIndexBufferSharedPtr _createGridIndexBuffer(const int &Complexity) const;
+
+		/** Create the vertex buffers ring from the current vertex buffer
+		 */
+		void _createVertexBufferRing();
+
+		/** Write data in the current vertex buffer, counting stalled locks
+		    @param Offset Offset in bytes
+			@param Length Length in bytes
+			@param Source Source data
+			@param Discard Discard the whole buffer contents?
+			@remarks Only the lock is timed, the copy time depends on the data size
+		 */
+		void _writeVertexBuffer(const size_t &Offset, const size_t &Length, const void* Source, const bool &Discard);
+
+		/** Create the far field ring sub mesh
+		 */
+		void _createFarFieldGeometry();
+
+		/** Get the mesh bounds for some options
+		    @param Options Mesh options
+			@return Object-space mesh bounds
+		 */
+		Ogre::AxisAlignedBox _getMeshBounds(const Options &Options) const;
+
+		/** Update the cached world-space -> grid-space affine transform
+		 */
+		void _updateGridTransform();
+
         /// Mesh options
         Options mOptions;
 		/// Is _createGeometry() called?
@@ -319,17 +571,62 @@ namespace Hydrax
 
         /// Vertex buffer
         Ogre::HardwareVertexBufferSharedPtr mVertexBuffer;
+		/// Vertex buffers ring, mVertexBuffer is the current one
+		std::vector<Ogre::HardwareVertexBufferSharedPtr> mVertexBuffers;
+		/// Number of vertex buffers
+		int mNumberOfVertexBuffers;
+		/// Current vertex buffer of the ring
+		int mCurrentVertexBuffer;
+		/// Number of stalled vertex buffer locks
+		unsigned long mNumberOfStalledLocks;
+		/// Timer for detect stalled locks
+		Ogre::Timer mLockTimer;
         /// Index buffer
         Ogre::HardwareIndexBufferSharedPtr  mIndexBuffer;
+		/// Cached index buffers per level of detail
+		std::map<int, Ogre::HardwareIndexBufferSharedPtr> mIndexBuffers;
+		/// Dynamic index buffer (See _updateIndexData(...))
+		Ogre::HardwareIndexBufferSharedPtr mDynamicIndexBuffer;
+		/// Is the geometry created by Mesh::_createGeometry()? (Not by the module)
+		bool mDefaultGeometry;
+
+		/// Is the far field ring enabled?
+		bool mFarFieldEnabled;
+		/// Far field inner radius
+		float mFarFieldInnerRadius;
+		/// Far field outer radius
+		float mFarFieldOuterRadius;
+		/// Far field sub mesh
+		Ogre::SubMesh *mFarFieldSubMesh;
+		/// Far field vertex buffer
+		Ogre::HardwareVertexBufferSharedPtr mFarFieldVertexBuffer;
+		/// Object-space x/z center of the far field ring
+		Ogre::Vector2 mFarFieldCenter;
+		/// Has the far field ring been placed?
+		bool mFarFieldValid;
 
 		/// Ogre::SceneNode pointer
 		Ogre::SceneNode* mSceneNode;
+		/// Scene node transform revision
+		unsigned int mTransformRevision;
+		/// Cached world-space x/z -> grid x affine transform (x, z and constant coefficients)
+		Ogre::Vector3 mGridTransformX;
+		/// Cached world-space x/z -> grid y affine transform (x, z and constant coefficients)
+		Ogre::Vector3 mGridTransformY;
+		/// Transform revision of the cached grid transform
+		unsigned int mGridTransformRevision;
 
         /// Material name
         Ogre::String mMaterialName;
 
         /// Hydrax pointer
 		Hydrax *mHydrax;
+		/// Water body which owns the mesh, NULL for the main water mesh
+		WaterBody *mWaterBody;
+		/// Camera view which owns the mesh, NULL for the main water mesh
+		CameraView *mCameraView;
+		/// Ogre mesh name, the entity name is the mesh name + "Ent"
+		Ogre::String mMeshName;
     };
 }
 
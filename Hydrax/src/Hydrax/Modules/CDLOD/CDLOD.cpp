@@ -0,0 +1,594 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#include "CDLOD.h"
+
+namespace Hydrax{namespace Module
+{
+	Mesh::VertexType _CDLOD_getVertexTypeFromNormalMode(const MaterialManager::NormalMode& NormalMode)
+	{
+		if (NormalMode == MaterialManager::NM_VERTEX)
+		{
+			return Mesh::VT_POS_NORM;
+		}
+
+		// NM_RTT
+		return Mesh::VT_POS;
+	}
+
+	Ogre::String _CDLOD_getNormalModeString(const MaterialManager::NormalMode& NormalMode)
+	{
+		if (NormalMode == MaterialManager::NM_VERTEX)
+		{
+			return "Vertex";
+		}
+
+		return "Rtt";
+	}
+
+	float _CDLOD_getDistance(const Ogre::AxisAlignedBox &Box, const Ogre::Vector3 &Point)
+	{
+		const Ogre::Vector3 &Min = Box.getMinimum(),
+			                &Max = Box.getMaximum();
+
+		float dx = std::max(0.0f, std::max(Min.x - Point.x, Point.x - Max.x)),
+			  dy = std::max(0.0f, std::max(Min.y - Point.y, Point.y - Max.y)),
+			  dz = std::max(0.0f, std::max(Min.z - Point.z, Point.z - Max.z));
+
+		return Ogre::Math::Sqrt(dx*dx + dy*dy + dz*dz);
+	}
+
+	CDLOD::CDLOD(Hydrax *h, Noise::Noise *n, const MaterialManager::NormalMode& NormalMode)
+		: Module("CDLOD" + _CDLOD_getNormalModeString(NormalMode),
+		         n, Mesh::Options(0, Size(16384), _CDLOD_getVertexTypeFromNormalMode(NormalMode)), NormalMode, h)
+		, mVertices(0)
+		, mPatchVertices(0)
+		, mPatchX(0)
+		, mPatchZ(0)
+		, mPatchHeights(0)
+		, mOrigin(Ogre::Vector3(0,0,0))
+		, mCameraPosition(Ogre::Vector3(0,0,0))
+	{
+	}
+
+	CDLOD::CDLOD(Hydrax *h, Noise::Noise *n, const MaterialManager::NormalMode& NormalMode, const Options &Options)
+		: Module("CDLOD" + _CDLOD_getNormalModeString(NormalMode),
+		         n, Mesh::Options(0, Size(Options.WorldSize), _CDLOD_getVertexTypeFromNormalMode(NormalMode)), NormalMode, h)
+		, mVertices(0)
+		, mPatchVertices(0)
+		, mPatchX(0)
+		, mPatchZ(0)
+		, mPatchHeights(0)
+		, mOrigin(Ogre::Vector3(0,0,0))
+		, mCameraPosition(Ogre::Vector3(0,0,0))
+	{
+		setOptions(Options);
+	}
+
+	CDLOD::~CDLOD()
+	{
+		remove();
+
+		HydraxLOG(getName() + " destroyed.");
+	}
+
+	void CDLOD::setOptions(const Options &Options)
+	{
+		// The pipelined update (if any) mustn't be running while options change
+		mHydrax->_waitForAsyncUpdate();
+
+		mMeshOptions.MeshSize     = Size(Options.WorldSize);
+		mMeshOptions.MeshStrength = Options.Strength;
+
+		_applyMeshOptions();
+
+		if (isCreated())
+		{
+			if (Options.PatchComplexity != mOptions.PatchComplexity || Options.MaxNodes != mOptions.MaxNodes)
+			{
+				remove();
+				mOptions = Options;
+				create();
+
+				if (mNormalMode == MaterialManager::NM_RTT)
+				{
+					if (!mNoise->createGPUNormalMapResources(mHydrax->getGPUNormalMapManager()))
+					{
+						HydraxLOG(mNoise->getName() + " doesn't support GPU Normal map generation.");
+					}
+				}
+
+				Ogre::String MaterialNameTmp = _getMesh()->getMaterialName();
+				_getMesh()->remove();
+				_getMesh()->setOptions(getMeshOptions());
+				_getMesh()->setMaterialName(MaterialNameTmp);
+				_getMesh()->create();
+
+				return;
+			}
+
+			// World size, levels and ranges only change the node selection
+			mOptions = Options;
+
+			_calculeRanges();
+
+			return;
+		} 
+
+		mOptions = Options;
+	}
+
+	void CDLOD::create()
+	{
+		HydraxLOG("Creating " + getName() + " module.");
+
+		Module::create();
+
+		mPatchVertices = (mOptions.PatchComplexity+1)*(mOptions.PatchComplexity+1);
+
+		if (getNormalMode() == MaterialManager::NM_VERTEX)
+		{
+			mVertices = new Mesh::POS_NORM_VERTEX[mOptions.MaxNodes*mPatchVertices];
+		}
+		else if (getNormalMode() == MaterialManager::NM_RTT)
+		{
+			mVertices = new Mesh::POS_VERTEX[mOptions.MaxNodes*mPatchVertices];
+		}
+
+		mPatchX       = new float[mPatchVertices];
+		mPatchZ       = new float[mPatchVertices];
+		mPatchHeights = new float[mPatchVertices];
+
+		_calculeRanges();
+
+		HydraxLOG(getName() + " created.");
+	}
+
+	const bool CDLOD::_createGeometry(Mesh *mMesh) const
+	{
+		const int &N = mOptions.PatchComplexity;
+		int PatchVertices = (N+1)*(N+1),
+			numVertices = mOptions.MaxNodes*PatchVertices;
+
+		// Vertex buffers
+		mMesh->getSubMesh()->vertexData = new Ogre::VertexData();
+		mMesh->getSubMesh()->vertexData->vertexStart = 0;
+		mMesh->getSubMesh()->vertexData->vertexCount = numVertices;
+
+		Ogre::VertexDeclaration* vdecl = mMesh->getSubMesh()->vertexData->vertexDeclaration;
+		Ogre::VertexBufferBinding* vbind = mMesh->getSubMesh()->vertexData->vertexBufferBinding;
+
+		size_t offset = 0;
+
+		switch (mMeshOptions.MeshVertexType)
+		{
+		    case Mesh::VT_POS_NORM:
+			{
+				vdecl->addElement(0, 0, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+		        offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+		        vdecl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
+
+				mMesh->getHardwareVertexBuffer() = Ogre::HardwareBufferManager::getSingleton().
+					createVertexBuffer(sizeof(Mesh::POS_NORM_VERTEX),
+			                           numVertices,
+			                           Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+			}
+			break;
+
+			case Mesh::VT_POS:
+			{
+				vdecl->addElement(0, 0, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+
+				mMesh->getHardwareVertexBuffer() = Ogre::HardwareBufferManager::getSingleton().
+					createVertexBuffer(sizeof(Mesh::POS_VERTEX),
+			                           numVertices,
+			                           Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+			}
+			break;
+
+			default:
+			{
+				HydraxLOG("Error in CDLOD::_createGeometry: Unsupported vertex type, the default geometry will be used.");
+
+				// The mesh creates its own vertex data for the default geometry
+				delete mMesh->getSubMesh()->vertexData;
+				mMesh->getSubMesh()->vertexData = 0;
+
+				return false;
+			}
+			break;
+		}
+
+		vbind->setBinding(0, mMesh->getHardwareVertexBuffer());
+
+		// The same patch for all nodes, one after another, so only the draw range changes each frame
+		int PatchIndices = 6*N*N,
+			numEle = mOptions.MaxNodes * PatchIndices;
+
+		unsigned int *indexbuffer = new unsigned int[numEle];
+		unsigned int *face = indexbuffer;
+
+		for(int v=0; v<N; v++)
+		{
+			for(int u=0; u<N; u++)
+			{
+				// face 1 |/
+				face[0] = v*(N+1) + u;
+				face[1] = v*(N+1) + u + 1;
+				face[2] = (v+1)*(N+1) + u;
+
+				// face 2 /|
+				face[3] = (v+1)*(N+1) + u;
+				face[4] = v*(N+1) + u + 1;
+				face[5] = (v+1)*(N+1) + u + 1;
+
+				face += 6;
+			}
+		}
+
+		// Optimized per patch, so any number of nodes can be drawn
+		Mesh::_optimizeIndices(indexbuffer, PatchIndices);
+
+		for (int Node = 1; Node < mOptions.MaxNodes; Node++)
+		{
+			unsigned int First = static_cast<unsigned int>(Node*PatchVertices);
+
+			for (int k = 0; k < PatchIndices; k++)
+			{
+				face[k] = First + indexbuffer[k];
+			}
+
+			face += PatchIndices;
+		}
+
+		mMesh->_addIndexBuffer(0, Mesh::_createIndexBuffer(indexbuffer, numEle));
+		mMesh->_setDrawRange(0, 0, 0);
+
+		delete []indexbuffer;
+
+		return true;
+	}
+
+	void CDLOD::remove()
+	{
+		if (!isCreated())
+		{
+			return;
+		}
+
+		Module::remove();
+
+		if (mVertices)
+		{
+			if (getNormalMode() == MaterialManager::NM_VERTEX)
+			{
+				delete [] static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+			}
+			else if (getNormalMode() == MaterialManager::NM_RTT)
+			{
+				delete [] static_cast<Mesh::POS_VERTEX*>(mVertices);
+			}
+
+			mVertices = 0;
+		}
+
+		delete [] mPatchX;
+		delete [] mPatchZ;
+		delete [] mPatchHeights;
+
+		mPatchX = mPatchZ = mPatchHeights = 0;
+		mPatchVertices = 0;
+
+		mRanges.clear();
+		mMorphStart.clear();
+		mMorphScale.clear();
+		mSelectedNodes.clear();
+	}
+
+	void CDLOD::saveCfg(Ogre::String &Data)
+	{
+		Module::saveCfg(Data);
+
+		Data += CfgFileManager::_getCfgString("CDLOD_WorldSize", mOptions.WorldSize);
+		Data += CfgFileManager::_getCfgString("CDLOD_PatchComplexity", mOptions.PatchComplexity);
+		Data += CfgFileManager::_getCfgString("CDLOD_LODLevels", mOptions.LODLevels);
+		Data += CfgFileManager::_getCfgString("CDLOD_LODDistance", mOptions.LODDistance);
+		Data += CfgFileManager::_getCfgString("CDLOD_MorphRatio", mOptions.MorphRatio);
+		Data += CfgFileManager::_getCfgString("CDLOD_MaxNodes", mOptions.MaxNodes);
+		Data += CfgFileManager::_getCfgString("CDLOD_Strength", mOptions.Strength);Data += "\n";
+	}
+
+	bool CDLOD::loadCfg(Ogre::ConfigFile &CfgFile)
+	{
+		if (!Module::loadCfg(CfgFile))
+		{
+			return false;
+		}
+
+		setOptions(
+			Options(CfgFileManager::_getFloatValue(CfgFile, "CDLOD_WorldSize"),
+			        CfgFileManager::_getIntValue(CfgFile,   "CDLOD_PatchComplexity"),
+					CfgFileManager::_getIntValue(CfgFile,   "CDLOD_LODLevels"),
+					CfgFileManager::_getFloatValue(CfgFile, "CDLOD_LODDistance"),
+					CfgFileManager::_getFloatValue(CfgFile, "CDLOD_MorphRatio"),
+					CfgFileManager::_getIntValue(CfgFile,   "CDLOD_MaxNodes"),
+					CfgFileManager::_getFloatValue(CfgFile, "CDLOD_Strength")));
+
+		return true;
+	}
+
+	void CDLOD::_calculeRanges()
+	{
+		mRanges.resize(mOptions.LODLevels);
+		mMorphStart.resize(mOptions.LODLevels);
+		mMorphScale.resize(mOptions.LODLevels);
+
+		float PreviousRange = 0;
+
+		for (int Level = 0; Level < mOptions.LODLevels; Level++)
+		{
+			mRanges[Level] = mOptions.LODDistance * static_cast<float>(1 << Level);
+
+			// Morph in the last part of the range, at the range end vertices are in the next level positions
+			mMorphStart[Level] = mRanges[Level] - mOptions.MorphRatio*(mRanges[Level]-PreviousRange);
+			mMorphScale[Level] = 1.0f / std::max(mRanges[Level]-mMorphStart[Level], 0.0001f);
+
+			PreviousRange = mRanges[Level];
+		}
+	}
+
+	void CDLOD::update(const Ogre::Real &timeSinceLastFrame)
+	{
+		if (!isCreated())
+		{
+			return;
+		}
+
+		Module::update(timeSinceLastFrame);
+
+		// The mesh scene node is placed at the water position - WorldSize/2
+		mOrigin = _getPosition() - Ogre::Vector3(mOptions.WorldSize/2, 0, mOptions.WorldSize/2);
+		mCameraPosition = _getCamera()->getDerivedPosition();
+
+		// Quadtree node selection
+		mSelectedNodes.clear();
+
+		int Root = mOptions.LODLevels-1;
+
+		if (!_selectNode(0, 0, mOptions.WorldSize, Root) && 
+			_getCamera()->isVisible(_getNodeBox(0, 0, mOptions.WorldSize)))
+		{
+			_addNode(0, 0, mOptions.WorldSize, Root);
+		}
+
+		// Update patches
+		for (int Node = 0; Node < static_cast<int>(mSelectedNodes.size()); Node++)
+		{
+			_updateNode(Node);
+		}
+
+		int NumberOfNodes = static_cast<int>(mSelectedNodes.size());
+
+		_getMesh()->_setDrawRange(0, NumberOfNodes*mPatchVertices, NumberOfNodes*6*mOptions.PatchComplexity*mOptions.PatchComplexity);
+
+		// Upload geometry changes
+		if (NumberOfNodes > 0)
+		{
+			_getMesh()->updateGeometry(NumberOfNodes*mPatchVertices, mVertices);
+		}
+	}
+
+	Ogre::AxisAlignedBox CDLOD::_getNodeBox(const float &x, const float &z, const float &Size) const
+	{
+		return Ogre::AxisAlignedBox(
+			mOrigin.x + x,      mOrigin.y - mOptions.Strength, mOrigin.z + z,
+			mOrigin.x + x+Size, mOrigin.y + mOptions.Strength, mOrigin.z + z+Size);
+	}
+
+	bool CDLOD::_selectNode(const float &x, const float &z, const float &Size, const int &Level)
+	{
+		Ogre::AxisAlignedBox Box = _getNodeBox(x, z, Size);
+
+		float Distance = _CDLOD_getDistance(Box, mCameraPosition);
+
+		if (Distance > mRanges[Level])
+		{
+			return false;
+		}
+
+		// Out of the frustum, there's nothing to draw
+		if (!_getCamera()->isVisible(Box))
+		{
+			return true;
+		}
+
+		// The whole node is out of the next level range
+		if (Level == 0 || Distance > mRanges[Level-1])
+		{
+			_addNode(x, z, Size, Level);
+
+			return true;
+		}
+
+		float HalfSize = Size/2;
+
+		for (int k = 0; k < 4; k++)
+		{
+			float cx = x + (k & 1)*HalfSize,
+				  cz = z + (k >> 1)*HalfSize;
+
+			// Children out of their range: draw their area with the child patch, fully morphed 
+			// it has the resolution of this level
+			if (!_selectNode(cx, cz, HalfSize, Level-1) &&
+				_getCamera()->isVisible(_getNodeBox(cx, cz, HalfSize)))
+			{
+				_addNode(cx, cz, HalfSize, Level-1);
+			}
+		}
+
+		return true;
+	}
+
+	void CDLOD::_addNode(const float &x, const float &z, const float &Size, const int &Level)
+	{
+		if (static_cast<int>(mSelectedNodes.size()) >= mOptions.MaxNodes)
+		{
+			return;
+		}
+
+		SelectedNode Node;
+
+		Node.x = x;
+		Node.z = z;
+		Node.Size = Size;
+		Node.Level = Level;
+
+		mSelectedNodes.push_back(Node);
+	}
+
+	void CDLOD::_updateNode(const int &NodeIndex)
+	{
+		const SelectedNode &Node = mSelectedNodes[NodeIndex];
+		const int &N = mOptions.PatchComplexity;
+
+		float Cell = Node.Size/N,
+			  MorphStart = mMorphStart[Node.Level],
+			  MorphScale = mMorphScale[Node.Level],
+			  dy = mOrigin.y - mCameraPosition.y,
+			  dx, dz, Morph;
+
+		int i, j, k = 0;
+
+		// Morph odd vertices towards the previous even vertex (next level grid) by camera distance
+		for (i = 0; i <= N; i++)
+		{
+			for (j = 0; j <= N; j++, k++)
+			{
+				dx = mOrigin.x + Node.x + i*Cell - mCameraPosition.x;
+				dz = mOrigin.z + Node.z + j*Cell - mCameraPosition.z;
+
+				Morph = Ogre::Math::Sqrt(dx*dx + dy*dy + dz*dz);
+				Morph = std::min(1.0f, std::max(0.0f, (Morph-MorphStart)*MorphScale));
+
+				mPatchX[k] = Node.x + (i - (i & 1)*Morph)*Cell;
+				mPatchZ[k] = Node.z + (j - (j & 1)*Morph)*Cell;
+			}
+		}
+
+		// Heights, noise is sampled in world-space
+		mNoise->getValues(mPatchX, mPatchZ, mPatchVertices, mPatchHeights, mOrigin.x, mOrigin.z, mOptions.Strength);
+
+		int First = NodeIndex*mPatchVertices;
+
+		if (getNormalMode() == MaterialManager::NM_RTT)
+		{
+			Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices) + First;
+
+			for (k = 0; k < mPatchVertices; k++)
+			{
+				Vertices[k].x = mPatchX[k];
+				Vertices[k].y = mPatchHeights[k];
+				Vertices[k].z = mPatchZ[k];
+			}
+
+			return;
+		}
+
+		Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices) + First;
+
+		int ip, im, jp, jm, a, b;
+		Ogre::Vector3 vec1, vec2, normal;
+
+		for (i = 0, k = 0; i <= N; i++)
+		{
+			for (j = 0; j <= N; j++, k++)
+			{
+				// Neighbours clamped to the patch, skip the collapsed ones of fully morphed vertices
+				ip = std::min(i+1, N); im = std::max(i-1, 0);
+
+				if (mPatchX[ip*(N+1) + j] == mPatchX[im*(N+1) + j])
+				{
+					ip = std::min(i+2, N); im = std::max(i-2, 0);
+				}
+
+				jp = std::min(j+1, N); jm = std::max(j-1, 0);
+
+				if (mPatchZ[i*(N+1) + jp] == mPatchZ[i*(N+1) + jm])
+				{
+					jp = std::min(j+2, N); jm = std::max(j-2, 0);
+				}
+
+				a = i*(N+1) + jp; b = i*(N+1) + jm;
+				vec1 = Ogre::Vector3(mPatchX[a]-mPatchX[b], mPatchHeights[a]-mPatchHeights[b], mPatchZ[a]-mPatchZ[b]);
+
+				a = ip*(N+1) + j; b = im*(N+1) + j;
+				vec2 = Ogre::Vector3(mPatchX[a]-mPatchX[b], mPatchHeights[a]-mPatchHeights[b], mPatchZ[a]-mPatchZ[b]);
+
+				normal = vec2.crossProduct(vec1);
+
+				Vertices[k].x  = mPatchX[k];
+				Vertices[k].y  = mPatchHeights[k];
+				Vertices[k].z  = mPatchZ[k];
+				Vertices[k].nx = normal.x;
+				Vertices[k].ny = normal.y;
+				Vertices[k].nz = normal.z;
+			}
+		}
+	}
+
+	float CDLOD::getHeigth(const Ogre::Vector2 &Position)
+	{
+		return _getPosition().y + mNoise->getValue(Position.x, Position.y)*mOptions.Strength;
+	}
+
+	void CDLOD::getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid)
+	{
+		_getNoiseHeigths(Positions, Heigths, Count, _getPosition().y, mOptions.Strength);
+
+		if (Valid)
+		{
+			std::fill(Valid, Valid+Count, true);
+		}
+	}
+
+	void CDLOD::getSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, bool *Valid)
+	{
+		_getNoiseSurfaceSamples(Positions, Samples, Count, _getPosition().y, mOptions.Strength);
+
+		if (Valid)
+		{
+			std::fill(Valid, Valid+Count, true);
+		}
+	}
+
+	bool CDLOD::getSurfaceBounds(float &MaxDisplacement, float &MaxSlope)
+	{
+		return _getNoiseSurfaceBounds(mOptions.Strength, MaxDisplacement, MaxSlope);
+	}
+
+	WaterState* CDLOD::_createWaterState()
+	{
+		return _createInfiniteWaterState(_getPosition().y, mOptions.Strength);
+	}
+}}
@@ -0,0 +1,689 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#include "Clipmap.h"
+
+namespace Hydrax{namespace Module
+{
+	Mesh::VertexType _CM_getVertexTypeFromNormalMode(const MaterialManager::NormalMode& NormalMode)
+	{
+		if (NormalMode == MaterialManager::NM_VERTEX)
+		{
+			return Mesh::VT_POS_NORM;
+		}
+
+		// NM_RTT
+		return Mesh::VT_POS;
+	}
+
+	Ogre::String _CM_getNormalModeString(const MaterialManager::NormalMode& NormalMode)
+	{
+		if (NormalMode == MaterialManager::NM_VERTEX)
+		{
+			return "Vertex";
+		}
+
+		return "Rtt";
+	}
+
+	Clipmap::Clipmap(Hydrax *h, Noise::Noise *n, const MaterialManager::NormalMode& NormalMode)
+		: Module("Clipmap" + _CM_getNormalModeString(NormalMode),
+		         n, Mesh::Options(0, Size(0), _CM_getVertexTypeFromNormalMode(NormalMode)), NormalMode, h)
+		, mVertices(0)
+		, mLevelVertices(0)
+		, mLatticeX(0)
+		, mLatticeZ(0)
+		, mHeights(0)
+		, mPosition(Ogre::Vector3(0,0,0))
+		, mMeshRevision(0)
+		, mFrame(0)
+		, mNumberOfSamples(0)
+	{
+	}
+
+	Clipmap::Clipmap(Hydrax *h, Noise::Noise *n, const MaterialManager::NormalMode& NormalMode, const Options &Options)
+		: Module("Clipmap" + _CM_getNormalModeString(NormalMode),
+		         n, Mesh::Options(0, Size(0), _CM_getVertexTypeFromNormalMode(NormalMode)), NormalMode, h)
+		, mVertices(0)
+		, mLevelVertices(0)
+		, mLatticeX(0)
+		, mLatticeZ(0)
+		, mHeights(0)
+		, mPosition(Ogre::Vector3(0,0,0))
+		, mMeshRevision(0)
+		, mFrame(0)
+		, mNumberOfSamples(0)
+	{
+		setOptions(Options);
+	}
+
+	Clipmap::~Clipmap()
+	{
+		remove();
+
+		HydraxLOG(getName() + " destroyed.");
+	}
+
+	void Clipmap::setOptions(const Options &Options)
+	{
+		// The pipelined update (if any) mustn't be running while options change
+		mHydrax->_waitForAsyncUpdate();
+
+		mMeshOptions.MeshSize     = Size(0);
+		mMeshOptions.MeshStrength = Options.Strength;
+
+		_applyMeshOptions();
+
+		if (isCreated())
+		{
+			if (Options.Resolution != mOptions.Resolution || Options.Levels != mOptions.Levels)
+			{
+				remove();
+				mOptions = Options;
+				create();
+
+				if (mNormalMode == MaterialManager::NM_RTT)
+				{
+					if (!mNoise->createGPUNormalMapResources(mHydrax->getGPUNormalMapManager()))
+					{
+						HydraxLOG(mNoise->getName() + " doesn't support GPU Normal map generation.");
+					}
+				}
+
+				Ogre::String MaterialNameTmp = _getMesh()->getMaterialName();
+				_getMesh()->remove();
+				_getMesh()->setOptions(getMeshOptions());
+				_getMesh()->setMaterialName(MaterialNameTmp);
+				_getMesh()->create();
+
+				return;
+			}
+
+			mOptions = Options;
+
+			// Grid spacing or strength changes invalidate all levels
+			for (int l = 0; l < mOptions.Levels; l++)
+			{
+				mLevels[l].Valid = false;
+			}
+
+			return;
+		} 
+
+		if (Options.Resolution % 4 != 0 || Options.Resolution < 4)
+		{
+			HydraxLOG(getName() + ": Resolution must be a multiple of 4, using 64.");
+
+			mOptions = Options;
+			mOptions.Resolution = 64;
+
+			return;
+		}
+
+		mOptions = Options;
+	}
+
+	void Clipmap::create()
+	{
+		HydraxLOG("Creating " + getName() + " module.");
+
+		Module::create();
+
+		mLevelVertices = (mOptions.Resolution+1)*(mOptions.Resolution+1);
+
+		int NumberOfVertices = mOptions.Levels*mLevelVertices;
+
+		if (getNormalMode() == MaterialManager::NM_VERTEX)
+		{
+			mVertices = new Mesh::POS_NORM_VERTEX[NumberOfVertices];
+		}
+		else if (getNormalMode() == MaterialManager::NM_RTT)
+		{
+			mVertices = new Mesh::POS_VERTEX[NumberOfVertices];
+		}
+
+		mLatticeX = new float[NumberOfVertices];
+		mLatticeZ = new float[NumberOfVertices];
+		mHeights  = new float[NumberOfVertices];
+
+		mLevels.resize(mOptions.Levels);
+
+		for (int l = 0; l < mOptions.Levels; l++)
+		{
+			mLevels[l].OriginX = mLevels[l].OriginZ = 0;
+			mLevels[l].Valid = false;
+			mLevels[l].Dirty = false;
+		}
+
+		mFrame = 0;
+
+		HydraxLOG(getName() + " created.");
+	}
+
+	const bool Clipmap::_createGeometry(Mesh *mMesh) const
+	{
+		const unsigned int N = mOptions.Resolution+1;
+		int numVertices = mOptions.Levels*N*N;
+
+		// Vertex buffers
+		mMesh->getSubMesh()->vertexData = new Ogre::VertexData();
+		mMesh->getSubMesh()->vertexData->vertexStart = 0;
+		mMesh->getSubMesh()->vertexData->vertexCount = numVertices;
+
+		Ogre::VertexDeclaration* vdecl = mMesh->getSubMesh()->vertexData->vertexDeclaration;
+		Ogre::VertexBufferBinding* vbind = mMesh->getSubMesh()->vertexData->vertexBufferBinding;
+
+		size_t offset = 0;
+
+		switch (mMeshOptions.MeshVertexType)
+		{
+		    case Mesh::VT_POS_NORM:
+			{
+				vdecl->addElement(0, 0, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+		        offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+		        vdecl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
+
+				mMesh->getHardwareVertexBuffer() = Ogre::HardwareBufferManager::getSingleton().
+					createVertexBuffer(sizeof(Mesh::POS_NORM_VERTEX),
+			                           numVertices,
+			                           Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+			}
+			break;
+
+			case Mesh::VT_POS:
+			{
+				vdecl->addElement(0, 0, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+
+				mMesh->getHardwareVertexBuffer() = Ogre::HardwareBufferManager::getSingleton().
+					createVertexBuffer(sizeof(Mesh::POS_VERTEX),
+			                           numVertices,
+			                           Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+			}
+			break;
+
+			default:
+			{
+				HydraxLOG("Error in Clipmap::_createGeometry: Unsupported vertex type, the default geometry will be used.");
+
+				// The mesh creates its own vertex data for the default geometry
+				delete mMesh->getSubMesh()->vertexData;
+				mMesh->getSubMesh()->vertexData = 0;
+
+				return false;
+			}
+			break;
+		}
+
+		vbind->setBinding(0, mMesh->getHardwareVertexBuffer());
+
+		// Placeholder index buffer (a single quad) until the first update builds the levels indices
+		unsigned int indexbuffer[6] = {0, 1, N, N, 1, N+1};
+
+		mMesh->_addIndexBuffer(0, Mesh::_createIndexBuffer(indexbuffer, 6));
+		mMesh->_setDrawRange(0, numVertices, 0);
+
+		return true;
+	}
+
+	void Clipmap::remove()
+	{
+		if (!isCreated())
+		{
+			return;
+		}
+
+		Module::remove();
+
+		if (mVertices)
+		{
+			if (getNormalMode() == MaterialManager::NM_VERTEX)
+			{
+				delete [] static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+			}
+			else if (getNormalMode() == MaterialManager::NM_RTT)
+			{
+				delete [] static_cast<Mesh::POS_VERTEX*>(mVertices);
+			}
+
+			mVertices = 0;
+		}
+
+		delete [] mLatticeX;
+		delete [] mLatticeZ;
+		delete [] mHeights;
+
+		mLatticeX = mLatticeZ = mHeights = 0;
+		mLevelVertices = 0;
+
+		mLevels.clear();
+		mIndices.clear();
+		mScratch.clear();
+		mScratchSlots.clear();
+	}
+
+	void Clipmap::saveCfg(Ogre::String &Data)
+	{
+		Module::saveCfg(Data);
+
+		Data += CfgFileManager::_getCfgString("CM_Resolution", mOptions.Resolution);
+		Data += CfgFileManager::_getCfgString("CM_Levels", mOptions.Levels);
+		Data += CfgFileManager::_getCfgString("CM_CellSize", mOptions.CellSize);
+		Data += CfgFileManager::_getCfgString("CM_Strength", mOptions.Strength);
+		Data += CfgFileManager::_getCfgString("CM_UpdatePeriod", mOptions.UpdatePeriod);Data += "\n";
+	}
+
+	bool Clipmap::loadCfg(Ogre::ConfigFile &CfgFile)
+	{
+		if (!Module::loadCfg(CfgFile))
+		{
+			return false;
+		}
+
+		setOptions(
+			Options(CfgFileManager::_getIntValue(CfgFile,   "CM_Resolution"),
+			        CfgFileManager::_getIntValue(CfgFile,   "CM_Levels"),
+					CfgFileManager::_getFloatValue(CfgFile, "CM_CellSize"),
+					CfgFileManager::_getFloatValue(CfgFile, "CM_Strength"),
+					CfgFileManager::_getIntValue(CfgFile,   "CM_UpdatePeriod")));
+
+		return true;
+	}
+
+	void Clipmap::update(const Ogre::Real &timeSinceLastFrame)
+	{
+		if (!isCreated())
+		{
+			return;
+		}
+
+		Module::update(timeSinceLastFrame);
+
+		// Object-space positions are relative to the water position, and a 
+		// recreated mesh (See Hydrax::setFarField(...)) has an empty vertex buffer
+		if (mPosition != _getPosition() || mMeshRevision != _getMesh()->getTransformRevision())
+		{
+			mPosition = _getPosition();
+			mMeshRevision = _getMesh()->getTransformRevision();
+
+			for (int l = 0; l < mOptions.Levels; l++)
+			{
+				mLevels[l].Valid = false;
+			}
+		}
+
+		const Ogre::Vector3 &CameraPosition = _getCamera()->getDerivedPosition();
+		const int HalfResolution = mOptions.Resolution/2;
+
+		bool Moved = false;
+		int l;
+
+		mNumberOfSamples = 0;
+		mFrame++;
+
+		for (l = 0; l < mOptions.Levels; l++)
+		{
+			float Spacing = mOptions.CellSize * static_cast<float>(1 << l);
+
+			// Origins are even, so the inner level borders are on this level grid lines
+			int OriginX = 2*static_cast<int>(Ogre::Math::Floor(CameraPosition.x/(2*Spacing))) - HalfResolution,
+				OriginZ = 2*static_cast<int>(Ogre::Math::Floor(CameraPosition.z/(2*Spacing))) - HalfResolution;
+
+			if (!mLevels[l].Valid || OriginX != mLevels[l].OriginX || OriginZ != mLevels[l].OriginZ)
+			{
+				_moveLevel(l, OriginX, OriginZ);
+
+				Moved = true;
+			}
+
+			// Amortized height refresh
+			int Period = std::max(1, std::min(1 << l, mOptions.UpdatePeriod));
+
+			if ((mFrame + l) % Period == 0)
+			{
+				_sampleRectangle(l, mLevels[l].OriginX, mLevels[l].OriginZ, 
+					                mLevels[l].OriginX + mOptions.Resolution+1, mLevels[l].OriginZ + mOptions.Resolution+1);
+			}
+		}
+
+		// Level borders are stitched with the outer level heights
+		for (l = mOptions.Levels-2; l >= 0; l--)
+		{
+			mLevels[l].Dirty = mLevels[l].Dirty || mLevels[l+1].Dirty;
+		}
+
+		for (l = 0; l < mOptions.Levels; l++)
+		{
+			if (mLevels[l].Dirty)
+			{
+				_buildLevelVertices(l);
+			}
+		}
+
+		if (Moved)
+		{
+			_buildIndices();
+		}
+	}
+
+	void Clipmap::_moveLevel(const int &l, const int &OriginX, const int &OriginZ)
+	{
+		Level &Lv = mLevels[l];
+		const int N = mOptions.Resolution+1;
+
+		int dx = OriginX - Lv.OriginX,
+			dz = OriginZ - Lv.OriginZ;
+
+		if (!Lv.Valid || std::abs(dx) >= N || std::abs(dz) >= N)
+		{
+			Lv.OriginX = OriginX;
+			Lv.OriginZ = OriginZ;
+			Lv.Valid = true;
+
+			_sampleRectangle(l, OriginX, OriginZ, OriginX+N, OriginZ+N);
+
+			return;
+		}
+
+		// Newly exposed columns (x), for the new z range
+		if (dx > 0)
+		{
+			_sampleRectangle(l, Lv.OriginX+N, OriginZ, OriginX+N, OriginZ+N);
+		}
+		else if (dx < 0)
+		{
+			_sampleRectangle(l, OriginX, OriginZ, Lv.OriginX, OriginZ+N);
+		}
+
+		// Newly exposed rows (z), for the x range which hasn't been sampled above
+		int gx0 = (dx > 0) ? OriginX : Lv.OriginX,
+			gx1 = (dx > 0) ? Lv.OriginX+N : OriginX+N;
+
+		if (dx == 0)
+		{
+			gx0 = OriginX; gx1 = OriginX+N;
+		}
+
+		if (dz > 0)
+		{
+			_sampleRectangle(l, gx0, Lv.OriginZ+N, gx1, OriginZ+N);
+		}
+		else if (dz < 0)
+		{
+			_sampleRectangle(l, gx0, OriginZ, gx1, Lv.OriginZ);
+		}
+
+		Lv.OriginX = OriginX;
+		Lv.OriginZ = OriginZ;
+
+		// Borders have changed
+		Lv.Dirty = true;
+	}
+
+	void Clipmap::_sampleRectangle(const int &l, const int &gx0, const int &gz0, const int &gx1, const int &gz1)
+	{
+		if (gx1 <= gx0 || gz1 <= gz0)
+		{
+			return;
+		}
+
+		const int First = l*mLevelVertices,
+			      Count = (gx1-gx0)*(gz1-gz0);
+
+		float Spacing = mOptions.CellSize * static_cast<float>(1 << l);
+
+		if (static_cast<int>(mScratchSlots.size()) < Count)
+		{
+			mScratch.resize(3*Count);
+			mScratchSlots.resize(Count);
+		}
+
+		float *X = &mScratch[0],
+			  *Z = X + Count,
+			  *H = Z + Count;
+
+		int gx, gz, k = 0;
+
+		for (gx = gx0; gx < gx1; gx++)
+		{
+			for (gz = gz0; gz < gz1; gz++, k++)
+			{
+				int Slot = First + _getSlot(gx, gz);
+
+				mLatticeX[Slot] = gx*Spacing - mPosition.x;
+				mLatticeZ[Slot] = gz*Spacing - mPosition.z;
+
+				X[k] = mLatticeX[Slot];
+				Z[k] = mLatticeZ[Slot];
+				mScratchSlots[k] = Slot;
+			}
+		}
+
+		// Noise is sampled in world-space
+		mNoise->getValues(X, Z, Count, H, mPosition.x, mPosition.z, mOptions.Strength);
+
+		for (k = 0; k < Count; k++)
+		{
+			mHeights[mScratchSlots[k]] = H[k];
+		}
+
+		mNumberOfSamples += Count;
+		mLevels[l].Dirty = true;
+	}
+
+	void Clipmap::_buildLevelVertices(const int &l)
+	{
+		const Level &Lv = mLevels[l];
+		const int R = mOptions.Resolution,
+				  First = l*mLevelVertices;
+
+		const float *X = mLatticeX + First,
+			        *Z = mLatticeZ + First,
+					*H = mHeights  + First;
+
+		// Outer border vertices take the outer level heights (interpolated between its vertices), 
+		// so there aren't cracks even if levels are refreshed in different frames
+		const float *OuterH = (l < mOptions.Levels-1) ? mHeights + (l+1)*mLevelVertices : 0;
+
+		int i, j, Slot, gx, gz;
+		float y;
+
+		if (getNormalMode() == MaterialManager::NM_RTT)
+		{
+			Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices) + First;
+
+			for (i = 0; i <= R; i++)
+			{
+				for (j = 0; j <= R; j++)
+				{
+					gx = Lv.OriginX + i; gz = Lv.OriginZ + j;
+					Slot = _getSlot(gx, gz);
+					y = H[Slot];
+
+					if (OuterH && (i == 0 || i == R || j == 0 || j == R))
+					{
+						y = _getStitchedHeigth(OuterH, gx, gz);
+					}
+
+					Vertices[Slot].x = X[Slot];
+					Vertices[Slot].y = y;
+					Vertices[Slot].z = Z[Slot];
+				}
+			}
+		}
+		else
+		{
+			Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices) + First;
+
+			float Spacing = mOptions.CellSize * static_cast<float>(1 << l);
+
+			for (i = 0; i <= R; i++)
+			{
+				for (j = 0; j <= R; j++)
+				{
+					gx = Lv.OriginX + i; gz = Lv.OriginZ + j;
+					Slot = _getSlot(gx, gz);
+					y = H[Slot];
+
+					if (OuterH && (i == 0 || i == R || j == 0 || j == R))
+					{
+						y = _getStitchedHeigth(OuterH, gx, gz);
+					}
+
+					// Normal from the neighbour heights, clamped to the level
+					int ip = std::min(i+1, R), im = std::max(i-1, 0),
+						jp = std::min(j+1, R), jm = std::max(j-1, 0);
+
+					float dhdx = (H[_getSlot(Lv.OriginX+ip, gz)] - H[_getSlot(Lv.OriginX+im, gz)]) / ((ip-im)*Spacing),
+						  dhdz = (H[_getSlot(gx, Lv.OriginZ+jp)] - H[_getSlot(gx, Lv.OriginZ+jm)]) / ((jp-jm)*Spacing);
+
+					Vertices[Slot].x  = X[Slot];
+					Vertices[Slot].y  = y;
+					Vertices[Slot].z  = Z[Slot];
+					// Same orientation as the other modules normals, (0,-1,0) for flat water
+					Vertices[Slot].nx = dhdx;
+					Vertices[Slot].ny = -1;
+					Vertices[Slot].nz = dhdz;
+				}
+			}
+		}
+
+		if (getNormalMode() == MaterialManager::NM_VERTEX)
+		{
+			_getMesh()->_updateGeometryRange(First, mLevelVertices, static_cast<Mesh::POS_NORM_VERTEX*>(mVertices) + First);
+		}
+		else
+		{
+			_getMesh()->_updateGeometryRange(First, mLevelVertices, static_cast<Mesh::POS_VERTEX*>(mVertices) + First);
+		}
+
+		mLevels[l].Dirty = false;
+	}
+
+	float Clipmap::_getStitchedHeigth(const float *OuterHeights, const int &gx, const int &gz) const
+	{
+		// Border indices are even in one axis, odd ones are between two outer level vertices
+		if (gx & 1)
+		{
+			return 0.5f*(OuterHeights[_getSlot((gx-1)/2, gz/2)] + OuterHeights[_getSlot((gx+1)/2, gz/2)]);
+		}
+
+		if (gz & 1)
+		{
+			return 0.5f*(OuterHeights[_getSlot(gx/2, (gz-1)/2)] + OuterHeights[_getSlot(gx/2, (gz+1)/2)]);
+		}
+
+		return OuterHeights[_getSlot(gx/2, gz/2)];
+	}
+
+	void Clipmap::_buildIndices()
+	{
+		const int R = mOptions.Resolution;
+
+		int l, i, j, First, 
+			HoleX0, HoleZ0, HoleX1, HoleZ1;
+
+		mIndices.clear();
+
+		for (l = 0; l < mOptions.Levels; l++)
+		{
+			const Level &Lv = mLevels[l];
+
+			First = l*mLevelVertices;
+
+			// Area covered by the inner level, in this level cells
+			HoleX0 = HoleZ0 = HoleX1 = HoleZ1 = 0;
+
+			if (l > 0)
+			{
+				HoleX0 = mLevels[l-1].OriginX/2 - Lv.OriginX;
+				HoleZ0 = mLevels[l-1].OriginZ/2 - Lv.OriginZ;
+				HoleX1 = HoleX0 + R/2;
+				HoleZ1 = HoleZ0 + R/2;
+			}
+
+			for (i = 0; i < R; i++)
+			{
+				for (j = 0; j < R; j++)
+				{
+					if (i >= HoleX0 && i < HoleX1 && j >= HoleZ0 && j < HoleZ1)
+					{
+						continue;
+					}
+
+					unsigned int a = First + _getSlot(Lv.OriginX+i,   Lv.OriginZ+j),
+						         b = First + _getSlot(Lv.OriginX+i,   Lv.OriginZ+j+1),
+								 c = First + _getSlot(Lv.OriginX+i+1, Lv.OriginZ+j),
+								 d = First + _getSlot(Lv.OriginX+i+1, Lv.OriginZ+j+1);
+
+					// face 1 |/
+					mIndices.push_back(a);
+					mIndices.push_back(b);
+					mIndices.push_back(c);
+
+					// face 2 /|
+					mIndices.push_back(c);
+					mIndices.push_back(b);
+					mIndices.push_back(d);
+				}
+			}
+		}
+
+		_getMesh()->_updateIndexData(mIndices.empty() ? 0 : &mIndices[0], static_cast<int>(mIndices.size()));
+	}
+
+	float Clipmap::getHeigth(const Ogre::Vector2 &Position)
+	{
+		return _getPosition().y + mNoise->getValue(Position.x, Position.y)*mOptions.Strength;
+	}
+
+	void Clipmap::getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid)
+	{
+		_getNoiseHeigths(Positions, Heigths, Count, _getPosition().y, mOptions.Strength);
+
+		if (Valid)
+		{
+			std::fill(Valid, Valid+Count, true);
+		}
+	}
+
+	void Clipmap::getSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, bool *Valid)
+	{
+		_getNoiseSurfaceSamples(Positions, Samples, Count, _getPosition().y, mOptions.Strength);
+
+		if (Valid)
+		{
+			std::fill(Valid, Valid+Count, true);
+		}
+	}
+
+	bool Clipmap::getSurfaceBounds(float &MaxDisplacement, float &MaxSlope)
+	{
+		return _getNoiseSurfaceBounds(mOptions.Strength, MaxDisplacement, MaxSlope);
+	}
+
+	WaterState* Clipmap::_createWaterState()
+	{
+		return _createInfiniteWaterState(_getPosition().y, mOptions.Strength);
+	}
+}}
@@ -0,0 +1,304 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef _Hydrax_Modules_Clipmap_H_
+#define _Hydrax_Modules_Clipmap_H_
+
+#include "../../Prerequisites.h"
+
+#include "../../Hydrax.h"
+#include "../../Mesh.h"
+#include "../Module.h"
+
+namespace Hydrax{ namespace Module
+{
+	/** Hydrax geometry clipmap module
+	    Nested square grids centred on the camera, each level doubles the grid spacing of the 
+		previous one and only draws the ring which isn't covered by the inner level.
+		Levels are stored with toroidal addressing: when the camera moves only the newly exposed 
+		rows and columns get new positions, the rest of the level is reused in place.
+		@remarks Noise is animated, so heights are resampled each Options::UpdatePeriod frames at 
+		         most (coarse levels can be refreshed less often than the inner ones).
+				 The water mesh can't be rotated (Hydrax::rotate(...))
+	 */
+	class DllExport Clipmap : public Module
+	{
+	public:
+		/** Struct wich contains Hydrax clipmap module options
+		 */
+		struct Options
+		{
+			/// Number of quads per level side, must be a multiple of 4
+			int Resolution;
+			/// Number of levels
+			int Levels;
+			/// Grid spacing of the inner level (world units)
+			float CellSize;
+			/// Water strength
+			float Strength;
+			/// Max number of frames between height refreshes of the outer levels, the level L 
+			/// is refreshed each min(2^L, UpdatePeriod) frames (1 = all levels each frame)
+			int UpdatePeriod;
+
+			/** Default constructor
+			 */
+			Options()
+				: Resolution(64)
+				, Levels(6)
+				, CellSize(1.0f)
+				, Strength(32.5f)
+				, UpdatePeriod(1)
+			{
+			}
+
+			/** Constructor
+			    @param _Resolution Number of quads per level side
+				@param _Levels Number of levels
+				@param _CellSize Grid spacing of the inner level
+			 */
+			Options(const int   &_Resolution,
+				    const int   &_Levels,
+					const float &_CellSize)
+				: Resolution(_Resolution)
+				, Levels(_Levels)
+				, CellSize(_CellSize)
+				, Strength(32.5f)
+				, UpdatePeriod(1)
+			{
+			}
+
+			/** Constructor
+			    @param _Resolution Number of quads per level side
+				@param _Levels Number of levels
+				@param _CellSize Grid spacing of the inner level
+				@param _Strength Water strength
+				@param _UpdatePeriod Max number of frames between height refreshes of the outer levels
+			 */
+			Options(const int   &_Resolution,
+				    const int   &_Levels,
+					const float &_CellSize,
+					const float &_Strength,
+					const int   &_UpdatePeriod)
+				: Resolution(_Resolution)
+				, Levels(_Levels)
+				, CellSize(_CellSize)
+				, Strength(_Strength)
+				, UpdatePeriod(_UpdatePeriod)
+			{
+			}
+		};
+
+		/** Constructor
+		    @param h Hydrax manager pointer
+			@param n Hydrax noise module
+			@param NormalMode Switch between MaterialManager::NM_VERTEX and Materialmanager::NM_RTT
+		 */
+		Clipmap(Hydrax *h, Noise::Noise *n, const MaterialManager::NormalMode& NormalMode);
+
+		/** Constructor
+		    @param h Hydrax manager pointer
+			@param n Hydrax noise module
+			@param NormalMode Switch between MaterialManager::NM_VERTEX and Materialmanager::NM_RTT
+			@param Options Clipmap options
+		 */
+		Clipmap(Hydrax *h, Noise::Noise *n, const MaterialManager::NormalMode& NormalMode, const Options &Options);
+
+		/** Destructor
+		 */
+        ~Clipmap();
+
+		/** Create
+		 */
+		void create();
+
+		/** Remove
+		 */
+		void remove();
+
+		/** Call it each frame
+		    @param timeSinceLastFrame Time since last frame(delta)
+		 */
+		void update(const Ogre::Real &timeSinceLastFrame);
+
+		/** Set options
+		    @param Options Options
+		 */
+		void setOptions(const Options &Options);
+
+		/** Save config
+		    @param Data String reference 
+		 */
+		void saveCfg(Ogre::String &Data);
+
+		/** Load config
+		    @param CgfFile Ogre::ConfigFile reference 
+			@return True if is the correct module config
+		 */
+		bool loadCfg(Ogre::ConfigFile &CfgFile);
+
+		/** Get the current heigth at a especified world-space point
+		    @param Position X/Z World position
+			@return Heigth at the given position in y-World coordinates, if it's outside of the water return -1
+		 */
+		float getHeigth(const Ogre::Vector2 &Position);
+
+		/** Get the current heigths at some world-space points
+		    @param Positions X/Z World positions
+			@param Heigths Heigths at the given positions in y-World coordinates (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+		 */
+		void getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid = 0);
+
+		/** Get the current surface samples (heigth, normal and vertical velocity) at some world-space points
+		    @param Positions X/Z World positions
+			@param Samples Surface samples (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+		 */
+		void getSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, bool *Valid = 0);
+
+		/** Get the bounds of the current water surface
+		    @param MaxDisplacement Maximum y displacement from the water position (Output)
+			@param MaxSlope Maximum surface slope (Output)
+			@return false if the noise can't bound its values
+		 */
+		bool getSurfaceBounds(float &MaxDisplacement, float &MaxSlope);
+
+		/** Create an immutable snapshot of the current water state
+		    @return New water state, or 0 if the noise doesn't support snapshots
+		 */
+		WaterState* _createWaterState();
+
+		/** Get current options
+		    @return Current options
+		 */
+		inline const Options& getOptions() const
+		{
+			return mOptions;
+		}
+
+		/** Create geometry in module(If special geometry is needed)
+		    @param mMesh Mesh
+			@return false if it must be create by default Mesh::_createGeometry() fnc.
+		 */
+		const bool _createGeometry(Mesh *mMesh) const;
+
+		/** Get the number of noise samples of the last frame
+		    @return Number of sampled vertices
+		 */
+		inline const int& getNumberOfSamples() const
+		{
+			return mNumberOfSamples;
+		}
+
+	private:
+		/** Clipmap level state
+		 */
+		struct Level
+		{
+			/// World grid index (in level grid spacing units) of the first vertex row/column
+			int OriginX, OriginZ;
+			/// Are positions and heights valid?
+			bool Valid;
+			/// Have vertices to be rebuilt and uploaded?
+			bool Dirty;
+		};
+
+		/** Get the vertex slot of a world grid index in a level (toroidal addressing)
+		    @param gx World grid x index
+			@param gz World grid z index
+			@return Slot in the level block
+		 */
+		inline int _getSlot(const int &gx, const int &gz) const
+		{
+			const int N = mOptions.Resolution+1;
+
+			return (((gx % N) + N) % N)*N + (((gz % N) + N) % N);
+		}
+
+		/** Move a level to a new origin, sampling the newly exposed rows and columns
+		    @param l Level index
+			@param OriginX New origin x
+			@param OriginZ New origin z
+		 */
+		void _moveLevel(const int &l, const int &OriginX, const int &OriginZ);
+
+		/** Sample positions and heights of a world grid rectangle of a level
+		    @param l Level index
+			@param gx0 First world grid x index
+			@param gz0 First world grid z index
+			@param gx1 Last world grid x index (not included)
+			@param gz1 Last world grid z index (not included)
+		 */
+		void _sampleRectangle(const int &l, const int &gx0, const int &gz0, const int &gx1, const int &gz1);
+
+		/** Build the vertices of a level and upload them
+		    @param l Level index
+		 */
+		void _buildLevelVertices(const int &l);
+
+		/** Get the heigth of a level border vertex from the outer level heights
+		    @param OuterHeights Outer level heights
+			@param gx World grid x index (in the inner level spacing units)
+			@param gz World grid z index (in the inner level spacing units)
+			@return Heigth on the outer level edge
+		 */
+		float _getStitchedHeigth(const float *OuterHeights, const int &gx, const int &gz) const;
+
+		/** Build the index data of all levels
+		 */
+		void _buildIndices();
+
+		/// Vertex pointer (Mesh::POS_NORM_VERTEX or Mesh::POS_VERTEX)
+		void *mVertices;
+		/// Number of vertices per level, (Resolution+1)^2
+		int mLevelVertices;
+
+		/// Object-space x/z positions and heights, toroidal per level
+		float *mLatticeX, *mLatticeZ, *mHeights;
+		/// Gather buffer for batch noise sampling (x, z, heights, slot)
+		std::vector<float> mScratch;
+		std::vector<int> mScratchSlots;
+
+		/// Level states
+		std::vector<Level> mLevels;
+		/// Index data
+		std::vector<unsigned int> mIndices;
+
+		/// Water position used for the current positions
+		Ogre::Vector3 mPosition;
+		/// Mesh transform revision of the levels geometry
+		unsigned int mMeshRevision;
+		/// Frame counter, for amortized level refreshes
+		int mFrame;
+		/// Number of noise samples in the current frame
+		int mNumberOfSamples;
+
+		/// Our clipmap options
+		Options mOptions;
+	};
+}}
+
+#endif
@@ -24,47 +24,68 @@ http://www.gnu.org/copyleft/lesser.txt.
 
 #include "Module.h"
 
+#include "../Hydrax.h"
+#include "../WaterBody.h"
+#include "../CameraView.h"
+
+#define _def_SurfaceSampleDelta 0.1f
+
 namespace Hydrax{namespace Module
 {
 	Module::Module(const Ogre::String &Name, 
 		           Noise::Noise *n,
 				   const Mesh::Options &MeshOptions,
-				   const MaterialManager::NormalMode &NormalMode)
+				   const MaterialManager::NormalMode &NormalMode,
+				   Hydrax *h)
 		: mName(Name) 
 		, mNoise(n)
 		, mMeshOptions(MeshOptions)
 		, mNormalMode(NormalMode)
 	    , mCreated(false)
+		, mSharedNoise(false)
+		, mWaterBody(0)
+		, mCameraView(0)
+		, mHydrax(h)
 	{
 	}
 
 	Module::~Module()
 	{
-		delete mNoise;
+		if (!mSharedNoise)
+		{
+		    delete mNoise;
+		}
 	}
 
 	void Module::create()
 	{
-		mNoise->create();
+		if (!mSharedNoise)
+		{
+		    mNoise->create();
+		}
 
 		mCreated = true;
 	}
 
 	void Module::remove()
 	{
-		mNoise->remove();
+		if (!mSharedNoise)
+		{
+		    mNoise->remove();
+		}
 
 		mCreated = false;
 	}
 
 	void Module::setNoise(Noise::Noise* Noise, GPUNormalMapManager* g, const bool& DeleteOldNoise)
 	{
-		if (DeleteOldNoise)
+		if (DeleteOldNoise && !mSharedNoise)
 		{
 			delete mNoise;
 		}
 
 		mNoise = Noise;
+		mSharedNoise = false;
 
 		if (mCreated)
 		{
@@ -93,7 +114,45 @@ namespace Hydrax{namespace Module
 
 	void Module::update(const Ogre::Real &timeSinceLastFrame)
 	{
-		mNoise->update(timeSinceLastFrame);
+		// Shared noises are advanced by their owner module
+		if (!mSharedNoise)
+		{
+		    mNoise->advance(timeSinceLastFrame);
+		}
+	}
+
+	Mesh* Module::_getMesh() const
+	{
+		if (mWaterBody)
+		{
+			return mWaterBody->getMesh();
+		}
+
+		return mCameraView ? mCameraView->getMesh() : mHydrax->getMesh();
+	}
+
+	void Module::_applyMeshOptions()
+	{
+		if (mWaterBody || mCameraView)
+		{
+			// Water bodies and camera views share the main water material
+			_getMesh()->setOptions(mMeshOptions);
+		}
+		else if (mHydrax->getModule() == this)
+		{
+			mHydrax->getMesh()->setOptions(mMeshOptions);
+			mHydrax->_setStrength(mMeshOptions.MeshStrength);
+		}
+	}
+
+	Ogre::Camera* Module::_getCamera() const
+	{
+		return mCameraView ? mCameraView->getCamera() : mHydrax->getCamera();
+	}
+
+	const Ogre::Vector3& Module::_getPosition() const
+	{
+		return mWaterBody ? mWaterBody->getPosition() : mHydrax->getPosition();
 	}
 
 	void Module::saveCfg(Ogre::String &Data)
@@ -116,4 +175,146 @@ namespace Hydrax{namespace Module
 	{
 		return -1;
 	}
+
+	void Module::getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid)
+	{
+		for (int k = 0; k < Count; k++)
+		{
+			Heigths[k] = getHeigth(Positions[k]);
+
+			if (Valid)
+			{
+				Valid[k] = true;
+			}
+		}
+	}
+
+	void Module::getSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, bool *Valid)
+	{
+		const int ChunkSize = 64;
+		const float Delta = _def_SurfaceSampleDelta;
+
+		Ogre::Vector2 Points[ChunkSize*5];
+		float Heigths[ChunkSize*5];
+		bool ValidPoints[ChunkSize*5];
+		int First, n, k;
+
+		for (First = 0; First < Count; First += ChunkSize)
+		{
+			n = std::min(ChunkSize, Count-First);
+
+			// Position, +x, -x, +z, -z neighbours
+			for (k = 0; k < n; k++)
+			{
+				const Ogre::Vector2 &Position = Positions[First+k];
+
+				Points[k]     = Position;
+				Points[k+n]   = Ogre::Vector2(Position.x + Delta, Position.y);
+				Points[k+2*n] = Ogre::Vector2(Position.x - Delta, Position.y);
+				Points[k+3*n] = Ogre::Vector2(Position.x, Position.y + Delta);
+				Points[k+4*n] = Ogre::Vector2(Position.x, Position.y - Delta);
+			}
+
+			getHeigths(Points, Heigths, 5*n, ValidPoints);
+
+			for (k = 0; k < n; k++)
+			{
+				SurfaceSample &Sample = Samples[First+k];
+
+				Sample.Heigth = Heigths[k];
+				Sample.Normal = Ogre::Vector3(Heigths[k+2*n] - Heigths[k+n], 2*Delta, Heigths[k+4*n] - Heigths[k+3*n]).normalisedCopy();
+				Sample.Velocity = 0;
+
+				if (Valid)
+				{
+					Valid[First+k] = ValidPoints[k];
+				}
+			}
+		}
+	}
+
+	void Module::_getNoiseSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, 
+		                                 const float &WaterHeigth, const float &Strength) const
+	{
+		const int ChunkSize = 256;
+
+		float X[ChunkSize], Y[ChunkSize], Values[ChunkSize], dx[ChunkSize], dy[ChunkSize], dt[ChunkSize];
+		int First, n, k;
+
+		for (First = 0; First < Count; First += ChunkSize)
+		{
+			n = std::min(ChunkSize, Count-First);
+
+			for (k = 0; k < n; k++)
+			{
+				X[k] = Positions[First+k].x;
+				Y[k] = Positions[First+k].y;
+			}
+
+			mNoise->getValuesAndDerivatives(X, Y, n, Values, dx, dy, dt, 0, 0, Strength);
+
+			for (k = 0; k < n; k++)
+			{
+				SurfaceSample &Sample = Samples[First+k];
+
+				Sample.Heigth = WaterHeigth + Values[k];
+				Sample.Normal = Ogre::Vector3(-dx[k], 1, -dy[k]).normalisedCopy();
+				Sample.Velocity = dt[k];
+			}
+		}
+	}
+
+	WaterState* Module::_createInfiniteWaterState(const float &WaterHeigth, const float &Strength) const
+	{
+		Noise::Noise::Snapshot *NoiseSnapshot = mNoise->_createSnapshot();
+
+		if (!NoiseSnapshot)
+		{
+			return 0;
+		}
+
+		return new WaterState(NoiseSnapshot, WaterHeigth, Strength);
+	}
+
+	bool Module::_getNoiseSurfaceBounds(const float &Strength, float &MaxDisplacement, float &MaxSlope) const
+	{
+		float MaxValue, MaxNoiseSlope;
+
+		if (!mNoise->getBounds(MaxValue, MaxNoiseSlope))
+		{
+			return false;
+		}
+
+		MaxDisplacement = MaxValue*Ogre::Math::Abs(Strength);
+		MaxSlope = MaxNoiseSlope*Ogre::Math::Abs(Strength);
+
+		return true;
+	}
+
+	void Module::_getNoiseHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, 
+		                          const float &WaterHeigth, const float &Strength) const
+	{
+		const int ChunkSize = 256;
+
+		float X[ChunkSize], Y[ChunkSize];
+		int First, n, k;
+
+		for (First = 0; First < Count; First += ChunkSize)
+		{
+			n = std::min(ChunkSize, Count-First);
+
+			for (k = 0; k < n; k++)
+			{
+				X[k] = Positions[First+k].x;
+				Y[k] = Positions[First+k].y;
+			}
+
+			mNoise->getValues(X, Y, n, Heigths+First, 0, 0, Strength);
+
+			for (k = 0; k < n; k++)
+			{
+				Heigths[First+k] += WaterHeigth;
+			}
+		}
+	}
 }}
\ No newline at end of file
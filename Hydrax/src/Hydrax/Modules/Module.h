@@ -30,6 +30,7 @@ http://www.gnu.org/copyleft/lesser.txt.
 #include "../Mesh.h"
 #include "../MaterialManager.h"
 #include "../GPUNormalMapManager.h"
+#include "../WaterState.h"
 
 namespace Hydrax{ namespace Module
 {
@@ -44,11 +45,13 @@ namespace Hydrax{ namespace Module
 			@param n Hydrax::Noise::Noise generator pointer
 			@param MeshOptions Mesh options
 			@param NormalMode Normal generation mode
+			@param h Hydrax manager pointer
 		 */
 		Module(const Ogre::String                &Name, 
 			   Noise::Noise                      *n,
 			   const Mesh::Options               &MeshOptions,
-			   const MaterialManager::NormalMode &NormalMode);
+			   const MaterialManager::NormalMode &NormalMode,
+			   Hydrax                            *h = 0);
 		
 		/** Destructor
 		 */
@@ -76,6 +79,31 @@ namespace Hydrax{ namespace Module
 		 */
 		virtual void update(const Ogre::Real &timeSinceLastFrame);
 
+		/** Prepare a pipelined update, called each frame from the render thread if the 
+		    Hydrax pipelined update mode is enabled (see Hydrax::setPipelinedUpdate(...))
+		    @param timeSinceLastFrame Time since last frame(delta)
+			@return false if the module doesn't support pipelined updates, update(...) will be called instead
+			@remarks Store here all the scene state(cameras, nodes, ...) needed by _asyncUpdate()
+		 */
+		inline virtual bool _prepareAsyncUpdate(const Ogre::Real &timeSinceLastFrame)
+		{
+			return false;
+		}
+
+		/** Pipelined update, called from a worker thread after _prepareAsyncUpdate(...)
+		    @remarks Scene objects and the Hydrax manager mustn't be accessed here
+		 */
+		inline virtual void _asyncUpdate()
+		{
+		}
+
+		/** Upload the pipelined update result(geometry, ...), called from the render thread 
+		    in the next frame, once _asyncUpdate() is finished
+		 */
+		inline virtual void _commitAsyncUpdate()
+		{
+		}
+
 		/** Save config
 		    @param Data String reference 
 		 */
@@ -137,13 +165,163 @@ namespace Hydrax{ namespace Module
 			return mNoise;
 		}
 
+		/** Is the noise shared with another module?
+		    @return true if yes, false if not
+		 */
+		inline const bool& isNoiseShared() const
+		{
+			return mSharedNoise;
+		}
+
+		/** Set if the noise is shared with another module, which creates, updates and deletes it
+		    @param Shared true if the noise is shared, false if it's owned by this module
+			@remarks Called by WaterBody::setModule(...) when the module uses the main water noise
+		 */
+		inline void _setNoiseShared(const bool &Shared)
+		{
+			mSharedNoise = Shared;
+		}
+
+		/** Get the water body which owns the module
+		    @return Water body, NULL if it's the main water module
+		 */
+		inline WaterBody* getWaterBody()
+		{
+			return mWaterBody;
+		}
+
+		/** Set the water body which owns the module
+		    @param b Water body, NULL for the main water module
+			@remarks Called by WaterBody::setModule(...)
+		 */
+		inline void _setWaterBody(WaterBody *b)
+		{
+			mWaterBody = b;
+		}
+
+		/** Get the camera view which owns the module
+		    @return Camera view, NULL if it isn't a camera view module
+		 */
+		inline CameraView* getCameraView()
+		{
+			return mCameraView;
+		}
+
+		/** Set the camera view which owns the module
+		    @param v Camera view, NULL for the main camera
+			@remarks Called by CameraView::setModule(...)
+		 */
+		inline void _setCameraView(CameraView *v)
+		{
+			mCameraView = v;
+		}
+
 		/** Get the current heigth at a especified world-space point
 		    @param Position X/Z World position
 			@return Heigth at the given position in y-World coordinates, if it's outside of the water return -1
 		 */
 		virtual float getHeigth(const Ogre::Vector2 &Position);
 
+		/** Get the current heigths at some world-space points
+		    @param Positions X/Z World positions
+			@param Heigths Heigths at the given positions in y-World coordinates (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+			@remarks Override it for a batched noise evaluation, by default getHeigth(...) is called per position
+		 */
+		virtual void getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid = 0);
+
+		/** Get the current surface samples (heigth, normal and vertical velocity) at some world-space points
+		    @param Positions X/Z World positions
+			@param Samples Surface samples (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+			@remarks Override it for analytic noise derivatives, by default normals are central 
+			         differences of getHeigths(...) (5 heigths per position) and velocities are 0
+		 */
+		virtual void getSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, bool *Valid = 0);
+
+		/** Get the bounds of the current water surface
+		    @param MaxDisplacement Maximum y displacement from the water position (Output)
+			@param MaxSlope Maximum surface slope, |dy/dx| along any x/z direction (Output)
+			@return false if the module or its noise can't bound the surface
+			@remarks Used for clip and march rays against the water surface, see Hydrax::raycast(...)
+		 */
+		virtual bool getSurfaceBounds(float &MaxDisplacement, float &MaxSlope)
+		{
+			return false;
+		}
+
+		/** Create an immutable snapshot of the current water state
+		    @return New water state, or 0 if the module or its noise doesn't support snapshots
+			@remarks Called by Hydrax each frame when water state snapshots are enabled,
+			         see Hydrax::setWaterStateSnapshots(...)
+		 */
+		virtual WaterState* _createWaterState()
+		{
+			return 0;
+		}
+
 	protected:
+		/** Get the mesh where the module geometry is built
+		    @return Water body mesh, or the Hydrax mesh for the main water module
+		 */
+		Mesh* _getMesh() const;
+
+		/** Set the module mesh options in the mesh of its owner (and the water strength for 
+		    the main water module)
+			@remarks Nothing is done until the module is set in Hydrax, a water body or a camera view, 
+			         its owner sets the mesh options when the module is set
+		 */
+		void _applyMeshOptions();
+
+		/** Get the camera the module geometry is built for
+		    @return Camera view camera, or the Hydrax camera
+		 */
+		Ogre::Camera* _getCamera() const;
+
+		/** Get the position of the water which owns the module
+		    @return Water body position, or the Hydrax position for the main water module
+		 */
+		const Ogre::Vector3& _getPosition() const;
+
+		/** Create a snapshot of an infinite water (noise evaluated in world-space coords)
+		    @param WaterHeigth Water y-World position
+			@param Strength Noise strength
+			@return New water state, or 0 if the noise doesn't support snapshots
+		 */
+		WaterState* _createInfiniteWaterState(const float &WaterHeigth, const float &Strength) const;
+
+		/** Get the surface samples of an infinite water at some world-space points
+		    @param Positions X/Z World positions
+			@param Samples Surface samples (Output)
+			@param Count Number of positions
+			@param WaterHeigth Water y-World position
+			@param Strength Noise strength
+			@remarks The noise is evaluated with Noise::getValuesAndDerivatives(...) in small chunks
+		 */
+		void _getNoiseSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, 
+			                         const float &WaterHeigth, const float &Strength) const;
+
+		/** Get the bounds of a water surface which is the noise scaled by Strength
+		    @param Strength Noise strength
+			@param MaxDisplacement Maximum y displacement from the water position (Output)
+			@param MaxSlope Maximum surface slope (Output)
+			@return false if the noise can't bound its values
+		 */
+		bool _getNoiseSurfaceBounds(const float &Strength, float &MaxDisplacement, float &MaxSlope) const;
+
+		/** Get the heigths of an infinite water at some world-space points
+		    @param Positions X/Z World positions
+			@param Heigths Heigths (Output)
+			@param Count Number of positions
+			@param WaterHeigth Water y-World position
+			@param Strength Noise strength
+			@remarks The noise is evaluated with Noise::getValues(...) in small chunks, so it's thread-safe
+		 */
+		void _getNoiseHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, 
+			                  const float &WaterHeigth, const float &Strength) const;
+
 		/// Module name
 		Ogre::String mName;
 		/// Noise generator pointer
@@ -154,6 +332,15 @@ namespace Hydrax{ namespace Module
 		MaterialManager::NormalMode mNormalMode;
 		/// Is create() called?
 		bool mCreated;
+		/// Is the noise shared with another module?
+		bool mSharedNoise;
+
+		/// Water body which owns the module, NULL for the main water module
+		WaterBody *mWaterBody;
+		/// Camera view which owns the module, NULL for the main camera
+		CameraView *mCameraView;
+		/// Our Hydrax pointer
+		Hydrax* mHydrax;
 	};
 }}
 
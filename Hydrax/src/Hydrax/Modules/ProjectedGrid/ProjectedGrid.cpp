@@ -30,6 +30,10 @@ http://www.cnblogs.com/ArenAK/archive/2007/11/07/951713.html
 
 #include "ProjectedGrid.h"
 
+#if HYDRAX_USE_SSE
+#include <xmmintrin.h>
+#endif
+
 #define _def_MaxFarClipDistance 99999
 
 namespace Hydrax{namespace Module
@@ -45,6 +49,22 @@ namespace Hydrax{namespace Module
 		return Mesh::VT_POS;
 	}
 
+	/// Sort rows by descending priority
+	struct _PG_RowPriorityCompare
+	{
+		_PG_RowPriorityCompare(const float* Priority)
+			: mPriority(Priority)
+		{
+		}
+
+		bool operator()(const int& a, const int& b) const
+		{
+			return mPriority[a] > mPriority[b];
+		}
+
+		const float* mPriority;
+	};
+
 	Ogre::String _PG_getNormalModeString(const MaterialManager::NormalMode& NormalMode)
 	{
 		if (NormalMode == MaterialManager::NM_VERTEX)
@@ -57,10 +77,34 @@ namespace Hydrax{namespace Module
 
 	ProjectedGrid::ProjectedGrid(Hydrax *h, Noise::Noise *n, const Ogre::Plane &BasePlane, const MaterialManager::NormalMode& NormalMode)
 		: Module("ProjectedGrid" + _PG_getNormalModeString(NormalMode), 
-		         n, Mesh::Options(256, Size(0), _PG_getVertexTypeFromNormalMode(NormalMode)), NormalMode)
-		, mHydrax(h)
+		         n, Mesh::Options(256, Size(0), _PG_getVertexTypeFromNormalMode(NormalMode)), NormalMode, h)
 		, mVertices(0)
 		, mVerticesChoppyBuffer(0)
+		, mVertexCapacity(0)
+		, mGridX(0)
+		, mGridZ(0)
+		, mGridV(0)
+		, mGridY(0)
+		, mHeights0(0)
+		, mHeights1(0)
+		, mRowAge(0)
+		, mRowInterval(0)
+		, mRowWeight(0)
+		, mRowPriority(0)
+		, mBudget(1.0f)
+		, mPendingTime(0)
+		, mFrame(0)
+		, mProjectionPosition(Ogre::Vector3(0,0,0))
+		, mForceFullRefresh(true)
+		, mGeometryUpdate(GU_NONE)
+		, mRecenter(false)
+		, mCameraPosition(Ogre::Vector3(0,0,0))
+		, mCameraDirection(Ogre::Vector3::NEGATIVE_UNIT_Z)
+		, mCameraFarClipDistance(0)
+		, mWaterHeight(0)
+		, mUnderwater(false)
+		, mAsyncTime(0)
+		, mAsyncLastFrame(false)
 		, mBasePlane(BasePlane)
 		, mNormal(BasePlane.normal)
 		, mPos(Ogre::Vector3(0,0,0))
@@ -72,10 +116,34 @@ namespace Hydrax{namespace Module
 
 	ProjectedGrid::ProjectedGrid(Hydrax *h, Noise::Noise *n, const Ogre::Plane &BasePlane, const MaterialManager::NormalMode& NormalMode, const Options &Options)
 		: Module("ProjectedGrid" + _PG_getNormalModeString(NormalMode), 
-		         n, Mesh::Options(Options.Complexity, Size(0), _PG_getVertexTypeFromNormalMode(NormalMode)), NormalMode)
-		, mHydrax(h)
+		         n, Mesh::Options(Options.Complexity, Size(0), _PG_getVertexTypeFromNormalMode(NormalMode)), NormalMode, h)
 		, mVertices(0)
 		, mVerticesChoppyBuffer(0)
+		, mVertexCapacity(0)
+		, mGridX(0)
+		, mGridZ(0)
+		, mGridV(0)
+		, mGridY(0)
+		, mHeights0(0)
+		, mHeights1(0)
+		, mRowAge(0)
+		, mRowInterval(0)
+		, mRowWeight(0)
+		, mRowPriority(0)
+		, mBudget(1.0f)
+		, mPendingTime(0)
+		, mFrame(0)
+		, mProjectionPosition(Ogre::Vector3(0,0,0))
+		, mForceFullRefresh(true)
+		, mGeometryUpdate(GU_NONE)
+		, mRecenter(false)
+		, mCameraPosition(Ogre::Vector3(0,0,0))
+		, mCameraDirection(Ogre::Vector3::NEGATIVE_UNIT_Z)
+		, mCameraFarClipDistance(0)
+		, mWaterHeight(0)
+		, mUnderwater(false)
+		, mAsyncTime(0)
+		, mAsyncLastFrame(false)
 		, mBasePlane(BasePlane)
 		, mNormal(BasePlane.normal)
 		, mPos(Ogre::Vector3(0,0,0))
@@ -95,17 +163,31 @@ namespace Hydrax{namespace Module
 
 	void ProjectedGrid::setOptions(const Options &Options)
 	{
+		// The pipelined update (if any) mustn't be running while options change
+		mHydrax->_waitForAsyncUpdate();
+
 		// Size(0) -> Infinite mesh
 		mMeshOptions.MeshSize     = Size(0);
 		mMeshOptions.MeshStrength = Options.Strength;
 		mMeshOptions.MeshComplexity = Options.Complexity;
+		mMeshOptions.MeshMaxComplexity = Options.MaxComplexity;
 
-		mHydrax->getMesh()->setOptions(mMeshOptions);
-		mHydrax->_setStrength(Options.Strength);
+		_applyMeshOptions();
 
 		// Re-create geometry if it's needed
 		if (isCreated() && Options.Complexity != mOptions.Complexity)
 		{
+			// Inside of the allocated capacity: only the mesh draw range changes
+			if (Options.Complexity*Options.Complexity <= mVertexCapacity &&
+				Options.MaxComplexity == mOptions.MaxComplexity &&
+				_getMesh()->setComplexity(Options.Complexity))
+			{
+				mOptions = Options;
+				mForceFullRefresh = true;
+
+				return;
+			}
+
 			remove();
 			mOptions = Options;
 			create();
@@ -118,11 +200,11 @@ namespace Hydrax{namespace Module
 				}
 			}
 			
-		    Ogre::String MaterialNameTmp = mHydrax->getMesh()->getMaterialName();
-		    mHydrax->getMesh()->remove();
-		    mHydrax->getMesh()->setOptions(getMeshOptions());
-		    mHydrax->getMesh()->setMaterialName(MaterialNameTmp);
-		    mHydrax->getMesh()->create();
+		    Ogre::String MaterialNameTmp = _getMesh()->getMaterialName();
+		    _getMesh()->remove();
+		    _getMesh()->setOptions(getMeshOptions());
+		    _getMesh()->setMaterialName(MaterialNameTmp);
+		    _getMesh()->create();
 
 			// Force to recalculate the geometry on next frame
 			mLastPosition = Ogre::Vector3(0,0,0);
@@ -131,6 +213,15 @@ namespace Hydrax{namespace Module
 			return;
 		}
 
+		// Row distribution or update budget changed: force to recalculate the geometry on next frame
+		if (Options.AdaptiveDistribution != mOptions.AdaptiveDistribution ||
+			Options.AdaptiveStrength     != mOptions.AdaptiveStrength     ||
+			Options.UpdateBudget         != mOptions.UpdateBudget         ||
+			Options.UpdateByDistance     != mOptions.UpdateByDistance)
+		{
+			mForceFullRefresh = true;
+		}
+
 		mOptions = Options;
 	}
 
@@ -140,31 +231,51 @@ namespace Hydrax{namespace Module
 
 		Module::create();
 
+		// Allocate for the max complexity, so complexity changes don't need reallocations
+		int MaxComplexity = std::max(mOptions.Complexity, mOptions.MaxComplexity);
+
+		mVertexCapacity = MaxComplexity*MaxComplexity;
+
 		if (getNormalMode() == MaterialManager::NM_VERTEX)
 		{
-		    mVertices = new Mesh::POS_NORM_VERTEX[mOptions.Complexity*mOptions.Complexity];	
+		    mVertices = new Mesh::POS_NORM_VERTEX[mVertexCapacity];	
 
 			Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
 
-			for (int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
+			for (int i = 0; i < mVertexCapacity; i++)
 			{
 				Vertices[i].nx = 0;
 				Vertices[i].ny = -1;
 				Vertices[i].nz = 0;
 			}
 
-			mVerticesChoppyBuffer = new Mesh::POS_NORM_VERTEX[mOptions.Complexity*mOptions.Complexity];
+			mVerticesChoppyBuffer = new Mesh::POS_NORM_VERTEX[mVertexCapacity];
 		}
 		else if(getNormalMode() == MaterialManager::NM_RTT)
 		{
-			mVertices = new Mesh::POS_VERTEX[mOptions.Complexity*mOptions.Complexity];
+			mVertices = new Mesh::POS_VERTEX[mVertexCapacity];
 		}
 
+		mGridX = new float[mVertexCapacity];
+		mGridZ = new float[mVertexCapacity];
+		mGridV = new float[MaxComplexity];
+		mGridY = new float[mVertexCapacity];
+
+		mHeights0    = new float[mVertexCapacity];
+		mHeights1    = new float[mVertexCapacity];
+		mRowAge      = new float[MaxComplexity];
+		mRowInterval = new float[MaxComplexity];
+		mRowWeight   = new float[MaxComplexity];
+		mRowPriority = new float[MaxComplexity];
+
 	    _setDisplacementAmplitude(0.0f);
 
 		mTmpRndrngCamera  = new Ogre::Camera("PG_TmpRndrngCamera", NULL);
 		mProjectingCamera = new Ogre::Camera("PG_ProjectingCamera", NULL);
 
+		// Camera views project the grid for their own camera
+		mRenderingCamera = _getCamera();
+
 		HydraxLOG(getName() + " created.");
 	}
 
@@ -187,13 +298,51 @@ namespace Hydrax{namespace Module
 			{
 				delete [] static_cast<Mesh::POS_VERTEX*>(mVertices);
 			}
+
+			mVertices = 0;
 		}
 
 		if (mVerticesChoppyBuffer)
 		{
 			delete [] mVerticesChoppyBuffer;
+
+			mVerticesChoppyBuffer = 0;
 		}
 
+		mVertexCapacity = 0;
+
+		if (mGridX)
+		{
+			delete [] mGridX;
+			delete [] mGridZ;
+			delete [] mGridV;
+			delete [] mGridY;
+
+			mGridX = 0;
+			mGridZ = 0;
+			mGridV = 0;
+			mGridY = 0;
+		}
+
+		if (mHeights0)
+		{
+			delete [] mHeights0;
+			delete [] mHeights1;
+			delete [] mRowAge;
+			delete [] mRowInterval;
+			delete [] mRowWeight;
+			delete [] mRowPriority;
+
+			mHeights0 = 0;
+			mHeights1 = 0;
+			mRowAge = 0;
+			mRowInterval = 0;
+			mRowWeight = 0;
+			mRowPriority = 0;
+		}
+
+		mRowIndices.clear();
+
 		if (mTmpRndrngCamera)
 		{
 			delete mTmpRndrngCamera;
@@ -202,6 +351,8 @@ namespace Hydrax{namespace Module
 
 		mLastPosition = Ogre::Vector3(0,0,0);
 		mLastOrientation = Ogre::Quaternion();
+		mProjectionPosition = Ogre::Vector3(0,0,0);
+		mForceFullRefresh = true;
 	}
 
 	void ProjectedGrid::saveCfg(Ogre::String &Data)
@@ -211,10 +362,17 @@ namespace Hydrax{namespace Module
 		Data += CfgFileManager::_getCfgString("PG_ChoopyStrength", mOptions.ChoppyStrength);
 		Data += CfgFileManager::_getCfgString("PG_ChoppyWaves", mOptions.ChoppyWaves);
 		Data += CfgFileManager::_getCfgString("PG_Complexity", mOptions.Complexity);
+		Data += CfgFileManager::_getCfgString("PG_MaxComplexity", mOptions.MaxComplexity);
 		Data += CfgFileManager::_getCfgString("PG_Elevation", mOptions.Elevation);
 		Data += CfgFileManager::_getCfgString("PG_ForceRecalculateGeometry", mOptions.ForceRecalculateGeometry);
 		Data += CfgFileManager::_getCfgString("PG_Smooth", mOptions.Smooth);
-		Data += CfgFileManager::_getCfgString("PG_Strength", mOptions.Strength); Data += "\n";
+		Data += CfgFileManager::_getCfgString("PG_Strength", mOptions.Strength);
+		Data += CfgFileManager::_getCfgString("PG_AdaptiveDistribution", mOptions.AdaptiveDistribution);
+		Data += CfgFileManager::_getCfgString("PG_AdaptiveStrength", mOptions.AdaptiveStrength);
+		Data += CfgFileManager::_getCfgString("PG_UpdateBudget", mOptions.UpdateBudget);
+		Data += CfgFileManager::_getCfgString("PG_UpdateByDistance", mOptions.UpdateByDistance);
+		Data += CfgFileManager::_getCfgString("PG_FullRefreshDistance", mOptions.FullRefreshDistance);
+		Data += CfgFileManager::_getCfgString("PG_TargetFrameTime", mOptions.TargetFrameTime); Data += "\n";
 	}
 
 	bool ProjectedGrid::loadCfg(Ogre::ConfigFile &CfgFile)
@@ -224,14 +382,29 @@ namespace Hydrax{namespace Module
 			return false;
 		}
 
-		setOptions(
+		Options LoadedOptions = 
 			Options(CfgFileManager::_getIntValue(CfgFile,   "PG_Complexity"),
 			        CfgFileManager::_getFloatValue(CfgFile, "PG_Strength"),
 					CfgFileManager::_getFloatValue(CfgFile, "PG_Elevation"),
 					CfgFileManager::_getBoolValue(CfgFile,  "PG_Smooth"),
 					CfgFileManager::_getBoolValue(CfgFile,  "PG_ForceRecalculateGeometry"),
 					CfgFileManager::_getBoolValue(CfgFile,  "PG_ChoppyWaves"),
-					CfgFileManager::_getFloatValue(CfgFile, "PG_ChoopyStrength")));
+					CfgFileManager::_getFloatValue(CfgFile, "PG_ChoopyStrength"),
+					CfgFileManager::_getBoolValue(CfgFile,  "PG_AdaptiveDistribution"),
+					CfgFileManager::_getFloatValue(CfgFile, "PG_AdaptiveStrength"));
+
+		LoadedOptions.MaxComplexity = CfgFileManager::_getIntValue(CfgFile, "PG_MaxComplexity");
+
+		// Budgeted updates, old cfg files don't store them: keep the defaults
+		if (CfgFile.getSetting("<float>PG_UpdateBudget") != "")
+		{
+			LoadedOptions.UpdateBudget        = CfgFileManager::_getFloatValue(CfgFile, "PG_UpdateBudget");
+			LoadedOptions.UpdateByDistance    = CfgFileManager::_getBoolValue(CfgFile,  "PG_UpdateByDistance");
+			LoadedOptions.FullRefreshDistance = CfgFileManager::_getFloatValue(CfgFile, "PG_FullRefreshDistance");
+			LoadedOptions.TargetFrameTime     = CfgFileManager::_getFloatValue(CfgFile, "PG_TargetFrameTime");
+		}
+
+		setOptions(LoadedOptions);
 
 		return true;
 	}
@@ -245,75 +418,179 @@ namespace Hydrax{namespace Module
 
 		Module::update(timeSinceLastFrame);
 
-		Ogre::Vector3 RenderingCameraPos = mRenderingCamera->getDerivedPosition();
+		mAsyncLastFrame = false;
 
-		if (mLastPosition    != RenderingCameraPos    || 
-			mLastOrientation != mRenderingCamera->getDerivedOrientation() ||
-			mOptions.ForceRecalculateGeometry)
+		_prepareGeometry(timeSinceLastFrame, mRenderingCamera->getDerivedPosition(), mRenderingCamera->getDerivedOrientation());
+		_generateGeometry();
+		_commitGeometry();
+	}
+
+	bool ProjectedGrid::_prepareAsyncUpdate(const Ogre::Real &timeSinceLastFrame)
+	{
+		if (!isCreated())
 		{
-			if (mLastPosition != RenderingCameraPos)
-			{
-				Ogre::Vector3 HydraxPos = Ogre::Vector3(RenderingCameraPos.x,mHydrax->getPosition().y,RenderingCameraPos.z);
+			return false;
+		}
+
+		// GPU normal map resources are updated with the noise, they must be uploaded from here
+		if (mNoise->areGPUNormalMapResourcesCreated())
+		{
+			Module::update(timeSinceLastFrame);
+			mAsyncTime = -1;
+		}
+		else
+		{
+			mAsyncTime = timeSinceLastFrame;
+		}
 
-		        mHydrax->getMesh()->getSceneNode()->setPosition(HydraxPos);
-		        mHydrax->getRttManager()->getPlanesSceneNode()->setPosition(HydraxPos);
+		Ogre::Vector3    CameraPosition    = mRenderingCamera->getDerivedPosition();
+		Ogre::Quaternion CameraOrientation = mRenderingCamera->getDerivedOrientation();
 
-		        // For world-space -> object-space conversion
-				mHydrax->setSunPosition(mHydrax->getSunPosition());
+		// The geometry will be displayed in the next frame: reproject the grid for the 
+		// next frame camera, extrapolated from the last frame camera motion
+		if (mAsyncLastFrame)
+		{
+			Ogre::Vector3    PredictedPosition    = CameraPosition + (CameraPosition - mPrevCameraPosition);
+			Ogre::Quaternion PredictedOrientation = (CameraOrientation * mPrevCameraOrientation.Inverse()) * CameraOrientation;
+			PredictedOrientation.normalise();
+
+			mPrevCameraPosition    = CameraPosition;
+			mPrevCameraOrientation = CameraOrientation;
+
+			_prepareGeometry(timeSinceLastFrame, PredictedPosition, PredictedOrientation);
+		}
+		else
+		{
+			mPrevCameraPosition    = CameraPosition;
+			mPrevCameraOrientation = CameraOrientation;
+
+			_prepareGeometry(timeSinceLastFrame, CameraPosition, CameraOrientation);
+		}
+
+		mAsyncLastFrame = true;
+
+		return true;
+	}
+
+	void ProjectedGrid::_asyncUpdate()
+	{
+		if (mAsyncTime >= 0)
+		{
+			Module::update(mAsyncTime);
+		}
+
+		_generateGeometry();
+	}
+
+	void ProjectedGrid::_commitAsyncUpdate()
+	{
+		_commitGeometry();
+	}
+
+	void ProjectedGrid::_prepareGeometry(const Ogre::Real &timeSinceLastFrame, const Ogre::Vector3& CameraPosition, const Ogre::Quaternion& CameraOrientation)
+	{
+		mPendingTime += timeSinceLastFrame;
+
+		mGeometryUpdate = GU_NONE;
+
+		bool Budgeted = mOptions.UpdateBudget < 1.0f,
+			 Moved    = (mLastPosition != CameraPosition);
+
+		// Budgeted updates: small camera displacements keep the current grid projection
+		if (Budgeted && Moved)
+		{
+			Moved = mProjectionPosition.distance(CameraPosition) > mOptions.FullRefreshDistance;
+		}
+
+		if (Budgeted && mOptions.TargetFrameTime > 0 && timeSinceLastFrame > 0)
+		{
+			mBudget *= (timeSinceLastFrame > mOptions.TargetFrameTime) ? 0.9f : 1.05f;
+			mBudget  = std::max(1.0f/mOptions.Complexity, std::min(mBudget, mOptions.UpdateBudget));
+		}
+		else
+		{
+			mBudget = mOptions.UpdateBudget;
+		}
+
+		// Scene state used by the geometry generation
+		mCameraPosition  = CameraPosition;
+		mCameraDirection = CameraOrientation * Ogre::Vector3::NEGATIVE_UNIT_Z;
+		mWaterHeight     = _getPosition().y;
+		// Underwater effects are only rendered for the main camera
+		mUnderwater      = mCameraView ? false : mHydrax->_isCurrentFrameUnderwater();
+
+		// Beyond the far field inner radius the water is rendered by the mesh far field ring
+		float MaxFarClipDistance = _def_MaxFarClipDistance;
+
+		if (_getMesh()->isFarFieldEnabled())
+		{
+			MaxFarClipDistance = std::min(MaxFarClipDistance, _getMesh()->getFarFieldInnerRadius());
+		}
+
+		if (Moved || mForceFullRefresh ||
+			mCameraFarClipDistance != std::min(mRenderingCamera->getFarClipDistance(), MaxFarClipDistance) ||
+			mLastOrientation != CameraOrientation ||
+			mOptions.ForceRecalculateGeometry)
+		{
+			mForceFullRefresh = false;
+
+			if (mProjectionPosition != CameraPosition)
+			{
+				// The mesh is moved in _commitGeometry(), with the new geometry
+				mProjectionPosition = CameraPosition;
+				mRecenter = true;
 			}
 
 			float RenderingFarClipDistance = mRenderingCamera->getFarClipDistance();
 
-		    if (RenderingFarClipDistance > _def_MaxFarClipDistance)
+		    if (RenderingFarClipDistance > MaxFarClipDistance)
 		    {
-			    mRenderingCamera->setFarClipDistance(_def_MaxFarClipDistance);
+			    mRenderingCamera->setFarClipDistance(MaxFarClipDistance);
 		    }
 
-			mLastMinMax = _getMinMax(&mRange);
+			mCameraFarClipDistance = mRenderingCamera->getFarClipDistance();
+
+			mLastMinMax = _getMinMax(&mRange, CameraPosition, CameraOrientation);
 
 		    if (mLastMinMax)
 		    {
-			    _renderGeometry(mRange, mProjectingCamera->getViewMatrix(), RenderingCameraPos);
-
-			    mHydrax->getMesh()->updateGeometry(mOptions.Complexity*mOptions.Complexity, mVertices);
+				mViewMatrix     = mProjectingCamera->getViewMatrix();
+				mGeometryUpdate = GU_FULL;
 		    }
 
 			mRenderingCamera->setFarClipDistance(RenderingFarClipDistance);
 		}
 		else if (mLastMinMax)
 		{
-			int i = 0, v, u;
+			mGeometryUpdate = GU_HEIGHTS;
+		}
 
-			if (getNormalMode() == MaterialManager::NM_VERTEX)
-			{
-				Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+		mLastPosition = CameraPosition;
+		mLastOrientation = CameraOrientation;
+	}
 
-				if (mOptions.ChoppyWaves)
-				{
-					for(int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
-		            {
-			            Vertices[i] = mVerticesChoppyBuffer[i];
-						Vertices[i].y = -mBasePlane.d + mNoise->getValue(RenderingCameraPos.x + Vertices[i].x, RenderingCameraPos.z + Vertices[i].z)*mOptions.Strength;
-		            }
-				}
-				else
-				{
-					for(int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
-		            {
-						Vertices[i].y = -mBasePlane.d + mNoise->getValue(RenderingCameraPos.x + Vertices[i].x, RenderingCameraPos.z + Vertices[i].z)*mOptions.Strength;
-		            }
-				}
-			}
-			else if (getNormalMode() == MaterialManager::NM_RTT)
+	void ProjectedGrid::_generateGeometry()
+	{
+		if (mGeometryUpdate == GU_FULL)
+		{
+			_renderGeometry(mRange, mViewMatrix, mProjectionPosition);
+		}
+		else if (mGeometryUpdate == GU_HEIGHTS)
+		{
+			int v, u;
+
+			if (getNormalMode() == MaterialManager::NM_VERTEX && mOptions.ChoppyWaves)
 			{
-				Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
+				Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
 
 				for(int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
 		        {
-				    Vertices[i].y = -mBasePlane.d + mNoise->getValue(RenderingCameraPos.x + Vertices[i].x, RenderingCameraPos.z + Vertices[i].z)*mOptions.Strength;
+			        Vertices[i] = mVerticesChoppyBuffer[i];
 		        }
 			}
 
+			_updateHeights(mProjectionPosition, false);
+
 			// Smooth the heightdata
 		    if (mOptions.Smooth)
 		    {
@@ -358,12 +635,35 @@ namespace Hydrax{namespace Module
 			_calculeNormals();
 
 			_performChoppyWaves();
+		}
+	}
 
-			mHydrax->getMesh()->updateGeometry(mOptions.Complexity*mOptions.Complexity, mVertices);
+	void ProjectedGrid::_commitGeometry()
+	{
+		if (mRecenter)
+		{
+			Ogre::Vector3 HydraxPos = Ogre::Vector3(mProjectionPosition.x,_getPosition().y,mProjectionPosition.z);
+
+		    _getMesh()->getSceneNode()->setPosition(HydraxPos);
+
+			// RTTs are rendered for the main camera
+			if (!mCameraView)
+			{
+				mHydrax->getRttManager()->getPlanesSceneNode()->setPosition(HydraxPos);
+
+				// For world-space -> object-space conversion
+				mHydrax->setSunPosition(mHydrax->getSunPosition());
+			}
+
+			mRecenter = false;
 		}
 
-		mLastPosition = RenderingCameraPos;
-		mLastOrientation = mRenderingCamera->getDerivedOrientation();
+		if (mGeometryUpdate != GU_NONE)
+		{
+			_getMesh()->updateGeometry(mOptions.Complexity*mOptions.Complexity, mVertices);
+
+			mGeometryUpdate = GU_NONE;
+		}
 	}
 
 	bool ProjectedGrid::_renderGeometry(const Ogre::Matrix4& m,const Ogre::Matrix4& _viewMat, const Ogre::Vector3& WorldPos)
@@ -372,48 +672,24 @@ namespace Hydrax{namespace Module
 		t_corners1 = _calculeWorldPosition(Ogre::Vector2(+1.0f, 0.0f),m,_viewMat);
 		t_corners2 = _calculeWorldPosition(Ogre::Vector2( 0.0f,+1.0f),m,_viewMat);
 		t_corners3 = _calculeWorldPosition(Ogre::Vector2(+1.0f,+1.0f),m,_viewMat);
-	
-		float du  = 1.0f/(mOptions.Complexity-1),
-			  dv  = 1.0f/(mOptions.Complexity-1),
-			  u,v = 0.0f,
-			  // _1_u = (1.0f-u)
-			  _1_u, _1_v = 1.0f,
-			  divide;
 
-		Ogre::Vector4 result;
+		_calculeRowDistribution();
+		_projectGrid();
 
-		int i = 0, iv, iu;
+		int i, iv, iu;
 
 		if (getNormalMode() == MaterialManager::NM_VERTEX)
 		{
 			Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
 
-			for(iv=0; iv<mOptions.Complexity; iv++)
+			for(i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
 			{
-				u = 0.0f;	
-				_1_u = 1.0f;
-				for(iu=0; iu<mOptions.Complexity; iu++)
-				{				
-					result.x = _1_v*(_1_u*t_corners0.x + u*t_corners1.x) + v*(_1_u*t_corners2.x + u*t_corners3.x);				
-					result.z = _1_v*(_1_u*t_corners0.z + u*t_corners1.z) + v*(_1_u*t_corners2.z + u*t_corners3.z);				
-					result.w = _1_v*(_1_u*t_corners0.w + u*t_corners1.w) + v*(_1_u*t_corners2.w + u*t_corners3.w);				
-
-					divide = 1.0f/result.w;				
-					result.x *= divide;
-					result.z *= divide;
-
-					Vertices[i].x = result.x;
-					Vertices[i].z = result.z;
-					Vertices[i].y = -mBasePlane.d + mNoise->getValue(WorldPos.x + result.x, WorldPos.z + result.z)*mOptions.Strength;
-
-					i++;
-					u += du;
-					_1_u = 1.0f-u;
-				}
-				v += dv;
-				_1_v = 1.0f-v;
+				Vertices[i].x = mGridX[i];
+				Vertices[i].z = mGridZ[i];
 			}
 
+			_updateHeights(WorldPos, true);
+
 			if (mOptions.ChoppyWaves)
 			{
 				for(int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
@@ -426,31 +702,13 @@ namespace Hydrax{namespace Module
 		{
 			Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
 
-			for(iv=0; iv<mOptions.Complexity; iv++)
+			for(i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
 			{
-				u = 0.0f;	
-				_1_u = 1.0f;
-				for(iu=0; iu<mOptions.Complexity; iu++)
-				{				
-					result.x = _1_v*(_1_u*t_corners0.x + u*t_corners1.x) + v*(_1_u*t_corners2.x + u*t_corners3.x);				
-					result.z = _1_v*(_1_u*t_corners0.z + u*t_corners1.z) + v*(_1_u*t_corners2.z + u*t_corners3.z);				
-					result.w = _1_v*(_1_u*t_corners0.w + u*t_corners1.w) + v*(_1_u*t_corners2.w + u*t_corners3.w);				
-
-					divide = 1.0f/result.w;				
-					result.x *= divide;
-					result.z *= divide;
-
-					Vertices[i].x = result.x;
-					Vertices[i].z = result.z;
-					Vertices[i].y = -mBasePlane.d + mNoise->getValue(WorldPos.x + result.x, WorldPos.z + result.z)*mOptions.Strength;
-
-					i++;
-					u += du;
-					_1_u = 1.0f-u;
-				}
-				v += dv;
-				_1_v = 1.0f-v;
+				Vertices[i].x = mGridX[i];
+				Vertices[i].z = mGridZ[i];
 			}
+
+			_updateHeights(WorldPos, true);
 		}
 
 		// Smooth the heightdata
@@ -501,6 +759,277 @@ namespace Hydrax{namespace Module
 		return true;
 	}
 
+	void ProjectedGrid::_projectGrid()
+	{
+		const int   C   = mOptions.Complexity;
+		const float inv = 1.0f/(C-1);
+
+		float v, _1_v,
+			  // Row end points (homogeneous x/z/w), row start and per-vertex delta
+			  ax, az, aw, bx, bz, bw,
+			  dx, dz, dw,
+			  divide;
+
+		int iv, iu, i = 0;
+
+#if HYDRAX_USE_SSE
+		const __m128 _Two   = _mm_set1_ps(2.0f),
+			         _Eight = _mm_set1_ps(8.0f);
+#endif
+
+		for(iv=0; iv<C; iv++)
+		{
+			// Exact row parameter, v isn't accumulated so there's no drift along the grid
+			v    = mGridV[iv];
+			_1_v = 1.0f-v;
+
+			ax = _1_v*t_corners0.x + v*t_corners2.x;
+			az = _1_v*t_corners0.z + v*t_corners2.z;
+			aw = _1_v*t_corners0.w + v*t_corners2.w;
+
+			bx = _1_v*t_corners1.x + v*t_corners3.x;
+			bz = _1_v*t_corners1.z + v*t_corners3.z;
+			bw = _1_v*t_corners1.w + v*t_corners3.w;
+
+			dx = (bx-ax)*inv;
+			dz = (bz-az)*inv;
+			dw = (bw-aw)*inv;
+
+			iu = 0;
+
+#if HYDRAX_USE_SSE
+			// Homogeneous coordinates are linear along the row: P(iu) = A + iu*D.
+			// The column index is carried as an exact float vector (+8 per iteration), 
+			// so the forward difference never accumulates rounding error.
+			__m128 _Idx0 = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f),
+				   _Idx1 = _mm_set_ps(7.0f, 6.0f, 5.0f, 4.0f),
+				   _Ax = _mm_set1_ps(ax), _Az = _mm_set1_ps(az), _Aw = _mm_set1_ps(aw),
+				   _Dx = _mm_set1_ps(dx), _Dz = _mm_set1_ps(dz), _Dw = _mm_set1_ps(dw),
+				   _X0, _Z0, _W0, _R0,
+				   _X1, _Z1, _W1, _R1;
+
+			for(; iu+8<=C; iu+=8, i+=8)
+			{
+				_X0 = _mm_add_ps(_Ax, _mm_mul_ps(_Idx0, _Dx));
+				_Z0 = _mm_add_ps(_Az, _mm_mul_ps(_Idx0, _Dz));
+				_W0 = _mm_add_ps(_Aw, _mm_mul_ps(_Idx0, _Dw));
+
+				_X1 = _mm_add_ps(_Ax, _mm_mul_ps(_Idx1, _Dx));
+				_Z1 = _mm_add_ps(_Az, _mm_mul_ps(_Idx1, _Dz));
+				_W1 = _mm_add_ps(_Aw, _mm_mul_ps(_Idx1, _Dw));
+
+				// Approximate reciprocal (12 bits) refined with one Newton-Raphson step: r = r*(2 - w*r)
+				_R0 = _mm_rcp_ps(_W0);
+				_R1 = _mm_rcp_ps(_W1);
+				_R0 = _mm_mul_ps(_R0, _mm_sub_ps(_Two, _mm_mul_ps(_W0, _R0)));
+				_R1 = _mm_mul_ps(_R1, _mm_sub_ps(_Two, _mm_mul_ps(_W1, _R1)));
+
+				_mm_storeu_ps(mGridX + i,     _mm_mul_ps(_X0, _R0));
+				_mm_storeu_ps(mGridZ + i,     _mm_mul_ps(_Z0, _R0));
+				_mm_storeu_ps(mGridX + i + 4, _mm_mul_ps(_X1, _R1));
+				_mm_storeu_ps(mGridZ + i + 4, _mm_mul_ps(_Z1, _R1));
+
+				_Idx0 = _mm_add_ps(_Idx0, _Eight);
+				_Idx1 = _mm_add_ps(_Idx1, _Eight);
+			}
+#endif
+
+			// Scalar path / row remainder
+			for(; iu<C; iu++, i++)
+			{
+				divide = 1.0f/(aw + iu*dw);
+
+				mGridX[i] = (ax + iu*dx)*divide;
+				mGridZ[i] = (az + iu*dz)*divide;
+			}
+		}
+	}
+
+	void ProjectedGrid::_calculeRowDistribution()
+	{
+		const float inv = 1.0f/(mOptions.Complexity-1);
+
+		int iv;
+
+		if (!mOptions.AdaptiveDistribution || mOptions.AdaptiveStrength <= 0)
+		{
+			for(iv=0; iv<mOptions.Complexity; iv++)
+			{
+				mGridV[iv] = iv*inv;
+			}
+
+			return;
+		}
+
+		// Uniform rows in projector space crowd near the horizon (v = 1) when the camera looks
+		// to the horizon, and the effect grows with the far clip distance relative to the height
+		// of the projector over the plane. Warp rows with v' = v^k, k in [1, 1+AdaptiveStrength]
+		float Pitch     = Ogre::Math::Abs(mBasePlane.normal.dotProduct(mCameraDirection)),
+		      Height    = Ogre::Math::Abs(mBasePlane.getDistance(mProjectingCamera->getRealPosition())),
+			  FarFactor = Ogre::Math::Log(mCameraFarClipDistance/std::max(Height, 1.0f)) / Ogre::Math::Log(1000.0f);
+
+		FarFactor = std::max(0.0f, std::min(FarFactor, 1.0f));
+
+		float k = 1.0f + mOptions.AdaptiveStrength*(1.0f-Pitch)*FarFactor;
+
+		for(iv=0; iv<mOptions.Complexity; iv++)
+		{
+			mGridV[iv] = Ogre::Math::Pow(iv*inv, k);
+		}
+
+		// Keep the last row exactly over the horizon
+		mGridV[mOptions.Complexity-1] = 1.0f;
+	}
+
+	void ProjectedGrid::_updateHeights(const Ogre::Vector3& Origin, const bool& Full)
+	{
+		const int C = mOptions.Complexity;
+
+		int i, iv, iu, r, Rows;
+
+		const float Elapsed = mPendingTime;
+		mPendingTime = 0;
+
+		if (Full || mOptions.UpdateBudget >= 1.0f)
+		{
+			// One call for the whole grid instead of a virtual call per vertex
+			mNoise->getValues(mGridX, mGridZ, C*C, mGridY, Origin.x, Origin.z, mOptions.Strength);
+
+			if (mOptions.UpdateBudget < 1.0f)
+			{
+				// Reset the height history: no extrapolation until rows get a new sample
+				memcpy(mHeights0, mGridY, C*C*sizeof(float));
+				memcpy(mHeights1, mGridY, C*C*sizeof(float));
+
+				float CameraHeight = mCameraPosition.y - mWaterHeight,
+					  MinDistance  = -1;
+
+				for(iv=0; iv<C; iv++)
+				{
+					i = iv*C + C/2;
+
+					mRowAge[iv]      = 0;
+					mRowInterval[iv] = 0;
+					mRowPriority[iv] = 0;
+					mRowWeight[iv]   = Ogre::Math::Sqrt(mGridX[i]*mGridX[i] + mGridZ[i]*mGridZ[i] + CameraHeight*CameraHeight);
+
+					if (MinDistance < 0 || mRowWeight[iv] < MinDistance)
+					{
+						MinDistance = mRowWeight[iv];
+					}
+				}
+
+				// Weight = nearest row distance / row distance, in (0,1]
+				for(iv=0; iv<C; iv++)
+				{
+					mRowWeight[iv] = (mRowWeight[iv] > 0) ? MinDistance/mRowWeight[iv] : 1.0f;
+				}
+			}
+		}
+		else
+		{
+			_selectBudgetRows();
+
+			for(iv=0; iv<C; iv++)
+			{
+				mRowAge[iv] += Elapsed;
+			}
+
+			for(r = 0; r < static_cast<int>(mRowIndices.size()); r += Rows)
+			{
+				iv = mRowIndices[r];
+
+				// Consecutive rows are contiguous in the grid arrays, sample them with a single call
+				for(Rows = 1; r+Rows < static_cast<int>(mRowIndices.size()) && mRowIndices[r+Rows] == iv+Rows; Rows++)
+				{
+					mRowInterval[iv+Rows] = mRowAge[iv+Rows];
+					mRowAge[iv+Rows]      = 0;
+				}
+
+				mRowInterval[iv] = mRowAge[iv];
+				mRowAge[iv]      = 0;
+
+				i = iv*C;
+
+				memcpy(mHeights1 + i, mHeights0 + i, Rows*C*sizeof(float));
+				mNoise->getValues(mGridX + i, mGridZ + i, Rows*C, mHeights0 + i, Origin.x, Origin.z, mOptions.Strength);
+			}
+
+			// Linear extrapolation from the last two samples, limited to one sample interval
+			float Factor;
+
+			for(iv=0; iv<C; iv++)
+			{
+				Factor = (mRowInterval[iv] > 0) ? std::min(mRowAge[iv]/mRowInterval[iv], 1.0f) : 0.0f;
+
+				for(iu=0, i=iv*C; iu<C; iu++, i++)
+				{
+					mGridY[i] = mHeights0[i] + (mHeights0[i]-mHeights1[i])*Factor;
+				}
+			}
+		}
+
+		if (getNormalMode() == MaterialManager::NM_VERTEX)
+		{
+			Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+
+			for(i = 0; i < C*C; i++)
+			{
+				Vertices[i].y = -mBasePlane.d + mGridY[i];
+			}
+		}
+		else if(getNormalMode() == MaterialManager::NM_RTT)
+		{
+			Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
+
+			for(i = 0; i < C*C; i++)
+			{
+				Vertices[i].y = -mBasePlane.d + mGridY[i];
+			}
+		}
+	}
+
+	void ProjectedGrid::_selectBudgetRows()
+	{
+		const int C    = mOptions.Complexity,
+			      Rows = std::max(1, std::min(static_cast<int>(Ogre::Math::Ceil(mBudget*C)), C));
+
+		int iv;
+
+		mRowIndices.clear();
+
+		if (!mOptions.UpdateByDistance)
+		{
+			// Interleaved rows
+			int Stride = (C + Rows - 1)/Rows;
+
+			for(iv = static_cast<int>(mFrame % Stride); iv < C; iv += Stride)
+			{
+				mRowIndices.push_back(iv);
+			}
+		}
+		else
+		{
+			// Rows with the highest accumulated priority, near rows accumulate faster
+			for(iv=0; iv<C; iv++)
+			{
+				mRowPriority[iv] += mRowWeight[iv];
+				mRowIndices.push_back(iv);
+			}
+
+			_PG_RowPriorityCompare Compare(mRowPriority);
+			std::nth_element(mRowIndices.begin(), mRowIndices.begin() + (Rows-1), mRowIndices.end(), Compare);
+			mRowIndices.resize(Rows);
+
+			for(iv=0; iv<Rows; iv++)
+			{
+				mRowPriority[mRowIndices[iv]] = 0;
+			}
+		}
+
+		mFrame++;
+	}
+
 	void ProjectedGrid::_calculeNormals()
 	{
 		if (getNormalMode() != MaterialManager::NM_VERTEX)
@@ -546,7 +1075,7 @@ namespace Hydrax{namespace Module
 		int v, u,
 		    Underwater = 1;
 
-		if (mHydrax->_isCurrentFrameUnderwater())
+		if (mUnderwater)
 		{
 			Underwater = -1;
 		}
@@ -557,7 +1086,7 @@ namespace Hydrax{namespace Module
 		Ogre::Vector3 CameraDir, Norm;
 		Ogre::Vector2 Dir, Perp, Norm2;
 
-		CameraDir = mRenderingCamera->getDerivedDirection();
+		CameraDir = mCameraDirection;
 		Dir       = Ogre::Vector2(CameraDir.x, CameraDir.z).normalisedCopy();
 		Perp      = Dir.perpendicular();
 
@@ -639,7 +1168,7 @@ namespace Hydrax{namespace Module
 		return retPos;
 	}
 
-	bool ProjectedGrid::_getMinMax(Ogre::Matrix4 *range)
+	bool ProjectedGrid::_getMinMax(Ogre::Matrix4 *range, const Ogre::Vector3& CameraPosition, const Ogre::Quaternion& CameraOrientation)
 	{
 		_setDisplacementAmplitude(mOptions.Strength);
 
@@ -664,12 +1193,12 @@ namespace Hydrax{namespace Module
 		// Set temporal rendering camera parameters
 		mTmpRndrngCamera->setFrustumOffset(mRenderingCamera->getFrustumOffset());
 		mTmpRndrngCamera->setAspectRatio(mRenderingCamera->getAspectRatio());
-		mTmpRndrngCamera->setDirection(mRenderingCamera->getDerivedDirection());
+		mTmpRndrngCamera->setDirection(CameraOrientation * Ogre::Vector3::NEGATIVE_UNIT_Z);
 		mTmpRndrngCamera->setFarClipDistance(mRenderingCamera->getFarClipDistance());
 		mTmpRndrngCamera->setFOVy(mRenderingCamera->getFOVy());
 		mTmpRndrngCamera->setNearClipDistance(mRenderingCamera->getNearClipDistance());
-		mTmpRndrngCamera->setOrientation(mRenderingCamera->getDerivedOrientation());
-		mTmpRndrngCamera->setPosition(0, mRenderingCamera->getDerivedPosition().y - mHydrax->getPosition().y, 0);
+		mTmpRndrngCamera->setOrientation(CameraOrientation);
+		mTmpRndrngCamera->setPosition(0, CameraPosition.y - _getPosition().y, 0);
 
 		Ogre::Matrix4 invviewproj = (mTmpRndrngCamera->getProjectionMatrixWithRSDepth()*mTmpRndrngCamera->getViewMatrix()).inverse();
 		frustum[0] = invviewproj * Ogre::Vector3(-1,-1,0);
@@ -834,6 +1363,36 @@ namespace Hydrax{namespace Module
 
 	float ProjectedGrid::getHeigth(const Ogre::Vector2 &Position)
 	{
-		return mHydrax->getPosition().y + mNoise->getValue(Position.x, Position.y)*mOptions.Strength;
+		return _getPosition().y + mNoise->getValue(Position.x, Position.y)*mOptions.Strength;
+	}
+
+	void ProjectedGrid::getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid)
+	{
+		_getNoiseHeigths(Positions, Heigths, Count, _getPosition().y, mOptions.Strength);
+
+		if (Valid)
+		{
+			std::fill(Valid, Valid+Count, true);
+		}
+	}
+
+	void ProjectedGrid::getSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, bool *Valid)
+	{
+		_getNoiseSurfaceSamples(Positions, Samples, Count, _getPosition().y, mOptions.Strength);
+
+		if (Valid)
+		{
+			std::fill(Valid, Valid+Count, true);
+		}
+	}
+
+	bool ProjectedGrid::getSurfaceBounds(float &MaxDisplacement, float &MaxSlope)
+	{
+		return _getNoiseSurfaceBounds(mOptions.Strength, MaxDisplacement, MaxSlope);
+	}
+
+	WaterState* ProjectedGrid::_createWaterState()
+	{
+		return _createInfiniteWaterState(_getPosition().y, mOptions.Strength);
 	}
 }}
\ No newline at end of file
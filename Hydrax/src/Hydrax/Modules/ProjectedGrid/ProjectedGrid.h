@@ -50,6 +50,9 @@ namespace Hydrax{ namespace Module
 		{
 			/// Projected grid complexity (N*N)
 			int Complexity;
+			/// Max projected grid complexity, vertex arrays and buffers are allocated for it so
+			/// Complexity can be changed at runtime without reallocations (0 = Complexity)
+			int MaxComplexity;
 			/// Strength
 			float Strength;
 			/// Elevation 
@@ -62,17 +65,39 @@ namespace Hydrax{ namespace Module
 			bool ChoppyWaves;
 			/// Choppy waves strength
 			float ChoppyStrength;
+			/// Screen-space adaptive vertex distribution: grid rows are warped towards the camera
+			/// depending on the camera pitch and far clip distance, so the vertex density roughly
+			/// follows the projected screen area instead of crowding near the horizon
+			bool AdaptiveDistribution;
+			/// Adaptive distribution strength (0 = uniform rows, 1 = default warp)
+			float AdaptiveStrength;
+			/// Fraction [0,1] of grid rows re-evaluated each frame when only the waves move (1 = all rows).
+			/// With a budget < 1 the rest of rows are extrapolated from their last two samples
+			float UpdateBudget;
+			/// Budgeted updates: refresh rows by distance to the camera (near rows more often) instead of interleaved rows
+			bool UpdateByDistance;
+			/// Budgeted updates: camera displacement which forces a full grid refresh (0 = any displacement)
+			float FullRefreshDistance;
+			/// Budgeted updates: target frame time in seconds, if > 0 the budget follows the measured frame time (never over UpdateBudget)
+			float TargetFrameTime;
 
 			/** Default constructor
 			 */
 			Options()
 				: Complexity(256)
+				, MaxComplexity(0)
 				, Strength(35.0f)
 				, Elevation(50.0f)
 				, Smooth(false)
 				, ForceRecalculateGeometry(false)
 				, ChoppyWaves(true)
 				, ChoppyStrength(3.75f)
+				, AdaptiveDistribution(false)
+				, AdaptiveStrength(1.0f)
+				, UpdateBudget(1.0f)
+				, UpdateByDistance(false)
+				, FullRefreshDistance(0.0f)
+				, TargetFrameTime(0.0f)
 			{
 			}
 
@@ -81,12 +106,19 @@ namespace Hydrax{ namespace Module
 			 */
 			Options(const int &_Complexity)
 				: Complexity(_Complexity)
+				, MaxComplexity(0)
 				, Strength(35.0f)
 				, Elevation(50.0f)
 				, Smooth(false)
 				, ForceRecalculateGeometry(false)
 				, ChoppyWaves(true)
 				, ChoppyStrength(3.75f)
+				, AdaptiveDistribution(false)
+				, AdaptiveStrength(1.0f)
+				, UpdateBudget(1.0f)
+				, UpdateByDistance(false)
+				, FullRefreshDistance(0.0f)
+				, TargetFrameTime(0.0f)
 			{
 			}
 
@@ -101,12 +133,19 @@ namespace Hydrax{ namespace Module
 					const float &_Elevation,
 					const bool  &_Smooth)
 				: Complexity(_Complexity)
+				, MaxComplexity(0)
 				, Strength(_Strength)
 				, Elevation(_Elevation)
 				, Smooth(_Smooth)
 				, ForceRecalculateGeometry(false)
 				, ChoppyWaves(true)
 				, ChoppyStrength(3.75f)
+				, AdaptiveDistribution(false)
+				, AdaptiveStrength(1.0f)
+				, UpdateBudget(1.0f)
+				, UpdateByDistance(false)
+				, FullRefreshDistance(0.0f)
+				, TargetFrameTime(0.0f)
 			{
 			}
 
@@ -127,12 +166,56 @@ namespace Hydrax{ namespace Module
 					const bool  &_ChoppyWaves,
 					const float &_ChoppyStrength)
 				: Complexity(_Complexity)
+				, MaxComplexity(0)
 				, Strength(_Strength)
 				, Elevation(_Elevation)
 				, Smooth(_Smooth)
 				, ForceRecalculateGeometry(_ForceRecalculateGeometry)
 				, ChoppyWaves(_ChoppyWaves)
 				, ChoppyStrength(_ChoppyStrength)
+				, AdaptiveDistribution(false)
+				, AdaptiveStrength(1.0f)
+				, UpdateBudget(1.0f)
+				, UpdateByDistance(false)
+				, FullRefreshDistance(0.0f)
+				, TargetFrameTime(0.0f)
+			{
+			}
+
+			/** Constructor
+			    @param _Complexity Projected grid complexity
+				@param _Strength Perlin noise strength
+				@param _Elevation Elevation
+				@param _Smooth Smooth vertex?
+				@param _ForceRecalculateGeometry Force to recalculate the projected grid geometry each frame
+				@param _ChoppyWaves Choppy waves enabled? Note: Only with Materialmanager::NM_VERTEX normal mode.
+				@param _ChoppyStrength Choppy waves strength
+				@param _AdaptiveDistribution Screen-space adaptive vertex distribution enabled?
+				@param _AdaptiveStrength Adaptive distribution strength
+			 */
+			Options(const int   &_Complexity,
+				    const float &_Strength,
+					const float &_Elevation,
+					const bool  &_Smooth,
+					const bool  &_ForceRecalculateGeometry,
+					const bool  &_ChoppyWaves,
+					const float &_ChoppyStrength,
+					const bool  &_AdaptiveDistribution,
+					const float &_AdaptiveStrength)
+				: Complexity(_Complexity)
+				, MaxComplexity(0)
+				, Strength(_Strength)
+				, Elevation(_Elevation)
+				, Smooth(_Smooth)
+				, ForceRecalculateGeometry(_ForceRecalculateGeometry)
+				, ChoppyWaves(_ChoppyWaves)
+				, ChoppyStrength(_ChoppyStrength)
+				, AdaptiveDistribution(_AdaptiveDistribution)
+				, AdaptiveStrength(_AdaptiveStrength)
+				, UpdateBudget(1.0f)
+				, UpdateByDistance(false)
+				, FullRefreshDistance(0.0f)
+				, TargetFrameTime(0.0f)
 			{
 			}
 		};
@@ -171,6 +254,22 @@ namespace Hydrax{ namespace Module
 		 */
 		void update(const Ogre::Real &timeSinceLastFrame);
 
+		/** Prepare a pipelined update (camera snapshot and grid projection)
+		    @param timeSinceLastFrame Time since last frame(delta)
+			@return true
+			@remarks The grid is projected for the next frame camera, extrapolated from the 
+			         last frame camera motion, since it'll be displayed one frame later.
+		 */
+		bool _prepareAsyncUpdate(const Ogre::Real &timeSinceLastFrame);
+
+		/** Pipelined update: noise update and geometry generation
+		 */
+		void _asyncUpdate();
+
+		/** Upload the geometry generated in _asyncUpdate()
+		 */
+		void _commitAsyncUpdate();
+
 		/** Set options
 		    @param Options Options
 		 */
@@ -193,6 +292,34 @@ namespace Hydrax{ namespace Module
 		 */
 		float getHeigth(const Ogre::Vector2 &Position);
 
+		/** Get the current heigths at some world-space points
+		    @param Positions X/Z World positions
+			@param Heigths Heigths at the given positions in y-World coordinates (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+		 */
+		void getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid = 0);
+
+		/** Get the current surface samples (heigth, normal and vertical velocity) at some world-space points
+		    @param Positions X/Z World positions
+			@param Samples Surface samples (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+		 */
+		void getSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, bool *Valid = 0);
+
+		/** Get the bounds of the current water surface
+		    @param MaxDisplacement Maximum y displacement from the water position (Output)
+			@param MaxSlope Maximum surface slope (Output)
+			@return false if the noise can't bound its values
+		 */
+		bool getSurfaceBounds(float &MaxDisplacement, float &MaxSlope);
+
+		/** Create an immutable snapshot of the current water state
+		    @return New water state, or 0 if the noise doesn't support snapshots
+		 */
+		WaterState* _createWaterState();
+
 		/** Get current options
 		    @return Current options
 		 */
@@ -202,6 +329,35 @@ namespace Hydrax{ namespace Module
 		}
 
 	private:
+		/** Geometry update to be performed by _generateGeometry()
+		 */
+		enum GeometryUpdate
+		{
+			GU_NONE    = 0,
+			// Project the grid and evaluate all vertices
+			GU_FULL    = 1,
+			// Keep the current projection, update the heights only
+			GU_HEIGHTS = 2
+		};
+
+		/** Decide the geometry update and store the scene state used by the geometry generation,
+		    it must be called from the render thread
+		    @param timeSinceLastFrame Time since last frame(delta)
+			@param CameraPosition Rendering camera world position
+			@param CameraOrientation Rendering camera world orientation
+		 */
+		void _prepareGeometry(const Ogre::Real &timeSinceLastFrame, const Ogre::Vector3& CameraPosition, const Ogre::Quaternion& CameraOrientation);
+
+		/** Generate the geometry decided in _prepareGeometry(...) in mVertices
+		    @remarks It doesn't access scene objects, it can be called from a worker thread
+		 */
+		void _generateGeometry();
+
+		/** Move the mesh to the projection position if needed and upload the generated geometry,
+		    it must be called from the render thread
+		 */
+		void _commitGeometry();
+
 		/** Calcule current normals
 		 */
 		void _calculeNormals();
@@ -218,6 +374,33 @@ namespace Hydrax{ namespace Module
 		 */
 		bool _renderGeometry(const Ogre::Matrix4& m,const Ogre::Matrix4& _viewMat, const Ogre::Vector3& WorldPos);
 
+		/** Project the grid over the base plane using the current t_corners0..3,
+		    results are stored in mGridX/mGridZ (object-space x/z, row-major)
+			@remarks Each row starts from its exact end points (no accumulated error along v),
+			         vertices along the row are generated by forward differencing of the
+					 homogeneous coordinates, 8 vertices per iteration when SSE is available.
+		 */
+		void _projectGrid();
+
+		/** Calcule the row parameter table (mGridV) used by _projectGrid()
+		    @remarks With Options::AdaptiveDistribution rows follow v' = v^k, where k grows 
+			         when the camera looks to the horizon and with the far clip/height ratio.
+					 Columns are kept uniform: along a projected row the screen-space 
+					 density is already uniform.
+		 */
+		void _calculeRowDistribution();
+
+		/** Update grid heights (mGridY) and vertex heights
+		    @param Origin World-space x/z origin of the grid
+			@param Full true for evaluate all vertices, false for evaluate only the rows in the 
+			       current budget (see Options::UpdateBudget), the rest are extrapolated
+		 */
+		void _updateHeights(const Ogre::Vector3& Origin, const bool& Full);
+
+		/** Select the rows to refresh this frame in budgeted mode (mRowIndices)
+		 */
+		void _selectBudgetRows();
+
 		/** Calcule world position
 		    @param uv uv
 			@param m Range
@@ -228,9 +411,11 @@ namespace Hydrax{ namespace Module
 	
 		/** Get min/max
 		    @param range Range
+			@param CameraPosition Rendering camera world position
+			@param CameraOrientation Rendering camera world orientation
 			@return true if it's in min/max
 		 */
-	    bool _getMinMax(Ogre::Matrix4 *range);
+	    bool _getMinMax(Ogre::Matrix4 *range, const Ogre::Vector3& CameraPosition, const Ogre::Quaternion& CameraOrientation);
 
 		/** Set displacement amplitude
 		    @param Amplitude Amplitude to set
@@ -243,6 +428,55 @@ namespace Hydrax{ namespace Module
 		/// Use it to store vertex positions when choppy displacement is enabled
 		Mesh::POS_NORM_VERTEX* mVerticesChoppyBuffer;
 
+		/// Allocated number of vertices (see Options::MaxComplexity)
+		int mVertexCapacity;
+
+		/// Projected grid x/z positions (Complexity*Complexity), filled by _projectGrid()
+		float *mGridX, *mGridZ;
+		/// Grid row parameters (Complexity), see _calculeRowDistribution()
+		float *mGridV;
+		/// Grid heights (Complexity*Complexity, noise*strength)
+		float *mGridY;
+
+		/// Budgeted updates: last two height samples per vertex, time since the last sample and 
+		/// time between the last two samples per row (elapsed times, so they keep their precision)
+		float *mHeights0, *mHeights1;
+		float *mRowAge, *mRowInterval;
+		/// Budgeted updates: row refresh weights (by distance) and accumulated priorities
+		float *mRowWeight, *mRowPriority;
+		/// Budgeted updates: rows to refresh in the current frame
+		std::vector<int> mRowIndices;
+		/// Budgeted updates: current budget, time not yet added to the row ages and frame counter
+		float mBudget;
+		Ogre::Real mPendingTime;
+		unsigned long mFrame;
+
+		/// Camera position used for the current grid projection
+		Ogre::Vector3 mProjectionPosition;
+		/// Force a full grid refresh on next update
+		bool mForceFullRefresh;
+
+		/// Geometry update decided in _prepareGeometry(...)
+		GeometryUpdate mGeometryUpdate;
+		/// Has the mesh to be moved to mProjectionPosition in _commitGeometry()?
+		bool mRecenter;
+		/// Rendering camera state used by the geometry generation
+		Ogre::Vector3 mCameraPosition, mCameraDirection;
+		Ogre::Real mCameraFarClipDistance;
+		/// Water height and underwater state used by the geometry generation
+		Ogre::Real mWaterHeight;
+		bool mUnderwater;
+		/// Projecting camera view matrix used by the geometry generation
+		Ogre::Matrix4 mViewMatrix;
+
+		/// Pipelined update: noise time step, -1 if the noise has been updated in the render thread
+		Ogre::Real mAsyncTime;
+		/// Pipelined update: was the last update pipelined?
+		bool mAsyncLastFrame;
+		/// Pipelined update: last frame real camera position and orientation (camera motion prediction)
+		Ogre::Vector3 mPrevCameraPosition;
+		Ogre::Quaternion mPrevCameraOrientation;
+
 		/// For corners
 		Ogre::Vector4 t_corners0,t_corners1,t_corners2,t_corners3;
 
@@ -269,9 +503,6 @@ namespace Hydrax{ namespace Module
 
 		/// Our projected grid options
 		Options mOptions;
-
-		/// Our Hydrax pointer
-		Hydrax* mHydrax;
 	};
 }}
 
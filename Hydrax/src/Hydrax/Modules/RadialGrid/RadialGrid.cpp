@@ -37,6 +37,148 @@ namespace Hydrax{namespace Module
 		return Mesh::VT_POS;
 	}
 
+	int _RG_getLODKey(const RadialGrid::Options& Options)
+	{
+		// Steps/Circles < 4096, LODRings < 128. Other layouts share the -1 key, so their 
+		// index buffer can't be reused by a different layout (See RadialGrid::setOptions(...))
+		if (Options.Steps    < 0 || Options.Steps    >= 4096 ||
+			Options.Circles  < 0 || Options.Circles  >= 4096 ||
+			Options.LODRings < 0 || Options.LODRings >= 128)
+		{
+			return -1;
+		}
+
+		return (Options.LODRings << 24) | (Options.Steps << 12) | Options.Circles;
+	}
+
+	void _RG_calculeRings(const RadialGrid::Options& Options, std::vector<int>& RingSteps, std::vector<int>& RingOffsets)
+	{
+		RingSteps.resize(Options.Circles);
+		RingOffsets.resize(Options.Circles+1);
+
+		// Vertex 0 is the center
+		RingOffsets[0] = 1;
+
+		for (int y = 0; y < Options.Circles; y++)
+		{
+			RingSteps[y] = Options.Steps;
+
+			if (y > 0)
+			{
+				RingSteps[y] = RingSteps[y-1];
+
+				// Halve the steps every LODRings circles, while they can be stitched (even) and 
+				// the ring keeps a minimum of 8 steps
+				if (Options.LODRings > 0 && y % Options.LODRings == 0 && 
+					RingSteps[y] % 2 == 0 && RingSteps[y] >= 16)
+				{
+					RingSteps[y] /= 2;
+				}
+			}
+
+			RingOffsets[y+1] = RingOffsets[y] + RingSteps[y];
+		}
+	}
+
+	Ogre::HardwareIndexBufferSharedPtr _RG_createIndexBuffer(const std::vector<int>& RingSteps, const std::vector<int>& RingOffsets)
+	{
+		int Circles = static_cast<int>(RingSteps.size()),
+			numEle  = 3 * RingSteps[0],
+			y, x, k;
+
+		for(y=0; y<Circles-1; y++)
+		{
+			// Regular strip: 2 triangles per step, stitching strip: 3 triangles per outer step
+			numEle += (RingSteps[y+1] == RingSteps[y]) ? 6 * RingSteps[y] : 9 * RingSteps[y+1];
+		}
+
+		unsigned int *indexbuffer = new unsigned int[numEle],
+			         *face        = indexbuffer;
+
+		// Center fan
+		for (k = 0; k < RingSteps[0]; k++)
+		{
+			face[2] = 0;
+			face[1] = k+1;
+
+			if (k != RingSteps[0]-1)
+			{
+			    face[0] = k+2;
+			}
+			else
+			{
+				face[0] = 1;
+			}
+
+			face += 3;
+		}
+
+		for(y=0; y<Circles-1; y++) 
+		{
+			int Inner = RingOffsets[y],   InnerSteps = RingSteps[y],
+				Outer = RingOffsets[y+1], OuterSteps = RingSteps[y+1];
+
+			if (InnerSteps == OuterSteps)
+			{
+				for(x=0; x<InnerSteps; x++) 
+				{
+					int p0 = Inner + x,
+						p1 = Inner + (x+1)%InnerSteps,
+						p2 = Outer + x,
+						p3 = Outer + (x+1)%OuterSteps;
+
+					// First triangle
+					face[0]=p0;
+					face[1]=p1;
+					face[2]=p2;
+
+					// Second triangle
+					face[3]=p1;
+					face[4]=p3;
+					face[5]=p2;
+
+					face += 6;
+				}
+			}
+			else
+			{
+				// Stitching strip: the outer ring has half the steps, each outer step covers two 
+				// inner steps and the inner middle vertex is connected to both outer vertices, 
+				// so there aren't T-junctions
+				for(x=0; x<OuterSteps; x++) 
+				{
+					int i0 = Inner + 2*x,
+						i1 = Inner + 2*x+1,
+						i2 = Inner + (2*x+2)%InnerSteps,
+						o0 = Outer + x,
+						o1 = Outer + (x+1)%OuterSteps;
+
+					face[0]=i0;
+					face[1]=i1;
+					face[2]=o0;
+
+					face[3]=i1;
+					face[4]=o1;
+					face[5]=o0;
+
+					face[6]=i1;
+					face[7]=i2;
+					face[8]=o1;
+
+					face += 9;
+				}
+			}
+	    }
+
+		Mesh::_optimizeIndices(indexbuffer, numEle);
+
+		Ogre::HardwareIndexBufferSharedPtr IndexBuffer = Mesh::_createIndexBuffer(indexbuffer, numEle);
+
+		delete []indexbuffer;
+
+		return IndexBuffer;
+	}
+
 	Ogre::String _RG_getNormalModeString(const MaterialManager::NormalMode& NormalMode)
 	{
 		if (NormalMode == MaterialManager::NM_VERTEX)
@@ -49,19 +191,29 @@ namespace Hydrax{namespace Module
 
 	RadialGrid::RadialGrid(Hydrax *h, Noise::Noise *n, const MaterialManager::NormalMode& NormalMode)
 		: Module("RadialGrid" + _RG_getNormalModeString(NormalMode),
-		         n, Mesh::Options(0, Size(200), _RG_getVertexTypeFromNormalMode(NormalMode)), NormalMode)
-		, mHydrax(h)
+		         n, Mesh::Options(0, Size(200), _RG_getVertexTypeFromNormalMode(NormalMode)), NormalMode, h)
 		, mVertices(0)
-		, mVerticesChoppyBuffer(0)
+		, mVertexCapacity(0)
+		, mLatticeX(0)
+		, mLatticeZ(0)
+		, mHeights(0)
+		, mSmoothHeights(0)
+		, mOrigin(Ogre::Vector3(0,0,0))
+		, mChoppySign(1)
 	{
 	}
 
 	RadialGrid::RadialGrid(Hydrax *h, Noise::Noise *n, const MaterialManager::NormalMode& NormalMode, const Options &Options)
 		: Module("RadialGrid" + _RG_getNormalModeString(NormalMode),
-		         n, Mesh::Options(0, Size(Options.Radius*2), _RG_getVertexTypeFromNormalMode(NormalMode)), NormalMode)
-		, mHydrax(h)
+		         n, Mesh::Options(0, Size(Options.Radius*2), _RG_getVertexTypeFromNormalMode(NormalMode)), NormalMode, h)
 		, mVertices(0)
-		, mVerticesChoppyBuffer(0)
+		, mVertexCapacity(0)
+		, mLatticeX(0)
+		, mLatticeZ(0)
+		, mHeights(0)
+		, mSmoothHeights(0)
+		, mOrigin(Ogre::Vector3(0,0,0))
+		, mChoppySign(1)
 	{
 		setOptions(Options);
 	}
@@ -75,15 +227,44 @@ namespace Hydrax{namespace Module
 
 	void RadialGrid::setOptions(const Options &Options)
 	{
+		// The pipelined update (if any) mustn't be running while options change
+		mHydrax->_waitForAsyncUpdate();
+
 		mMeshOptions.MeshSize     = Size(Options.Radius*2);
 		mMeshOptions.MeshStrength = Options.Strength;
 
-		mHydrax->getMesh()->setOptions(mMeshOptions);
-		mHydrax->_setStrength(mOptions.Strength);
+		_applyMeshOptions();
 
 		if (isCreated())
 		{
-			if ((Options.Steps != mOptions.Steps) || (Options.Circles != mOptions.Circles))
+			bool LayoutChanged = (Options.Steps    != mOptions.Steps)   || 
+				                 (Options.Circles  != mOptions.Circles) || 
+								 (Options.LODRings != mOptions.LODRings),
+				 CapacitySwitch = false;
+
+			if (LayoutChanged)
+			{
+				// Inside of the allocated capacity only the mesh draw range changes, vertices 
+				// are packed again with the new layout below. Layouts without an unique LOD key 
+				// are recreated
+				if (_RG_getLODKey(Options) != -1 && 1+Options.Steps*Options.Circles <= mVertexCapacity &&
+					Options.MaxSteps == mOptions.MaxSteps && Options.MaxCircles == mOptions.MaxCircles)
+				{
+					std::vector<int> RingSteps, RingOffsets;
+					_RG_calculeRings(Options, RingSteps, RingOffsets);
+
+					int LODKey = _RG_getLODKey(Options);
+
+					if (!_getMesh()->_hasIndexBuffer(LODKey))
+					{
+						_getMesh()->_addIndexBuffer(LODKey, _RG_createIndexBuffer(RingSteps, RingOffsets));
+					}
+
+					CapacitySwitch = _getMesh()->_setDrawRange(LODKey, RingOffsets[Options.Circles]);
+				}
+			}
+
+			if (LayoutChanged && !CapacitySwitch)
 			{
 				remove();
 				mOptions = Options;
@@ -97,72 +278,19 @@ namespace Hydrax{namespace Module
 					}
 				}
 
-				Ogre::String MaterialNameTmp = mHydrax->getMesh()->getMaterialName();
-				mHydrax->getMesh()->remove();
-				mHydrax->getMesh()->setOptions(getMeshOptions());
-				mHydrax->getMesh()->setMaterialName(MaterialNameTmp);
-				mHydrax->getMesh()->create();
+				Ogre::String MaterialNameTmp = _getMesh()->getMaterialName();
+				_getMesh()->remove();
+				_getMesh()->setOptions(getMeshOptions());
+				_getMesh()->setMaterialName(MaterialNameTmp);
+				_getMesh()->create();
 
 				return;
 			}
 
 			mOptions = Options;
 
-			int x, y;
-			if (getNormalMode() == MaterialManager::NM_VERTEX)
-			{
-				Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
-
-				Vertices[0].x = mOptions.Radius;
-			    Vertices[0].z = mOptions.Radius;
-
-				float r_scale = mOptions.Radius/
-					(mOptions.StepSizeLin  * mOptions.Circles + 
-					 mOptions.StepSizeCube * Ogre::Math::Pow(mOptions.Circles, 3) + 
-				     mOptions.StepSizeFive * Ogre::Math::Pow(mOptions.Circles, 5));
-
-				for(y=0;y<mOptions.Circles;y++) 
-				{
-					float r = r_scale*(mOptions.StepSizeLin * (y+1) + mOptions.StepSizeCube * Ogre::Math::Pow(y+1, 3) + mOptions.StepSizeFive * Ogre::Math::Pow(y+1, 5));
-				
-					for(x=0;x<mOptions.Steps;x++) 
-					{
-						Vertices[1+y*mOptions.Steps + x].x = mOptions.Radius + r * Ogre::Math::Cos(Ogre::Math::TWO_PI * x / mOptions.Steps);
-						Vertices[1+y*mOptions.Steps + x].z = mOptions.Radius + r * Ogre::Math::Sin(Ogre::Math::TWO_PI * x / mOptions.Steps);
-					}
-				}
-
-				if (mOptions.ChoppyWaves && mVerticesChoppyBuffer)
-			    {
-				    for(int i = 0; i < 1+mOptions.Circles*mOptions.Steps; i++)
-				    {
-					    mVerticesChoppyBuffer[i] = Vertices[i];
-				    }
-			    }
-			}
-			else if (getNormalMode() == MaterialManager::NM_RTT)
-			{
-				Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
-
-				Vertices[0].x = mOptions.Radius;
-			    Vertices[0].z = mOptions.Radius;
-
-                float r_scale = mOptions.Radius/
-					(mOptions.StepSizeLin  * mOptions.Circles + 
-					 mOptions.StepSizeCube * Ogre::Math::Pow(mOptions.Circles, 3) + 
-				     mOptions.StepSizeFive * Ogre::Math::Pow(mOptions.Circles, 5));
-
-				for(y=0;y<mOptions.Circles;y++) 
-				{
-					float r = r_scale*(mOptions.StepSizeLin * (y+1) + mOptions.StepSizeCube * Ogre::Math::Pow(y+1, 3) + mOptions.StepSizeFive * Ogre::Math::Pow(y+1, 5));
-
-					for(x=0;x<mOptions.Steps;x++) 
-					{
-						Vertices[1+y*mOptions.Steps + x].x = mOptions.Radius + r * Ogre::Math::Cos(Ogre::Math::TWO_PI * x / mOptions.Steps);
-						Vertices[1+y*mOptions.Steps + x].z = mOptions.Radius + r * Ogre::Math::Sin(Ogre::Math::TWO_PI * x / mOptions.Steps);
-					}
-				}
-			}
+			_RG_calculeRings(mOptions, mRingSteps, mRingOffsets);
+			_createLattice();
 			
 			return;
 		} 
@@ -176,85 +304,80 @@ namespace Hydrax{namespace Module
 
 		Module::create();
 
-		int x, y;
+		// Allocate for the max steps/circles, so changes don't need reallocations
+		mVertexCapacity = 1+std::max(mOptions.Steps, mOptions.MaxSteps) * std::max(mOptions.Circles, mOptions.MaxCircles);
+
+		_RG_calculeRings(mOptions, mRingSteps, mRingOffsets);
+
 		if (getNormalMode() == MaterialManager::NM_VERTEX)
 		{
-			mVertices = new Mesh::POS_NORM_VERTEX[1+mOptions.Steps * mOptions.Circles];	
-			Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+			mVertices = new Mesh::POS_NORM_VERTEX[mVertexCapacity];
+		}
+		else if (getNormalMode() == MaterialManager::NM_RTT)
+		{
+			mVertices = new Mesh::POS_VERTEX[mVertexCapacity];
+		}
 
-			Vertices[0].x = mOptions.Radius;
-			Vertices[0].y = 0;
-			Vertices[0].z = mOptions.Radius;
+		mLatticeX      = new float[mVertexCapacity];
+		mLatticeZ      = new float[mVertexCapacity];
+		mHeights       = new float[mVertexCapacity];
+		mSmoothHeights = new float[mVertexCapacity];
 
-			Vertices[0].nx = 0;
-			Vertices[0].ny = -1;
-			Vertices[0].nz = 0;
+		_createLattice();
 
-            float r_scale = mOptions.Radius/
-				           (mOptions.StepSizeLin  * mOptions.Circles + 
-				            mOptions.StepSizeCube * Ogre::Math::Pow(mOptions.Circles, 3) + 
-				            mOptions.StepSizeFive * Ogre::Math::Pow(mOptions.Circles, 5));
+		HydraxLOG(getName() + " created.");
+	}
 
-			for(y=0;y<mOptions.Circles;y++) 
-			{
-				float r = r_scale*(mOptions.StepSizeLin * (y+1) + mOptions.StepSizeCube * Ogre::Math::Pow(y+1, 3) + mOptions.StepSizeFive * Ogre::Math::Pow(y+1, 5));
+	void RadialGrid::_createLattice()
+	{
+		int x, y, i;
 
-				for(x=0;x<mOptions.Steps;x++) 
-				{
-					Vertices[1+y*mOptions.Steps + x].x = mOptions.Radius + r * Ogre::Math::Cos(Ogre::Math::TWO_PI * x / mOptions.Steps);
-					Vertices[1+y*mOptions.Steps + x].y = 0;
-					Vertices[1+y*mOptions.Steps + x].z = mOptions.Radius + r * Ogre::Math::Sin(Ogre::Math::TWO_PI * x / mOptions.Steps);
+        float r_scale = mOptions.Radius/
+				       (mOptions.StepSizeLin  * mOptions.Circles + 
+				        mOptions.StepSizeCube * Ogre::Math::Pow(mOptions.Circles, 3) + 
+				        mOptions.StepSizeFive * Ogre::Math::Pow(mOptions.Circles, 5));
 
-					Vertices[1+y*mOptions.Steps + x].nx = 0;
-					Vertices[1+y*mOptions.Steps + x].ny = -1;
-					Vertices[1+y*mOptions.Steps + x].nz = 0;
-				}
-			}
+		mLatticeX[0] = mOptions.Radius;
+		mLatticeZ[0] = mOptions.Radius;
 
-			if (mOptions.ChoppyWaves)
+		for(y=0;y<mOptions.Circles;y++) 
+		{
+			float r = r_scale*(mOptions.StepSizeLin * (y+1) + mOptions.StepSizeCube * Ogre::Math::Pow(y+1, 3) + mOptions.StepSizeFive * Ogre::Math::Pow(y+1, 5));
+
+			for(x=0;x<mRingSteps[y];x++) 
 			{
-				mVerticesChoppyBuffer = new Mesh::POS_NORM_VERTEX[1+mOptions.Circles*mOptions.Steps];
+				i = mRingOffsets[y] + x;
 
-				for(int i = 0; i < 1+mOptions.Circles*mOptions.Steps; i++)
-				{
-					mVerticesChoppyBuffer[i] = Vertices[i];
-				}
+				mLatticeX[i] = mOptions.Radius + r * Ogre::Math::Cos(Ogre::Math::TWO_PI * x / mRingSteps[y]);
+				mLatticeZ[i] = mOptions.Radius + r * Ogre::Math::Sin(Ogre::Math::TWO_PI * x / mRingSteps[y]);
 			}
 		}
-		else if (getNormalMode() == MaterialManager::NM_RTT)
-		{
-			mVertices = new Mesh::POS_VERTEX[1+mOptions.Steps * mOptions.Circles];	
-			Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
 
-			Vertices[0].x = mOptions.Radius;
-			Vertices[0].y = 0;
-			Vertices[0].z = mOptions.Radius;
+		// Choppy waves proportions per circle: distance per step vertex, distance per circle vertex
+		mRingProportion.resize(mOptions.Circles);
 
-            float r_scale = mOptions.Radius/
-				           (mOptions.StepSizeLin  * mOptions.Circles + 
-				            mOptions.StepSizeCube * Ogre::Math::Pow(mOptions.Circles, 3) + 
-				            mOptions.StepSizeFive * Ogre::Math::Pow(mOptions.Circles, 5));
+		for(y=0;y<mOptions.Circles;y++)
+		{
+			mRingProportion[y] = Ogre::Vector2(0,0);
 
-			for(y=0;y<mOptions.Circles;y++) 
+			if (y < mOptions.Circles-1)
 			{
-				float r = r_scale*(mOptions.StepSizeLin * (y+1) + mOptions.StepSizeCube * Ogre::Math::Pow(y+1, 3) + mOptions.StepSizeFive * Ogre::Math::Pow(y+1, 5));
+				Ogre::Vector2 Current    = Ogre::Vector2(mLatticeX[mRingOffsets[y]],   mLatticeZ[mRingOffsets[y]]),
+					          NearStep   = Ogre::Vector2(mLatticeX[mRingOffsets[y]+1], mLatticeZ[mRingOffsets[y]+1]),
+							  CircleStep = Ogre::Vector2(mLatticeX[mRingOffsets[y+1]], mLatticeZ[mRingOffsets[y+1]]);
 
-				for(x=0;x<mOptions.Steps;x++) 
-				{
-					Vertices[1+y*mOptions.Steps + x].x = mOptions.Radius + r * Ogre::Math::Cos(Ogre::Math::TWO_PI * x / mOptions.Steps);
-					Vertices[1+y*mOptions.Steps + x].y = 0;
-					Vertices[1+y*mOptions.Steps + x].z = mOptions.Radius + r * Ogre::Math::Sin(Ogre::Math::TWO_PI * x / mOptions.Steps);
-				}
+				mRingProportion[y] = Ogre::Vector2((Current-NearStep).length(), (Current-CircleStep).length());
 			}
 		}
 
-		HydraxLOG(getName() + " created.");
+		// Chunks depend on the layout
+		mChunkRings.clear();
 	}
 
 	const bool RadialGrid::_createGeometry(Mesh *mMesh) const
 	{
-		int numVertices = mOptions.Steps * mOptions.Circles + 1;
-		int numEle = 6 * mOptions.Steps * (mOptions.Circles-1) + 3 * mOptions.Steps;
+		// Vertex buffer capacity for the max steps/circles
+		int numVertices = std::max(mOptions.Steps, mOptions.MaxSteps) * std::max(mOptions.Circles, mOptions.MaxCircles) + 1;
 
 		// Vertex buffers
 		mMesh->getSubMesh()->vertexData = new Ogre::VertexData();
@@ -295,71 +418,10 @@ namespace Hydrax{namespace Module
 
 		vbind->setBinding(0, mMesh->getHardwareVertexBuffer());
 
-		unsigned int *indexbuffer = new unsigned int[numEle];
-
-		for (int k = 0; k < mOptions.Steps; k++)
-		{
-			indexbuffer[k*3+2]   = 0;
-			indexbuffer[k*3+1] = k+1;
-
-			if (k != mOptions.Steps-1)
-			{
-			    indexbuffer[k*3] = k+2;
-			}
-			else
-			{
-				indexbuffer[k*3] = 1;
-			}
-		}
-
-		for(int y=0; y<mOptions.Circles-1; y++) 
-		{
-		    for(int x=0; x<mOptions.Steps; x++) 
-			{
-			    unsigned int *twoface = indexbuffer + (y*mOptions.Steps+x)*6 + 3 * mOptions.Steps;
-
-			    int p0 = 1+y * mOptions.Steps + x ;
-			    int p1 = 1+y * mOptions.Steps + x + 1 ;
-			    int p2 = 1+(y+1)* mOptions.Steps + x ;
-			    int p3 = 1+(y+1)* mOptions.Steps + x + 1 ;
-
-				if (x == mOptions.Steps-1)
-				{
-					p1 -= x+1;
-					p3 -= x+1;
-				}
-
-				// First triangle
-			    twoface[0]=p0;
-			    twoface[1]=p1;
-			    twoface[2]=p2;
-
-				// Second triangle
-			    twoface[3]=p1;
-			    twoface[4]=p3;
-			    twoface[5]=p2;
-		    }
-	    }
-
-		// Prepare buffer for indices
-		mMesh->getHardwareIndexBuffer() =
-			Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(
-			Ogre::HardwareIndexBuffer::IT_32BIT,
-			numEle,
-			Ogre::HardwareBuffer::HBU_STATIC, true);
-
-		mMesh->getHardwareIndexBuffer()->
-			writeData(0,
-			          mMesh->getHardwareIndexBuffer()->getSizeInBytes(),
-			          indexbuffer,
-			          true);
-
-		delete []indexbuffer;
+		int LODKey = _RG_getLODKey(mOptions);
 
-		// Set index buffer for this submesh
-		mMesh->getSubMesh()->indexData->indexBuffer = mMesh->getHardwareIndexBuffer();
-		mMesh->getSubMesh()->indexData->indexStart = 0;
-		mMesh->getSubMesh()->indexData->indexCount = numEle;
+		mMesh->_addIndexBuffer(LODKey, _RG_createIndexBuffer(mRingSteps, mRingOffsets));
+		mMesh->_setDrawRange(LODKey, getNumberOfVertices());
 
 		return true;
 	}
@@ -383,12 +445,23 @@ namespace Hydrax{namespace Module
 			{
 				delete [] static_cast<Mesh::POS_VERTEX*>(mVertices);
 			}
-		}
 
-		if (mVerticesChoppyBuffer)
-		{
-			delete [] mVerticesChoppyBuffer;
+			mVertices = 0;
 		}
+
+		delete [] mLatticeX;
+		delete [] mLatticeZ;
+		delete [] mHeights;
+		delete [] mSmoothHeights;
+
+		mLatticeX = mLatticeZ = mHeights = mSmoothHeights = 0;
+
+		mVertexCapacity = 0;
+
+		mRingSteps.clear();
+		mRingOffsets.clear();
+		mRingProportion.clear();
+		mChunkRings.clear();
 	}
 
 	void RadialGrid::saveCfg(Ogre::String &Data)
@@ -397,6 +470,9 @@ namespace Hydrax{namespace Module
 
 		Data += CfgFileManager::_getCfgString("RG_Steps", mOptions.Steps);
 		Data += CfgFileManager::_getCfgString("RG_Circles", mOptions.Circles);
+		Data += CfgFileManager::_getCfgString("RG_MaxSteps", mOptions.MaxSteps);
+		Data += CfgFileManager::_getCfgString("RG_MaxCircles", mOptions.MaxCircles);
+		Data += CfgFileManager::_getCfgString("RG_LODRings", mOptions.LODRings);
 		Data += CfgFileManager::_getCfgString("RG_Radius", mOptions.Radius);
 		Data += CfgFileManager::_getCfgString("RG_Smooth", mOptions.Smooth);
 		Data += CfgFileManager::_getCfgString("RG_ChoppyWaves", mOptions.ChoppyWaves);
@@ -414,7 +490,7 @@ namespace Hydrax{namespace Module
 			return false;
 		}
 
-		setOptions(
+		Options LoadedOptions = 
 			Options(CfgFileManager::_getIntValue(CfgFile,   "RG_Steps"),
 			        CfgFileManager::_getIntValue(CfgFile,  "RG_Circles"),
 					CfgFileManager::_getFloatValue(CfgFile, "RG_Radius"),
@@ -424,7 +500,13 @@ namespace Hydrax{namespace Module
 					CfgFileManager::_getFloatValue(CfgFile, "RG_StepSizeCube"),
 					CfgFileManager::_getFloatValue(CfgFile, "RG_StepSizeFive"),
 					CfgFileManager::_getFloatValue(CfgFile, "RG_StepSizeLin"),
-					CfgFileManager::_getFloatValue(CfgFile, "RG_Strength")));
+					CfgFileManager::_getFloatValue(CfgFile, "RG_Strength"));
+
+		LoadedOptions.MaxSteps   = CfgFileManager::_getIntValue(CfgFile, "RG_MaxSteps");
+		LoadedOptions.MaxCircles = CfgFileManager::_getIntValue(CfgFile, "RG_MaxCircles");
+		LoadedOptions.LODRings   = CfgFileManager::_getIntValue(CfgFile, "RG_LODRings");
+
+		setOptions(LoadedOptions);
 
 		return true;
 	}
@@ -438,230 +520,304 @@ namespace Hydrax{namespace Module
 
 		Module::update(timeSinceLastFrame);
 
+		// Split the circles in chunks, two per thread
+		ThreadPool *Pool = mHydrax->getThreadPool();
+
+		int NumberOfChunks = (Pool && Pool->getNumberOfThreads() > 0) ? 2*(Pool->getNumberOfThreads()+1) : 1;
+
+		NumberOfChunks = std::min(NumberOfChunks, mOptions.Circles);
+
+		if (static_cast<int>(mChunkRings.size()) != NumberOfChunks+1)
+		{
+			_calculeChunks(NumberOfChunks);
+		}
+
+		// Scene state used by the passes
+		mOrigin     = _getPosition();
+		mChoppySign = mHydrax->_isCurrentFrameUnderwater() ? -1.0f : 1.0f;
+
 		// Update heigths
-		int i, x, y;
+		_runPass(UP_HEIGHTS);
 
-		if (getNormalMode() == MaterialManager::NM_VERTEX)
+		// Smooth the heightdata
+		if (mOptions.Smooth)
 		{
-			Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+			_runPass(UP_SMOOTH);
 
-			if (mOptions.ChoppyWaves)
-			{
-				for(i = 0; i < 1+mOptions.Circles*mOptions.Steps; i++)
-				{
-					Vertices[i] = mVerticesChoppyBuffer[i];
-				}
-			}
+			std::swap(mHeights, mSmoothHeights);
+		}
+
+		// Build vertices: positions, normals and choppy waves
+		_runPass(UP_VERTICES);
 
-			Ogre::Vector3 HydraxPos = mHydrax->getPosition();
+		// Upload geometry changes
+		_getMesh()->updateGeometry(getNumberOfVertices(), mVertices);
+	}
+
+	void RadialGrid::_calculeChunks(const int& NumberOfChunks)
+	{
+		// Balance chunks by number of vertices: inner circles have more steps with LOD
+		int Total = getNumberOfVertices(),
+			y     = 0;
+
+		mChunkRings.resize(NumberOfChunks+1);
+		mChunkRings[0] = 0;
 
-			for(i = 0; i <1+mOptions.Circles*mOptions.Steps; i++)
+		for (int k = 1; k < NumberOfChunks; k++)
+		{
+			int Target = static_cast<int>(static_cast<float>(Total)*k/NumberOfChunks);
+
+			while (y < mOptions.Circles && mRingOffsets[y] < Target)
 			{
-				Vertices[i].y = mNoise->getValue(HydraxPos.x + Vertices[i].x, HydraxPos.z + Vertices[i].z)*mOptions.Strength;
+				y++;
 			}
+
+			mChunkRings[k] = y;
 		}
-		else if (getNormalMode() == MaterialManager::NM_RTT)
+
+		mChunkRings[NumberOfChunks] = mOptions.Circles;
+	}
+
+	void RadialGrid::_runPass(const UpdatePass& Pass)
+	{
+		const int NumberOfChunks = static_cast<int>(mChunkRings.size())-1;
+
+		if (NumberOfChunks > 1)
 		{
-			Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
+			mRingsTask.mRadialGrid = this;
+			mRingsTask.mPass = Pass;
 
-			Ogre::Vector3 HydraxPos = mHydrax->getPosition();
+			mHydrax->getThreadPool()->parallelFor(&mRingsTask, NumberOfChunks);
+		}
+		else
+		{
+			_updateRings(Pass, 0);
+		}
+	}
 
-			for(i = 0; i <1+mOptions.Circles*mOptions.Steps; i++)
-			{
-				Vertices[i].y = mNoise->getValue(HydraxPos.x + Vertices[i].x, HydraxPos.z + Vertices[i].z)*mOptions.Strength;
-			}
+	void RadialGrid::_updateRings(const UpdatePass& Pass, const int& Chunk)
+	{
+		const int FirstRing = mChunkRings[Chunk],
+			      LastRing  = mChunkRings[Chunk+1];
+
+		if (FirstRing == LastRing)
+		{
+			return;
 		}
 
-		// Smooth the heightdata
-		if (mOptions.Smooth)
+		// The first chunk owns the center vertex
+		const int Begin = (FirstRing == 0) ? 0 : mRingOffsets[FirstRing],
+			      End   = mRingOffsets[LastRing];
+
+		const float *X = mLatticeX, 
+			        *Z = mLatticeZ;
+
+		int x, y, s, o, i, 
+			Inner, InnerMul, Outer, OuterShift;
+
+		switch (Pass)
 		{
-			if (getNormalMode() == MaterialManager::NM_VERTEX)
+			case UP_HEIGHTS:
 			{
-				Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+				mNoise->getValues(X + Begin, Z + Begin, End - Begin, mHeights + Begin, mOrigin.x, mOrigin.z, mOptions.Strength);
+			}
+			break;
 
-				for(y=1;y<mOptions.Circles-1;y++) 
+			case UP_SMOOTH:
+			{
+				const float *H = mHeights;
+
+				if (FirstRing == 0)
+				{
+					mSmoothHeights[0] = H[0];
+				}
+
+				for(y=FirstRing;y<LastRing;y++) 
 				{
-					for(x=1;x<mOptions.Steps-1;x++)
+					s = mRingSteps[y];
+					o = mRingOffsets[y];
+
+					// First and last circles aren't smoothed
+					if (y == 0 || y == mOptions.Circles-1)
 					{
-						Vertices[y*mOptions.Steps + x].y =	
+						memcpy(mSmoothHeights + o, H + o, s*sizeof(float));
+
+						continue;
+					}
+
+					_getRingNeighbours(y, Inner, InnerMul, Outer, OuterShift);
+
+					for(x=0;x<s;x++)
+					{
+						mSmoothHeights[o + x] =	
 							0.2f *
-						   (Vertices[y*mOptions.Steps + x    ].y +
-							Vertices[y*mOptions.Steps + x + 1].y + 
-							Vertices[y*mOptions.Steps + x - 1].y + 
-							Vertices[(y+1)*mOptions.Steps + x].y + 
-							Vertices[(y-1)*mOptions.Steps + x].y);															
+						   (H[o + x] +
+							H[(x+1 == s) ? o : o + x + 1] + 
+							H[(x == 0)   ? o + s - 1 : o + x - 1] + 
+							H[Outer + (x >> OuterShift)] + 
+							H[Inner + x*InnerMul]);
 					}
 				}
 			}
-			else if (getNormalMode() == MaterialManager::NM_RTT)
+			break;
+
+			case UP_VERTICES:
 			{
-				Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
+				const float *Y = mHeights;
 
-				for(y=1;y<mOptions.Circles-1;y++) 
+				if (getNormalMode() == MaterialManager::NM_RTT)
 				{
-					for(x=1;x<mOptions.Steps-1;x++)
+					Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
+
+					for(i = Begin; i < End; i++)
 					{
-						Vertices[y*mOptions.Steps + x].y =	
-							0.2f *
-						   (Vertices[y*mOptions.Steps + x    ].y +
-							Vertices[y*mOptions.Steps + x + 1].y + 
-							Vertices[y*mOptions.Steps + x - 1].y + 
-							Vertices[(y+1)*mOptions.Steps + x].y + 
-							Vertices[(y-1)*mOptions.Steps + x].y);															
+						Vertices[i].x = X[i];
+						Vertices[i].y = Y[i];
+						Vertices[i].z = Z[i];
 					}
+
+					return;
 				}
-			}
-		}
-		
-		// Update normals
-		_calculeNormals();
 
-		// Perform choppy waves
-		_performChoppyWaves();
+				Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
 
-		// Upload geometry changes
-		mHydrax->getMesh()->updateGeometry(1+mOptions.Steps * mOptions.Circles, mVertices);
-	}
+				float ax, ay, az, bx, by, bz;
+				int next, prev, in, out;
 
-	void RadialGrid::_calculeNormals()
-	{
-		if (getNormalMode() != MaterialManager::NM_VERTEX)
-		{
-			return;
-		}
+				// Calculate the normal of the center grid point
+				if (FirstRing == 0)
+				{
+					int Steps_4 = static_cast<int>(mRingSteps[0]/4);
 
-		int x, y;
-		Ogre::Vector3 vec1, vec2, normal;
+					ax = X[1]-X[1+Steps_4*2]; ay = Y[1]-Y[1+Steps_4*2]; az = Z[1]-Z[1+Steps_4*2];
+					bx = X[1+Steps_4]-X[1+Steps_4*3]; by = Y[1+Steps_4]-Y[1+Steps_4*3]; bz = Z[1+Steps_4]-Z[1+Steps_4*3];
 
-		Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+					Vertices[0].x = X[0];
+					Vertices[0].y = Y[0];
+					Vertices[0].z = Z[0];
 
-		int Steps_4 = static_cast<int>(mOptions.Steps/4);
+					Vertices[0].nx = ay*bz - az*by;
+					Vertices[0].ny = az*bx - ax*bz;
+					Vertices[0].nz = ax*by - ay*bx;
+				}
 
-		// Calculate the normal of the center grid point
-        vec2 = Ogre::Vector3(
-					Vertices[1].x-Vertices[1+Steps_4*2].x,
-					Vertices[1].y-Vertices[1+Steps_4*2].y, 
-					Vertices[1].z-Vertices[1+Steps_4*2].z);
+				Ogre::Vector2 Dir, Perp, Norm2, Proportion;
+				Ogre::Vector3 Norm;
 
-		vec1 = Ogre::Vector3(
-					Vertices[1+Steps_4].x - Vertices[1+Steps_4*3].x,
-					Vertices[1+Steps_4].y - Vertices[1+Steps_4*3].y,
-					Vertices[1+Steps_4].z - Vertices[1+Steps_4*3].z);
+				for(y=FirstRing;y<LastRing;y++) 
+				{
+					s = mRingSteps[y];
+					o = mRingOffsets[y];
 
-		normal = vec2.crossProduct(vec1);
+					_getRingNeighbours(y, Inner, InnerMul, Outer, OuterShift);
 
-		Vertices[0].nx = normal.x;
-		Vertices[0].ny = normal.y;
-		Vertices[0].nz = normal.z;
+					// The last circle isn't displaced by choppy waves
+					bool Choppy = mOptions.ChoppyWaves && y < mOptions.Circles-1;
+					Proportion = mRingProportion[y];
 
-        // Calculate first circle normals
-		for(x=0;x<mOptions.Steps;x++)
-		{
-			vec2 = Ogre::Vector3(
-				Vertices[x + 2].x-Vertices[x].x,
-				Vertices[x + 2].y-Vertices[x].y, 
-				Vertices[x + 2].z-Vertices[x].z);
+					for(x=0;x<s;x++)
+					{
+						i    = o + x;
+						next = (x+1 == s) ? o : i + 1;
+						prev = (x == 0)   ? o + s - 1 : i - 1;
+						in   = (y == 0)   ? 0 : Inner + x*InnerMul;
+						out  = (y == mOptions.Circles-1) ? i : Outer + (x >> OuterShift);
 
-			vec1 = Ogre::Vector3(
-				Vertices[0].x - Vertices[mOptions.Steps + x].x,
-				Vertices[0].y - Vertices[mOptions.Steps + x].y,
-				Vertices[0].z - Vertices[mOptions.Steps + x].z);
+						// Normal: (along the circle) x (inner circle -> outer circle)
+						ax = X[next]-X[prev]; ay = Y[next]-Y[prev]; az = Z[next]-Z[prev];
+						bx = X[in]-X[out];    by = Y[in]-Y[out];    bz = Z[in]-Z[out];
 
-			normal = vec2.crossProduct(vec1);
+						Vertices[i].x = X[i];
+						Vertices[i].y = Y[i];
+						Vertices[i].z = Z[i];
 
-			Vertices[1+x].nx = normal.x;
-			Vertices[1+x].ny = normal.y;
-			Vertices[1+x].nz = normal.z;
-		}
+						Vertices[i].nx = ay*bz - az*by;
+						Vertices[i].ny = az*bx - ax*bz;
+						Vertices[i].nz = ax*by - ay*bx;
 
-		// Calculate all the other vertex normals
-		for(y=1;y<mOptions.Circles-1;y++) 
-		{
-			for(x=0;x<mOptions.Steps;x++)
-			{
-				vec2 = Ogre::Vector3(
-					Vertices[y*mOptions.Steps + x + 2].x-Vertices[y*mOptions.Steps + x].x,
-					Vertices[y*mOptions.Steps + x + 2].y-Vertices[y*mOptions.Steps + x].y, 
-					Vertices[y*mOptions.Steps + x + 2].z-Vertices[y*mOptions.Steps + x].z);
+						if (!Choppy)
+						{
+							continue;
+						}
+
+						Dir = Ogre::Vector2(Vertices[i].nx, Vertices[i].nz).normalisedCopy();
+						Perp = Dir.perpendicular();
+
+						if (Dir.x < 0) Dir.x = -Dir.x;
+						if (Dir.y < 0) Dir.y = -Dir.y;
+
+						if (Perp.x < 0) Perp.x = -Perp.x;
+						if (Perp.y < 0) Perp.y = -Perp.y;
 
-				vec1 = Ogre::Vector3(
-					Vertices[(y-1)*mOptions.Steps + x + 1].x - Vertices[(y+1)*mOptions.Steps + x].x,
-					Vertices[(y-1)*mOptions.Steps + x + 1].y - Vertices[(y+1)*mOptions.Steps + x].y,
-					Vertices[(y-1)*mOptions.Steps + x + 1].z - Vertices[(y+1)*mOptions.Steps + x].z);
+						Norm = Ogre::Vector3(Vertices[i].nx, Vertices[i].ny, Vertices[i].nz).normalisedCopy();
 
-				normal = vec2.crossProduct(vec1);
+						Norm2 = Ogre::Vector2(Norm.x, Norm.z)  * 
+									  ( (Dir  * Proportion.x)   +
+										(Perp * Proportion.y))  *
+				 					  mOptions.ChoppyStrength;
 
-				Vertices[1+y*mOptions.Steps+x].nx = normal.x;
-				Vertices[1+y*mOptions.Steps+x].ny = normal.y;
-				Vertices[1+y*mOptions.Steps+x].nz = normal.z;
+						Vertices[i].x += Norm2.x * mChoppySign;
+						Vertices[i].z += Norm2.y * mChoppySign;
+					}
+				}
 			}
-	    }
+			break;
+		}
 	}
 
-	void RadialGrid::_performChoppyWaves()
+	void RadialGrid::_getRingNeighbours(const int& Ring, int& Inner, int& InnerMul, int& Outer, int& OuterShift) const
 	{
-		if (getNormalMode() != MaterialManager::NM_VERTEX || !mOptions.ChoppyWaves)
+		// Steps only decrease outwards: the inner circle has the same or twice the steps,
+		// the outer circle has the same or half the steps
+		Inner = Outer = 0;
+		InnerMul = 1;
+		OuterShift = 0;
+
+		if (Ring > 0)
 		{
-			return;
+			Inner    = mRingOffsets[Ring-1];
+			InnerMul = mRingSteps[Ring-1] / mRingSteps[Ring];
 		}
 
-		int x, y,
-			Underwater = 1;
-
-		if (mHydrax->_isCurrentFrameUnderwater())
+		if (Ring < mOptions.Circles-1)
 		{
-			Underwater = -1;
+			Outer      = mRingOffsets[Ring+1];
+			OuterShift = (mRingSteps[Ring+1] < mRingSteps[Ring]) ? 1 : 0;
 		}
+	}
 
-		Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+	float RadialGrid::getHeigth(const Ogre::Vector2 &Position)
+	{
+		return _getPosition().y + mNoise->getValue(Position.x, Position.y)*mOptions.Strength;
+	}
 
-		Ogre::Vector2 Current, NearStep, CircleStep,
-			          Proportion,
-					  Dir, Perp,
-					  Norm2;
-		Ogre::Vector3 Norm;
+	void RadialGrid::getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid)
+	{
+		_getNoiseHeigths(Positions, Heigths, Count, _getPosition().y, mOptions.Strength);
 
-		for(y=0;y<mOptions.Circles-1;y++)
+		if (Valid)
 		{
-			Current = Ogre::Vector2(Vertices[y*mOptions.Steps + 1].x, Vertices[y*mOptions.Steps + 1].z);
-			NearStep = Ogre::Vector2(Vertices[y*mOptions.Steps + 2].x, Vertices[y*mOptions.Steps + 2].z);
-			CircleStep = Ogre::Vector2(Vertices[(y+1)*mOptions.Steps + 1].x, Vertices[(y+1)*mOptions.Steps + 1].z);
-
-			Proportion = Ogre::Vector2(
-				// Distance per step vertex
-				(Current-NearStep).length(),
-				// Distance per circle vertex
-				(Current-CircleStep).length());
-
-			for(x=0;x<mOptions.Steps;x++)
-			{
-				Dir = Ogre::Vector2(Vertices[1+y*mOptions.Steps + x].nx, Vertices[1+y*mOptions.Steps + x].nz).normalisedCopy();
-				Perp = Dir.perpendicular();
-
-				if (Dir.x < 0) Dir.x = -Dir.x;
-		        if (Dir.y < 0) Dir.y = -Dir.y;
-
-		        if (Perp.x < 0) Perp.x = -Perp.x;
-		        if (Perp.y < 0) Perp.y = -Perp.y;
-
-				Norm = Ogre::Vector3(
-					   Vertices[1+y*mOptions.Steps + x].nx,
-					   Vertices[1+y*mOptions.Steps + x].ny,
-			           Vertices[1+y*mOptions.Steps + x].nz).normalisedCopy();
+			std::fill(Valid, Valid+Count, true);
+		}
+	}
 
-				Norm2 = Ogre::Vector2(Norm.x, Norm.z)  * 
-					          ( (Dir  * Proportion.x)   +
-					            (Perp * Proportion.y))  *
-				 			  mOptions.ChoppyStrength;
+	void RadialGrid::getSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, bool *Valid)
+	{
+		_getNoiseSurfaceSamples(Positions, Samples, Count, _getPosition().y, mOptions.Strength);
 
-				Vertices[1+y*mOptions.Steps + x].x += Norm2.x * Underwater;
-				Vertices[1+y*mOptions.Steps + x].z += Norm2.y * Underwater;
-			}
+		if (Valid)
+		{
+			std::fill(Valid, Valid+Count, true);
 		}
 	}
 
-	float RadialGrid::getHeigth(const Ogre::Vector2 &Position)
+	bool RadialGrid::getSurfaceBounds(float &MaxDisplacement, float &MaxSlope)
+	{
+		return _getNoiseSurfaceBounds(mOptions.Strength, MaxDisplacement, MaxSlope);
+	}
+
+	WaterState* RadialGrid::_createWaterState()
 	{
-		return mHydrax->getPosition().y + mNoise->getValue(Position.x, Position.y)*mOptions.Strength;
+		return _createInfiniteWaterState(_getPosition().y, mOptions.Strength);
 	}
 }}
\ No newline at end of file
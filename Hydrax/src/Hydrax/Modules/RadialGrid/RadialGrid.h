@@ -62,6 +62,12 @@ namespace Hydrax{ namespace Module
 			float StepSizeLin;
 			/// Water strength
 			float Strength;
+			/// Max number of steps and circles, vertex arrays and buffers are allocated for them so
+			/// Steps/Circles can be changed at runtime without reallocations (0 = Steps/Circles)
+			int MaxSteps, MaxCircles;
+			/// LOD: the number of steps is halved every LODRings circles (0 = same steps in all circles)
+			/// Circles are stitched without cracks, the steps are never halved under 8
+			int LODRings;
 
 			/** Default constructor
 			 */
@@ -76,6 +82,9 @@ namespace Hydrax{ namespace Module
 				, StepSizeFive(0.0f)
 				, StepSizeLin(0.1f)
 				, Strength(32.5f)
+				, MaxSteps(0)
+				, MaxCircles(0)
+				, LODRings(0)
 			{
 			}
 
@@ -97,6 +106,9 @@ namespace Hydrax{ namespace Module
 				, StepSizeFive(0.0f)
 				, StepSizeLin(0.1f)
 				, Strength(32.5f)
+				, MaxSteps(0)
+				, MaxCircles(0)
+				, LODRings(0)
 			{
 			}
 
@@ -132,6 +144,9 @@ namespace Hydrax{ namespace Module
 				, StepSizeFive(_StepSizeFive)
 				, StepSizeLin(_StepSizeLin)
 				, Strength(_Strength)
+				, MaxSteps(0)
+				, MaxCircles(0)
+				, LODRings(0)
 			{
 			}
 		};
@@ -190,6 +205,34 @@ namespace Hydrax{ namespace Module
 		 */
 		float getHeigth(const Ogre::Vector2 &Position);
 
+		/** Get the current heigths at some world-space points
+		    @param Positions X/Z World positions
+			@param Heigths Heigths at the given positions in y-World coordinates (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+		 */
+		void getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid = 0);
+
+		/** Get the current surface samples (heigth, normal and vertical velocity) at some world-space points
+		    @param Positions X/Z World positions
+			@param Samples Surface samples (Output)
+			@param Count Number of positions
+			@param Valid Is each position over the water? (Output, can be 0)
+		 */
+		void getSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, bool *Valid = 0);
+
+		/** Get the bounds of the current water surface
+		    @param MaxDisplacement Maximum y displacement from the water position (Output)
+			@param MaxSlope Maximum surface slope (Output)
+			@return false if the noise can't bound its values
+		 */
+		bool getSurfaceBounds(float &MaxDisplacement, float &MaxSlope);
+
+		/** Create an immutable snapshot of the current water state
+		    @return New water state, or 0 if the noise doesn't support snapshots
+		 */
+		WaterState* _createWaterState();
+
 		/** Get current options
 		    @return Current options
 		 */
@@ -204,26 +247,123 @@ namespace Hydrax{ namespace Module
 		 */
 		const bool _createGeometry(Mesh *mMesh) const;
 
+		/** Get the number of steps of a circle
+		    @param Ring Circle index (0 = inner circle)
+			@return Number of steps(vertices) of the circle
+		 */
+		inline const int& getRingSteps(const int& Ring) const
+		{
+			return mRingSteps[Ring];
+		}
+
+		/** Get the first vertex of a circle
+		    @param Ring Circle index (0 = inner circle), Options::Circles for the end of the last circle
+			@return Vertex offset, vertex 0 is the center
+		 */
+		inline const int& getRingOffset(const int& Ring) const
+		{
+			return mRingOffsets[Ring];
+		}
+
+		/** Get the number of vertices
+		    @return Number of vertices of the current layout
+		 */
+		inline int getNumberOfVertices() const
+		{
+			return mRingOffsets.empty() ? 0 : mRingOffsets.back();
+		}
+
 	private:
-		/** Calcule current normals
+		/** Update passes, each pass is executed in parallel by circle chunks
 		 */
-		void _calculeNormals();
+		enum UpdatePass
+		{
+			// Noise heights (mHeights)
+			UP_HEIGHTS  = 0,
+			// Smoothed heights (mSmoothHeights)
+			UP_SMOOTH   = 1,
+			// Vertex positions, normals and choppy displacement (mVertices)
+			UP_VERTICES = 2
+		};
 
-		/** Perform choppy waves
+		/** Parallel pass task
 		 */
-		void _performChoppyWaves();
+		class RingsTask : public ThreadPool::ParallelTask
+		{
+		public:
+			/// RadialGrid pointer
+			RadialGrid *mRadialGrid;
+			/// Pass to execute
+			UpdatePass mPass;
+
+			/** Execute the pass for a chunk of circles
+			    @param Chunk Chunk index
+			 */
+			void execute(const int& Chunk)
+			{
+				mRadialGrid->_updateRings(mPass, Chunk);
+			}
+		};
+
+		friend class RingsTask;
+
+		/** Calcule the x/z lattice of the current layout (mRingSteps/mRingOffsets)
+		 */
+		void _createLattice();
+
+		/** Split the circles in chunks with a similar number of vertices (mChunkRings)
+		    @param NumberOfChunks Number of chunks
+		 */
+		void _calculeChunks(const int& NumberOfChunks);
+
+		/** Execute an update pass for all circle chunks
+		    @param Pass Update pass
+		 */
+		void _runPass(const UpdatePass& Pass);
+
+		/** Execute an update pass for a chunk of circles
+		    @param Pass Update pass
+			@param Chunk Chunk index
+			@remarks Chunks write disjoint vertex ranges, so they can run in parallel
+		 */
+		void _updateRings(const UpdatePass& Pass, const int& Chunk);
+
+		/** Get the neighbour circles of a circle, the neighbour of the vertex x at the 
+		    same angle is Inner + x*InnerMul / Outer + (x >> OuterShift)
+		    @param Ring Circle index
+			@param Inner First vertex of the inner circle (Output)
+			@param InnerMul Inner circle steps / circle steps (Output)
+			@param Outer First vertex of the outer circle (Output)
+			@param OuterShift 1 if the outer circle has half the steps, 0 if not (Output)
+		 */
+		void _getRingNeighbours(const int& Ring, int& Inner, int& InnerMul, int& Outer, int& OuterShift) const;
 
 		/// Vertex pointer (Mesh::POS_NORM_VERTEX or Mesh::POS_VERTEX)
 		void *mVertices;
 
-		/// Use it to store vertex positions when choppy displacement is enabled
-		Mesh::POS_NORM_VERTEX* mVerticesChoppyBuffer;
+		/// Allocated number of vertices (see Options::MaxSteps/MaxCircles)
+		int mVertexCapacity;
+
+		/// Number of steps and first vertex per circle (mRingOffsets[Circles] = number of vertices)
+		std::vector<int> mRingSteps, mRingOffsets;
+
+		/// Static x/z lattice (object-space)
+		float *mLatticeX, *mLatticeZ;
+		/// Heights and smoothed heights
+		float *mHeights, *mSmoothHeights;
+		/// Choppy waves proportions per circle
+		std::vector<Ogre::Vector2> mRingProportion;
+		/// First circle of each chunk (number of chunks + 1)
+		std::vector<int> mChunkRings;
+		/// Parallel pass task
+		RingsTask mRingsTask;
+
+		/// Water position and choppy displacement sign (-1 underwater) of the current update
+		Ogre::Vector3 mOrigin;
+		float mChoppySign;
 
 		/// Our projected grid options
 		Options mOptions;
-
-		/// Our Hydrax pointer
-		Hydrax* mHydrax;
 	};
 }}
 
@@ -47,21 +47,142 @@ namespace Hydrax{namespace Module
 		return "Rtt";
 	}
 
+	void _SG_addTriangle(std::vector<int> &Offsets, const int &Complexity, 
+		                 const int &av, const int &au, const int &bv, const int &bu, const int &cv, const int &cu)
+	{
+		// Same winding as the regular grid faces, skip degenerated triangles
+		int Cross = (bv-av)*(cu-au) - (bu-au)*(cv-av);
+
+		if (Cross == 0)
+		{
+			return;
+		}
+
+		Offsets.push_back(av*Complexity + au);
+
+		if (Cross < 0)
+		{
+			Offsets.push_back(bv*Complexity + bu);
+			Offsets.push_back(cv*Complexity + cu);
+		}
+		else
+		{
+			Offsets.push_back(cv*Complexity + cu);
+			Offsets.push_back(bv*Complexity + bu);
+		}
+	}
+
+	void _SG_createTilePattern(const int &Quads, const int &Complexity, const int &Level, const int *EdgeLevels, std::vector<int> &Offsets)
+	{
+		// Tile vertices are (v,u) in [0,Quads], offsets are v*Complexity + u
+		int Step = 1 << Level,
+			Cells = Quads/Step,
+			cv, cu;
+
+		Offsets.clear();
+
+		if (Cells == 1)
+		{
+			_SG_addTriangle(Offsets, Complexity, 0, 0, 0, Quads, Quads, 0);
+			_SG_addTriangle(Offsets, Complexity, Quads, 0, 0, Quads, Quads, Quads);
+
+			return;
+		}
+
+		// Inner cells
+		for (cv = 1; cv < Cells-1; cv++)
+		{
+			for (cu = 1; cu < Cells-1; cu++)
+			{
+				_SG_addTriangle(Offsets, Complexity, cv*Step, cu*Step, cv*Step, (cu+1)*Step, (cv+1)*Step, cu*Step);
+				_SG_addTriangle(Offsets, Complexity, (cv+1)*Step, cu*Step, cv*Step, (cu+1)*Step, (cv+1)*Step, (cu+1)*Step);
+			}
+		}
+
+		// Border ring: each side zips the outer edge (at the edge level step) with the
+		// first inner row (at the tile step), so edges match coarser neighbours without cracks
+		// Side order: v = 0, u = Quads, v = Quads, u = 0
+		const int OuterV[5] = {0, 0,     Quads,      Quads,      0},
+			      OuterU[5] = {0, Quads, Quads,      0,          0},
+				  InnerV[5] = {Step, Step,       Quads-Step, Quads-Step, Step},
+				  InnerU[5] = {Step, Quads-Step, Quads-Step, Step,       Step};
+
+		for (int k = 0; k < 4; k++)
+		{
+			int EdgeStep = 1 << std::max(Level, EdgeLevels[k]),
+				OuterSegments = Quads/EdgeStep,
+				InnerSegments = Cells-2,
+				a = 0, b = 0;
+
+			while (a < OuterSegments || b < InnerSegments)
+			{
+				int oav = OuterV[k] + (OuterV[k+1]-OuterV[k])*a/OuterSegments,
+					oau = OuterU[k] + (OuterU[k+1]-OuterU[k])*a/OuterSegments,
+					iav = InnerV[k], iau = InnerU[k];
+
+				if (InnerSegments > 0)
+				{
+					iav += (InnerV[k+1]-InnerV[k])*b/InnerSegments;
+					iau += (InnerU[k+1]-InnerU[k])*b/InnerSegments;
+				}
+
+				// Advance on the outer edge while its next vertex is before the middle of the next inner segment
+				if (b == InnerSegments || (a < OuterSegments && 2*(a+1)*EdgeStep <= (2*b+3)*Step))
+				{
+					_SG_addTriangle(Offsets, Complexity, oav, oau,
+						OuterV[k] + (OuterV[k+1]-OuterV[k])*(a+1)/OuterSegments,
+						OuterU[k] + (OuterU[k+1]-OuterU[k])*(a+1)/OuterSegments,
+						iav, iau);
+					a++;
+				}
+				else
+				{
+					_SG_addTriangle(Offsets, Complexity, oav, oau,
+						InnerV[k] + (InnerV[k+1]-InnerV[k])*(b+1)/InnerSegments,
+						InnerU[k] + (InnerU[k+1]-InnerU[k])*(b+1)/InnerSegments,
+						iav, iau);
+					b++;
+				}
+			}
+		}
+
+		// Patterns are cached, so they're optimized for the vertex cache only once
+		std::vector<unsigned int> Indices(Offsets.begin(), Offsets.end());
+
+		Mesh::_optimizeIndices(&Indices[0], static_cast<int>(Indices.size()));
+
+		Offsets.assign(Indices.begin(), Indices.end());
+	}
+
 	SimpleGrid::SimpleGrid(Hydrax *h, Noise::Noise *n, const MaterialManager::NormalMode& NormalMode)
 		: Module("SimpleGrid" + _SG_getNormalModeString(NormalMode),
-		         n, Mesh::Options(256, Size(100), _SG_getVertexTypeFromNormalMode(NormalMode)), NormalMode)
-		, mHydrax(h)
+		         n, Mesh::Options(256, Size(100), _SG_getVertexTypeFromNormalMode(NormalMode)), NormalMode, h)
 		, mVertices(0)
 		, mVerticesChoppyBuffer(0)
+		, mVertexCapacity(0)
+		, mWorldX(0)
+		, mWorldZ(0)
+		, mHeights(0)
+		, mWorldRevision(0)
+		, mTileQuads(0)
+		, mMaxTileLOD(0)
+		, mNumberOfVisibleTiles(0)
 	{
 	}
 
 	SimpleGrid::SimpleGrid(Hydrax *h, Noise::Noise *n, const MaterialManager::NormalMode& NormalMode, const Options &Options)
 		: Module("SimpleGrid" + _SG_getNormalModeString(NormalMode),
-		         n, Mesh::Options(Options.Complexity, Size(Options.MeshSize), _SG_getVertexTypeFromNormalMode(NormalMode)), NormalMode)
-		, mHydrax(h)
+		         n, Mesh::Options(Options.Complexity, Size(Options.MeshSize), _SG_getVertexTypeFromNormalMode(NormalMode)), NormalMode, h)
 		, mVertices(0)
 		, mVerticesChoppyBuffer(0)
+		, mVertexCapacity(0)
+		, mWorldX(0)
+		, mWorldZ(0)
+		, mHeights(0)
+		, mWorldRevision(0)
+		, mTileQuads(0)
+		, mMaxTileLOD(0)
+		, mNumberOfVisibleTiles(0)
 	{
 		setOptions(Options);
 	}
@@ -75,16 +196,31 @@ namespace Hydrax{namespace Module
 
 	void SimpleGrid::setOptions(const Options &Options)
 	{
+		// The pipelined update (if any) mustn't be running while options change
+		mHydrax->_waitForAsyncUpdate();
+
 		mMeshOptions.MeshSize     = Options.MeshSize;
 		mMeshOptions.MeshStrength = Options.Strength;
 		mMeshOptions.MeshComplexity = Options.Complexity;
+		mMeshOptions.MeshMaxComplexity = Options.MaxComplexity;
 
-		mHydrax->getMesh()->setOptions(mMeshOptions);
-		mHydrax->_setStrength(Options.Strength);
+		_applyMeshOptions();
 
 		if (isCreated())
 		{
-			if (Options.Complexity != mOptions.Complexity || Options.ChoppyWaves != Options.ChoppyWaves)
+			// Choppy waves need their own vertex buffer (mVerticesChoppyBuffer), created in create()
+			bool Recreate = Options.ChoppyWaves != mOptions.ChoppyWaves;
+
+			// Inside of the allocated capacity only the mesh draw range changes, vertices are
+			// packed again with the new complexity below
+			bool CapacitySwitch = 
+				!Recreate &&
+				Options.Complexity != mOptions.Complexity &&
+				Options.Complexity*Options.Complexity <= mVertexCapacity &&
+				Options.MaxComplexity == mOptions.MaxComplexity &&
+				_getMesh()->setComplexity(Options.Complexity);
+
+			if (Recreate || (Options.Complexity != mOptions.Complexity && !CapacitySwitch))
 			{
 				remove();
 				mOptions = Options;
@@ -98,18 +234,31 @@ namespace Hydrax{namespace Module
 					}
 				}
 
-				Ogre::String MaterialNameTmp = mHydrax->getMesh()->getMaterialName();
-				mHydrax->getMesh()->remove();
+				Ogre::String MaterialNameTmp = _getMesh()->getMaterialName();
+				_getMesh()->remove();
 				
-				mHydrax->getMesh()->setOptions(getMeshOptions());
-				mHydrax->getMesh()->setMaterialName(MaterialNameTmp);
-				mHydrax->getMesh()->create();
+				_getMesh()->setOptions(getMeshOptions());
+				_getMesh()->setMaterialName(MaterialNameTmp);
+				_getMesh()->create();
 
 				return;
 			}
 
+			bool WasTiled = isTiled();
+
 			mOptions = Options;
 
+			// Vertex layout has changed
+			mWorldRevision = 0;
+
+			_calculeTiles();
+
+			// Restore the full grid index buffer
+			if (WasTiled && !isTiled())
+			{
+				_getMesh()->setComplexity(mOptions.Complexity);
+			}
+
 			int v, u;
 			if (getNormalMode() == MaterialManager::NM_VERTEX)
 			{
@@ -158,10 +307,15 @@ namespace Hydrax{namespace Module
 
 		Module::create();
 
+		// Allocate for the max complexity, so complexity changes don't need reallocations
+		int MaxComplexity = std::max(mOptions.Complexity, mOptions.MaxComplexity);
+
+		mVertexCapacity = MaxComplexity*MaxComplexity;
+
 		int v, u;
 		if (getNormalMode() == MaterialManager::NM_VERTEX)
 		{
-			mVertices = new Mesh::POS_NORM_VERTEX[mOptions.Complexity*mOptions.Complexity];	
+			mVertices = new Mesh::POS_NORM_VERTEX[mVertexCapacity];	
 			Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
 
 			for(v=0; v<mOptions.Complexity; v++)
@@ -179,7 +333,7 @@ namespace Hydrax{namespace Module
 
 			if (mOptions.ChoppyWaves)
 			{
-				mVerticesChoppyBuffer = new Mesh::POS_NORM_VERTEX[mOptions.Complexity*mOptions.Complexity];
+				mVerticesChoppyBuffer = new Mesh::POS_NORM_VERTEX[mVertexCapacity];
 
 				for(int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
 				{
@@ -189,9 +343,14 @@ namespace Hydrax{namespace Module
 		}
 		else if (getNormalMode() == MaterialManager::NM_RTT)
 		{
-			mVertices = new Mesh::POS_VERTEX[mOptions.Complexity*mOptions.Complexity];	
+			mVertices = new Mesh::POS_VERTEX[mVertexCapacity];	
 			Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
 
+			mWorldX  = new float[mVertexCapacity];
+			mWorldZ  = new float[mVertexCapacity];
+			mHeights = new float[mVertexCapacity];
+			mWorldRevision = 0;
+
 			for(v=0; v<mOptions.Complexity; v++)
 			{
 				for(u=0; u<mOptions.Complexity; u++)
@@ -202,6 +361,8 @@ namespace Hydrax{namespace Module
 			}
 		}
 
+		_calculeTiles();
+
 		HydraxLOG(getName() + " created.");
 	}
 
@@ -224,12 +385,32 @@ namespace Hydrax{namespace Module
 			{
 				delete [] static_cast<Mesh::POS_VERTEX*>(mVertices);
 			}
+
+			mVertices = 0;
 		}
 
 		if (mVerticesChoppyBuffer)
 		{
 			delete [] mVerticesChoppyBuffer;
+
+			mVerticesChoppyBuffer = 0;
 		}
+
+		delete [] mWorldX;
+		delete [] mWorldZ;
+		delete [] mHeights;
+
+		mWorldX = mWorldZ = mHeights = 0;
+		mWorldRevision = 0;
+
+		mVertexCapacity = 0;
+
+		mTileQuads = 0;
+		mTileLOD.clear();
+		mTilePatterns.clear();
+		mTileIndices.clear();
+		mTileScratch.clear();
+		mNumberOfVisibleTiles = 0;
 	}
 
 	void SimpleGrid::saveCfg(Ogre::String &Data)
@@ -237,11 +418,14 @@ namespace Hydrax{namespace Module
 		Module::saveCfg(Data);
 
 		Data += CfgFileManager::_getCfgString("SG_Complexity", mOptions.Complexity);
+		Data += CfgFileManager::_getCfgString("SG_MaxComplexity", mOptions.MaxComplexity);
 		Data += CfgFileManager::_getCfgString("SG_MeshSize", mOptions.MeshSize);
 		Data += CfgFileManager::_getCfgString("SG_Strength", mOptions.Strength);
 		Data += CfgFileManager::_getCfgString("SG_Smooth", mOptions.Smooth);
 		Data += CfgFileManager::_getCfgString("SG_ChoppyWaves", mOptions.ChoppyWaves);
-		Data += CfgFileManager::_getCfgString("SG_ChoppyStrength", mOptions.ChoppyStrength); Data += "\n";
+		Data += CfgFileManager::_getCfgString("SG_ChoppyStrength", mOptions.ChoppyStrength);
+		Data += CfgFileManager::_getCfgString("SG_Tiles", mOptions.Tiles);
+		Data += CfgFileManager::_getCfgString("SG_TileLODDistance", mOptions.TileLODDistance); Data += "\n";
 	}
 
 	bool SimpleGrid::loadCfg(Ogre::ConfigFile &CfgFile)
@@ -251,13 +435,19 @@ namespace Hydrax{namespace Module
 			return false;
 		}
 
-		setOptions(
+		Options LoadedOptions = 
 			Options(CfgFileManager::_getIntValue(CfgFile,   "SG_Complexity"),
 			        CfgFileManager::_getSizeValue(CfgFile,  "SG_MeshSize"),
 					CfgFileManager::_getFloatValue(CfgFile, "SG_Strength"),
 					CfgFileManager::_getBoolValue(CfgFile,  "PG_Smooth"),
 					CfgFileManager::_getBoolValue(CfgFile,  "PG_ChoppyWaves"),
-					CfgFileManager::_getFloatValue(CfgFile, "PG_ChoopyStrength")));
+					CfgFileManager::_getFloatValue(CfgFile, "PG_ChoopyStrength"));
+
+		LoadedOptions.MaxComplexity = CfgFileManager::_getIntValue(CfgFile, "SG_MaxComplexity");
+		LoadedOptions.Tiles = CfgFileManager::_getIntValue(CfgFile, "SG_Tiles");
+		LoadedOptions.TileLODDistance = CfgFileManager::_getFloatValue(CfgFile, "SG_TileLODDistance");
+
+		setOptions(LoadedOptions);
 
 		return true;
 	}
@@ -271,6 +461,13 @@ namespace Hydrax{namespace Module
 
 		Module::update(timeSinceLastFrame);
 
+		if (isTiled())
+		{
+			_updateTiles();
+
+			return;
+		}
+
 		// Update heigths
 		int i = 0, v, u;
 
@@ -298,22 +495,19 @@ namespace Hydrax{namespace Module
 		{
 			Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
 
-			// For object-space to world-space conversion
-			// RTT normals calculation needs world-space coords
-			Ogre::Vector3 p = Ogre::Vector3(0,0,0);
-		    Ogre::Matrix4 mWorldMatrix;
-		    mHydrax->getMesh()->getEntity()->getParentSceneNode()->getWorldTransforms(&mWorldMatrix);
-
-			for(int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
+			// RTT normals calculation needs world-space coords, they only change with the mesh transform
+			if (mWorldRevision != _getMesh()->getTransformRevision())
 			{
-				p.x = Vertices[i].x;
-				p.y = 0;
-				p.z = Vertices[i].z;
+				_updateWorldPositions();
+			}
+
+			const int NumberOfVertices = mOptions.Complexity*mOptions.Complexity;
 
-				// Calculate the world-space position
-				mWorldMatrix.transformAffine(p);
+			mNoise->getValues(mWorldX, mWorldZ, NumberOfVertices, mHeights, 0, 0, mOptions.Strength);
 
-				Vertices[i].y = mNoise->getValue(p.x, p.z) * mOptions.Strength;
+			for(int i = 0; i < NumberOfVertices; i++)
+			{
+				Vertices[i].y = mHeights[i];
 			}
 		}
 
@@ -365,7 +559,355 @@ namespace Hydrax{namespace Module
 		_performChoppyWaves();
 
 		// Upload geometry changes
-		mHydrax->getMesh()->updateGeometry(mOptions.Complexity*mOptions.Complexity, mVertices);
+		_getMesh()->updateGeometry(mOptions.Complexity*mOptions.Complexity, mVertices);
+	}
+
+	void SimpleGrid::_updateWorldPositions()
+	{
+		Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
+
+		// For object-space to world-space conversion
+		Ogre::Vector3 p = Ogre::Vector3(0,0,0);
+		Ogre::Matrix4 mWorldMatrix;
+		_getMesh()->getEntity()->getParentSceneNode()->getWorldTransforms(&mWorldMatrix);
+
+		for(int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
+		{
+			p.x = Vertices[i].x;
+			p.y = 0;
+			p.z = Vertices[i].z;
+
+			// Calculate the world-space position
+			mWorldMatrix.transformAffine(p);
+
+			mWorldX[i] = p.x;
+			mWorldZ[i] = p.z;
+		}
+
+		mWorldRevision = _getMesh()->getTransformRevision();
+	}
+
+	void SimpleGrid::_calculeTiles()
+	{
+		mTileQuads = 0;
+		mMaxTileLOD = 0;
+		mTileLOD.clear();
+		mTilePatterns.clear();
+		mNumberOfVisibleTiles = 0;
+
+		if (mOptions.Tiles < 2)
+		{
+			return;
+		}
+
+		int Quads = (mOptions.Complexity-1)/mOptions.Tiles;
+
+		if ((mOptions.Complexity-1) % mOptions.Tiles != 0 || Quads < 1 || (Quads & (Quads-1)) != 0)
+		{
+			HydraxLOG(getName() + ": (Complexity-1)/Tiles must be a power of two, tiling disabled.");
+
+			return;
+		}
+
+		mTileQuads = Quads;
+
+		while ((1 << (mMaxTileLOD+1)) <= mTileQuads)
+		{
+			mMaxTileLOD++;
+		}
+
+		mTileLOD.resize(mOptions.Tiles*mOptions.Tiles, -1);
+		mTileScratch.resize(3*(mTileQuads+1)*(mTileQuads+1));
+	}
+
+	void SimpleGrid::_updateTiles()
+	{
+		const int &Tiles = mOptions.Tiles;
+
+		Ogre::Matrix4 WorldMatrix;
+		_getMesh()->getEntity()->getParentSceneNode()->getWorldTransforms(&WorldMatrix);
+
+		Ogre::Camera *Camera = _getCamera();
+		const Ogre::Vector3 &CameraPosition = Camera->getDerivedPosition();
+
+		// Heights are in [-Strength, Strength], choppy waves can move vertices out of the tile
+		float TileWidth  = mOptions.MeshSize.Width/Tiles,
+			  TileHeight = mOptions.MeshSize.Height/Tiles,
+			  Margin     = mOptions.ChoppyWaves ? mOptions.Strength : 0;
+
+		int tv, tu, Level;
+
+		// Frustum culling and levels of detail
+		mNumberOfVisibleTiles = 0;
+
+		for (tv = 0; tv < Tiles; tv++)
+		{
+			for (tu = 0; tu < Tiles; tu++)
+			{
+				Ogre::AxisAlignedBox TileBox(
+					tv*TileWidth - Margin,      -mOptions.Strength, tu*TileHeight - Margin,
+					(tv+1)*TileWidth + Margin,   mOptions.Strength, (tu+1)*TileHeight + Margin);
+
+				TileBox.transformAffine(WorldMatrix);
+
+				if (!Camera->isVisible(TileBox))
+				{
+					mTileLOD[tv*Tiles + tu] = -1;
+
+					continue;
+				}
+
+				Level = 0;
+
+				if (mOptions.TileLODDistance > 0)
+				{
+					float Distance = std::max(0.0f, (TileBox.getCenter()-CameraPosition).length() - TileBox.getHalfSize().length());
+
+					Level = std::min(mMaxTileLOD, static_cast<int>(Distance/mOptions.TileLODDistance));
+				}
+
+				mTileLOD[tv*Tiles + tu] = Level;
+				mNumberOfVisibleTiles++;
+			}
+		}
+
+		// Update visible tiles
+		if (getNormalMode() == MaterialManager::NM_RTT && mWorldRevision != _getMesh()->getTransformRevision())
+		{
+			_updateWorldPositions();
+		}
+
+		for (tv = 0; tv < Tiles; tv++)
+		{
+			for (tu = 0; tu < Tiles; tu++)
+			{
+				Level = mTileLOD[tv*Tiles + tu];
+
+				if (Level >= 0)
+				{
+					_updateTile(tv, tu, 1 << Level);
+				}
+			}
+		}
+
+		_buildTileIndices();
+
+		// Upload geometry changes
+		_getMesh()->updateGeometry(mOptions.Complexity*mOptions.Complexity, mVertices);
+	}
+
+	void SimpleGrid::_updateTile(const int &TileV, const int &TileU, const int &Step)
+	{
+		const int &Complexity = mOptions.Complexity;
+
+		int v0 = TileV*mTileQuads, v1 = v0 + mTileQuads,
+			u0 = TileU*mTileQuads, u1 = u0 + mTileQuads,
+			v, u, i, k = 0;
+
+		// Update heigths, gathering the tile lattice for a batch noise query
+		if (getNormalMode() == MaterialManager::NM_VERTEX)
+		{
+			Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+
+			for (v = v0; v <= v1; v += Step)
+			{
+				for (u = u0; u <= u1; u += Step, k++)
+				{
+					i = v*Complexity + u;
+
+					if (mOptions.ChoppyWaves)
+					{
+						Vertices[i] = mVerticesChoppyBuffer[i];
+					}
+
+					mTileScratch[k] = Vertices[i].x;
+					mTileScratch[mTileScratch.size()/3 + k] = Vertices[i].z;
+				}
+			}
+		}
+		else if (getNormalMode() == MaterialManager::NM_RTT)
+		{
+			for (v = v0; v <= v1; v += Step)
+			{
+				for (u = u0; u <= u1; u += Step, k++)
+				{
+					i = v*Complexity + u;
+
+					mTileScratch[k] = mWorldX[i];
+					mTileScratch[mTileScratch.size()/3 + k] = mWorldZ[i];
+				}
+			}
+		}
+
+		const int Size = static_cast<int>(mTileScratch.size())/3;
+		float *Heights = &mTileScratch[2*Size];
+
+		mNoise->getValues(&mTileScratch[0], &mTileScratch[Size], k, Heights, 0, 0, mOptions.Strength);
+
+		Mesh::POS_VERTEX* PosVertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
+		Mesh::POS_NORM_VERTEX* NormVertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+
+		k = 0;
+		for (v = v0; v <= v1; v += Step)
+		{
+			for (u = u0; u <= u1; u += Step, k++)
+			{
+				if (getNormalMode() == MaterialManager::NM_VERTEX)
+				{
+					NormVertices[v*Complexity + u].y = Heights[k];
+				}
+				else
+				{
+					PosVertices[v*Complexity + u].y = Heights[k];
+				}
+			}
+		}
+
+		// Smooth the heightdata, tile edges are shared with the neighbour tiles so they aren't smoothed
+		if (mOptions.Smooth)
+		{
+			if (getNormalMode() == MaterialManager::NM_VERTEX)
+			{
+				for (v = v0+Step; v < v1; v += Step)
+				{
+					for (u = u0+Step; u < u1; u += Step)
+					{
+						NormVertices[v*Complexity + u].y =	
+							 0.2f *
+							(NormVertices[v       *Complexity + u       ].y +
+							 NormVertices[v       *Complexity + (u+Step)].y + 
+							 NormVertices[v       *Complexity + (u-Step)].y + 
+							 NormVertices[(v+Step)*Complexity + u       ].y + 
+							 NormVertices[(v-Step)*Complexity + u       ].y);
+					}
+				}
+			}
+			else if (getNormalMode() == MaterialManager::NM_RTT)
+			{
+				for (v = v0+Step; v < v1; v += Step)
+				{
+					for (u = u0+Step; u < u1; u += Step)
+					{
+						PosVertices[v*Complexity + u].y =	
+							 0.2f *
+							(PosVertices[v       *Complexity + u       ].y +
+							 PosVertices[v       *Complexity + (u+Step)].y + 
+							 PosVertices[v       *Complexity + (u-Step)].y + 
+							 PosVertices[(v+Step)*Complexity + u       ].y + 
+							 PosVertices[(v-Step)*Complexity + u       ].y);
+					}
+				}
+			}
+		}
+
+		if (getNormalMode() != MaterialManager::NM_VERTEX)
+		{
+			return;
+		}
+
+		// Update normals, neighbours are clamped to the tile since the neighbour tiles can be outdated
+		Ogre::Vector3 vec1, vec2, normal;
+
+		for (v = v0; v <= v1; v += Step)
+		{
+			int vp = std::min(v+Step, v1), vm = std::max(v-Step, v0);
+
+			for (u = u0; u <= u1; u += Step)
+			{
+				int up = std::min(u+Step, u1), um = std::max(u-Step, u0);
+
+				vec1 = Ogre::Vector3(
+					NormVertices[v*Complexity + up].x - NormVertices[v*Complexity + um].x,
+					NormVertices[v*Complexity + up].y - NormVertices[v*Complexity + um].y, 
+					NormVertices[v*Complexity + up].z - NormVertices[v*Complexity + um].z);
+
+				vec2 = Ogre::Vector3(
+					NormVertices[vp*Complexity + u].x - NormVertices[vm*Complexity + u].x,
+					NormVertices[vp*Complexity + u].y - NormVertices[vm*Complexity + u].y,
+					NormVertices[vp*Complexity + u].z - NormVertices[vm*Complexity + u].z);
+
+				normal = vec2.crossProduct(vec1);
+
+				NormVertices[v*Complexity + u].nx = normal.x;
+				NormVertices[v*Complexity + u].ny = normal.y;
+				NormVertices[v*Complexity + u].nz = normal.z;
+			}
+		}
+
+		// Perform choppy waves, grid borders aren't displaced
+		if (!mOptions.ChoppyWaves)
+		{
+			return;
+		}
+
+		float Underwater = mHydrax->_isCurrentFrameUnderwater() ? -1.0f : 1.0f;
+
+		for (v = std::max(v0, Step); v <= std::min(v1, Complexity-1-Step); v += Step)
+		{
+			for (u = std::max(u0, Step); u <= std::min(u1, Complexity-1-Step); u += Step)
+			{
+				NormVertices[v*Complexity + u].x += NormVertices[v*Complexity + u].nx * mOptions.ChoppyStrength * Underwater;
+				NormVertices[v*Complexity + u].z += NormVertices[v*Complexity + u].nz * mOptions.ChoppyStrength * Underwater;
+			}
+		}
+	}
+
+	void SimpleGrid::_buildTileIndices()
+	{
+		const int &Tiles = mOptions.Tiles;
+
+		int tv, tu, Level, k, t, EdgeLevels[4];
+
+		mTileIndices.clear();
+
+		for (tv = 0; tv < Tiles; tv++)
+		{
+			for (tu = 0; tu < Tiles; tu++)
+			{
+				Level = mTileLOD[tv*Tiles + tu];
+
+				if (Level < 0)
+				{
+					continue;
+				}
+
+				// Neighbour levels in the pattern side order (v = 0, u = Quads, v = Quads, u = 0),
+				// not visible neighbours aren't drawn so they don't need stitching
+				const int NeighbourV[4] = {tv-1, tv,   tv+1, tv},
+					      NeighbourU[4] = {tu,   tu+1, tu,   tu-1};
+
+				for (k = 0; k < 4; k++)
+				{
+					EdgeLevels[k] = Level;
+
+					if (NeighbourV[k] >= 0 && NeighbourV[k] < Tiles && NeighbourU[k] >= 0 && NeighbourU[k] < Tiles)
+					{
+						EdgeLevels[k] = std::max(Level, mTileLOD[NeighbourV[k]*Tiles + NeighbourU[k]]);
+					}
+				}
+
+				int Key = Level | (EdgeLevels[0] << 4) | (EdgeLevels[1] << 8) | (EdgeLevels[2] << 12) | (EdgeLevels[3] << 16);
+
+				std::map<int, std::vector<int> >::iterator PatternIt = mTilePatterns.find(Key);
+
+				if (PatternIt == mTilePatterns.end())
+				{
+					PatternIt = mTilePatterns.insert(std::make_pair(Key, std::vector<int>())).first;
+
+					_SG_createTilePattern(mTileQuads, mOptions.Complexity, Level, EdgeLevels, PatternIt->second);
+				}
+
+				const std::vector<int> &Pattern = PatternIt->second;
+				unsigned int First = static_cast<unsigned int>(tv*mTileQuads*mOptions.Complexity + tu*mTileQuads);
+
+				for (t = 0; t < static_cast<int>(Pattern.size()); t++)
+				{
+					mTileIndices.push_back(First + Pattern[t]);
+				}
+			}
+		}
+
+		_getMesh()->_updateIndexData(mTileIndices.empty() ? 0 : &mTileIndices[0], static_cast<int>(mTileIndices.size()));
 	}
 
 	void SimpleGrid::_calculeNormals()
@@ -434,16 +976,165 @@ namespace Hydrax{namespace Module
 	{
 		if (getNormalMode() != MaterialManager::NM_RTT)
 		{
-		    Ogre::Vector2 RelativePos = mHydrax->getMesh()->getGridPosition(Position);
+		    Ogre::Vector2 RelativePos = _getMesh()->getGridPosition(Position);
 
 		    RelativePos.x *= mOptions.MeshSize.Width;
 		    RelativePos.y *= mOptions.MeshSize.Height;
 
-		    return mHydrax->getPosition().y + mNoise->getValue(RelativePos.x, RelativePos.y)*mOptions.Strength;
+		    return _getPosition().y + mNoise->getValue(RelativePos.x, RelativePos.y)*mOptions.Strength;
 		}
 		else // RTT Normals calculations works with world-space coords
 		{
-			return mHydrax->getPosition().y + mNoise->getValue(Position.x, Position.y)*mOptions.Strength;
+			return _getPosition().y + mNoise->getValue(Position.x, Position.y)*mOptions.Strength;
+		}
+	}
+
+	void SimpleGrid::getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid)
+	{
+		if (getNormalMode() == MaterialManager::NM_RTT)
+		{
+			// Infinite water, world-space coords
+			_getNoiseHeigths(Positions, Heigths, Count, _getPosition().y, mOptions.Strength);
+
+			if (Valid)
+			{
+				std::fill(Valid, Valid+Count, true);
+			}
+
+			return;
+		}
+
+		const int ChunkSize = 256;
+
+		Ogre::Vector2 GridPositions[ChunkSize];
+		float X[ChunkSize], Y[ChunkSize];
+		int First, n, k;
+
+		for (First = 0; First < Count; First += ChunkSize)
+		{
+			n = std::min(ChunkSize, Count-First);
+
+			// Grid-space -> object-space coords
+			_getMesh()->getGridPositions(Positions+First, GridPositions, n);
+
+			for (k = 0; k < n; k++)
+			{
+				X[k] = GridPositions[k].x*mOptions.MeshSize.Width;
+				Y[k] = GridPositions[k].y*mOptions.MeshSize.Height;
+			}
+
+			mNoise->getValues(X, Y, n, Heigths+First, 0, 0, mOptions.Strength);
+
+			for (k = 0; k < n; k++)
+			{
+				bool InGrid = GridPositions[k].x >= 0;
+
+				// Outside of the grid there isn't water, use the water level
+				Heigths[First+k] = _getPosition().y + (InGrid ? Heigths[First+k] : 0);
+
+				if (Valid)
+				{
+					Valid[First+k] = InGrid;
+				}
+			}
 		}
 	}
+
+	void SimpleGrid::getSurfaceSamples(const Ogre::Vector2 *Positions, SurfaceSample *Samples, const int &Count, bool *Valid)
+	{
+		if (getNormalMode() == MaterialManager::NM_RTT)
+		{
+			// Infinite water, world-space coords
+			_getNoiseSurfaceSamples(Positions, Samples, Count, _getPosition().y, mOptions.Strength);
+
+			if (Valid)
+			{
+				std::fill(Valid, Valid+Count, true);
+			}
+
+			return;
+		}
+
+		const int ChunkSize = 256;
+
+		Ogre::Vector2 GridPositions[ChunkSize];
+		float X[ChunkSize], Y[ChunkSize], Values[ChunkSize], dx[ChunkSize], dy[ChunkSize], dt[ChunkSize];
+		int First, n, k;
+
+		// Object-space -> world-space derivatives: object x = Width*(TX.x*World.x + TX.y*World.z + TX.z), ...
+		Ogre::Vector3 TX, TY;
+		_getMesh()->getGridTransform(TX, TY);
+
+		TX *= mOptions.MeshSize.Width;
+		TY *= mOptions.MeshSize.Height;
+
+		for (First = 0; First < Count; First += ChunkSize)
+		{
+			n = std::min(ChunkSize, Count-First);
+
+			// Grid-space -> object-space coords
+			_getMesh()->getGridPositions(Positions+First, GridPositions, n);
+
+			for (k = 0; k < n; k++)
+			{
+				X[k] = GridPositions[k].x*mOptions.MeshSize.Width;
+				Y[k] = GridPositions[k].y*mOptions.MeshSize.Height;
+			}
+
+			mNoise->getValuesAndDerivatives(X, Y, n, Values, dx, dy, dt, 0, 0, mOptions.Strength);
+
+			for (k = 0; k < n; k++)
+			{
+				SurfaceSample &Sample = Samples[First+k];
+
+				bool InGrid = GridPositions[k].x >= 0;
+
+				if (InGrid)
+				{
+					Sample.Heigth = _getPosition().y + Values[k];
+					Sample.Normal = Ogre::Vector3(-(dx[k]*TX.x + dy[k]*TY.x), 1, -(dx[k]*TX.y + dy[k]*TY.y)).normalisedCopy();
+					Sample.Velocity = dt[k];
+				}
+				else
+				{
+					// Outside of the grid there isn't water, use the water level
+					Sample.Heigth = _getPosition().y;
+					Sample.Normal = Ogre::Vector3::UNIT_Y;
+					Sample.Velocity = 0;
+				}
+
+				if (Valid)
+				{
+					Valid[First+k] = InGrid;
+				}
+			}
+		}
+	}
+
+	bool SimpleGrid::getSurfaceBounds(float &MaxDisplacement, float &MaxSlope)
+	{
+		return _getNoiseSurfaceBounds(mOptions.Strength, MaxDisplacement, MaxSlope);
+	}
+
+	WaterState* SimpleGrid::_createWaterState()
+	{
+		if (getNormalMode() == MaterialManager::NM_RTT)
+		{
+			// Infinite water, world-space coords
+			return _createInfiniteWaterState(_getPosition().y, mOptions.Strength);
+		}
+
+		Noise::Noise::Snapshot *NoiseSnapshot = mNoise->_createSnapshot();
+
+		if (!NoiseSnapshot)
+		{
+			return 0;
+		}
+
+		Ogre::Vector3 GridTransformX, GridTransformY;
+		_getMesh()->getGridTransform(GridTransformX, GridTransformY);
+
+		return new WaterState(NoiseSnapshot, _getPosition().y, mOptions.Strength, 
+			                  GridTransformX, GridTransformY, mOptions.MeshSize);
+	}
 }}
\ No newline at end of file
@@ -33,16 +33,118 @@ namespace Hydrax{namespace Noise
 		return rand() * ( 1.0f / ( RAND_MAX + 1.0f ) );
 	}
 
+	inline void _FFT_getTexels(const int &resolution, const float &Scale, const float &x, const float &y, 
+		                       int &A, int &B, int &C, int &D, float &xDIFF, float &yDIFF)
+	{
+		// Scale world coords
+		float xScale = x*Scale,
+		      yScale = y*Scale;
+
+		// Convert coords from world-space to data-space
+        int xs = static_cast<int>(xScale)%resolution,
+	        ys = static_cast<int>(yScale)%resolution;
+
+		// If data-space coords are negative, transform it to positive
+		if (x<0) xs += resolution-1;
+		if (y<0) ys += resolution-1;
+
+		// Determine x and y diff for linear interpolation
+		int xINT = (x>0) ? static_cast<int>(xScale) : static_cast<int>(xScale-1),
+		    yINT = (y>0) ? static_cast<int>(yScale) : static_cast<int>(yScale-1);
+
+		// Calculate interpolation coeficients
+		xDIFF  = xScale-xINT;
+		yDIFF  = yScale-yINT;
+
+		// To adjust the index if coords are out of range
+		int xxs = (xs==resolution-1) ? -1 : xs,
+			yys = (ys==resolution-1) ? -1 : ys;
+
+		//   A      B
+		//     
+		//
+		//   C      D
+		A = (ys*resolution+xs);
+		B = (ys*resolution+xxs+1);
+		C = ((yys+1)*resolution+xs);
+		D = ((yys+1)*resolution+xxs+1);
+	}
+
+	inline float _FFT_getValue(const float *re, const int &resolution, const float &Scale, const float &x, const float &y)
+	{
+		int A, B, C, D;
+		float xDIFF, yDIFF;
+
+		_FFT_getTexels(resolution, Scale, x, y, A, B, C, D, xDIFF, yDIFF);
+
+		float _xDIFF = 1-xDIFF,
+			  _yDIFF = 1-yDIFF;
+
+		// Return the result of the linear interpolation
+		return (re[A]*_xDIFF*_yDIFF +
+			    re[B]* xDIFF*_yDIFF +
+			    re[C]*_xDIFF* yDIFF +
+			    re[D]* xDIFF* yDIFF) // Range [-0.3, 0.3]
+				                 *0.6f-0.3f;
+	}
+
+	/** FFT noise snapshot, a copy of the heigth data
+	 */
+	class _FFT_Snapshot : public Noise::Snapshot
+	{
+	public:
+		/** Constructor
+		    @param re Heigth data
+			@param resolution FFT resolution
+			@param Scale Noise scale
+		 */
+		_FFT_Snapshot(const float *re, const int &resolution, const float &Scale)
+			: mData(re, re + resolution*resolution)
+			, mResolution(resolution)
+			, mScale(Scale)
+		{
+		}
+
+		/** Get the noise values of an array of x/y coords
+		 */
+		void getValues(const float *x, const float *y, const int &n, float *Values, 
+			           const float &OffsetX, const float &OffsetY, const float &Scale) const
+		{
+			const float *re = &mData[0];
+
+			for (int k = 0; k < n; k++)
+			{
+				Values[k] = _FFT_getValue(re, mResolution, mScale, OffsetX + x[k], OffsetY + y[k])*Scale;
+			}
+		}
+
+	private:
+		/// Heigth data
+		std::vector<float> mData;
+		/// FFT resolution
+		int mResolution;
+		/// Noise scale
+		float mScale;
+	};
+
 	FFT::FFT()
 		: Noise("FFT", true)
 		, resolution(128)
 		, re(0)
 		, img(0)
 		, maximalValue(2)
+		, normalizeScale(1)
+		, mTimeDerivatives(false)
+		, timeDerivativeWaves(0)
+		, dre(0)
+		, dimg(0)
 		, initialWaves(0)
 		, currentWaves(0)
 		, angularFrequencies(0)
 		, time(10)
+		, mBoundsDirty(true)
+		, mMaxValue(0)
+		, mMaxSlope(0)
 		, mGPUNormalMapManager(0)
 	{
 	}
@@ -54,10 +156,18 @@ namespace Hydrax{namespace Noise
 		, re(0)
 		, img(0)
 		, maximalValue(2)
+		, normalizeScale(1)
+		, mTimeDerivatives(false)
+		, timeDerivativeWaves(0)
+		, dre(0)
+		, dimg(0)
 		, initialWaves(0)
 		, currentWaves(0)
 		, angularFrequencies(0)
 		, time(10)
+		, mBoundsDirty(true)
+		, mMaxValue(0)
+		, mMaxSlope(0)
 		, mGPUNormalMapManager(0)
 	{
 	}
@@ -109,12 +219,21 @@ namespace Hydrax{namespace Noise
 		{
 			delete [] initialWaves;
 		}
+		if (timeDerivativeWaves)
+		{
+			delete [] timeDerivativeWaves;
+			delete [] dre;
+			delete [] dimg;
+		}
 
 	    if (angularFrequencies)
 		{
 			delete [] angularFrequencies;
 		}
 
+		currentWaves = initialWaves = timeDerivativeWaves = 0;
+		re = img = dre = dimg = angularFrequencies = 0;
+
 		maximalValue = 2;
 		time = 10;
  
@@ -169,6 +288,7 @@ namespace Hydrax{namespace Noise
 
 		mOptions = Options;
 		resolution = Options.Resolution;
+		mBoundsDirty = true;
 	}
 
 	bool FFT::createGPUNormalMapResources(GPUNormalMapManager *g)
@@ -429,6 +549,56 @@ namespace Hydrax{namespace Noise
 		}
 	}
 
+	void FFT::_pushInterpolationState()
+	{
+		const int Size = resolution*resolution;
+
+		mInterpolationStates[0].swap(mInterpolationStates[1]);
+
+		std::vector<float> &Newest = mInterpolationStates[1];
+		Newest.resize(mTimeDerivatives ? 2*Size : Size);
+
+		std::copy(re, re+Size, Newest.begin());
+
+		if (mTimeDerivatives)
+		{
+			std::copy(dre, dre+Size, Newest.begin()+Size);
+		}
+	}
+
+	void FFT::_interpolateState(const float &Alpha)
+	{
+		const std::vector<float> &Oldest = mInterpolationStates[0],
+			                     &Newest = mInterpolationStates[1];
+
+		const int Size = resolution*resolution;
+
+		int k;
+
+		for (k = 0; k < Size; k++)
+		{
+			re[k] = Oldest[k] + (Newest[k]-Oldest[k])*Alpha;
+		}
+
+		// Time derivatives may have been enabled after the oldest state
+		if (mTimeDerivatives && static_cast<int>(Newest.size()) == 2*Size)
+		{
+			if (static_cast<int>(Oldest.size()) == 2*Size)
+			{
+				for (k = Size; k < 2*Size; k++)
+				{
+					dre[k-Size] = Oldest[k] + (Newest[k]-Oldest[k])*Alpha;
+				}
+			}
+			else
+			{
+				std::copy(Newest.begin()+Size, Newest.end(), dre);
+			}
+		}
+
+		mBoundsDirty = true;
+	}
+
 	void FFT::_initNoise()
 	{
 		initialWaves = new std::complex<float>[resolution*resolution];
@@ -498,8 +668,62 @@ namespace Hydrax{namespace Noise
 			}
 		}
 		
-		_executeInverseFFT();
+		_executeInverseFFT(currentWaves, re, img);
 		_normalizeFFTData(0);
+
+		mBoundsDirty = true;
+
+		if (mTimeDerivatives)
+		{
+			_calculeTimeDerivative();
+		}
+	}
+
+	void FFT::_calculeTimeDerivative()
+	{
+		if (!timeDerivativeWaves)
+		{
+			timeDerivativeWaves = new std::complex<float>[resolution*resolution];
+			dre  = new float[resolution*resolution];
+			dimg = new float[resolution*resolution];
+		}
+
+		std::complex<float>* pData = timeDerivativeWaves;
+
+		int u, v, i;
+
+		float w, wt,
+			  coswt, sinwt;
+
+		// d/dt of the current waves: i*w*h
+		for (u = 0; u < resolution; u++)
+		{
+			for (v = 0; v< resolution ; v++)
+			{
+				const std::complex<float>& positive_h0 = initialWaves[u * (resolution)+v];
+				const std::complex<float>& negative_h0 = initialWaves[(resolution-1 - u) * (resolution) + (resolution-1- v)];
+
+				w  = angularFrequencies[u * (resolution) + v];
+				wt = w * time;
+
+				coswt = Ogre::Math::Cos(wt);
+				sinwt = Ogre::Math::Sin(wt);
+
+				*pData++ = std::complex<float>(
+					w * (-positive_h0.real() * sinwt - positive_h0.imag() * coswt - negative_h0.real() * sinwt - negative_h0.imag() * coswt),
+					w * ( positive_h0.real() * coswt - positive_h0.imag() * sinwt - negative_h0.real() * coswt + negative_h0.imag() * sinwt));
+			}
+		}
+
+		_executeInverseFFT(timeDerivativeWaves, dre, dimg);
+
+		// Same normalization than re, d(time)/d(seconds) = AnimationSpeed
+		const float Scale = mOptions.AnimationSpeed / (normalizeScale*2);
+
+		for (i = 0; i < resolution*resolution; i++)
+		{
+			dre[i] *= Scale;
+		}
 	}
 
 	const float FFT::_getGaussianRandomFloat() const
@@ -543,7 +767,7 @@ namespace Hydrax{namespace Noise
 		}
 	}
 
-	void FFT::_executeInverseFFT()
+	void FFT::_executeInverseFFT(const std::complex<float> *Waves, float *Re, float *Img)
 	{
 		int l2n = 0, p = 1; 
 		while (p < resolution) 
@@ -565,8 +789,8 @@ namespace Hydrax{namespace Noise
 		{
 			for(y = 0; y <resolution; y++) 
 			{
-				re[resolution * x + y] = currentWaves[resolution * x + y].real();
-				img[resolution * x + y] = currentWaves[resolution * x + y].imag();
+				Re[resolution * x + y] = Waves[resolution * x + y].real();
+				Img[resolution * x + y] = Waves[resolution * x + y].imag();
 			} 
 		}
 
@@ -577,8 +801,8 @@ namespace Hydrax{namespace Noise
 			j = 0;
 			for(i = 0; i < resolution - 1; i++)
 			{
-				re[resolution * i + y] = currentWaves[resolution * j + y].real();
-				img[resolution * i + y] = currentWaves[resolution * j + y].imag();
+				Re[resolution * i + y] = Waves[resolution * j + y].real();
+				Img[resolution * i + y] = Waves[resolution * j + y].imag();
 
 				k = resolution / 2;
 				while (k <= j) 
@@ -600,12 +824,12 @@ namespace Hydrax{namespace Noise
 			{
 				if(i < j)
 				{
-					tx = re[resolution * x + i];
-					ty = img[resolution * x + i];
-					re[resolution * x + i] = re[resolution * x + j];
-					img[resolution * x + i] = img[resolution * x + j];
-					re[resolution * x + j] = tx;
-					img[resolution * x + j] = ty;                      
+					tx = Re[resolution * x + i];
+					ty = Img[resolution * x + i];
+					Re[resolution * x + i] = Re[resolution * x + j];
+					Img[resolution * x + i] = Img[resolution * x + j];
+					Re[resolution * x + j] = tx;
+					Img[resolution * x + j] = ty;                      
 				}  
 				k = resolution / 2;
 				while (k <= j) 
@@ -644,12 +868,12 @@ namespace Hydrax{namespace Noise
 					for(i = j; i < resolution; i += l2)
 					{
 						i1 = i + l1;
-						t1 = u1 * re[resolution * x + i1] - u2 * img[resolution * x + i1];
-						t2 = u1 * img[resolution * x + i1] + u2 * re[resolution * x + i1];
-						re[resolution * x + i1] = re[resolution * x + i] - t1;
-						img[resolution * x + i1] = img[resolution * x + i] - t2;
-						re[resolution * x + i] += t1;
-						img[resolution * x + i] += t2;
+						t1 = u1 * Re[resolution * x + i1] - u2 * Img[resolution * x + i1];
+						t2 = u1 * Img[resolution * x + i1] + u2 * Re[resolution * x + i1];
+						Re[resolution * x + i1] = Re[resolution * x + i] - t1;
+						Img[resolution * x + i1] = Img[resolution * x + i] - t2;
+						Re[resolution * x + i] += t1;
+						Img[resolution * x + i] += t2;
 					}
 					z =  u1 * ca - u2 * sa;
 					u2 = u1 * sa + u2 * ca;
@@ -678,12 +902,12 @@ namespace Hydrax{namespace Noise
 					for(i = j; i < resolution; i += l2)
 					{
 						i1 = i + l1;
-					    t1 = u1 * re[resolution * i1 + y] - u2 * img[resolution * i1 + y];
-						t2 = u1 * img[resolution * i1 + y] + u2 * re[resolution* i1 + y];
-						re[resolution * i1 + y] = re[resolution * i + y] - t1;
-						img[resolution * i1 + y] = img[resolution * i + y] - t2;
-						re[resolution * i + y] += t1;
-						img[resolution * i + y] += t2;
+					    t1 = u1 * Re[resolution * i1 + y] - u2 * Img[resolution * i1 + y];
+						t2 = u1 * Img[resolution * i1 + y] + u2 * Re[resolution* i1 + y];
+						Re[resolution * i1 + y] = Re[resolution * i + y] - t1;
+						Img[resolution * i1 + y] = Img[resolution * i + y] - t2;
+						Re[resolution * i + y] += t1;
+						Img[resolution * i + y] += t2;
 					}
 					z =  u1 * ca - u2 * sa;
 					u2 = u1 * sa + u2 * ca;
@@ -700,11 +924,11 @@ namespace Hydrax{namespace Noise
 			{
 				if (((x+y) & 0x1)==1)
 				{
-					re[x*resolution+y]*=1;
+					Re[x*resolution+y]*=1;
 				}
 				else
 				{
-					re[x*resolution+y]*=-1;
+					Re[x*resolution+y]*=-1;
 				}
 			}
 		}
@@ -741,6 +965,8 @@ namespace Hydrax{namespace Noise
 			scaleCoef=scale;
 		}
 
+		normalizeScale = scaleCoef;
+
 		// Scale all the value, and clamp to [0,1] range
 		int x, y;
 		for(x=0;x<resolution;x++)
@@ -755,46 +981,116 @@ namespace Hydrax{namespace Noise
 
 	float FFT::getValue(const float &x, const float &y)
 	{
-		// Scale world coords
-		float xScale = x*mOptions.Scale,
-		      yScale = y*mOptions.Scale;
+		return _FFT_getValue(re, resolution, mOptions.Scale, x, y);
+	}
 
-		// Convert coords from world-space to data-space
-        int xs = static_cast<int>(xScale)%resolution,
-	        ys = static_cast<int>(yScale)%resolution;
+	void FFT::getValues(const float *x, const float *y, const int &n, float *Values, const float &OffsetX, const float &OffsetY, const float &Scale)
+	{
+		// Non-virtual calls, inlined by the compiler
+		for (int k = 0; k < n; k++)
+		{
+			Values[k] = _FFT_getValue(re, resolution, mOptions.Scale, OffsetX + x[k], OffsetY + y[k])*Scale;
+		}
+	}
 
-		// If data-space coords are negative, transform it to positive
-		if (x<0) xs += resolution-1;
-		if (y<0) ys += resolution-1;
+	bool FFT::getValuesAndDerivatives(const float *x, const float *y, const int &n, float *Values, float *dx, float *dy, float *dt,
+		                              const float &OffsetX, const float &OffsetY, const float &Scale)
+	{
+		int A, B, C, D;
+		float xDIFF, yDIFF;
 
-		// Determine x and y diff for linear interpolation
-		int xINT = (x>0) ? static_cast<int>(xScale) : static_cast<int>(xScale-1),
-		    yINT = (y>0) ? static_cast<int>(yScale) : static_cast<int>(yScale-1);
+		// Read-only: time derivatives are enabled with setTimeDerivatives(...)
+		const bool TimeDerivatives = dt && mTimeDerivatives && dre;
 
-		// Calculate interpolation coeficients
-		float xDIFF  = xScale-xINT,
-			  yDIFF  = yScale-yINT,
-			  _xDIFF = 1-xDIFF,
-			  _yDIFF = 1-yDIFF;
+		// Values are bilinear filtered data remapped with *0.6-0.3, with mOptions.Scale texels per world unit
+		const float GradientScale = Scale*0.6f*mOptions.Scale;
 
-		// To adjust the index if coords are out of range
-		int xxs = (xs==resolution-1) ? -1 : xs,
-			yys = (ys==resolution-1) ? -1 : ys;
+		for (int k = 0; k < n; k++)
+		{
+			_FFT_getTexels(resolution, mOptions.Scale, OffsetX + x[k], OffsetY + y[k], A, B, C, D, xDIFF, yDIFF);
 
-		//   A      B
-		//     
-		//
-		//   C      D
-		float A = re[(ys*resolution+xs)],
-			  B = re[(ys*resolution+xxs+1)],
-			  C = re[((yys+1)*resolution+xs)],
-			  D = re[((yys+1)*resolution+xxs+1)];
+			Values[k] = ((re[A]*(1-xDIFF) + re[B]*xDIFF)*(1-yDIFF) + (re[C]*(1-xDIFF) + re[D]*xDIFF)*yDIFF)*0.6f-0.3f;
+			Values[k] *= Scale;
 
-		// Return the result of the linear interpolation
-		return (A*_xDIFF*_yDIFF +
-			    B* xDIFF*_yDIFF +
-			    C*_xDIFF* yDIFF +
-			    D* xDIFF* yDIFF) // Range [-0.3, 0.3]
-				                 *0.6f-0.3f;
+			dx[k] = ((re[B]-re[A])*(1-yDIFF) + (re[D]-re[C])*yDIFF)*GradientScale;
+			dy[k] = ((re[C]-re[A])*(1-xDIFF) + (re[D]-re[B])*xDIFF)*GradientScale;
+
+			if (TimeDerivatives)
+			{
+				dt[k] = ((dre[A]*(1-xDIFF) + dre[B]*xDIFF)*(1-yDIFF) + (dre[C]*(1-xDIFF) + dre[D]*xDIFF)*yDIFF)*0.6f*Scale;
+			}
+		}
+
+		if (dt && !TimeDerivatives)
+		{
+			std::fill(dt, dt+n, 0.0f);
+
+			return false;
+		}
+
+		return true;
+	}
+
+	void FFT::setTimeDerivatives(const bool &Enable)
+	{
+		if (Enable == mTimeDerivatives)
+		{
+			return;
+		}
+
+		mTimeDerivatives = Enable;
+
+		if (mTimeDerivatives && isCreated())
+		{
+			_calculeTimeDerivative();
+		}
+	}
+
+	Noise::Snapshot* FFT::_createSnapshot() const
+	{
+		if (!re)
+		{
+			return 0;
+		}
+
+		return new _FFT_Snapshot(re, resolution, mOptions.Scale);
+	}
+
+	bool FFT::getBounds(float &MaxValue, float &MaxSlope)
+	{
+		if (!re)
+		{
+			return false;
+		}
+
+		if (mBoundsDirty)
+		{
+			// Values are bilinear filtered data remapped to [-0.3, 0.3] (See _FFT_getValue(...)), 
+			// with Scale texels per world unit
+			float MinData = re[0], MaxData = re[0], MaxDiff = 0;
+
+			for (int y = 0; y < resolution; y++)
+			{
+				for (int x = 0; x < resolution; x++)
+				{
+					float Data = re[y*resolution + x];
+
+					MinData = std::min(MinData, Data);
+					MaxData = std::max(MaxData, Data);
+					MaxDiff = std::max(MaxDiff, Ogre::Math::Abs(re[y*resolution + (x+1)%resolution] - Data));
+					MaxDiff = std::max(MaxDiff, Ogre::Math::Abs(re[((y+1)%resolution)*resolution + x] - Data));
+				}
+			}
+
+			mMaxValue = std::max(Ogre::Math::Abs(MinData*0.6f-0.3f), Ogre::Math::Abs(MaxData*0.6f-0.3f));
+			mMaxSlope = Ogre::Math::Sqrt(2.0f) * MaxDiff * 0.6f * mOptions.Scale;
+
+			mBoundsDirty = false;
+		}
+
+		MaxValue = mMaxValue;
+		MaxSlope = mMaxSlope;
+
+		return true;
 	}
 }}
@@ -197,6 +197,65 @@ namespace Hydrax{ namespace Noise
 		 */
 		float getValue(const float &x, const float &y);
 
+		/** Get the noise values of an array of x/y coords
+		    @param x X Coords
+			@param y Y Coords
+			@param n Number of coords
+			@param Values Noise values (Output)
+			@param OffsetX X offset added to all x coords
+			@param OffsetY Y offset added to all y coords
+			@param Scale Scale applied to all values
+		 */
+		void getValues(const float *x, const float *y, const int &n, float *Values, 
+			           const float &OffsetX = 0, const float &OffsetY = 0, const float &Scale = 1);
+
+		/** Create a snapshot of the current noise state
+		    @return New snapshot (The caller must delete it)
+		 */
+		Snapshot* _createSnapshot() const;
+
+		/** Get the bounds of the current noise values
+		    @param MaxValue Maximum absolute noise value (Output)
+			@param MaxSlope Maximum noise slope (Output)
+			@return true
+			@remarks Computed from the current noise data, so it's a tight bound
+		 */
+		bool getBounds(float &MaxValue, float &MaxSlope);
+
+		/** Get the noise values and analytic derivatives of an array of x/y coords
+		    @param x X Coords
+			@param y Y Coords
+			@param n Number of coords
+			@param Values Noise values (Output)
+			@param dx Noise x derivatives (Output)
+			@param dy Noise y derivatives (Output)
+			@param dt Noise time derivatives, per second (Output, can be 0)
+			@param OffsetX X offset added to all x coords
+			@param OffsetY Y offset added to all y coords
+			@param Scale Scale applied to all values and derivatives
+			@return true
+			@return false if dt is asked and time derivatives aren't enabled, true otherwise
+			@remarks x/y derivatives come from the bilinear filtered heigth data, at the cost of 
+			         one value. Time derivatives are the inverse FFT of the i*w*h spectrum, which 
+					 is calculated in each update() when they're enabled, see setTimeDerivatives(...)
+		 */
+		bool getValuesAndDerivatives(const float *x, const float *y, const int &n, float *Values, float *dx, float *dy, float *dt,
+			                         const float &OffsetX = 0, const float &OffsetY = 0, const float &Scale = 1);
+
+		/** Enable/Disable the time derivatives calculation
+		    @param Enable true for calculate the time derivatives in each update
+			@remarks Not thread-safe: call it from the update thread, out of the noise queries
+		 */
+		void setTimeDerivatives(const bool &Enable);
+
+		/** Are time derivatives calculated?
+		    @return true if yes, false if not
+		 */
+		inline bool areTimeDerivativesEnabled() const
+		{
+			return mTimeDerivatives;
+		}
+
 		/** Set/Update fft noise options
 		    @param Options FFT noise options
 		 */
@@ -210,6 +269,24 @@ namespace Hydrax{ namespace Noise
 			return mOptions;
 		}
 
+	protected:
+		/** Does the noise support interpolation between two states?
+		    @return true
+		 */
+		inline bool _isInterpolationSupported() const
+		{
+			return true;
+		}
+
+		/** Store the current heigth data as the newest interpolation state
+		 */
+		void _pushInterpolationState();
+
+		/** Set the current heigth data from the two interpolation states
+		    @param Alpha Interpolation factor in [0,1), 0 = oldest state
+		 */
+		void _interpolateState(const float &Alpha);
+
 	private:
 		/** Initialize noise
 		 */
@@ -221,8 +298,15 @@ namespace Hydrax{ namespace Noise
 		void _calculeNoise(const float &delta);
 
 		/** Execute inverse fast fourier transform
+		    @param Waves Spectrum data
+			@param Re Real part of the result (Output)
+			@param Img Imaginary part of the result (Output)
+		 */
+		void _executeInverseFFT(const std::complex<float> *Waves, float *Re, float *Img);
+
+		/** Calcule the time derivative of the heigth data (dre)
 		 */
-		void _executeInverseFFT();
+		void _calculeTimeDerivative();
 
 		/** Normalize fft data
 		    @param scale User defined scale
@@ -252,6 +336,17 @@ namespace Hydrax{ namespace Noise
     	float *re, *img;
 	    /// The minimal value of the result data of the fft transformation
     	float maximalValue;
+		/// Last scale used for normalize the fft data
+		float normalizeScale;
+
+		/// Are the time derivatives calculated in each update?
+		bool mTimeDerivatives;
+		/// Time derivative spectrum, and its inverse fft result (dre/dimg), resolution*resolution size arrays
+		std::complex<float> *timeDerivativeWaves;
+		float *dre, *dimg;
+
+		/// Oldest/newest interpolation states: re, followed by dre if time derivatives are calculated
+		std::vector<float> mInterpolationStates[2];
 
 		/// the data which is referred as h0{x,t), that is, the data of the simulation at the time 0.
 	    std::complex<float> *initialWaves;
@@ -262,6 +357,13 @@ namespace Hydrax{ namespace Noise
 		/// Current time
 		float time;
 
+		/// Have the noise bounds to be recalculated?
+		bool mBoundsDirty;
+		/// Maximum absolute noise value
+		float mMaxValue;
+		/// Maximum noise slope
+		float mMaxSlope;
+
 		/// GPUNormalMapManager pointer
 		GPUNormalMapManager *mGPUNormalMapManager;
 
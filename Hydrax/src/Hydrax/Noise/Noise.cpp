@@ -24,6 +24,8 @@ http://www.gnu.org/copyleft/lesser.txt.
 
 #include "Noise.h"
 
+#define _def_DerivativeDelta 0.1f
+
 namespace Hydrax{namespace Noise
 {
     Noise::Noise(const Ogre::String &Name, const bool& GPUNormalMapSupported)
@@ -31,6 +33,10 @@ namespace Hydrax{namespace Noise
 	    , mCreated(false)
 		, mGPUNormalMapSupported(GPUNormalMapSupported)
 		, mGPUNormalMapResourcesCreated(false)
+		, mFixedTimeStep(0)
+		, mFixedTimeAccumulator(0)
+		, mInterpolationReady(false)
+		, mInterpolationAlpha(-1)
 	{
 	}
 
@@ -41,11 +47,72 @@ namespace Hydrax{namespace Noise
 	void Noise::create()
 	{
 		mCreated = true;
+		mInterpolationReady = false;
 	}
 
 	void Noise::remove()
 	{
 		mCreated = false;
+		mInterpolationReady = false;
+	}
+
+	void Noise::advance(const Ogre::Real &timeSinceLastFrame)
+	{
+		if (mFixedTimeStep <= 0 || !mCreated || !_isInterpolationSupported())
+		{
+			update(timeSinceLastFrame);
+
+			return;
+		}
+
+		bool Stepped = false;
+
+		if (!mInterpolationReady)
+		{
+			_pushInterpolationState();
+			_pushInterpolationState();
+
+			mFixedTimeAccumulator = 0;
+			mInterpolationReady = true;
+			Stepped = true;
+		}
+
+		mFixedTimeAccumulator += timeSinceLastFrame;
+
+		int Steps = static_cast<int>(mFixedTimeAccumulator/mFixedTimeStep);
+
+		if (Steps > 0)
+		{
+			mFixedTimeAccumulator -= Steps*mFixedTimeStep;
+
+			// Noise values are a function of the time, so only the last two steps are needed
+			if (Steps > 1)
+			{
+				update((Steps-1)*mFixedTimeStep);
+				_pushInterpolationState();
+			}
+
+			update(mFixedTimeStep);
+			_pushInterpolationState();
+
+			Stepped = true;
+		}
+
+		// 1/256 interpolation steps, so the states aren't blended again each frame at high frame rates
+		const float Alpha = std::floor(mFixedTimeAccumulator/mFixedTimeStep*256)/256;
+
+		if (Stepped || Alpha != mInterpolationAlpha)
+		{
+			_interpolateState(Alpha);
+
+			mInterpolationAlpha = Alpha;
+		}
+	}
+
+	void Noise::setFixedTimeStep(const Ogre::Real &TimeStep)
+	{
+		mFixedTimeStep = std::max(TimeStep, static_cast<Ogre::Real>(0));
+		mInterpolationReady = false;
 	}
 
 	bool Noise::createGPUNormalMapResources(GPUNormalMapManager *g)
@@ -83,6 +150,55 @@ namespace Hydrax{namespace Noise
 		Data += "Noise="+mName+"\n\n";
 	}
 
+	void Noise::getValues(const float *x, const float *y, const int &n, float *Values, const float &OffsetX, const float &OffsetY, const float &Scale)
+	{
+		for (int k = 0; k < n; k++)
+		{
+			Values[k] = getValue(OffsetX + x[k], OffsetY + y[k])*Scale;
+		}
+	}
+
+	bool Noise::getValuesAndDerivatives(const float *x, const float *y, const int &n, float *Values, float *dx, float *dy, float *dt,
+		                                const float &OffsetX, const float &OffsetY, const float &Scale)
+	{
+		const int ChunkSize = 64;
+		const float Delta = _def_DerivativeDelta;
+
+		float X[ChunkSize*4], Y[ChunkSize*4], Neighbours[ChunkSize*4];
+		int First, c, k;
+
+		getValues(x, y, n, Values, OffsetX, OffsetY, Scale);
+
+		for (First = 0; First < n; First += ChunkSize)
+		{
+			c = std::min(ChunkSize, n-First);
+
+			// +x, -x, +y, -y neighbours
+			for (k = 0; k < c; k++)
+			{
+				X[k]     = x[First+k] + Delta; Y[k]     = y[First+k];
+				X[k+c]   = x[First+k] - Delta; Y[k+c]   = y[First+k];
+				X[k+2*c] = x[First+k];         Y[k+2*c] = y[First+k] + Delta;
+				X[k+3*c] = x[First+k];         Y[k+3*c] = y[First+k] - Delta;
+			}
+
+			getValues(X, Y, 4*c, Neighbours, OffsetX, OffsetY, Scale);
+
+			for (k = 0; k < c; k++)
+			{
+				dx[First+k] = (Neighbours[k]     - Neighbours[k+c])  /(2*Delta);
+				dy[First+k] = (Neighbours[k+2*c] - Neighbours[k+3*c])/(2*Delta);
+			}
+		}
+
+		if (dt)
+		{
+			std::fill(dt, dt+n, 0.0f);
+		}
+
+		return false;
+	}
+
 	bool Noise::loadCfg(Ogre::ConfigFile &CfgFile)
 	{
 		if (CfgFile.getSetting("Noise") == mName)
@@ -34,11 +34,141 @@ http://graphics.cs.lth.se/theses/projects/projgrid/
 
 namespace Hydrax{namespace Noise
 {
+	inline int _PN_readTexelLinearDual(const int *p_noise, const int &u, const int &v,const int &o)
+	{
+		int iu, iup, iv, ivp, fu, fv,
+			ut01, ut23, ut;
+
+		iu = (u>>n_dec_bits)&np_size_m1;
+		iv = ((v>>n_dec_bits)&np_size_m1)*np_size;
+
+		iup = ((u>>n_dec_bits) + 1)&np_size_m1;
+		ivp = (((v>>n_dec_bits) + 1)&np_size_m1)*np_size;
+
+		fu = u & n_dec_magn_m1;
+		fv = v & n_dec_magn_m1;
+
+		// Packed octave noise source
+		const int *r_noise = p_noise + o*np_size_sq;
+
+		ut01 = ((n_dec_magn-fu)*r_noise[iv + iu] + fu*r_noise[iv + iup])>>n_dec_bits;
+		ut23 = ((n_dec_magn-fu)*r_noise[ivp + iu] + fu*r_noise[ivp + iup])>>n_dec_bits;
+		ut = ((n_dec_magn-fv)*ut01 + fv*ut23) >> n_dec_bits;
+
+		return ut;
+	}
+
+	inline float _PN_getHeigthDual(const int *p_noise, const float &magnitude, const int &Octaves, float u, float v)
+	{	
+		int ui = u*magnitude,
+		    vi = v*magnitude,
+			i, 
+			value = 0,
+			hoct = Octaves / n_packsize;
+
+		for(i=0; i<hoct; i++)
+		{		
+			value += _PN_readTexelLinearDual(p_noise,ui,vi,i);
+			ui = ui << n_packsize;
+			vi = vi << n_packsize;
+		}		
+
+		return static_cast<float>(value)/noise_magnitude;
+	}
+
+	inline float _PN_getHeigthAndGradientDual(const int *p_noise, const float &magnitude, const int &Octaves, float u, float v, float &du, float &dv)
+	{
+		int ui = u*magnitude,
+		    vi = v*magnitude,
+			i, 
+			value = 0,
+			hoct = Octaves / n_packsize,
+			iu, iup, iv, ivp, fu, fv;
+
+		// Texels per world unit of the current pack
+		float TexelsPerUnit = magnitude / n_dec_magn;
+
+		du = 0;
+		dv = 0;
+
+		for(i=0; i<hoct; i++)
+		{
+			value += _PN_readTexelLinearDual(p_noise,ui,vi,i);
+
+			// Bilinear patch derivatives, per texel
+			const int *r_noise = p_noise + i*np_size_sq;
+
+			iu = (ui>>n_dec_bits)&np_size_m1;
+			iv = ((vi>>n_dec_bits)&np_size_m1)*np_size;
+
+			iup = ((ui>>n_dec_bits) + 1)&np_size_m1;
+			ivp = (((vi>>n_dec_bits) + 1)&np_size_m1)*np_size;
+
+			fu = ui & n_dec_magn_m1;
+			fv = vi & n_dec_magn_m1;
+
+			du += TexelsPerUnit * (((n_dec_magn-fv)*(r_noise[iv + iup] - r_noise[iv + iu]) + fv*(r_noise[ivp + iup] - r_noise[ivp + iu])) >> n_dec_bits);
+			dv += TexelsPerUnit * (((n_dec_magn-fu)*(r_noise[ivp + iu] - r_noise[iv + iu]) + fu*(r_noise[ivp + iup] - r_noise[iv + iup])) >> n_dec_bits);
+
+			ui = ui << n_packsize;
+			vi = vi << n_packsize;
+			TexelsPerUnit *= (1<<n_packsize);
+		}		
+
+		du /= noise_magnitude;
+		dv /= noise_magnitude;
+
+		return static_cast<float>(value)/noise_magnitude;
+	}
+
+	/** Perlin noise snapshot, a copy of the used packed octaves
+	 */
+	class _PN_Snapshot : public Noise::Snapshot
+	{
+	public:
+		/** Constructor
+		    @param p_noise Packed noise
+			@param magnitude Noise magnitude
+			@param Octaves Number of octaves
+		 */
+		_PN_Snapshot(const int *p_noise, const float &magnitude, const int &Octaves)
+			: mPackedNoise(p_noise, p_noise + np_size_sq*std::max(1, Octaves/n_packsize))
+			, mMagnitude(magnitude)
+			, mOctaves(Octaves)
+		{
+		}
+
+		/** Get the noise values of an array of x/y coords
+		 */
+		void getValues(const float *x, const float *y, const int &n, float *Values, 
+			           const float &OffsetX, const float &OffsetY, const float &Scale) const
+		{
+			const int *p_noise = &mPackedNoise[0];
+
+			for (int k = 0; k < n; k++)
+			{
+				Values[k] = _PN_getHeigthDual(p_noise, mMagnitude, mOctaves, OffsetX + x[k], OffsetY + y[k])*Scale;
+			}
+		}
+
+	private:
+		/// Packed octaves
+		std::vector<int> mPackedNoise;
+		/// Noise magnitude
+		float mMagnitude;
+		/// Number of octaves
+		int mOctaves;
+	};
+
 	Perlin::Perlin()
 		: Noise("Perlin", true)
 		, time(0)
-		, r_noise(0)
 		, magnitude(n_dec_magn * 0.085f)
+		, mBoundsDirty(true)
+		, mMaxValue(0)
+		, mMaxSlope(0)
+		, mTimeDerivatives(false)
+		, mTimeDerivativeScale(0)
 		, mGPUNormalMapManager(0)
 	{
 	}
@@ -47,8 +177,12 @@ namespace Hydrax{namespace Noise
 		: Noise("Perlin", true)
 		, mOptions(Options)
 		, time(0)
-		, r_noise(0)
 		, magnitude(n_dec_magn * Options.Scale)
+		, mBoundsDirty(true)
+		, mMaxValue(0)
+		, mMaxSlope(0)
+		, mTimeDerivatives(false)
+		, mTimeDerivativeScale(0)
 		, mGPUNormalMapManager(0)
 	{
 	}
@@ -121,6 +255,7 @@ namespace Hydrax{namespace Noise
 		}
 
 		magnitude = n_dec_magn * mOptions.Scale;
+		mBoundsDirty = true;
 	}
 
 	bool Perlin::createGPUNormalMapResources(GPUNormalMapManager *g)
@@ -369,12 +504,69 @@ namespace Hydrax{namespace Noise
 		time += timeSinceLastFrame*mOptions.Animspeed;
 		_calculeNoise();
 
+		if (mTimeDerivatives)
+		{
+			_calculeNoise(true);
+		}
+
 		if (areGPUNormalMapResourcesCreated())
 		{
 			_updateGPUNormalMapResources();
 		}
 	}
 
+	void Perlin::_pushInterpolationState()
+	{
+		const int Size = np_size_sq*(mOptions.Octaves/n_packsize);
+
+		mInterpolationStates[0].swap(mInterpolationStates[1]);
+
+		std::vector<int> &Newest = mInterpolationStates[1];
+		Newest.resize(mTimeDerivatives ? 2*Size : Size);
+
+		std::copy(p_noise, p_noise+Size, Newest.begin());
+
+		if (mTimeDerivatives)
+		{
+			std::copy(dp_noise, dp_noise+Size, Newest.begin()+Size);
+		}
+	}
+
+	void Perlin::_interpolateState(const float &Alpha)
+	{
+		const std::vector<int> &Oldest = mInterpolationStates[0],
+			                   &Newest = mInterpolationStates[1];
+
+		const int Size = np_size_sq*(mOptions.Octaves/n_packsize),
+			      // Fixed point interpolation factor, 8 decimal bits (Alpha is already a multiple of 1/256)
+			      a = static_cast<int>(Alpha*256);
+
+		int k;
+
+		for (k = 0; k < Size; k++)
+		{
+			p_noise[k] = Oldest[k] + (((Newest[k]-Oldest[k])*a)>>8);
+		}
+
+		// Time derivatives may have been enabled after the oldest state
+		if (mTimeDerivatives && static_cast<int>(Newest.size()) == 2*Size)
+		{
+			if (static_cast<int>(Oldest.size()) == 2*Size)
+			{
+				for (k = Size; k < 2*Size; k++)
+				{
+					dp_noise[k-Size] = Oldest[k] + (((Newest[k]-Oldest[k])*a)>>8);
+				}
+			}
+			else
+			{
+				std::copy(Newest.begin()+Size, Newest.end(), dp_noise);
+			}
+		}
+
+		mBoundsDirty = true;
+	}
+
 	void Perlin::_updateGPUNormalMapResources()
 	{
 		unsigned short *Data;
@@ -405,6 +597,119 @@ namespace Hydrax{namespace Noise
 		return _getHeigthDual(x,y);
 	}
 
+	void Perlin::getValues(const float *x, const float *y, const int &n, float *Values, const float &OffsetX, const float &OffsetY, const float &Scale)
+	{
+		// Non-virtual calls, inlined by the compiler
+		for (int k = 0; k < n; k++)
+		{
+			Values[k] = _getHeigthDual(OffsetX + x[k], OffsetY + y[k])*Scale;
+		}
+	}
+
+	bool Perlin::getValuesAndDerivatives(const float *x, const float *y, const int &n, float *Values, float *dx, float *dy, float *dt,
+		                                 const float &OffsetX, const float &OffsetY, const float &Scale)
+	{
+		for (int k = 0; k < n; k++)
+		{
+			Values[k] = _PN_getHeigthAndGradientDual(p_noise, magnitude, mOptions.Octaves, OffsetX + x[k], OffsetY + y[k], dx[k], dy[k])*Scale;
+
+			dx[k] *= Scale;
+			dy[k] *= Scale;
+		}
+
+		if (!dt)
+		{
+			return true;
+		}
+
+		// Read-only: time derivatives are enabled with setTimeDerivatives(...)
+		if (!mTimeDerivatives)
+		{
+			std::fill(dt, dt+n, 0.0f);
+
+			return false;
+		}
+
+		// d(noise)/d(seconds) = d(noise)/d(time) * Animspeed
+		const float TimeScale = Scale*mTimeDerivativeScale*mOptions.Animspeed;
+
+		for (int k = 0; k < n; k++)
+		{
+			dt[k] = _PN_getHeigthDual(dp_noise, magnitude, mOptions.Octaves, OffsetX + x[k], OffsetY + y[k])*TimeScale;
+		}
+
+		return true;
+	}
+
+	void Perlin::setTimeDerivatives(const bool &Enable)
+	{
+		if (Enable == mTimeDerivatives)
+		{
+			return;
+		}
+
+		mTimeDerivatives = Enable;
+
+		if (mTimeDerivatives && isCreated())
+		{
+			_calculeNoise(true);
+		}
+	}
+
+	Noise::Snapshot* Perlin::_createSnapshot() const
+	{
+		return new _PN_Snapshot(p_noise, magnitude, mOptions.Octaves);
+	}
+
+	bool Perlin::getBounds(float &MaxValue, float &MaxSlope)
+	{
+		if (mBoundsDirty)
+		{
+			mMaxValue = 0;
+			mMaxSlope = 0;
+
+			// Each pack is a bilinear filtered np_size*np_size tiled texture, with Scale texels per 
+			// world unit for the first pack and n_packsize octaves more for each next pack. The 
+			// slope of a bilinear patch is bounded by sqrt(2)*(max. difference between neighbour texels)
+			float TexelsPerUnit = magnitude / n_dec_magn;
+
+			int hoct = mOptions.Octaves / n_packsize,
+				i, u, v, MaxAbs, MaxDiff;
+
+			for(i=0; i<hoct; i++)
+			{
+				const int *r_noise = p_noise + i*np_size_sq;
+
+				MaxAbs = 0;
+				MaxDiff = 0;
+
+				for(v=0; v<np_size; v++)
+				{
+					for(u=0; u<np_size; u++)
+					{
+						int Texel = r_noise[v*np_size + u];
+
+						MaxAbs  = std::max(MaxAbs,  std::abs(Texel));
+						MaxDiff = std::max(MaxDiff, std::abs(r_noise[v*np_size + ((u+1)&np_size_m1)] - Texel));
+						MaxDiff = std::max(MaxDiff, std::abs(r_noise[((v+1)&np_size_m1)*np_size + u] - Texel));
+					}
+				}
+
+				mMaxValue += static_cast<float>(MaxAbs) / noise_magnitude;
+				mMaxSlope += Ogre::Math::Sqrt(2.0f) * MaxDiff * TexelsPerUnit / noise_magnitude;
+
+				TexelsPerUnit *= (1<<n_packsize);
+			}
+
+			mBoundsDirty = false;
+		}
+
+		MaxValue = mMaxValue;
+		MaxSlope = mMaxSlope;
+
+		return true;
+	}
+
 	void Perlin::_initNoise()
 	{	
 		// Create noise (uniform)
@@ -444,7 +749,7 @@ namespace Hydrax{namespace Noise
 		}	
 	}
 
-	void Perlin::_calculeNoise()
+	void Perlin::_calculeNoise(const bool &TimeDerivative)
 	{
 		int i, o, v, u,
 			multitable[max_octaves],
@@ -478,14 +783,50 @@ namespace Hydrax{namespace Noise
 		double r_timemulti = 1.0;
 		const float PI_3 = Ogre::Math::PI/3;
 
+		int *Octaves = TimeDerivative ? o_dnoise : o_noise,
+			*Packed  = TimeDerivative ? dp_noise : p_noise;
+
+		if (TimeDerivative)
+		{
+			// d(sin^2(a))/d(time) = sin(2a)*PI/3*timemulti, normalize the octave factors 
+			// to half of the value range for keep the fixed-point maths in range
+			float MaxFactor = 0;
+
+			for(o=0; o<mOptions.Octaves; o++)
+			{
+				f_multitable[o] *= r_timemulti*PI_3/1.5f;
+				MaxFactor = std::max(MaxFactor, f_multitable[o]);
+
+				r_timemulti *= mOptions.Timemulti;
+			}
+
+			mTimeDerivativeScale = 2*MaxFactor;
+
+			for(o=0; o<mOptions.Octaves; o++)
+			{
+				f_multitable[o] /= (MaxFactor > 0) ? mTimeDerivativeScale : 1;
+			}
+
+			r_timemulti = 1.0;
+		}
+
 		for(o=0; o<mOptions.Octaves; o++)
 		{		
 			fraction = modf(time*r_timemulti,&dImage);
 			iImage = static_cast<int>(dImage);
 
-			amount[0] = scale_magnitude*f_multitable[o]*(pow(sin((fraction+2)*PI_3),2)/1.5);
-			amount[1] = scale_magnitude*f_multitable[o]*(pow(sin((fraction+1)*PI_3),2)/1.5);
-			amount[2] = scale_magnitude*f_multitable[o]*(pow(sin((fraction  )*PI_3),2)/1.5);
+			if (TimeDerivative)
+			{
+				amount[0] = scale_magnitude*f_multitable[o]*sin(2*(fraction+2)*PI_3);
+				amount[1] = scale_magnitude*f_multitable[o]*sin(2*(fraction+1)*PI_3);
+				amount[2] = scale_magnitude*f_multitable[o]*sin(2*(fraction  )*PI_3);
+			}
+			else
+			{
+				amount[0] = scale_magnitude*f_multitable[o]*(pow(sin((fraction+2)*PI_3),2)/1.5);
+				amount[1] = scale_magnitude*f_multitable[o]*(pow(sin((fraction+1)*PI_3),2)/1.5);
+				amount[2] = scale_magnitude*f_multitable[o]*(pow(sin((fraction  )*PI_3),2)/1.5);
+			}
 
 			image[0] = (iImage  ) & noise_frames_m1;
 			image[1] = (iImage+1) & noise_frames_m1;
@@ -493,7 +834,7 @@ namespace Hydrax{namespace Noise
 			
 			for (i=0; i<n_size_sq; i++)
 			{
-			    o_noise[i + n_size_sq*o] = (	
+			    Octaves[i + n_size_sq*o] = (	
 				   ((amount[0] * noise[i + n_size_sq * image[0]])>>scale_decimalbits) + 
 				   ((amount[1] * noise[i + n_size_sq * image[1]])>>scale_decimalbits) + 
 				   ((amount[2] * noise[i + n_size_sq * image[2]])>>scale_decimalbits));
@@ -511,62 +852,29 @@ namespace Hydrax{namespace Noise
 				{
 					for(u=0; u<np_size; u++)
 					{
-						p_noise[v*np_size+u+octavepack*np_size_sq]  = o_noise[(o+3)*n_size_sq + (v&n_size_m1)*n_size + (u&n_size_m1)];
-						p_noise[v*np_size+u+octavepack*np_size_sq] += _mapSample( u, v, 3, o);
-						p_noise[v*np_size+u+octavepack*np_size_sq] += _mapSample( u, v, 2, o+1);
-						p_noise[v*np_size+u+octavepack*np_size_sq] += _mapSample( u, v, 1, o+2);		
+						Packed[v*np_size+u+octavepack*np_size_sq]  = Octaves[(o+3)*n_size_sq + (v&n_size_m1)*n_size + (u&n_size_m1)];
+						Packed[v*np_size+u+octavepack*np_size_sq] += _mapSample(Octaves, u, v, 3, o);
+						Packed[v*np_size+u+octavepack*np_size_sq] += _mapSample(Octaves, u, v, 2, o+1);
+						Packed[v*np_size+u+octavepack*np_size_sq] += _mapSample(Octaves, u, v, 1, o+2);		
 					}
 				}
 
 				octavepack++;
 			}
 		}
-	}
-
-	int Perlin::_readTexelLinearDual(const int &u, const int &v,const int &o)
-	{
-		int iu, iup, iv, ivp, fu, fv,
-			ut01, ut23, ut;
-
-		iu = (u>>n_dec_bits)&np_size_m1;
-		iv = ((v>>n_dec_bits)&np_size_m1)*np_size;
 
-		iup = ((u>>n_dec_bits) + 1)&np_size_m1;
-		ivp = (((v>>n_dec_bits) + 1)&np_size_m1)*np_size;
-
-		fu = u & n_dec_magn_m1;
-		fv = v & n_dec_magn_m1;
-
-		ut01 = ((n_dec_magn-fu)*r_noise[iv + iu] + fu*r_noise[iv + iup])>>n_dec_bits;
-		ut23 = ((n_dec_magn-fu)*r_noise[ivp + iu] + fu*r_noise[ivp + iup])>>n_dec_bits;
-		ut = ((n_dec_magn-fv)*ut01 + fv*ut23) >> n_dec_bits;
-
-		return ut;
+		if (!TimeDerivative)
+		{
+			mBoundsDirty = true;
+		}
 	}
 
 	float Perlin::_getHeigthDual(float u, float v)
 	{	
-		// Pointer to the current noise source octave	
-		r_noise = p_noise;	
-
-		int ui = u*magnitude,
-		    vi = v*magnitude,
-			i, 
-			value = 0,
-			hoct = mOptions.Octaves / n_packsize;
-
-		for(i=0; i<hoct; i++)
-		{		
-			value += _readTexelLinearDual(ui,vi,0);
-			ui = ui << n_packsize;
-			vi = vi << n_packsize;
-			r_noise += np_size_sq;
-		}		
-
-		return static_cast<float>(value)/noise_magnitude;
+		return _PN_getHeigthDual(p_noise, magnitude, mOptions.Octaves, u, v);
 	}
 
-	int Perlin::_mapSample(const int &u, const int &v, const int &upsamplepower, const int &octave)
+	int Perlin::_mapSample(const int *Octaves, const int &u, const int &v, const int &upsamplepower, const int &octave)
 	{
 		int magnitude = 1<<upsamplepower,
 
@@ -579,10 +887,10 @@ namespace Hydrax{namespace Noise
 		    fu_m = magnitude - fu,
 		    fv_m = magnitude - fv,
 
-		    o = fu_m*fv_m*o_noise[octave*n_size_sq + ((pv)  &n_size_m1)*n_size + ((pu)  &n_size_m1)] +
-			    fu*  fv_m*o_noise[octave*n_size_sq + ((pv)  &n_size_m1)*n_size + ((pu+1)&n_size_m1)] +
-			    fu_m*fv*  o_noise[octave*n_size_sq + ((pv+1)&n_size_m1)*n_size + ((pu)  &n_size_m1)] +
-			    fu*  fv*  o_noise[octave*n_size_sq + ((pv+1)&n_size_m1)*n_size + ((pu+1)&n_size_m1)];
+		    o = fu_m*fv_m*Octaves[octave*n_size_sq + ((pv)  &n_size_m1)*n_size + ((pu)  &n_size_m1)] +
+			    fu*  fv_m*Octaves[octave*n_size_sq + ((pv)  &n_size_m1)*n_size + ((pu+1)&n_size_m1)] +
+			    fu_m*fv*  Octaves[octave*n_size_sq + ((pv+1)&n_size_m1)*n_size + ((pu)  &n_size_m1)] +
+			    fu*  fv*  Octaves[octave*n_size_sq + ((pv+1)&n_size_m1)*n_size + ((pu+1)&n_size_m1)];
 
 		return o >> (upsamplepower+upsamplepower);
 	}
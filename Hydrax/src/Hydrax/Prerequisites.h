@@ -52,4 +52,23 @@ http://www.gnu.org/copyleft/lesser.txt.
 #define HYDRAX_IMAGE_CHECK_PIXELS 0 // See Image.cpp, 1 = Check pixels / 0 = No check pixels
                                     // Use it for debug mode only
 
+/// SSE code paths, define HYDRAX_USE_SSE to 0 before including Hydrax for use the scalar paths
+#ifndef HYDRAX_USE_SSE
+   #if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+     #define HYDRAX_USE_SSE 1
+   #else
+     #define HYDRAX_USE_SSE 0
+   #endif
+#endif
+
+/// Worker threads (see ThreadPool.h), define HYDRAX_THREAD_SUPPORT to 0 before including Hydrax for 
+/// execute all tasks in the calling thread. Threads are implemented with boost, like Ogre does.
+#ifndef HYDRAX_THREAD_SUPPORT
+   #if defined(OGRE_THREAD_SUPPORT) && OGRE_THREAD_SUPPORT
+     #define HYDRAX_THREAD_SUPPORT 1
+   #else
+     #define HYDRAX_THREAD_SUPPORT 0
+   #endif
+#endif
+
 #endif
@@ -130,6 +130,17 @@ namespace Hydrax
 		}
 	}
 
+	void RttManager::setActive(const bool& Active)
+	{
+		for (int k = 0; k < 6; k++)
+		{
+			if (!mTextures[k].isNull())
+			{
+				mTextures[k]->getBuffer()->getRenderTarget()->setActive(Active);
+			}
+		}
+	}
+
 	void RttManager::remove(const RttType& Rtt)
 	{
 		Ogre::TexturePtr &Tex = mTextures[Rtt];
@@ -466,6 +477,7 @@ namespace Hydrax
 		mCReflectionQueueListener.mActive = true;
 
         mHydrax->getMesh()->getEntity()->setVisible(false);
+        mHydrax->_setWaterBodiesVisible(false);
         
 		if (mHydrax->_isCurrentFrameUnderwater())
 		{
@@ -524,6 +536,7 @@ namespace Hydrax
 		Hydrax *mHydrax = mRttManager->mHydrax;
 
         mHydrax->getMesh()->getEntity()->setVisible(true);
+        mHydrax->_setWaterBodiesVisible(true);
 
 		if (mCameraPlaneDiff != 0)
 		{
@@ -578,6 +591,7 @@ namespace Hydrax
 		Hydrax *mHydrax = mRttManager->mHydrax;
 
         mHydrax->getMesh()->getEntity()->setVisible(false);
+        mHydrax->_setWaterBodiesVisible(false);
 		
 		if (Ogre::Math::Abs(mHydrax->getPosition().y - mHydrax->getCamera()->getDerivedPosition().y) > mHydrax->getPlanesError())
 		{
@@ -602,6 +616,7 @@ namespace Hydrax
 		Hydrax *mHydrax = mRttManager->mHydrax;
 
         mHydrax->getMesh()->getEntity()->setVisible(true);
+        mHydrax->_setWaterBodiesVisible(true);
 
 		if (Ogre::Math::Abs(mHydrax->getPosition().y - mHydrax->getCamera()->getDerivedPosition().y) > mHydrax->getPlanesError())
 		{
@@ -701,6 +716,8 @@ namespace Hydrax
 			mHydrax->getMesh()->getEntity()->setVisible(false);
 		}
 
+		mHydrax->_setWaterBodiesVisible(false);
+
 		mRttManager->_invokeRttListeners(RTT_DEPTH, true);
     }
 
@@ -738,6 +755,7 @@ namespace Hydrax
         }
 
         mHydrax->getMesh()->getEntity()->setVisible(true);
+        mHydrax->_setWaterBodiesVisible(true);
 		mHydrax->getGodRaysManager()->setVisible(false);
 		mHydrax->getMesh()->getEntity()->setRenderQueueGroup(Ogre::RENDER_QUEUE_1);
 
@@ -764,6 +782,7 @@ namespace Hydrax
 		Hydrax *mHydrax = mRttManager->mHydrax;
 
 		mHydrax->getMesh()->getEntity()->setVisible(false);
+		mHydrax->_setWaterBodiesVisible(false);
 
         Ogre::SceneManager::MovableObjectIterator EntityIterator = 
 			mHydrax->getSceneManager()->getMovableObjectIterator("Entity");
@@ -871,6 +890,7 @@ namespace Hydrax
         }
 
         mHydrax->getMesh()->getEntity()->setVisible(true);
+        mHydrax->_setWaterBodiesVisible(true);
 
 		if (mCameraPlaneDiff != 0)
 		{
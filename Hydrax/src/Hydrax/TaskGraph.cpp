@@ -0,0 +1,257 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#include "TaskGraph.h"
+
+namespace Hydrax
+{
+	TaskGraph::TaskGraph()
+		: mPendingNodes(0)
+		, mFinishedNodes(0)
+		, mScheduler(0)
+	{
+	}
+
+	void TaskGraph::clear()
+	{
+		mNodes.clear();
+		mCallingThreadNodes.clear();
+	}
+
+	int TaskGraph::addNode(ThreadPool::Task* t, const Affinity& a)
+	{
+		Node n;
+		n.mTask = t;
+		n.mAffinity = a;
+		n.mDependencies = 0;
+		n.mPendingDependencies = 0;
+
+		mNodes.push_back(n);
+
+		return static_cast<int>(mNodes.size())-1;
+	}
+
+	void TaskGraph::addDependency(const int& Node, const int& Dependency)
+	{
+		if (Node < 0 || Node >= getNumberOfNodes() || Dependency < 0 || Dependency >= getNumberOfNodes() || Node == Dependency)
+		{
+			HydraxLOG("Error in TaskGraph::addDependency: Invalid node index.");
+
+			return;
+		}
+
+		mNodes[Dependency].mSuccessors.push_back(Node);
+		mNodes[Node].mDependencies++;
+	}
+
+	void TaskGraph::execute(TaskScheduler* Scheduler)
+	{
+		if (mNodes.empty())
+		{
+			return;
+		}
+
+		std::vector<int> Ready;
+		int k, s;
+
+		for (k = 0; k < getNumberOfNodes(); k++)
+		{
+			mNodes[k].mPendingDependencies = mNodes[k].mDependencies;
+
+			if (mNodes[k].mDependencies == 0)
+			{
+				Ready.push_back(k);
+			}
+		}
+
+		// Check that all nodes are reachable, a cyclic graph would never be finished
+		std::vector<int> Sorted(Ready);
+
+		for (k = 0; k < static_cast<int>(Sorted.size()); k++)
+		{
+			const std::vector<int> &Successors = mNodes[Sorted[k]].mSuccessors;
+
+			for (s = 0; s < static_cast<int>(Successors.size()); s++)
+			{
+				if (--mNodes[Successors[s]].mPendingDependencies == 0)
+				{
+					Sorted.push_back(Successors[s]);
+				}
+			}
+		}
+
+		if (static_cast<int>(Sorted.size()) != getNumberOfNodes())
+		{
+			HydraxLOG("Error in TaskGraph::execute: Cyclic dependencies, the graph has not been executed.");
+
+			return;
+		}
+
+		for (k = 0; k < getNumberOfNodes(); k++)
+		{
+			mNodes[k].mPendingDependencies = mNodes[k].mDependencies;
+			mNodes[k].mNodeTask.mGraph = this;
+			mNodes[k].mNodeTask.mNode = k;
+		}
+
+		mScheduler = Scheduler;
+		mPendingNodes = getNumberOfNodes();
+		mFinishedNodes = 0;
+		mCallingThreadNodes.clear();
+
+		_startNodes(Ready);
+
+#if HYDRAX_THREAD_SUPPORT
+		boost::mutex::scoped_lock Lock(mMutex);
+
+		while (mPendingNodes > 0)
+		{
+			if (!mCallingThreadNodes.empty())
+			{
+				int n = mCallingThreadNodes.front();
+				mCallingThreadNodes.pop_front();
+
+				Lock.unlock();
+				_executeNode(n);
+				Lock.lock();
+
+				continue;
+			}
+
+			// Help the scheduler instead of sleeping
+			int Finished = mFinishedNodes;
+
+			Lock.unlock();
+			bool Helped = mScheduler && mScheduler->help();
+			Lock.lock();
+
+			if (!Helped && Finished == mFinishedNodes && mCallingThreadNodes.empty() && mPendingNodes > 0)
+			{
+				mNodeFinished.wait(Lock);
+			}
+		}
+#else
+		while (mPendingNodes > 0)
+		{
+			if (!mCallingThreadNodes.empty())
+			{
+				int n = mCallingThreadNodes.front();
+				mCallingThreadNodes.pop_front();
+
+				_executeNode(n);
+
+				continue;
+			}
+
+			if (!mScheduler || !mScheduler->help())
+			{
+				HydraxLOG("Error in TaskGraph::execute: The scheduler has not executed all the nodes.");
+
+				break;
+			}
+		}
+#endif
+
+		mScheduler = 0;
+	}
+
+	void TaskGraph::_executeNode(const int& n)
+	{
+		mNodes[n].mTask->execute();
+
+		std::vector<int> Ready;
+
+		{
+#if HYDRAX_THREAD_SUPPORT
+			boost::mutex::scoped_lock Lock(mMutex);
+#endif
+			const std::vector<int> &Successors = mNodes[n].mSuccessors;
+
+			for (unsigned int s = 0; s < Successors.size(); s++)
+			{
+				if (--mNodes[Successors[s]].mPendingDependencies == 0)
+				{
+					Ready.push_back(Successors[s]);
+				}
+			}
+		}
+
+		_startNodes(Ready);
+
+		// The calling thread can return from execute(...) as soon as the last node 
+		// is finished, so the graph mustn't be touched after this point
+#if HYDRAX_THREAD_SUPPORT
+		boost::mutex::scoped_lock Lock(mMutex);
+#endif
+		mPendingNodes--;
+		mFinishedNodes++;
+#if HYDRAX_THREAD_SUPPORT
+		mNodeFinished.notify_all();
+#endif
+	}
+
+	void TaskGraph::_startNodes(const std::vector<int>& Ready)
+	{
+		unsigned int k;
+
+		{
+#if HYDRAX_THREAD_SUPPORT
+			boost::mutex::scoped_lock Lock(mMutex);
+
+			bool CallingThreadNodes = false;
+#endif
+
+			for (k = 0; k < Ready.size(); k++)
+			{
+				if (!mScheduler || mNodes[Ready[k]].mAffinity == AFFINITY_CALLING_THREAD)
+				{
+					mCallingThreadNodes.push_back(Ready[k]);
+#if HYDRAX_THREAD_SUPPORT
+					CallingThreadNodes = true;
+#endif
+				}
+			}
+
+#if HYDRAX_THREAD_SUPPORT
+			if (CallingThreadNodes)
+			{
+				mNodeFinished.notify_all();
+			}
+#endif
+		}
+
+		if (!mScheduler)
+		{
+			return;
+		}
+
+		for (k = 0; k < Ready.size(); k++)
+		{
+			if (mNodes[Ready[k]].mAffinity == AFFINITY_ANY_THREAD)
+			{
+				mScheduler->schedule(&mNodes[Ready[k]].mNodeTask);
+			}
+		}
+	}
+}
@@ -0,0 +1,231 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#include "ThreadPool.h"
+
+namespace Hydrax
+{
+	ThreadPool::ThreadPool(const int& NumberOfThreads)
+		: mNumberOfThreads(0)
+#if HYDRAX_THREAD_SUPPORT
+		, mStopThreads(false)
+#endif
+	{
+		setNumberOfThreads(NumberOfThreads);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		_removeThreads();
+	}
+
+	void ThreadPool::setNumberOfThreads(const int& NumberOfThreads)
+	{
+		int Threads = std::max(NumberOfThreads, 0);
+
+		if (Threads == mNumberOfThreads)
+		{
+			return;
+		}
+
+		_removeThreads();
+
+		mNumberOfThreads = Threads;
+
+		_createThreads();
+	}
+
+	void ThreadPool::addTask(Task* t, TaskGroup& Group)
+	{
+#if HYDRAX_THREAD_SUPPORT
+		if (mNumberOfThreads > 0)
+		{
+			QueuedTask q;
+			q.mTask  = t;
+			q.mGroup = &Group;
+
+			boost::mutex::scoped_lock Lock(mMutex);
+
+			Group.mPendingTasks++;
+			mTasks.push_back(q);
+
+			mTaskAdded.notify_one();
+
+			return;
+		}
+#else
+		// Without thread support tasks are executed in place
+		(void)Group;
+#endif
+
+		t->execute();
+	}
+
+	void ThreadPool::wait(TaskGroup& Group)
+	{
+#if HYDRAX_THREAD_SUPPORT
+		boost::mutex::scoped_lock Lock(mMutex);
+
+		while (Group.mPendingTasks > 0)
+		{
+			// Help the worker threads instead of sleeping
+			if (!mTasks.empty())
+			{
+				QueuedTask q = mTasks.front();
+				mTasks.pop_front();
+
+				Lock.unlock();
+				q.mTask->execute();
+				Lock.lock();
+
+				q.mGroup->mPendingTasks--;
+				mTaskFinished.notify_all();
+			}
+			else
+			{
+				mTaskFinished.wait(Lock);
+			}
+		}
+#else
+		(void)Group;
+#endif
+	}
+
+	bool ThreadPool::executeQueuedTask()
+	{
+#if HYDRAX_THREAD_SUPPORT
+		boost::mutex::scoped_lock Lock(mMutex);
+
+		if (mTasks.empty())
+		{
+			return false;
+		}
+
+		QueuedTask q = mTasks.front();
+		mTasks.pop_front();
+
+		Lock.unlock();
+		q.mTask->execute();
+		Lock.lock();
+
+		q.mGroup->mPendingTasks--;
+		mTaskFinished.notify_all();
+
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void ThreadPool::parallelFor(ParallelTask* t, const int& NumberOfChunks)
+	{
+		if (NumberOfChunks <= 0)
+		{
+			return;
+		}
+
+		TaskGroup Group;
+		std::vector<ChunkTask> Chunks(NumberOfChunks);
+
+		for (int k = 1; k < NumberOfChunks; k++)
+		{
+			Chunks[k].mParallelTask = t;
+			Chunks[k].mChunk = k;
+
+			addTask(&Chunks[k], Group);
+		}
+
+		t->execute(0);
+
+		wait(Group);
+	}
+
+	void ThreadPool::_createThreads()
+	{
+#if HYDRAX_THREAD_SUPPORT
+		mStopThreads = false;
+
+		for (int k = 0; k < mNumberOfThreads; k++)
+		{
+			WorkerFunctor f;
+			f.mThreadPool = this;
+
+			mThreads.push_back(new boost::thread(f));
+		}
+#endif
+	}
+
+	void ThreadPool::_removeThreads()
+	{
+#if HYDRAX_THREAD_SUPPORT
+		{
+			boost::mutex::scoped_lock Lock(mMutex);
+
+			mStopThreads = true;
+			mTaskAdded.notify_all();
+		}
+
+		for (unsigned int k = 0; k < mThreads.size(); k++)
+		{
+			mThreads[k]->join();
+			delete mThreads[k];
+		}
+
+		mThreads.clear();
+#endif
+	}
+
+	void ThreadPool::_workerLoop()
+	{
+#if HYDRAX_THREAD_SUPPORT
+		boost::mutex::scoped_lock Lock(mMutex);
+
+		while (true)
+		{
+			// Queued tasks are finished before stopping
+			if (mTasks.empty())
+			{
+				if (mStopThreads)
+				{
+					return;
+				}
+
+				mTaskAdded.wait(Lock);
+
+				continue;
+			}
+
+			QueuedTask q = mTasks.front();
+			mTasks.pop_front();
+
+			Lock.unlock();
+			q.mTask->execute();
+			Lock.lock();
+
+			q.mGroup->mPendingTasks--;
+			mTaskFinished.notify_all();
+		}
+#endif
+	}
+}
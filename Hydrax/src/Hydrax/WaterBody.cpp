@@ -0,0 +1,198 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#include "WaterBody.h"
+
+#include "Hydrax.h"
+
+namespace Hydrax
+{
+	WaterBody::WaterBody(Hydrax *h, const Ogre::String &Name, const Ogre::Vector3 &Position)
+		: mName(Name)
+		, mPosition(Position)
+		, mVisible(true)
+		, mCreated(false)
+		, mMesh(0)
+		, mModule(0)
+		, mHydrax(h)
+	{
+		mMesh = new Mesh(mHydrax, this);
+	}
+
+	WaterBody::~WaterBody()
+	{
+		remove();
+
+		if (mModule)
+		{
+			delete mModule;
+		}
+
+		delete mMesh;
+	}
+
+	bool WaterBody::setModule(Module::Module* Module, const bool& DeleteOldModule)
+	{
+		Module::Module *MainModule = mHydrax->getModule();
+
+		if (!MainModule)
+		{
+			HydraxLOG("WaterBody::setModule(...): The main water module must be set before, skipping...");
+
+			return false;
+		}
+
+		if (Module->getMeshOptions().MeshSize.Width <= 0 || Module->getMeshOptions().MeshSize.Height <= 0)
+		{
+			HydraxLOG("WaterBody::setModule(...): " + Module->getName() + " is an infinite module, water bodies must be finite, skipping...");
+
+			return false;
+		}
+
+		if (Module->getNormalMode() == MaterialManager::NM_RTT || Module->getNormalMode() != MainModule->getNormalMode())
+		{
+			HydraxLOG("WaterBody::setModule(...): Water bodies use the main water material, the module normal mode must be the main module one and can't be NM_RTT, skipping...");
+
+			return false;
+		}
+
+		bool Created = mCreated;
+
+		remove();
+
+		if (mModule)
+		{
+			if (DeleteOldModule)
+			{
+				delete mModule;
+			}
+			else
+			{
+				mModule->_setWaterBody(0);
+			}
+		}
+
+		mModule = Module;
+		mModule->_setWaterBody(this);
+		mModule->_setNoiseShared(mModule->getNoise() == MainModule->getNoise());
+
+		if (Created || mHydrax->isCreated())
+		{
+			create();
+		}
+
+		return true;
+	}
+
+	void WaterBody::create()
+	{
+		if (mCreated || !mModule)
+		{
+			return;
+		}
+
+		mModule->create();
+
+		mMesh->setOptions(mModule->getMeshOptions());
+		mMesh->setMaterialName(mHydrax->getMaterialManager()->getMaterial(MaterialManager::MAT_WATER)->getName());
+		mMesh->create();
+
+		mCreated = true;
+
+		_checkVisible();
+	}
+
+	void WaterBody::remove()
+	{
+		if (!mCreated)
+		{
+			return;
+		}
+
+		mMesh->remove();
+		mModule->remove();
+
+		mCreated = false;
+	}
+
+	void WaterBody::update(const Ogre::Real &timeSinceLastFrame)
+	{
+		if (!mCreated || !mVisible)
+		{
+			return;
+		}
+
+		mModule->update(timeSinceLastFrame);
+	}
+
+	void WaterBody::setPosition(const Ogre::Vector3 &Position)
+	{
+		mPosition = Position;
+
+		if (!mCreated)
+		{
+			return;
+		}
+
+		mMesh->getSceneNode()->setPosition(Position.x-mMesh->getSize().Width/2, Position.y, Position.z-mMesh->getSize().Height/2);
+		mMesh->_notifyTransformChanged();
+	}
+
+	void WaterBody::setVisible(const bool& Visible)
+	{
+		mVisible = Visible;
+
+		_checkVisible();
+	}
+
+	void WaterBody::_checkVisible()
+	{
+		if (!mCreated)
+		{
+			return;
+		}
+
+		mMesh->getSceneNode()->setVisible(mVisible && mHydrax->isVisible() && !mHydrax->isDormant());
+	}
+
+	float WaterBody::getHeigth(const Ogre::Vector2 &Position)
+	{
+		if (!mCreated)
+		{
+			return -1;
+		}
+
+		return mModule->getHeigth(Position);
+	}
+
+	bool WaterBody::_isInFrustum(Ogre::Camera *c)
+	{
+		if (!mCreated || !mVisible)
+		{
+			return false;
+		}
+
+		return c->isVisible(mMesh->getEntity()->getWorldBoundingBox(true));
+	}
+}
@@ -0,0 +1,232 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2008 Xavier Vergun Gonzlez <xavierverguin@hotmail.com>
+                                           <xavyiy@gmail.com>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#include "WaterState.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+
+#define _Hydrax_AtomicIncrement(v)   _InterlockedIncrement(v)
+#define _Hydrax_AtomicDecrement(v)   _InterlockedDecrement(v)
+#define _Hydrax_AtomicExchange(v, n) _InterlockedExchange(v, n)
+#define _Hydrax_AtomicRelease(v)     _InterlockedExchange(v, 0)
+#elif defined(__GNUC__)
+#define _Hydrax_AtomicIncrement(v)   __sync_add_and_fetch(v, 1)
+#define _Hydrax_AtomicDecrement(v)   __sync_sub_and_fetch(v, 1)
+// __sync_lock_test_and_set is only an acquire barrier, locks must be released with __sync_lock_release
+#define _Hydrax_AtomicExchange(v, n) __sync_lock_test_and_set(v, n)
+#define _Hydrax_AtomicRelease(v)     __sync_lock_release(v)
+#else
+#error "Hydrax::WaterStatePtr needs atomic operations for this compiler"
+#endif
+
+namespace Hydrax
+{
+	WaterState::WaterState(Noise::Noise::Snapshot *NoiseSnapshot, const float &WaterHeigth, const float &Strength)
+		: mNoiseSnapshot(NoiseSnapshot)
+		, mWaterHeigth(WaterHeigth)
+		, mStrength(Strength)
+		, mInfinite(true)
+		, mGridTransformX(Ogre::Vector3::ZERO)
+		, mGridTransformY(Ogre::Vector3::ZERO)
+		, mGridSize(Size(0))
+		, mReferences(0)
+	{
+	}
+
+	WaterState::WaterState(Noise::Noise::Snapshot *NoiseSnapshot, const float &WaterHeigth, const float &Strength,
+		                   const Ogre::Vector3 &GridTransformX, const Ogre::Vector3 &GridTransformY, const Size &GridSize)
+		: mNoiseSnapshot(NoiseSnapshot)
+		, mWaterHeigth(WaterHeigth)
+		, mStrength(Strength)
+		, mInfinite(false)
+		, mGridTransformX(GridTransformX)
+		, mGridTransformY(GridTransformY)
+		, mGridSize(GridSize)
+		, mReferences(0)
+	{
+	}
+
+	WaterState::~WaterState()
+	{
+		delete mNoiseSnapshot;
+	}
+
+	float WaterState::getHeigth(const Ogre::Vector2 &Position, bool *Valid) const
+	{
+		float Heigth;
+
+		getHeigths(&Position, &Heigth, 1, Valid);
+
+		return Heigth;
+	}
+
+	void WaterState::getHeigths(const Ogre::Vector2 *Positions, float *Heigths, const int &Count, bool *Valid) const
+	{
+		const int ChunkSize = 256;
+
+		float X[ChunkSize], Y[ChunkSize];
+		bool InGrid[ChunkSize];
+		int First, n, k;
+
+		for (First = 0; First < Count; First += ChunkSize)
+		{
+			n = std::min(ChunkSize, Count-First);
+
+			if (mInfinite)
+			{
+				for (k = 0; k < n; k++)
+				{
+					X[k] = Positions[First+k].x;
+					Y[k] = Positions[First+k].y;
+					InGrid[k] = true;
+				}
+			}
+			else
+			{
+				// World-space -> [0,1] grid-space -> object-space
+				for (k = 0; k < n; k++)
+				{
+					float x = mGridTransformX.x*Positions[First+k].x + mGridTransformX.y*Positions[First+k].y + mGridTransformX.z,
+						  y = mGridTransformY.x*Positions[First+k].x + mGridTransformY.y*Positions[First+k].y + mGridTransformY.z;
+
+					InGrid[k] = x >= 0 && x <= 1 && y >= 0 && y <= 1;
+
+					X[k] = x*mGridSize.Width;
+					Y[k] = y*mGridSize.Height;
+				}
+			}
+
+			mNoiseSnapshot->getValues(X, Y, n, Heigths+First, 0, 0, mStrength);
+
+			for (k = 0; k < n; k++)
+			{
+				Heigths[First+k] = mWaterHeigth + (InGrid[k] ? Heigths[First+k] : 0);
+
+				if (Valid)
+				{
+					Valid[First+k] = InGrid[k];
+				}
+			}
+		}
+	}
+
+	WaterStatePtr::WaterStatePtr()
+		: mState(0)
+	{
+	}
+
+	WaterStatePtr::WaterStatePtr(WaterState *State)
+		: mState(0)
+	{
+		bind(State);
+	}
+
+	WaterStatePtr::WaterStatePtr(const WaterStatePtr &Other)
+		: mState(Other.mState)
+	{
+		if (mState)
+		{
+			_Hydrax_AtomicIncrement(&mState->mReferences);
+		}
+	}
+
+	WaterStatePtr::~WaterStatePtr()
+	{
+		setNull();
+	}
+
+	WaterStatePtr& WaterStatePtr::operator=(const WaterStatePtr &Other)
+	{
+		// Copy first, Other can be released by setNull()
+		WaterStatePtr Tmp(Other);
+
+		swap(Tmp);
+
+		return *this;
+	}
+
+	void WaterStatePtr::bind(WaterState *State)
+	{
+		setNull();
+
+		mState = State;
+
+		if (mState)
+		{
+			_Hydrax_AtomicIncrement(&mState->mReferences);
+		}
+	}
+
+	void WaterStatePtr::setNull()
+	{
+		if (mState && _Hydrax_AtomicDecrement(&mState->mReferences) == 0)
+		{
+			delete mState;
+		}
+
+		mState = 0;
+	}
+
+	void WaterStatePtr::swap(WaterStatePtr &Other)
+	{
+		std::swap(mState, Other.mState);
+	}
+
+	WaterStateSlot::WaterStateSlot()
+		: mLock(0)
+	{
+	}
+
+	WaterStatePtr WaterStateSlot::get()
+	{
+		while (_Hydrax_AtomicExchange(&mLock, 1))
+		{
+		}
+
+		// The slot references the state, so it can't be deleted while it's copied
+		WaterStatePtr State(mState);
+
+		_Hydrax_AtomicRelease(&mLock);
+
+		return State;
+	}
+
+	void WaterStateSlot::set(const WaterStatePtr &State)
+	{
+		WaterStatePtr Tmp(State);
+
+		while (_Hydrax_AtomicExchange(&mLock, 1))
+		{
+		}
+
+		mState.swap(Tmp);
+
+		_Hydrax_AtomicRelease(&mLock);
+
+		// Tmp releases the old state here, out of the lock
+	}
+}